@@ -51,6 +51,10 @@
   " -f --download           path for the downloader destination\n" \
   " -c --commit-int         commits interval\n" \
   " -p --parser             number of parsers\n" \
+  " -w --walker             number of scanner walkers\n" \
+  " -u --dircache           skip the unchanged directories\n" \
+  " -o --watch              watch the changes after the first loop\n" \
+  " -x --file-index         keep the files state in memory\n" \
   " -n --decrap             enable decrapifier (for title metadata)\n" \
   " -k --keyword            keyword for the decrapifier\n" \
   " -s --suffix             file suffix (extension)\n" \
@@ -64,7 +68,7 @@
   " $ " APPNAME " -l 2 -t 5 -d ./mydb.db -p 1 -a 15 -s ogg -s mp3 /home/foobar/music\n" \
   "\n" \
   "Default values are loop=1, timewait=0, database=./valhalla.db,\n" \
-  "                   commit-int=128, parser=2, priority=19,\n" \
+  "                   commit-int=128, parser=2, walker=1, priority=19,\n" \
   "                   suffix=flac,m4a,mp3,ogg,wav,wma\n" \
   "                          avi,mkv,mov,mpg,wmv\n" \
   "                          bmp,gif,jpeg,jpg,png,tga,tif,tiff\n" \
@@ -121,16 +125,18 @@ main (int argc, char **argv)
   const char *grabber = NULL;
   const char *metadata = NULL;
 #endif /* USE_GRABBER */
-  int parser_nb = 2, grabber_nb = 4, sid = 0, kid = 0, gid = 0;
+  int parser_nb = 2, grabber_nb = 4, scanner_nb = 1;
+  int sid = 0, kid = 0, gid = 0;
   const char *suffix[SUFFIX_MAX];
   const char *keyword[KEYWORD_MAX];
   const char *grabbers[GRABBER_MAX];
-  int nograbber = 0, stats = 0, metadata_cb = 0;
+  int nograbber = 0, stats = 0, metadata_cb = 0, dircache = 0;
+  int watch = 0, file_index = 0;
   struct timespec tss, tse, tsd;
   const char *group = NULL;
 
   int c, index;
-  const char *const short_options = "hvl:t:e:m:a:d:f:c:p:nk:s:g:r:ijq";
+  const char *const short_options = "hvl:t:e:m:a:d:f:c:p:w:uoxnk:s:g:r:ijq";
   const struct option long_options[] = {
     { "help",        no_argument,       0, 'h'  },
     { "verbose",     no_argument,       0, 'v'  },
@@ -143,6 +149,10 @@ main (int argc, char **argv)
     { "download",    required_argument, 0, 'f'  },
     { "commit-int",  required_argument, 0, 'c'  },
     { "parser",      required_argument, 0, 'p'  },
+    { "walker",      required_argument, 0, 'w'  },
+    { "dircache",    no_argument,       0, 'u'  },
+    { "watch",       no_argument,       0, 'o'  },
+    { "file-index",  no_argument,       0, 'x'  },
     { "decrap",      no_argument,       0, 'n'  },
     { "keyword",     required_argument, 0, 'k'  },
     { "suffix",      required_argument, 0, 's'  },
@@ -214,6 +224,22 @@ main (int argc, char **argv)
       parser_nb = atoi (optarg);
       break;
 
+    case 'w':
+      scanner_nb = atoi (optarg);
+      break;
+
+    case 'u':
+      dircache = 1;
+      break;
+
+    case 'o':
+      watch = 1;
+      break;
+
+    case 'x':
+      file_index = 1;
+      break;
+
     case 's':
       if (sid < SUFFIX_MAX)
         suffix[sid++] = optarg;
@@ -258,8 +284,10 @@ main (int argc, char **argv)
   memset (&param, 0, sizeof (param));
   param.parser_nb   = parser_nb;
   param.grabber_nb  = grabber_nb;
+  param.scanner_nb  = scanner_nb;
   param.commit_int  = commit;
   param.decrapifier = decrap;
+  param.file_index  = file_index;
   param.gl_cb       = eventgl_cb;
   param.md_cb       = metadata_cb ? eventmd_cb : NULL;
 
@@ -292,6 +320,12 @@ main (int argc, char **argv)
     printf ("\n");
   }
 
+  if (dircache)
+    valhalla_config_set (handle, SCANNER_DIRCACHE, 1);
+
+  if (watch)
+    valhalla_config_set (handle, SCANNER_WATCH, 1);
+
   for (i = 0; i < kid; i++)
   {
     valhalla_config_set (handle, PARSER_KEYWORD, keyword[i]);
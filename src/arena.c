@@ -0,0 +1,156 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_ALIGN(size)   (((size) + 15) & ~(size_t) 15)
+#define ARENA_CHUNK_MIN     1024
+#define ARENA_CHUNK_MAX     (16 * 1024)
+
+typedef struct arena_chunk_s {
+  struct arena_chunk_s *next;
+  size_t size;
+  size_t used;
+} arena_chunk_t;
+
+struct arena_s {
+  arena_chunk_t *chunk;     /* current chunk, the first is after the arena */
+  size_t         next_size; /* size of the next chunk */
+};
+
+#define ARENA_CHUNK_DATA(c) ((uint8_t *) (c) + ARENA_ALIGN (sizeof (*(c))))
+#define ARENA_CHUNK_FIRST(a) \
+  ((arena_chunk_t *) ((uint8_t *) (a) + ARENA_ALIGN (sizeof (arena_t))))
+
+
+arena_t *
+vh_arena_new (size_t size)
+{
+  arena_t *arena;
+  arena_chunk_t *chunk;
+
+  size  = ARENA_ALIGN (size);
+  arena = malloc (ARENA_ALIGN (sizeof (arena_t))
+                  + ARENA_ALIGN (sizeof (arena_chunk_t)) + size);
+  if (!arena)
+    return NULL;
+
+  chunk = ARENA_CHUNK_FIRST (arena);
+  chunk->next = NULL;
+  chunk->size = size;
+  chunk->used = 0;
+
+  arena->chunk     = chunk;
+  arena->next_size = ARENA_CHUNK_MIN;
+  return arena;
+}
+
+void
+vh_arena_free (arena_t *arena)
+{
+  arena_chunk_t *chunk, *next;
+
+  if (!arena)
+    return;
+
+  /* the first chunk is in the same block as the arena */
+  for (chunk = arena->chunk; chunk; chunk = next)
+  {
+    next = chunk->next;
+    if (chunk != ARENA_CHUNK_FIRST (arena))
+      free (chunk);
+  }
+
+  free (arena);
+}
+
+/*
+ * The memory is set to zero. Without arena, the memory is allocated with
+ * calloc() and must be released with free().
+ */
+void *
+vh_arena_alloc (arena_t *arena, size_t size)
+{
+  uint8_t *data;
+  arena_chunk_t *chunk;
+
+  if (!arena)
+    return calloc (1, size);
+
+  size  = ARENA_ALIGN (size);
+  chunk = arena->chunk;
+
+  if (chunk->size - chunk->used < size)
+  {
+    const int big = size > arena->next_size;
+    const size_t csize = big ? size : arena->next_size;
+
+    chunk = malloc (ARENA_ALIGN (sizeof (arena_chunk_t)) + csize);
+    if (!chunk)
+      return NULL;
+
+    chunk->size = csize;
+    chunk->used = 0;
+
+    /* a big allocation has its own chunk, the current one is kept */
+    if (big)
+    {
+      chunk->next = arena->chunk->next;
+      arena->chunk->next = chunk;
+    }
+    else
+    {
+      chunk->next  = arena->chunk;
+      arena->chunk = chunk;
+      if (arena->next_size < ARENA_CHUNK_MAX)
+        arena->next_size *= 2;
+    }
+  }
+
+  data = ARENA_CHUNK_DATA (chunk) + chunk->used;
+  chunk->used += size;
+  memset (data, 0, size);
+  return data;
+}
+
+/* Without arena, the string is allocated with strdup(). */
+char *
+vh_arena_strdup (arena_t *arena, const char *str)
+{
+  char *dup;
+  size_t len;
+
+  if (!str)
+    return NULL;
+
+  if (!arena)
+    return strdup (str);
+
+  len = strlen (str) + 1;
+  dup = vh_arena_alloc (arena, len);
+  if (dup)
+    memcpy (dup, str, len);
+  return dup;
+}
@@ -0,0 +1,40 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef VALHALLA_ARENA_H
+#define VALHALLA_ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Memory used by one file while it is handled by the threads. All the
+ * allocations are released in one shot by vh_arena_free(). An arena is
+ * not thread-safe, a file is handled by only one thread at a time.
+ */
+typedef struct arena_s arena_t;
+
+
+arena_t *vh_arena_new (size_t size);
+void vh_arena_free (arena_t *arena);
+void *vh_arena_alloc (arena_t *arena, size_t size);
+char *vh_arena_strdup (arena_t *arena, const char *str);
+
+#endif /* VALHALLA_ARENA_H */
@@ -22,6 +22,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <pthread.h>
 
 #include <sqlite3.h>
 
@@ -30,11 +32,37 @@
 #include "metadata.h"
 #include "sql_statements.h"
 #include "database.h"
+#include "file_index.h"
+#include "stats.h"
 #include "logs.h"
 
 
 #define SQL_BUFFER 8192
 
+/* Max id for the tables id -> enum (see database_id_table_init()). */
+#define DATABASE_ID_TABLE_MAX 4096
+
+/* Max number of values bound to a public selection. */
+#define SQL_BIND_MAX 512
+
+/* Time to wait [ms] when the database is locked by an other connection. */
+#define DATABASE_BUSY_TIMEOUT 10000
+
+/* Number of idle read-only connections kept open. */
+#define DATABASE_READERS_MAX  8
+
+/* Number of prepared statements kept by read-only connection. */
+#define DATABASE_CACHE_SIZE   16
+
+/* Number of results of counts kept until the next change of the database. */
+#define DATABASE_COUNTS_SIZE  32
+
+/* Max number of values read in the full-text index for a search. */
+#define DATABASE_SEARCH_VALUES 1000
+
+/* Number of VM instructions between two calls of the progress handler. */
+#define DATABASE_PROGRESS_OPS  1000
+
 typedef struct stmt_list_s {
   const char   *sql;
   sqlite3_stmt *stmt;
@@ -45,30 +73,127 @@ typedef struct item_list_s {
   const char *name;
 } item_list_t;
 
+/* Enums indexed by the ids of the tables (type, grp, lang). */
+typedef struct id_table_s {
+  int          *values;
+  unsigned int  size;
+} id_table_t;
+
+/*
+ * The SQL of a public selection contains only numbered parameters, then it
+ * is the key of the shape of the selection (operators of the restrictions,
+ * ids or texts, group, lang, file type, ...).
+ */
+typedef struct database_cache_s {
+  char         *sql;
+  sqlite3_stmt *stmt;
+  unsigned int  used; /* for LRU */
+} database_cache_t;
+
+typedef struct database_reader_s {
+  sqlite3          *db;
+  database_cache_t  cache[DATABASE_CACHE_SIZE];
+  unsigned int      tick;
+} database_reader_t;
+
+/* Rows of a count, shared by the cache and the statements. */
+typedef struct database_facet_s {
+  unsigned int            refs;
+  unsigned int            nb;
+  valhalla_db_countres_t *rows;
+} database_facet_t;
+
+/*
+ * The key is the SQL of the count with the values. The rows are valid only
+ * for the generation of the database where they are computed.
+ */
+typedef struct database_count_s {
+  char             *key;
+  database_facet_t *facet;
+  unsigned int      generation;
+  unsigned int      used; /* for LRU */
+} database_count_t;
+
 struct database_s {
   sqlite3      *db;
+  int           pragmas[DATABASE_PRAGMA_NB];
   char         *path;
   stmt_list_t  *stmts;
   item_list_t  *file_type;
   int64_t      *groups_id;
   int64_t      *langs_id;
+  id_table_t    file_type_tb;
+  id_table_t    groups_tb;
+  id_table_t    langs_tb;
+
+  /* Ids of the table 'meta' by atom (metadata_atom_t), 0 if unknown. */
+  int64_t      *metas_id;
+  unsigned int  metas_nb;
+
+  /* Full-text index, 0 if SQLite is compiled without FTS5. */
+  int            fts;
+  char         **search; /* metadata in the index, NULL for the default */
+
+  /* In-memory index of the table 'file', NULL if disabled. */
+  file_index_t    *files;
+  pthread_mutex_t  files_mutex;
+
+  /* Idle read-only connections for the public selections. */
+  database_reader_t *readers[DATABASE_READERS_MAX];
+  unsigned int       readers_nb;
+  pthread_mutex_t    readers_mutex;
+
+  /* Results of the counts, see database_commit_hook(). */
+  database_count_t counts[DATABASE_COUNTS_SIZE];
+  unsigned int     counts_tick;
+  unsigned int     generation;
+  int              commit;
+  pthread_mutex_t  counts_mutex;
+
+  /* database_progress_t of the thread, see vh_database_progress_set(). */
+  pthread_key_t progress;
+
+  vh_stats_cnt_t *st_cache_hit;
+  vh_stats_cnt_t *st_cache_miss;
 };
 
-#define VHSTMT_MAXCOLS  8
-
 struct valhalla_db_stmt_s {
   char         *sql;
   sqlite3_stmt *stmt;
+  database_t   *database;
+  sqlite3      *db;       /* read-only connection used by the statement */
+
+  database_reader_t *reader;  /* NULL with the main connection */
+  database_cache_t  *cache;   /* NULL if the statement is not cached */
+
+  /* For the resume token, 0 if the selection is not paginated. */
+  char               page_list;
+  valhalla_db_sort_t page_sort;
+
+  /* Rows of a count (already computed), NULL for the other selections. */
+  database_facet_t  *facet;
+  unsigned int       facet_pos;
 
   unsigned int  cnt;
-  const char   *cols[VHSTMT_MAXCOLS];
+  int           progress; /* 1 if a progress handler is set on the reader */
 
   union {
     valhalla_db_metares_t metares;
     valhalla_db_fileres_t fileres;
+    valhalla_db_filemetares_t filemetares;
+    valhalla_db_searchres_t searchres;
   } u;
 };
 
+/* Metadata in the full-text index if nothing is configured. */
+static const char *const g_search_meta[] = {
+  VALHALLA_METADATA_ALBUM,
+  VALHALLA_METADATA_ARTIST,
+  VALHALLA_METADATA_SYNOPSIS,
+  VALHALLA_METADATA_TITLE,
+  NULL
+};
+
 static const item_list_t g_file_type[] = {
   [VALHALLA_FILE_TYPE_NULL]     = { 0, "null"     },
   [VALHALLA_FILE_TYPE_AUDIO]    = { 0, "audio"    },
@@ -80,6 +205,7 @@ static const item_list_t g_file_type[] = {
 typedef enum database_stmt {
   STMT_SELECT_FILE_INTERRUP,
   STMT_SELECT_FILE_MTIME,
+  STMT_SELECT_FILE_MTIME_BATCH,
   STMT_SELECT_TYPE_ID,
   STMT_SELECT_META_ID,
   STMT_SELECT_DATA_ID,
@@ -87,6 +213,7 @@ typedef enum database_stmt {
   STMT_SELECT_GROUP_ID,
   STMT_SELECT_GRABBER_ID,
   STMT_SELECT_FILE_ID,
+  STMT_SELECT_FILE_INDEX,
   STMT_SELECT_FILE_ID_BY_META,
   STMT_SELECT_FILE_ID_BY_METADATA,
   STMT_SELECT_FILE_GRABBER_NAME,
@@ -102,12 +229,14 @@ typedef enum database_stmt {
   STMT_INSERT_DLCONTEXT,
   STMT_INSERT_ASSOC_FILE_METADATA,
   STMT_INSERT_ASSOC_FILE_GRABBER,
+  STMT_INSERT_DATA_FTS,
   STMT_UPDATE_FILE,
   STMT_UPDATE_ASSOC_FILE_METADATA,
   STMT_UPDATE_ASSOC_FILE_MD_P,
   STMT_UPDATE_ASSOC_FILE_MD_PM,
   STMT_UPDATE_ASSOC_FILE_MD_PMD,
   STMT_DELETE_FILE,
+  STMT_DELETE_FILE_DIR,
   STMT_DELETE_ASSOC_FILE_METADATA,
   STMT_DELETE_ASSOC_FILE_METADATA2,
   STMT_DELETE_ASSOC_FILE_GRABBER,
@@ -117,13 +246,21 @@ typedef enum database_stmt {
   STMT_CLEANUP_ASSOC_FILE_GRABBER,
   STMT_CLEANUP_META,
   STMT_CLEANUP_DATA,
+  STMT_CLEANUP_DATA_FTS,
   STMT_CLEANUP_GRABBER,
+  STMT_CLEANUP_FILE_CLEAR,
+  STMT_CLEANUP_META_CLEAR,
+  STMT_CLEANUP_DATA_CLEAR,
+  STMT_CLEANUP_GRABBER_CLEAR,
 
   STMT_UPDATE_FILE_CHECKED_CLEAR,
   STMT_SELECT_FILE_CHECKED_CLEAR,
   STMT_UPDATE_FILE_INTERRUP_CLEAR,
   STMT_UPDATE_FILE_INTERRUP_FIX,
   STMT_SELECT_FILE_OUTOFPATH_SET,
+  STMT_INSERT_DIR,
+  STMT_UPDATE_FILE_CHECKED_DIR,
+  STMT_DELETE_DIR,
   STMT_BEGIN_TRANSACTION,
   STMT_END_TRANSACTION,
 } database_stmt_t;
@@ -131,6 +268,7 @@ typedef enum database_stmt {
 static const stmt_list_t g_stmts[] = {
   [STMT_SELECT_FILE_INTERRUP]        = { SELECT_FILE_INTERRUP,        NULL },
   [STMT_SELECT_FILE_MTIME]           = { SELECT_FILE_MTIME,           NULL },
+  [STMT_SELECT_FILE_MTIME_BATCH]     = { SELECT_FILE_MTIME_BATCH,     NULL },
   [STMT_SELECT_TYPE_ID]              = { SELECT_TYPE_ID,              NULL },
   [STMT_SELECT_META_ID]              = { SELECT_META_ID,              NULL },
   [STMT_SELECT_DATA_ID]              = { SELECT_DATA_ID,              NULL },
@@ -138,6 +276,7 @@ static const stmt_list_t g_stmts[] = {
   [STMT_SELECT_GROUP_ID]             = { SELECT_GROUP_ID,             NULL },
   [STMT_SELECT_GRABBER_ID]           = { SELECT_GRABBER_ID,           NULL },
   [STMT_SELECT_FILE_ID]              = { SELECT_FILE_ID,              NULL },
+  [STMT_SELECT_FILE_INDEX]           = { SELECT_FILE_INDEX,           NULL },
   [STMT_SELECT_FILE_ID_BY_META]      = { SELECT_FILE_ID_BY_META,      NULL },
   [STMT_SELECT_FILE_ID_BY_METADATA]  = { SELECT_FILE_ID_BY_METADATA,  NULL },
   [STMT_SELECT_FILE_GRABBER_NAME]    = { SELECT_FILE_GRABBER_NAME,    NULL },
@@ -153,12 +292,14 @@ static const stmt_list_t g_stmts[] = {
   [STMT_INSERT_DLCONTEXT]            = { INSERT_DLCONTEXT,            NULL },
   [STMT_INSERT_ASSOC_FILE_METADATA]  = { INSERT_ASSOC_FILE_METADATA,  NULL },
   [STMT_INSERT_ASSOC_FILE_GRABBER]   = { INSERT_ASSOC_FILE_GRABBER,   NULL },
+  [STMT_INSERT_DATA_FTS]             = { INSERT_DATA_FTS,             NULL },
   [STMT_UPDATE_FILE]                 = { UPDATE_FILE,                 NULL },
   [STMT_UPDATE_ASSOC_FILE_METADATA]  = { UPDATE_ASSOC_FILE_METADATA,  NULL },
   [STMT_UPDATE_ASSOC_FILE_MD_P]      = { UPDATE_ASSOC_FILE_MD_P,      NULL },
   [STMT_UPDATE_ASSOC_FILE_MD_PM]     = { UPDATE_ASSOC_FILE_MD_PM,     NULL },
   [STMT_UPDATE_ASSOC_FILE_MD_PMD]    = { UPDATE_ASSOC_FILE_MD_PMD,    NULL },
   [STMT_DELETE_FILE]                 = { DELETE_FILE,                 NULL },
+  [STMT_DELETE_FILE_DIR]             = { DELETE_FILE_DIR,             NULL },
   [STMT_DELETE_ASSOC_FILE_METADATA]  = { DELETE_ASSOC_FILE_METADATA,  NULL },
   [STMT_DELETE_ASSOC_FILE_METADATA2] = { DELETE_ASSOC_FILE_METADATA2, NULL },
   [STMT_DELETE_ASSOC_FILE_GRABBER]   = { DELETE_ASSOC_FILE_GRABBER,   NULL },
@@ -168,13 +309,21 @@ static const stmt_list_t g_stmts[] = {
   [STMT_CLEANUP_ASSOC_FILE_GRABBER]  = { CLEANUP_ASSOC_FILE_GRABBER,  NULL },
   [STMT_CLEANUP_META]                = { CLEANUP_META,                NULL },
   [STMT_CLEANUP_DATA]                = { CLEANUP_DATA,                NULL },
+  [STMT_CLEANUP_DATA_FTS]            = { CLEANUP_DATA_FTS,            NULL },
   [STMT_CLEANUP_GRABBER]             = { CLEANUP_GRABBER,             NULL },
+  [STMT_CLEANUP_FILE_CLEAR]          = { CLEANUP_FILE_CLEAR,          NULL },
+  [STMT_CLEANUP_META_CLEAR]          = { CLEANUP_META_CLEAR,          NULL },
+  [STMT_CLEANUP_DATA_CLEAR]          = { CLEANUP_DATA_CLEAR,          NULL },
+  [STMT_CLEANUP_GRABBER_CLEAR]       = { CLEANUP_GRABBER_CLEAR,       NULL },
 
   [STMT_UPDATE_FILE_CHECKED_CLEAR]   = { UPDATE_FILE_CHECKED_CLEAR,   NULL },
   [STMT_SELECT_FILE_CHECKED_CLEAR]   = { SELECT_FILE_CHECKED_CLEAR,   NULL },
   [STMT_UPDATE_FILE_INTERRUP_CLEAR]  = { UPDATE_FILE_INTERRUP_CLEAR,  NULL },
   [STMT_UPDATE_FILE_INTERRUP_FIX]    = { UPDATE_FILE_INTERRUP_FIX,    NULL },
   [STMT_SELECT_FILE_OUTOFPATH_SET]   = { SELECT_FILE_OUTOFPATH_SET,   NULL },
+  [STMT_INSERT_DIR]                  = { INSERT_DIR,                  NULL },
+  [STMT_UPDATE_FILE_CHECKED_DIR]     = { UPDATE_FILE_CHECKED_DIR,     NULL },
+  [STMT_DELETE_DIR]                  = { DELETE_DIR,                  NULL },
   [STMT_BEGIN_TRANSACTION]           = { BEGIN_TRANSACTION,           NULL },
   [STMT_END_TRANSACTION]             = { END_TRANSACTION,             NULL },
 };
@@ -212,17 +361,381 @@ static const stmt_list_t g_stmts[] = {
 /*                                                                            */
 /******************************************************************************/
 
+static const char *const g_journal[] = {
+  [VALHALLA_DB_JOURNAL_WAL]      = "WAL",
+  [VALHALLA_DB_JOURNAL_DELETE]   = "DELETE",
+  [VALHALLA_DB_JOURNAL_TRUNCATE] = "TRUNCATE",
+  [VALHALLA_DB_JOURNAL_PERSIST]  = "PERSIST",
+  [VALHALLA_DB_JOURNAL_MEMORY]   = "MEMORY",
+  [VALHALLA_DB_JOURNAL_OFF]      = "OFF",
+};
+
+static int
+database_pragma_exec (sqlite3 *db, database_pragma_t pragma, int value)
+{
+  int res;
+  char sql[128];
+  char *m = NULL;
+
+  switch (pragma)
+  {
+  case DATABASE_PRAGMA_CACHE:
+    /* negative value for KiB instead of pages */
+    snprintf (sql, sizeof (sql), "PRAGMA cache_size = -%i;", value);
+    break;
+
+  case DATABASE_PRAGMA_JOURNAL:
+    snprintf (sql, sizeof (sql),
+              "PRAGMA journal_mode = %s;", g_journal[value]);
+    break;
+
+  case DATABASE_PRAGMA_MMAP:
+    snprintf (sql, sizeof (sql),
+              "PRAGMA mmap_size = %"PRIi64";", (int64_t) value << 20);
+    break;
+
+  case DATABASE_PRAGMA_SYNC:
+    snprintf (sql, sizeof (sql), "PRAGMA synchronous = %i;", value);
+    break;
+
+  case DATABASE_PRAGMA_TEMPSTORE:
+    snprintf (sql, sizeof (sql), "PRAGMA temp_store = %i;", value);
+    break;
+
+  default:
+    return -1;
+  }
+
+  res = sqlite3_exec (db, sql, NULL, NULL, &m);
+  if (res != SQLITE_OK)
+  {
+    vh_log (VALHALLA_MSG_ERROR, "%s - query: %s", m, sql);
+    sqlite3_free (m);
+    return -1;
+  }
+
+  return 0;
+}
+
+static void
+database_reader_close (database_reader_t *reader)
+{
+  unsigned int i;
+
+  for (i = 0; i < DATABASE_CACHE_SIZE; i++)
+  {
+    if (!reader->cache[i].sql)
+      continue;
+
+    sqlite3_finalize (reader->cache[i].stmt);
+    free (reader->cache[i].sql);
+  }
+
+  sqlite3_close (reader->db);
+  free (reader);
+}
+
+/*
+ * The public selections use their own read-only connections, then they are
+ * not serialized with the transactions of the dbmanager (with WAL). The data
+ * are visible on these connections only when they are committed. A
+ * connection (and then its cached statements) is used by only one
+ * statement at a time.
+ */
+static database_reader_t *
+database_reader_get (database_t *database)
+{
+  int res;
+  unsigned int i;
+  database_reader_t *reader = NULL;
+
+  /* a new connection on an in-memory database is an other database */
+  if (!*database->path || !strcmp (database->path, ":memory:"))
+    return NULL;
+
+  pthread_mutex_lock (&database->readers_mutex);
+  if (database->readers_nb)
+    reader = database->readers[--database->readers_nb];
+  pthread_mutex_unlock (&database->readers_mutex);
+
+  if (reader)
+    return reader;
+
+  reader = calloc (1, sizeof (database_reader_t));
+  if (!reader)
+    return NULL;
+
+  res = sqlite3_open_v2 (database->path, &reader->db,
+                         SQLITE_OPEN_READONLY, NULL);
+  if (res != SQLITE_OK)
+  {
+    vh_log (VALHALLA_MSG_WARNING, "Can't open a read-only connection: %s",
+            sqlite3_errmsg (reader->db));
+    database_reader_close (reader);
+    return NULL;
+  }
+
+  sqlite3_busy_timeout (reader->db, DATABASE_BUSY_TIMEOUT);
+
+  /* the pragmas which are specific to the connection */
+  for (i = 0; i < DATABASE_PRAGMA_NB; i++)
+    if (database->pragmas[i] >= 0
+        && i != DATABASE_PRAGMA_JOURNAL && i != DATABASE_PRAGMA_SYNC)
+      database_pragma_exec (reader->db, i, database->pragmas[i]);
+
+  return reader;
+}
+
+static void
+database_reader_release (database_t *database, database_reader_t *reader)
+{
+  if (!reader)
+    return;
+
+  pthread_mutex_lock (&database->readers_mutex);
+  if (database->readers_nb < DATABASE_READERS_MAX)
+  {
+    database->readers[database->readers_nb++] = reader;
+    reader = NULL;
+  }
+  pthread_mutex_unlock (&database->readers_mutex);
+
+  /* too many idle connections */
+  if (reader)
+    database_reader_close (reader);
+}
+
+/* Only the idle connections are closed. */
+static void
+database_readers_close (database_t *database)
+{
+  pthread_mutex_lock (&database->readers_mutex);
+  while (database->readers_nb)
+    database_reader_close (database->readers[--database->readers_nb]);
+  pthread_mutex_unlock (&database->readers_mutex);
+}
+
+static database_cache_t *
+database_cache_get (database_reader_t *reader, const char *sql)
+{
+  unsigned int i;
+
+  for (i = 0; i < DATABASE_CACHE_SIZE; i++)
+    if (reader->cache[i].sql && !strcmp (reader->cache[i].sql, sql))
+    {
+      reader->cache[i].used = ++reader->tick;
+      return &reader->cache[i];
+    }
+
+  return NULL;
+}
+
+/* The least recently used statement is replaced. */
+static database_cache_t *
+database_cache_add (database_reader_t *reader,
+                    const char *sql, sqlite3_stmt *stmt)
+{
+  unsigned int i;
+  database_cache_t *cache = &reader->cache[0];
+  char *dup;
+
+  dup = strdup (sql);
+  if (!dup)
+    return NULL;
+
+  for (i = 1; i < DATABASE_CACHE_SIZE && cache->sql; i++)
+    if (!reader->cache[i].sql || reader->cache[i].used < cache->used)
+      cache = &reader->cache[i];
+
+  if (cache->sql)
+  {
+    sqlite3_finalize (cache->stmt);
+    free (cache->sql);
+  }
+
+  cache->sql  = dup;
+  cache->stmt = stmt;
+  cache->used = ++reader->tick;
+  return cache;
+}
+
+static void
+database_facet_free (database_facet_t *facet)
+{
+  unsigned int i;
+
+  for (i = 0; i < facet->nb; i++)
+    if (facet->rows[i].data_value)
+      free ((char *) facet->rows[i].data_value);
+  if (facet->rows)
+    free (facet->rows);
+  free (facet);
+}
+
+/* The rows are freed with the last reference. */
+static void
+database_facet_release (database_t *database, database_facet_t *facet)
+{
+  unsigned int refs;
+
+  if (!facet)
+    return;
+
+  pthread_mutex_lock (&database->counts_mutex);
+  refs = --facet->refs;
+  pthread_mutex_unlock (&database->counts_mutex);
+
+  if (!refs)
+    database_facet_free (facet);
+}
+
+static unsigned int
+database_generation_get (database_t *database)
+{
+  unsigned int generation;
+
+  pthread_mutex_lock (&database->counts_mutex);
+  generation = database->generation;
+  pthread_mutex_unlock (&database->counts_mutex);
+  return generation;
+}
+
+static void
+database_generation_inc (database_t *database)
+{
+  pthread_mutex_lock (&database->counts_mutex);
+  database->generation++;
+  pthread_mutex_unlock (&database->counts_mutex);
+}
+
+static database_facet_t *
+database_count_get (database_t *database, const char *key)
+{
+  unsigned int i;
+  database_facet_t *facet = NULL;
+
+  pthread_mutex_lock (&database->counts_mutex);
+  for (i = 0; i < DATABASE_COUNTS_SIZE; i++)
+  {
+    database_count_t *count = &database->counts[i];
+
+    if (!count->key || count->generation != database->generation
+        || strcmp (count->key, key))
+      continue;
+
+    count->used = ++database->counts_tick;
+    facet = count->facet;
+    facet->refs++;
+    break;
+  }
+  pthread_mutex_unlock (&database->counts_mutex);
+
+  return facet;
+}
+
+/* The outdated or the least recently used results are replaced. */
+static void
+database_count_add (database_t *database, const char *key,
+                    database_facet_t *facet, unsigned int generation)
+{
+  unsigned int i;
+  char *dup;
+  database_count_t *count = &database->counts[0];
+  database_facet_t *old = NULL;
+
+  dup = strdup (key);
+  if (!dup)
+    return;
+
+  pthread_mutex_lock (&database->counts_mutex);
+
+  /* the database has changed while the rows were read */
+  if (generation != database->generation)
+  {
+    pthread_mutex_unlock (&database->counts_mutex);
+    free (dup);
+    return;
+  }
+
+  for (i = 0; i < DATABASE_COUNTS_SIZE; i++)
+  {
+    database_count_t *it = &database->counts[i];
+
+    if (!it->key || it->generation != generation)
+    {
+      count = it;
+      break;
+    }
+
+    if (it->used < count->used)
+      count = it;
+  }
+
+  if (count->key)
+  {
+    free (count->key);
+    old = count->facet;
+    if (--old->refs)
+      old = NULL;
+  }
+
+  facet->refs++;
+  count->key        = dup;
+  count->facet      = facet;
+  count->generation = generation;
+  count->used       = ++database->counts_tick;
+
+  pthread_mutex_unlock (&database->counts_mutex);
+
+  if (old)
+    database_facet_free (old);
+}
+
+static void
+database_counts_free (database_t *database)
+{
+  unsigned int i;
+
+  for (i = 0; i < DATABASE_COUNTS_SIZE; i++)
+  {
+    database_count_t *count = &database->counts[i];
+
+    if (!count->key)
+      continue;
+
+    free (count->key);
+    database_facet_release (database, count->facet);
+  }
+}
+
 static void
 database_vhstmt_free (valhalla_db_stmt_t *vhstmt)
 {
   if (!vhstmt)
     return;
 
+  /* the cached statement is kept for the next selection */
+  if (vhstmt->cache)
+  {
+    sqlite3_reset (vhstmt->stmt);
+    sqlite3_clear_bindings (vhstmt->stmt);
+  }
+  else if (vhstmt->stmt)
+    sqlite3_finalize (vhstmt->stmt);
+
+  if (vhstmt->progress)
+    sqlite3_progress_handler (vhstmt->db, 0, NULL, NULL);
+
+  database_reader_release (vhstmt->database, vhstmt->reader);
+  database_facet_release (vhstmt->database, vhstmt->facet);
   if (vhstmt->sql)
     free (vhstmt->sql);
   free (vhstmt);
 }
 
+#define VHSTMT_INT64(v, c) sqlite3_column_int64 ((v)->stmt, c)
+#define VHSTMT_TEXT(v, c)  ((const char *) sqlite3_column_text ((v)->stmt, c))
+
 /*
  * This function is a replacement of sqlite3_exec() which should not be used
  * anymore. Only one SQL query must be passed in the argument.
@@ -241,44 +754,94 @@ database_sql_exec (sqlite3 *db, const char *sql,
   if (!stmt)
   {
     res = sqlite3_prepare_v2 (db, sql, -1, &stmt, NULL);
+    if (vhstmt)
+      vhstmt->stmt = stmt;
     if (res != SQLITE_OK)
       goto out;
   }
 
   res = sqlite3_step (stmt);
+  /* the columns are read with VHSTMT_INT64() and VHSTMT_TEXT() */
   if (res == SQLITE_ROW && vhstmt)
   {
-    unsigned int i;
-
-    vhstmt->stmt = stmt;
-    vhstmt->cnt  = sqlite3_column_count (stmt);
-    for (i = 0; i < vhstmt->cnt && i < VHSTMT_MAXCOLS; i++)
-      vhstmt->cols[i] = (const char *) sqlite3_column_text (stmt, i);
-
+    vhstmt->cnt = sqlite3_column_count (stmt);
     return 0;
   }
 
  out:
-  if (res != SQLITE_DONE && res != SQLITE_OK)
+  /* an interrupted statement is not an error, see vh_database_progress_set */
+  if (res != SQLITE_DONE && res != SQLITE_OK && res != SQLITE_INTERRUPT)
   {
     const char *err = sqlite3_errmsg (db);
     if (err)
       *errmsg = strdup (err);
   }
 
-  database_vhstmt_free (vhstmt);
-  sqlite3_finalize (stmt);
+  /* the statement is released with vhstmt */
+  if (vhstmt)
+    database_vhstmt_free (vhstmt);
+  else
+    sqlite3_finalize (stmt);
   return 1;
 }
 
+/*
+ * The ids of these tables are small because the rows are inserted only
+ * with the init. The table is not created for an unexpected big id and the
+ * lookups fall back to a linear search.
+ */
+static int
+database_id_table_init (id_table_t *table, const int64_t *ids, unsigned int nb)
+{
+  unsigned int i;
+  int64_t max = 0;
+
+  for (i = 0; i < nb; i++)
+    if (ids[i] > max)
+      max = ids[i];
+
+  if (max >= DATABASE_ID_TABLE_MAX)
+    return -1;
+
+  table->values = malloc ((max + 1) * sizeof (*table->values));
+  if (!table->values)
+    return -1;
+
+  table->size = max + 1;
+  for (i = 0; i < table->size; i++)
+    table->values[i] = -1;
+
+  for (i = 0; i < nb; i++)
+    if (ids[i] >= 0)
+      table->values[ids[i]] = i;
+
+  return 0;
+}
+
+static inline int
+database_id_table_get (const id_table_t *table, int64_t id)
+{
+  if (!table->values || id < 0 || id >= table->size)
+    return -1;
+
+  return table->values[id];
+}
+
 static valhalla_meta_grp_t
 database_group_get (database_t *database, int64_t id)
 {
+  int value;
   unsigned int i;
 
   if (!database)
     return VALHALLA_META_GRP_NIL;
 
+  value = database_id_table_get (&database->groups_tb, id);
+  if (value >= 0)
+    return value;
+  if (database->groups_tb.values)
+    return VALHALLA_META_GRP_NIL;
+
   for (i = 0; i < vh_metadata_group_size; i++)
     if (database->groups_id[i] == id)
       return i;
@@ -301,11 +864,18 @@ database_groupid_get (database_t *database, valhalla_meta_grp_t grp)
 static valhalla_lang_t
 database_lang_get (database_t *database, int64_t id)
 {
+  int value;
   unsigned int i;
 
   if (!database)
     return VALHALLA_LANG_UNDEF;
 
+  value = database_id_table_get (&database->langs_tb, id);
+  if (value >= 0)
+    return value;
+  if (database->langs_tb.values)
+    return VALHALLA_LANG_UNDEF;
+
   for (i = 0; i < vh_metadata_lang_size; i++)
     if (database->langs_id[i] == id)
       return i;
@@ -328,11 +898,18 @@ database_langid_get (database_t *database, valhalla_lang_t lang)
 static valhalla_file_type_t
 database_file_type_get (database_t *database, int64_t id)
 {
+  int value;
   unsigned int i;
 
   if (!database)
     return VALHALLA_FILE_TYPE_NULL;
 
+  value = database_id_table_get (&database->file_type_tb, id);
+  if (value >= 0)
+    return value;
+  if (database->file_type_tb.values)
+    return VALHALLA_FILE_TYPE_NULL;
+
   for (i = 0; i < ARRAY_NB_ELEMENTS (g_file_type); i++)
     if (database->file_type[i].id == id)
       return i;
@@ -353,51 +930,77 @@ database_file_typeid_get (database_t *database, valhalla_file_type_t type)
 }
 
 /*
- * The query plan is useful in order to found the best way for indexing
- * the tables.
+ * The details of the query plan (one step by line), NULL on error. The
+ * query plan is useful in order to found the best way for indexing the
+ * tables.
  */
-static void
-database_query_plan (database_t *database, const char *sql)
+static char *
+database_query_plan_get (sqlite3 *db, const char *sql)
 {
-  int row = 0;
-  size_t size;
-  const char *plan = "EXPLAIN QUERY PLAN ";
-  valhalla_db_stmt_t *vhstmt;
-
-  if (!vh_log_test (VALHALLA_MSG_VERBOSE))
-    return;
+  int res;
+  size_t size = 0;
+  char *explain, *plan = NULL;
+  const char *prefix = "EXPLAIN QUERY PLAN ";
+  sqlite3_stmt *stmt;
 
   if (!sql)
-    return;
+    return NULL;
 
-  vhstmt = calloc (1, sizeof (*vhstmt));
-  if (!vhstmt)
-    return;
+  explain = malloc (strlen (prefix) + strlen (sql) + 1);
+  if (!explain)
+    return NULL;
 
-  size = strlen (sql) + strlen (plan) + 1;
-  vhstmt->sql = malloc (size);
-  if (!vhstmt->sql)
-  {
-    free (vhstmt);
-    return;
-  }
+  sprintf (explain, "%s%s", prefix, sql);
+  res = sqlite3_prepare_v2 (db, explain, -1, &stmt, NULL);
+  free (explain);
+  if (res != SQLITE_OK)
+    return NULL;
 
-  snprintf (vhstmt->sql, size, "%s%s", plan, sql);
-  while (!database_sql_exec (database->db, vhstmt->sql, vhstmt, NULL))
+  while (sqlite3_step (stmt) == SQLITE_ROW)
   {
-    if (!row)
-    {
-      row = 1;
-      vh_log (VALHALLA_MSG_VERBOSE, "Query plan for : %s", sql);
-    }
+    char *tmp;
+    size_t len;
+    const char *detail = (const char *) sqlite3_column_text (stmt, 3);
 
-    vh_log (VALHALLA_MSG_VERBOSE, "| %s | %s | %s",
-            vhstmt->cols[0], vhstmt->cols[1], vhstmt->cols[2]);
-  }
+    if (!detail)
+      continue;
 
-  if (row)
-    vh_log (VALHALLA_MSG_VERBOSE, "");
-}
+    len = strlen (detail);
+    tmp = realloc (plan, size + len + 2);
+    if (!tmp)
+      break;
+
+    plan = tmp;
+    memcpy (plan + size, detail, len);
+    size += len;
+    plan[size++] = '\n';
+    plan[size] = '\0';
+  }
+
+  sqlite3_finalize (stmt);
+  return plan;
+}
+
+static void
+database_query_plan (database_t *database, const char *sql)
+{
+  char *plan, *it, *save = NULL;
+
+  if (!vh_log_test (VALHALLA_MSG_VERBOSE))
+    return;
+
+  plan = database_query_plan_get (database->db, sql);
+  if (!plan)
+    return;
+
+  vh_log (VALHALLA_MSG_VERBOSE, "Query plan for : %s", sql);
+  for (it = strtok_r (plan, "\n", &save); it;
+       it = strtok_r (NULL, "\n", &save))
+    vh_log (VALHALLA_MSG_VERBOSE, "| %s", it);
+  vh_log (VALHALLA_MSG_VERBOSE, "");
+
+  free (plan);
+}
 
 static int
 database_prepare_stmt (database_t *database)
@@ -412,8 +1015,14 @@ database_prepare_stmt (database_t *database)
 
   for (i = 0; i < ARRAY_NB_ELEMENTS (g_stmts); i++)
   {
-    int res = sqlite3_prepare_v2 (database->db, database->stmts[i].sql,
-                                  -1, &database->stmts[i].stmt, NULL);
+    int res;
+
+    if (!database->fts
+        && (i == STMT_INSERT_DATA_FTS || i == STMT_CLEANUP_DATA_FTS))
+      continue;
+
+    res = sqlite3_prepare_v2 (database->db, database->stmts[i].sql,
+                              -1, &database->stmts[i].stmt, NULL);
     if (res != SQLITE_OK)
     {
       vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
@@ -451,6 +1060,40 @@ database_table_get_id (database_t *database,
   return val;
 }
 
+static int64_t
+database_file_id_get (database_t *database, const char *file)
+{
+  int64_t val = 0;
+  file_index_data_t *fdata;
+
+  if (!database->files)
+    return database_table_get_id (database,
+                                  STMT_GET (STMT_SELECT_FILE_ID), file);
+
+  pthread_mutex_lock (&database->files_mutex);
+  fdata = vh_file_index_get (database->files, file);
+  if (fdata)
+    val = fdata->id;
+  pthread_mutex_unlock (&database->files_mutex);
+  return val;
+}
+
+/*
+ * The index is disabled (and SQLite is used) if it can not be updated,
+ * because it must be coherent with the table 'file'.
+ */
+static void
+database_file_index_set (database_t *database,
+                         const char *file, const file_index_data_t *fdata)
+{
+  if (!vh_file_index_set (database->files, file, fdata))
+    return;
+
+  vh_log (VALHALLA_MSG_WARNING, "in-memory file index disabled");
+  vh_file_index_free (database->files);
+  database->files = NULL;
+}
+
 static inline int64_t
 database_step_rowid (database_t *database,
                      sqlite3_stmt *stmt, int *res, int *err)
@@ -569,8 +1212,79 @@ database_meta_insert (database_t *database, const char *name)
   return val;
 }
 
+/* Only the dbmanager inserts the metadata, the cache is not locked. */
+static int64_t
+database_metaid_get (database_t *database, const metadata_atom_t *atom)
+{
+  if (atom->id >= database->metas_nb)
+  {
+    unsigned int nb = atom->id + 64;
+    int64_t *metas_id;
+
+    metas_id = realloc (database->metas_id, nb * sizeof (*metas_id));
+    if (!metas_id)
+      return database_meta_insert (database, atom->name);
+
+    memset (metas_id + database->metas_nb, 0,
+            (nb - database->metas_nb) * sizeof (*metas_id));
+    database->metas_id = metas_id;
+    database->metas_nb = nb;
+  }
+
+  if (!database->metas_id[atom->id])
+    database->metas_id[atom->id] = database_meta_insert (database, atom->name);
+
+  return database->metas_id[atom->id];
+}
+
+static const char *const *
+database_search_meta (database_t *database)
+{
+  return database->search ? (const char *const *) database->search
+                          : g_search_meta;
+}
+
+static int
+database_search_meta_cmp (database_t *database, const char *meta)
+{
+  const char *const *it;
+
+  for (it = database_search_meta (database); *it; it++)
+    if (!strcmp (*it, meta))
+      return 1;
+
+  return 0;
+}
+
+/* The value is added in the full-text index only for some metadata. */
+static void
+database_data_fts_insert (database_t *database,
+                          const char *meta, int64_t data_id, const char *value)
+{
+  int res, err = -1;
+  sqlite3_stmt *stmt = STMT_GET (STMT_INSERT_DATA_FTS);
+
+  if (!stmt || !data_id || !value || !database_search_meta_cmp (database, meta))
+    return;
+
+  VH_DB_BIND_INT64_OR_GOTO (stmt, 1, data_id, out);
+  VH_DB_BIND_TEXT_OR_GOTO  (stmt, 2, value,   out_clear);
+
+  res = sqlite3_step (stmt);
+  if (res == SQLITE_DONE)
+    err = 0;
+
+  sqlite3_reset (stmt);
+ out_clear:
+  sqlite3_clear_bindings (stmt);
+ out:
+  if (err < 0)
+    vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
+}
+
 static inline int64_t
-database_data_insert (database_t *database, const char *value, int64_t langid)
+database_data_insert (database_t *database,
+                      const char *meta, const char *value, int64_t langid)
 {
   int64_t val;
   val =
@@ -578,9 +1292,10 @@ database_data_insert (database_t *database, const char *value, int64_t langid)
 
   /* retrieve ID if aborted */
   if (!val)
-    return
+    val =
       database_table_get_id (database, STMT_GET (STMT_SELECT_DATA_ID), value);
 
+  database_data_fts_insert (database, meta, val, value);
   return val;
 }
 
@@ -844,6 +1559,19 @@ database_file_insert (database_t *database, file_data_t *data)
   if (res == SQLITE_DONE)
     err = 0;
 
+  if (!err && database->files)
+  {
+    file_index_data_t fdata = {
+      .id          = sqlite3_last_insert_rowid (database->db),
+      .mtime       = data->file.mtime,
+      .interrupted = -1,
+    };
+
+    pthread_mutex_lock (&database->files_mutex);
+    database_file_index_set (database, data->file.path, &fdata);
+    pthread_mutex_unlock (&database->files_mutex);
+  }
+
   sqlite3_reset (stmt);
  out_clear:
   sqlite3_clear_bindings (stmt);
@@ -870,6 +1598,20 @@ database_file_update (database_t *database, file_data_t *data, int64_t type_id)
   if (res == SQLITE_DONE)
     err = 0;
 
+  if (!err && database->files)
+  {
+    file_index_data_t *fdata;
+
+    pthread_mutex_lock (&database->files_mutex);
+    fdata = vh_file_index_get (database->files, data->file.path);
+    if (fdata)
+    {
+      fdata->mtime       = data->file.mtime;
+      fdata->interrupted = 1;
+    }
+    pthread_mutex_unlock (&database->files_mutex);
+  }
+
   sqlite3_reset (stmt);
  out_clear:
   sqlite3_clear_bindings (stmt);
@@ -892,9 +1634,9 @@ database_file_metadata (database_t *database,
   {
     int64_t lang_id;
 
-    meta_id  = database_meta_insert (database, tag->name);
+    meta_id  = database_metaid_get  (database, tag->atom);
     lang_id  = database_langid_get  (database, tag->lang);
-    data_id  = database_data_insert (database, tag->value, lang_id);
+    data_id  = database_data_insert (database, tag->name, tag->value, lang_id);
     group_id = database_groupid_get (database, tag->group);
 
     database_assoc_filemd_insert (database,
@@ -921,8 +1663,7 @@ database_file_data (database_t *database, file_data_t *data, int insert)
 
     type_id = database_file_typeid_get (database, data->file.type);
     database_file_update (database, data, type_id);
-    file_id = database_table_get_id (database, STMT_GET (STMT_SELECT_FILE_ID),
-                                     data->file.path);
+    file_id = database_file_id_get (database, data->file.path);
     database_file_metadata (database, file_id, data->meta_parser, 0);
 
     /*
@@ -932,7 +1673,7 @@ database_file_data (database_t *database, file_data_t *data, int insert)
      *       because there is only one property which is added in this way.
      */
     snprintf (v, sizeof (v), "%"PRIi64, data->file.size);
-    vh_metadata_add_auto (&meta, VALHALLA_METADATA_FILESIZE,
+    vh_metadata_add_auto (&meta, NULL, VALHALLA_METADATA_FILESIZE,
                           v, VALHALLA_LANG_UNDEF, &pl);
     database_file_metadata (database, file_id, meta, 0);
     vh_metadata_free (meta);
@@ -944,9 +1685,7 @@ database_file_grab (database_t *database, file_data_t *data)
 {
   int64_t file_id, grabber_id;
 
-  file_id = database_table_get_id (database,
-                                   STMT_GET (STMT_SELECT_FILE_ID),
-                                   data->file.path);
+  file_id = database_file_id_get (database, data->file.path);
   database_file_metadata (database, file_id, data->meta_grabber, 0);
 
   if (!data->grabber_name)
@@ -992,6 +1731,13 @@ vh_database_file_delete (database_t *database, const char *file)
   if (res == SQLITE_DONE)
     err = 0;
 
+  if (!err && database->files)
+  {
+    pthread_mutex_lock (&database->files_mutex);
+    vh_file_index_del (database->files, file);
+    pthread_mutex_unlock (&database->files_mutex);
+  }
+
   sqlite3_reset (stmt);
   sqlite3_clear_bindings (stmt);
  out:
@@ -999,6 +1745,89 @@ vh_database_file_delete (database_t *database, const char *file)
     vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
 }
 
+/*
+ * Range of the paths in a directory: from "dir/" (included) to "dir0"
+ * (excluded). The second string is in the same buffer.
+ */
+static char *
+database_dir_range (const char *dir, char **max, size_t *len)
+{
+  char *min;
+
+  if (!dir)
+    return NULL;
+
+  *len = strlen (dir);
+  if (*len && dir[*len - 1] == '/') /* root */
+    (*len)--;
+
+  min = malloc (2 * *len + 4);
+  if (!min)
+    return NULL;
+
+  *max = min + *len + 2;
+  memcpy (min,  dir, *len);
+  memcpy (*max, dir, *len);
+  strcpy (min  + *len, "/");
+  strcpy (*max + *len, "0");
+  return min;
+}
+
+typedef struct database_range_s {
+  const char *min;
+  const char *max;
+} database_range_t;
+
+/* Callback of vh_file_index_foreach(), the data are not used. */
+static int
+database_file_index_range (void *data,
+                           const char *path, vh_unused file_index_data_t *fdata)
+{
+  database_range_t *range = data;
+  return strcmp (path, range->min) > 0 && strcmp (path, range->max) < 0;
+}
+
+/*
+ * Delete all files in the directory and its subdirectories. The relations
+ * are removed with vh_database_cleanup().
+ */
+void
+vh_database_dir_delete (database_t *database, const char *dir)
+{
+  int res, err = -1;
+  size_t len;
+  char *min, *max;
+  sqlite3_stmt *stmt = STMT_GET (STMT_DELETE_FILE_DIR);
+
+  min = database_dir_range (dir, &max, &len);
+  if (!min)
+    return;
+
+  VH_DB_BIND_TEXT_OR_GOTO (stmt, 1, min, out_free);
+  VH_DB_BIND_TEXT_OR_GOTO (stmt, 2, max, out_free);
+
+  res = sqlite3_step (stmt);
+  if (res == SQLITE_DONE)
+    err = 0;
+
+  if (!err && database->files)
+  {
+    database_range_t range = { .min = min, .max = max };
+
+    pthread_mutex_lock (&database->files_mutex);
+    vh_file_index_foreach (database->files,
+                           database_file_index_range, &range);
+    pthread_mutex_unlock (&database->files_mutex);
+  }
+
+  sqlite3_reset (stmt);
+  sqlite3_clear_bindings (stmt);
+ out_free:
+  free (min);
+  if (err < 0)
+    vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
+}
+
 void
 vh_database_file_data_delete (database_t *database, const char *file)
 {
@@ -1006,8 +1835,7 @@ vh_database_file_data_delete (database_t *database, const char *file)
   int res, err = -1;
   sqlite3_stmt *stmt = STMT_GET (STMT_DELETE_ASSOC_FILE_METADATA);
 
-  file_id = database_table_get_id (database,
-                                   STMT_GET (STMT_SELECT_FILE_ID), file);
+  file_id = database_file_id_get (database, file);
   if (!file_id)
     return;
 
@@ -1031,8 +1859,7 @@ vh_database_file_grab_delete (database_t *database, const char *file)
   int res, err = -1;
   sqlite3_stmt *stmt = STMT_GET (STMT_DELETE_ASSOC_FILE_GRABBER);
 
-  file_id = database_table_get_id (database,
-                                   STMT_GET (STMT_SELECT_FILE_ID), file);
+  file_id = database_file_id_get (database, file);
   if (!file_id)
     return;
 
@@ -1059,6 +1886,18 @@ vh_database_file_get_mtime (database_t *database, const char *file)
   if (!file)
     return -1;
 
+  if (database->files)
+  {
+    file_index_data_t *fdata;
+
+    pthread_mutex_lock (&database->files_mutex);
+    fdata = vh_file_index_get (database->files, file);
+    if (fdata)
+      val = fdata->mtime;
+    pthread_mutex_unlock (&database->files_mutex);
+    return val;
+  }
+
   VH_DB_BIND_TEXT_OR_GOTO (stmt, 1, file, out);
 
   res = sqlite3_step (stmt);
@@ -1074,6 +1913,88 @@ vh_database_file_get_mtime (database_t *database, const char *file)
   return val;
 }
 
+/*
+ * Retrieve the mtime and the interrupted state of several files with one
+ * query for SELECT_FILE_MTIME_BATCH_NB files. The files must be sorted by
+ * path (strcmp), like the rows. -1 is set for the files which are not in
+ * the database.
+ */
+void
+vh_database_file_get_mtime_batch (database_t *database,
+                                  file_data_t **files, unsigned int nb,
+                                  int64_t *mtime, int *interrup)
+{
+  int res, err = -1;
+  unsigned int i, j, n;
+  sqlite3_stmt *stmt = STMT_GET (STMT_SELECT_FILE_MTIME_BATCH);
+
+  if (!files || !mtime || !interrup)
+    return;
+
+  for (i = 0; i < nb; i++)
+  {
+    mtime[i]    = -1;
+    interrup[i] = -1;
+  }
+
+  if (database->files)
+  {
+    pthread_mutex_lock (&database->files_mutex);
+    for (i = 0; i < nb; i++)
+    {
+      file_index_data_t *fdata =
+        vh_file_index_get (database->files, files[i]->file.path);
+      if (!fdata)
+        continue;
+
+      mtime[i]    = fdata->mtime;
+      interrup[i] = fdata->interrupted;
+    }
+    pthread_mutex_unlock (&database->files_mutex);
+    return;
+  }
+
+  for (i = 0; i < nb; i += n)
+  {
+    n = nb - i;
+    if (n > SELECT_FILE_MTIME_BATCH_NB)
+      n = SELECT_FILE_MTIME_BATCH_NB;
+
+    for (j = 0; j < n; j++)
+      VH_DB_BIND_TEXT_OR_GOTO (stmt, j + 1, files[i + j]->file.path, out);
+
+    j = 0;
+    while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+      const char *path = (const char *) sqlite3_column_text (stmt, 0);
+
+      if (!path)
+        continue;
+
+      while (j < n && strcmp (files[i + j]->file.path, path) < 0)
+        j++;
+
+      /* the same file can be several times in the list */
+      for (; j < n && !strcmp (files[i + j]->file.path, path); j++)
+      {
+        mtime[i + j]    = sqlite3_column_int64 (stmt, 1);
+        interrup[i + j] = sqlite3_column_int (stmt, 2);
+      }
+    }
+
+    sqlite3_reset (stmt);
+    sqlite3_clear_bindings (stmt);
+  }
+
+  err = 0;
+ out:
+  if (err < 0)
+  {
+    vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
+    sqlite3_clear_bindings (stmt);
+  }
+}
+
 void
 vh_database_file_get_grabber (database_t *database,
                               const char *file, list_t *l)
@@ -1157,6 +2078,17 @@ vh_database_file_interrupted_clear (database_t *database, const char *file)
   if (res == SQLITE_DONE)
     err = 0;
 
+  if (!err && database->files)
+  {
+    file_index_data_t *fdata;
+
+    pthread_mutex_lock (&database->files_mutex);
+    fdata = vh_file_index_get (database->files, file);
+    if (fdata)
+      fdata->interrupted = 0;
+    pthread_mutex_unlock (&database->files_mutex);
+  }
+
   sqlite3_reset (stmt);
   sqlite3_clear_bindings (stmt);
  out:
@@ -1164,6 +2096,16 @@ vh_database_file_interrupted_clear (database_t *database, const char *file)
     vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
 }
 
+/* Callback of vh_file_index_foreach(), only the data are used. */
+static int
+database_file_index_fix (vh_unused void *data,
+                         vh_unused const char *path, file_index_data_t *fdata)
+{
+  if (fdata->interrupted == -1)
+    fdata->interrupted = 1;
+  return 0;
+}
+
 void
 vh_database_file_interrupted_fix (database_t *database)
 {
@@ -1174,6 +2116,13 @@ vh_database_file_interrupted_fix (database_t *database)
   if (res == SQLITE_DONE)
     err = 0;
 
+  if (!err && database->files)
+  {
+    pthread_mutex_lock (&database->files_mutex);
+    vh_file_index_foreach (database->files, database_file_index_fix, NULL);
+    pthread_mutex_unlock (&database->files_mutex);
+  }
+
   sqlite3_reset (stmt);
   if (err < 0)
     vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
@@ -1188,6 +2137,18 @@ vh_database_file_get_interrupted (database_t *database, const char *file)
   if (!file)
     return -1;
 
+  if (database->files)
+  {
+    file_index_data_t *fdata;
+
+    pthread_mutex_lock (&database->files_mutex);
+    fdata = vh_file_index_get (database->files, file);
+    if (fdata)
+      val = fdata->interrupted;
+    pthread_mutex_unlock (&database->files_mutex);
+    return val;
+  }
+
   VH_DB_BIND_TEXT_OR_GOTO (stmt, 1, file, out);
 
   res = sqlite3_step (stmt);
@@ -1260,9 +2221,7 @@ vh_database_file_insert_dlcontext (database_t *database, file_data_t *data)
   file_dl_t *it;
   int64_t file_id;
 
-  file_id = database_table_get_id (database,
-                                   STMT_GET (STMT_SELECT_FILE_ID),
-                                   data->file.path);
+  file_id = database_file_id_get (database, data->file.path);
   if (!file_id)
     return;
 
@@ -1375,86 +2334,423 @@ database_info_set (database_t *database, const char *name, const char *value)
 }
 
 /******************************************************************************/
-/*                               Main Functions                               */
+/*                           Directories handling                             */
 /******************************************************************************/
 
-int
-vh_database_cleanup (database_t *database)
-{
-  int res, val, val_tmp, err = -1;
+#define VH_INFO_DIR_SIGNATURE "vh_dir_signature" /* suffixes of the scanner */
 
-  val_tmp = sqlite3_total_changes (database->db);
+void
+vh_database_dir_set (database_t *database, dir_list_t *list)
+{
+  int res, err = -1;
+  unsigned int i;
+  sqlite3_stmt *stmt = STMT_GET (STMT_DELETE_DIR);
 
-  res = sqlite3_step (STMT_GET (STMT_CLEANUP_ASSOC_FILE_METADATA));
+  res = sqlite3_step (stmt);
+  sqlite3_reset (stmt);
   if (res != SQLITE_DONE)
     goto out;
 
-  res = sqlite3_step (STMT_GET (STMT_CLEANUP_ASSOC_FILE_GRABBER));
-  if (res != SQLITE_DONE)
-    goto out;
+  stmt = STMT_GET (STMT_INSERT_DIR);
 
-  res = sqlite3_step (STMT_GET (STMT_CLEANUP_META));
-  if (res != SQLITE_DONE)
-    goto out;
+  for (i = 0; list && i < list->nb; i++)
+  {
+    VH_DB_BIND_TEXT_OR_GOTO  (stmt, 1, list->dirs[i].path,     out_reset);
+    VH_DB_BIND_INT64_OR_GOTO (stmt, 2, list->dirs[i].mtime,    out_reset);
+    VH_DB_BIND_INT_OR_GOTO   (stmt, 3, list->dirs[i].nb_files, out_reset);
 
-  res = sqlite3_step (STMT_GET (STMT_CLEANUP_DATA));
-  if (res != SQLITE_DONE)
-    goto out;
+    res = sqlite3_step (stmt);
+    sqlite3_reset (stmt);
+    if (res != SQLITE_DONE)
+      goto out_reset;
+  }
 
-  res = sqlite3_step (STMT_GET (STMT_CLEANUP_GRABBER));
-  if (res == SQLITE_DONE)
-    err = 0;
+  err = 0;
 
+ out_reset:
+  sqlite3_clear_bindings (stmt);
  out:
-  val = sqlite3_total_changes (database->db);
-  sqlite3_reset (STMT_GET (STMT_CLEANUP_ASSOC_FILE_METADATA));
-  sqlite3_reset (STMT_GET (STMT_CLEANUP_ASSOC_FILE_GRABBER));
-  sqlite3_reset (STMT_GET (STMT_CLEANUP_META));
-  sqlite3_reset (STMT_GET (STMT_CLEANUP_DATA));
-  sqlite3_reset (STMT_GET (STMT_CLEANUP_GRABBER));
   if (err < 0)
     vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
-  return val - val_tmp;
 }
 
-void
-vh_database_begin_transaction (database_t *database)
+/*
+ * Load the directories saved by the last complete loop of the scanner.
+ * A directory must be read again (mtime to -1) if one of its files is not
+ * fully handled, or if the number of files is not the same than in the
+ * database (the files were changed while the cache was disabled).
+ */
+int
+vh_database_dir_get (database_t *database, dir_list_t *list, const char *sig)
 {
-  sqlite3_step (STMT_GET (STMT_BEGIN_TRANSACTION));
-  sqlite3_reset (STMT_GET (STMT_BEGIN_TRANSACTION));
-}
+  int res, err = -1;
+  unsigned int i;
+  int *nb = NULL;
+  char *val;
+  sqlite3_stmt *stmt = NULL;
 
-void
-vh_database_end_transaction (database_t *database)
-{
-  sqlite3_step (STMT_GET (STMT_END_TRANSACTION));
-  sqlite3_reset (STMT_GET (STMT_END_TRANSACTION));
-}
+  if (!list)
+    return -1;
 
-void
-vh_database_step_transaction (database_t *database,
-                              unsigned int interval, int value)
-{
-  if (value && !(value % interval))
+  if (!sig)
+    sig = "";
+
+  /* the directories are useless if the suffixes have changed */
+  val = database_info_get (database, VH_INFO_DIR_SIGNATURE);
+  if (!val || strcmp (val, sig))
   {
-    vh_database_end_transaction (database);
-    vh_database_begin_transaction (database);
+    vh_database_dir_set (database, NULL);
+    database_info_set (database, VH_INFO_DIR_SIGNATURE, sig);
+    if (val)
+      free (val);
+    return 0;
   }
-}
+  free (val);
 
-#define DB_SQL_EXEC_OR_GOTO(d, s, m, g)       \
-  database_sql_exec (d, s, NULL, &m);         \
-  if (m)                                      \
-    goto g;
+  res = sqlite3_prepare_v2 (database->db, SELECT_DIR, -1, &stmt, NULL);
+  if (res != SQLITE_OK)
+    goto out;
 
-static void
-database_create_table (database_t *database)
-{
-  char *m = NULL;
+  while ((res = sqlite3_step (stmt)) == SQLITE_ROW)
+    if (vh_dir_list_add (list, (const char *) sqlite3_column_text (stmt, 0),
+                         sqlite3_column_int64 (stmt, 1),
+                         sqlite3_column_int (stmt, 2)))
+      goto out;
 
-  DB_SQL_EXEC_OR_GOTO (database->db, BEGIN_TRANSACTION,                m, err);
+  sqlite3_finalize (stmt);
+  stmt = NULL;
+  if (res != SQLITE_DONE)
+    goto out;
 
-  /* Create tables */
+  if (!list->nb)
+  {
+    err = 0;
+    goto out;
+  }
+
+  nb = calloc (list->nb, sizeof (*nb));
+  if (!nb)
+    goto out;
+
+  res = sqlite3_prepare_v2 (database->db,
+                            SELECT_FILE_DIR_CHECK, -1, &stmt, NULL);
+  if (res != SQLITE_OK)
+    goto out;
+
+  while ((res = sqlite3_step (stmt)) == SQLITE_ROW)
+  {
+    char *path, *it;
+    dir_data_t *dir;
+
+    path = strdup ((const char *) sqlite3_column_text (stmt, 0));
+    if (!path)
+      continue;
+
+    it = strrchr (path, '/');
+    if (it)
+    {
+      *(it == path ? it + 1 : it) = '\0';
+      dir = vh_dir_list_get (list, path);
+      if (dir)
+      {
+        if (sqlite3_column_int (stmt, 1))
+          dir->mtime = -1;
+        nb[dir - list->dirs]++;
+      }
+    }
+
+    free (path);
+  }
+
+  if (res != SQLITE_DONE)
+    goto out;
+
+  for (i = 0; i < list->nb; i++)
+    if (nb[i] != list->dirs[i].nb_files)
+      list->dirs[i].mtime = -1;
+
+  err = 0;
+
+ out:
+  if (nb)
+    free (nb);
+  sqlite3_finalize (stmt);
+  if (err < 0)
+  {
+    vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
+    vh_dir_list_clear (list);
+  }
+  return err;
+}
+
+void
+vh_database_dir_checked (database_t *database, const char *dir)
+{
+  int res, err = -1;
+  size_t len;
+  char *min, *max;
+  sqlite3_stmt *stmt = STMT_GET (STMT_UPDATE_FILE_CHECKED_DIR);
+
+  min = database_dir_range (dir, &max, &len);
+  if (!min)
+    return;
+
+  VH_DB_BIND_TEXT_OR_GOTO (stmt, 1, min,           out_free);
+  VH_DB_BIND_TEXT_OR_GOTO (stmt, 2, max,           out_free);
+  VH_DB_BIND_INT_OR_GOTO  (stmt, 3, (int) len + 2, out_free);
+
+  res = sqlite3_step (stmt);
+  if (res == SQLITE_DONE)
+    err = 0;
+
+  sqlite3_reset (stmt);
+  sqlite3_clear_bindings (stmt);
+ out_free:
+  free (min);
+  if (err < 0)
+    vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
+}
+
+/******************************************************************************/
+/*                          Full-text index handling                          */
+/******************************************************************************/
+
+#define VH_INFO_SEARCH_SIGNATURE "vh_search_signature" /* indexed metadata */
+
+void
+vh_database_search_meta_add (database_t *database, const char *meta)
+{
+  int n;
+  char *const *it;
+
+  if (!meta)
+    return;
+
+  /* check if the metadata is already in the list */
+  for (it = database->search; it && *it; it++)
+    if (!strcmp (*it, meta))
+      return;
+
+  n = vh_get_list_length (database->search) + 1;
+
+  database->search =
+    realloc (database->search, (n + 1) * sizeof (*database->search));
+  if (!database->search)
+    return;
+
+  database->search[n] = NULL;
+  database->search[n - 1] = strdup (meta);
+}
+
+static int
+database_search_index (database_t *database, const char *meta)
+{
+  int res, err = -1;
+  sqlite3_stmt *stmt;
+
+  res = sqlite3_prepare_v2 (database->db,
+                            INSERT_DATA_FTS_META, -1, &stmt, NULL);
+  if (res != SQLITE_OK)
+    goto out_err;
+
+  VH_DB_BIND_TEXT_OR_GOTO (stmt, 1, meta, out_free);
+
+  res = sqlite3_step (stmt);
+  if (res == SQLITE_DONE)
+    err = 0;
+
+ out_free:
+  sqlite3_finalize (stmt);
+ out_err:
+  if (err < 0)
+    vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
+  return err;
+}
+
+/*
+ * The full-text index is built again when the list of the metadata is not
+ * the same than in the previous session (or with an older database).
+ */
+void
+vh_database_search_sync (database_t *database)
+{
+  char *sig, *val, *m = NULL;
+  size_t size = 1;
+  const char *const *it;
+
+  if (!database->fts)
+    return;
+
+  for (it = database_search_meta (database); *it; it++)
+    size += strlen (*it) + 1;
+
+  sig = calloc (1, size);
+  if (!sig)
+    return;
+
+  for (it = database_search_meta (database); *it; it++)
+  {
+    if (it != database_search_meta (database))
+      strcat (sig, ",");
+    strcat (sig, *it);
+  }
+
+  val = database_info_get (database, VH_INFO_SEARCH_SIGNATURE);
+  if (val && !strcmp (val, sig))
+    goto out;
+
+  vh_log (VALHALLA_MSG_INFO, "[%s] build the full-text index (%s)",
+          __FUNCTION__, sig);
+
+  vh_database_begin_transaction (database);
+
+  database_sql_exec (database->db, DELETE_DATA_FTS, NULL, &m);
+  if (m)
+  {
+    vh_log (VALHALLA_MSG_ERROR, "%s", m);
+    free (m);
+    vh_database_end_transaction (database);
+    goto out;
+  }
+
+  for (it = database_search_meta (database); *it; it++)
+    if (database_search_index (database, *it))
+      break;
+
+  if (!*it)
+    database_info_set (database, VH_INFO_SEARCH_SIGNATURE, sig);
+
+  vh_database_end_transaction (database);
+
+ out:
+  if (val)
+    free (val);
+  free (sig);
+}
+
+/******************************************************************************/
+/*                               Main Functions                               */
+/******************************************************************************/
+
+/*
+ * The order is important because the deletes in the association tables
+ * collect the meta, data and grabber ids (triggers). The ids are cleared
+ * only when they are checked.
+ */
+static const struct {
+  database_stmt_t stmt;
+  int             relation; /* counted in the returned value */
+} g_cleanup[] = {
+  { STMT_CLEANUP_ASSOC_FILE_METADATA, 1 },
+  { STMT_CLEANUP_ASSOC_FILE_GRABBER,  1 },
+  { STMT_CLEANUP_FILE_CLEAR,          0 },
+  { STMT_CLEANUP_META,                1 },
+  { STMT_CLEANUP_META_CLEAR,          0 },
+  { STMT_CLEANUP_DATA,                1 },
+  { STMT_CLEANUP_DATA_FTS,            0 },
+  { STMT_CLEANUP_DATA_CLEAR,          0 },
+  { STMT_CLEANUP_GRABBER,             1 },
+  { STMT_CLEANUP_GRABBER_CLEAR,       0 },
+};
+
+int
+vh_database_cleanup (database_t *database)
+{
+  int res, val = 0, err = 0;
+  unsigned int i;
+
+  for (i = 0; i < ARRAY_NB_ELEMENTS (g_cleanup); i++)
+  {
+    sqlite3_stmt *stmt = STMT_GET (g_cleanup[i].stmt);
+
+    if (!stmt) /* without full-text index */
+      continue;
+
+    res = sqlite3_step (stmt);
+    sqlite3_reset (stmt);
+    if (res != SQLITE_DONE)
+    {
+      err = -1;
+      break;
+    }
+
+    /* the changes made by the triggers are not counted */
+    if (g_cleanup[i].relation)
+      val += sqlite3_changes (database->db);
+  }
+
+  /* the unused metadata are removed, the ids must be read again */
+  if (database->metas_id)
+    memset (database->metas_id, 0,
+            database->metas_nb * sizeof (*database->metas_id));
+
+  if (err < 0)
+    vh_log (VALHALLA_MSG_ERROR, "%s", sqlite3_errmsg (database->db));
+  return val;
+}
+
+/*
+ * The hook is called before every commit of the main connection, then the
+ * results of the counts are outdated. But the commit is not yet visible for
+ * the read-only connections, a count could read the old rows for the new
+ * generation. Then the generation is changed again at the end of the
+ * transaction.
+ */
+static int
+database_commit_hook (void *data)
+{
+  database_t *database = data;
+
+  database->commit = 1;
+  database_generation_inc (database);
+  return 0; /* the commit is not aborted */
+}
+
+void
+vh_database_begin_transaction (database_t *database)
+{
+  sqlite3_step (STMT_GET (STMT_BEGIN_TRANSACTION));
+  sqlite3_reset (STMT_GET (STMT_BEGIN_TRANSACTION));
+}
+
+void
+vh_database_end_transaction (database_t *database)
+{
+  sqlite3_step (STMT_GET (STMT_END_TRANSACTION));
+  sqlite3_reset (STMT_GET (STMT_END_TRANSACTION));
+
+  /* the commit is now visible, see database_commit_hook() */
+  if (database->commit)
+  {
+    database->commit = 0;
+    database_generation_inc (database);
+  }
+}
+
+void
+vh_database_step_transaction (database_t *database,
+                              unsigned int interval, int value)
+{
+  if (value && !(value % interval))
+  {
+    vh_database_end_transaction (database);
+    vh_database_begin_transaction (database);
+  }
+}
+
+#define DB_SQL_EXEC_OR_GOTO(d, s, m, g)       \
+  database_sql_exec (d, s, NULL, &m);         \
+  if (m)                                      \
+    goto g;
+
+static void
+database_create_table (database_t *database)
+{
+  char *m = NULL;
+
+  DB_SQL_EXEC_OR_GOTO (database->db, BEGIN_TRANSACTION,                m, err);
+
+  /* Create tables */
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_INFO,                m, err);
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_FILE,                m, err);
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_TYPE,                m, err);
@@ -1466,16 +2762,51 @@ database_create_table (database_t *database)
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_DLCONTEXT,           m, err);
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_ASSOC_FILE_METADATA, m, err);
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_ASSOC_FILE_GRABBER,  m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_DIR,                 m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_CLEANUP_FILE,        m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_CLEANUP_META,        m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_CLEANUP_DATA,        m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TABLE_CLEANUP_GRABBER,     m, err);
 
   /* Create indexes */
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_INDEX_CHECKED,             m, err);
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_INDEX_INTERRUPTED,         m, err);
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_INDEX_OUTOFPATH,           m, err);
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_INDEX_ASSOC,               m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db, DROP_INDEX_ASSOC,                 m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db, CREATE_INDEX_ASSOC_DATA,          m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db, CREATE_INDEX_ASSOC_GRABBER,       m, err);
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_INDEX_FK_FILE,             m, err);
   DB_SQL_EXEC_OR_GOTO (database->db, CREATE_INDEX_FK_ASSOC,            m, err);
 
   DB_SQL_EXEC_OR_GOTO (database->db, END_TRANSACTION,                  m, err);
+
+  /* Optional (FTS5 is not always compiled in SQLite) */
+  database_sql_exec (database->db, CREATE_TABLE_DATA_FTS, NULL, &m);
+  database->fts = !m;
+  if (m)
+  {
+    vh_log (VALHALLA_MSG_WARNING, "full-text search not available: %s", m);
+    free (m);
+  }
+  return;
+
+ err:
+  vh_log (VALHALLA_MSG_ERROR, "%s", m);
+  free (m);
+}
+
+/* The temporary triggers are lost when the temp_store pragma is changed. */
+static void
+database_create_trigger (database_t *database)
+{
+  char *m = NULL;
+
+  DB_SQL_EXEC_OR_GOTO (database->db, CREATE_TRIGGER_CLEANUP_FILE,      m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db,
+                       CREATE_TRIGGER_CLEANUP_ASSOC_FILE_METADATA,     m, err);
+  DB_SQL_EXEC_OR_GOTO (database->db,
+                       CREATE_TRIGGER_CLEANUP_ASSOC_FILE_GRABBER,      m, err);
   return;
 
  err:
@@ -1552,6 +2883,35 @@ database_info (database_t *database)
   return 0;
 }
 
+int
+vh_database_pragma_set (database_t *database,
+                        database_pragma_t pragma, int value)
+{
+  int res;
+
+  if (pragma >= DATABASE_PRAGMA_NB || value < 0)
+    return -1;
+
+  if (pragma == DATABASE_PRAGMA_JOURNAL
+      && (unsigned int) value >= ARRAY_NB_ELEMENTS (g_journal))
+    return -1;
+
+  /*
+   * The journal mode can not be changed when an other connection is open
+   * and the other pragmas are set when the connections are opened again.
+   */
+  database_readers_close (database);
+
+  res = database_pragma_exec (database->db, pragma, value);
+  if (!res)
+    database->pragmas[pragma] = value;
+
+  if (pragma == DATABASE_PRAGMA_TEMPSTORE)
+    database_create_trigger (database);
+
+  return res;
+}
+
 void
 vh_database_uninit (database_t *database)
 {
@@ -1571,43 +2931,130 @@ vh_database_uninit (database_t *database)
     free (database->stmts);
   }
 
+  if (database->search)
+  {
+    char **it;
+    for (it = database->search; *it; it++)
+      free (*it);
+    free (database->search);
+  }
+
   if (database->file_type)
     free (database->file_type);
   if (database->groups_id)
     free (database->groups_id);
+  if (database->metas_id)
+    free (database->metas_id);
   if (database->langs_id)
     free (database->langs_id);
-
+  if (database->file_type_tb.values)
+    free (database->file_type_tb.values);
+  if (database->groups_tb.values)
+    free (database->groups_tb.values);
+  if (database->langs_tb.values)
+    free (database->langs_tb.values);
+
+  vh_file_index_free (database->files);
+  pthread_mutex_destroy (&database->files_mutex);
+
+  database_readers_close (database);
+  pthread_mutex_destroy (&database->readers_mutex);
+  database_counts_free (database);
+  pthread_mutex_destroy (&database->counts_mutex);
+  pthread_key_delete (database->progress);
   if (database->db)
     sqlite3_close (database->db);
 
   free (database);
 }
 
-database_t *
-vh_database_init (const char *path)
+/*
+ * Load the paths, the mtimes and the interrupted states of all files with
+ * only one sequential scan.
+ */
+static int
+database_file_index_load (database_t *database)
 {
-  int res, exists;
-  unsigned int i;
-  database_t *database;
+  int res, err = 0;
+  sqlite3_stmt *stmt = STMT_GET (STMT_SELECT_FILE_INDEX);
 
-  if (!path)
-    return NULL;
+  database->files = vh_file_index_new ();
+  if (!database->files)
+    return -1;
 
-  if (sqlite3_threadsafe () != 1)
+  while (!err && (res = sqlite3_step (stmt)) == SQLITE_ROW)
   {
-    res = sqlite3_config (SQLITE_CONFIG_SERIALIZED);
-    if (res != SQLITE_OK)
-    {
-      vh_log (VALHALLA_MSG_ERROR,
-              "SQLite3 is not compiled with serialized threading mode!");
-      return NULL;
-    }
+    const char *path = (const char *) sqlite3_column_text (stmt, 1);
+    file_index_data_t fdata = {
+      .id          = sqlite3_column_int64 (stmt, 0),
+      .mtime       = sqlite3_column_int64 (stmt, 2),
+      .interrupted = sqlite3_column_int (stmt, 3),
+    };
+
+    if (path)
+      err = vh_file_index_set (database->files, path, &fdata);
   }
 
-  database = calloc (1, sizeof (database_t));
-  if (!database)
-    return NULL;
+  sqlite3_reset (stmt);
+  if (!err && res == SQLITE_DONE)
+    return 0;
+
+  vh_file_index_free (database->files);
+  database->files = NULL;
+  return -1;
+}
+
+void
+vh_database_file_index_stats (database_t *database,
+                              unsigned int *nb, size_t *size)
+{
+  pthread_mutex_lock (&database->files_mutex);
+  if (nb)
+    *nb = vh_file_index_count (database->files);
+  if (size)
+    *size = vh_file_index_memory (database->files);
+  pthread_mutex_unlock (&database->files_mutex);
+}
+
+void
+vh_database_cache_stats_set (database_t *database,
+                             vh_stats_cnt_t *hit, vh_stats_cnt_t *miss)
+{
+  database->st_cache_hit  = hit;
+  database->st_cache_miss = miss;
+}
+
+database_t *
+vh_database_init (const char *path, int file_index)
+{
+  int res, exists;
+  unsigned int i;
+  database_t *database;
+
+  if (!path)
+    return NULL;
+
+  if (sqlite3_threadsafe () != 1)
+  {
+    res = sqlite3_config (SQLITE_CONFIG_SERIALIZED);
+    if (res != SQLITE_OK)
+    {
+      vh_log (VALHALLA_MSG_ERROR,
+              "SQLite3 is not compiled with serialized threading mode!");
+      return NULL;
+    }
+  }
+
+  database = calloc (1, sizeof (database_t));
+  if (!database)
+    return NULL;
+
+  pthread_mutex_init (&database->files_mutex, NULL);
+  pthread_mutex_init (&database->readers_mutex, NULL);
+  pthread_mutex_init (&database->counts_mutex, NULL);
+  pthread_key_create (&database->progress, NULL);
+  for (i = 0; i < DATABASE_PRAGMA_NB; i++)
+    database->pragmas[i] = -1;
 
   res = sqlite3_initialize ();
   if (res != SQLITE_OK)
@@ -1624,11 +3071,16 @@ vh_database_init (const char *path)
   }
 
   database->path = strdup (path);
+  sqlite3_busy_timeout (database->db, DATABASE_BUSY_TIMEOUT);
+  sqlite3_commit_hook (database->db, database_commit_hook, database);
 
   if (exists && database_info (database))
     goto err;
 
   database_create_table (database);
+  database_create_trigger (database);
+  vh_database_pragma_set (database,
+                          DATABASE_PRAGMA_JOURNAL, VALHALLA_DB_JOURNAL_WAL);
 
   res = database_prepare_stmt (database);
   if (res)
@@ -1663,6 +3115,25 @@ vh_database_init (const char *path)
     database->langs_id[i] = database_lang_insert (database, lshort, llong);
   }
 
+  /* reverse tables for the public selections */
+  {
+    int64_t type_id[ARRAY_NB_ELEMENTS (g_file_type)];
+
+    for (i = 0; i < ARRAY_NB_ELEMENTS (g_file_type); i++)
+      type_id[i] = database->file_type[i].id;
+
+    database_id_table_init (&database->file_type_tb,
+                            type_id, ARRAY_NB_ELEMENTS (g_file_type));
+  }
+  database_id_table_init (&database->groups_tb,
+                          database->groups_id, vh_metadata_group_size);
+  database_id_table_init (&database->langs_tb,
+                          database->langs_id, vh_metadata_lang_size);
+
+  if (file_index && database_file_index_load (database))
+    vh_log (VALHALLA_MSG_WARNING,
+            "in-memory file index not available, SQLite is used instead");
+
   return database;
 
  err:
@@ -1686,41 +3157,163 @@ vh_database_init (const char *path)
   }                                                     \
   while (0)
 
-#define SQL_CONCAT_TYPE(sql, item, def)                              \
-  do                                                                 \
-  {                                                                  \
-    switch ((item).type)                                             \
-    {                                                                \
-    case VALHALLA_DB_TYPE_ID:                                        \
-      SQL_CONCAT (sql, SELECT_LIST_WHERE_##def##_ID, (item).id);     \
-      break;                                                         \
-                                                                     \
-    case VALHALLA_DB_TYPE_TEXT:                                      \
-      SQL_CONCAT (sql, SELECT_LIST_WHERE_##def##_NAME, (item).text); \
-      break;                                                         \
-                                                                     \
-    default:                                                         \
-      break;                                                         \
-    }                                                                \
-  }                                                                  \
+/* Value bound to a numbered parameter. */
+typedef struct database_bind_s {
+  int64_t     id;
+  const char *text; /* NULL for an integer */
+} database_bind_t;
+
+typedef struct database_query_s {
+  char            sql[SQL_BUFFER];
+  database_bind_t binds[SQL_BIND_MAX];
+  unsigned int    nb;
+  int             err;
+} database_query_t;
+
+/*
+ * The value is saved for sqlite3_bind_*() and the number of the parameter
+ * ?NNN is returned (0 on error). The parameters are numbered because the
+ * order of the values is not always the order in the query (see sql_tmp).
+ */
+static unsigned int
+database_query_bind (database_query_t *query, int64_t id, const char *text)
+{
+  if (query->nb >= SQL_BIND_MAX)
+  {
+    query->err = 1;
+    return 0;
+  }
+
+  query->binds[query->nb].id   = id;
+  query->binds[query->nb].text = text;
+  return ++query->nb;
+}
+
+#define SQL_CONCAT_BIND(query, sql, str, i, t)                      \
+  do                                                                \
+  {                                                                 \
+    unsigned int n = database_query_bind (query, i, t);             \
+    if (n)                                                          \
+      SQL_CONCAT (sql, str, n);                                     \
+  }                                                                 \
+  while (0)
+
+#define SQL_CONCAT_ID(query, sql, str, i) \
+  SQL_CONCAT_BIND (query, sql, str, i, NULL)
+#define SQL_CONCAT_TEXT(query, sql, str, t) \
+  SQL_CONCAT_BIND (query, sql, str, 0, t)
+
+#define SQL_CONCAT_TYPE(query, sql, item, def)                              \
+  do                                                                        \
+  {                                                                         \
+    switch ((item).type)                                                    \
+    {                                                                       \
+    case VALHALLA_DB_TYPE_ID:                                               \
+      SQL_CONCAT_ID (query, sql, SELECT_LIST_WHERE_##def##_ID, (item).id);  \
+      break;                                                                \
+                                                                            \
+    case VALHALLA_DB_TYPE_TEXT:                                             \
+      SQL_CONCAT_TEXT (query, sql,                                          \
+                       SELECT_LIST_WHERE_##def##_NAME, (item).text);        \
+      break;                                                                \
+                                                                            \
+    default:                                                                \
+      break;                                                                \
+    }                                                                       \
+  }                                                                         \
   while (0)
 
-#define VH_DB_RETURN_SQL_PREPARE(d, s, v)                         \
-  {                                                               \
-    int rc;                                                       \
-    database_query_plan (d, s);                                   \
-    v->sql = strdup (s);                                          \
-    rc = sqlite3_prepare_v2 (d->db, v->sql, -1, &v->stmt, NULL);  \
-    if (rc != SQLITE_OK)                                          \
-    {                                                             \
-      vh_log (VALHALLA_MSG_ERROR,                                 \
-              "%s - query: %s", sqlite3_errmsg (d->db), s);       \
-      database_vhstmt_free (v);                                   \
-      return NULL;                                                \
-    }                                                             \
-    return v;                                                     \
+/*
+ * The statement is prepared only if the shape of the query is not in the
+ * cache of the read-only connection. Then the values are bound.
+ */
+static valhalla_db_stmt_t *
+database_vhstmt_prepare (database_t *database,
+                         database_query_t *query, valhalla_db_stmt_t *vhstmt)
+{
+  int rc;
+  unsigned int i;
+  const database_progress_t *progress;
+
+  vhstmt->database = database;
+  vhstmt->reader   = database_reader_get (database);
+  vhstmt->db       = vhstmt->reader ? vhstmt->reader->db : database->db;
+
+  /*
+   * The thread can abort the steps. The handler is set only on a read-only
+   * connection because the main connection is shared with the writer.
+   */
+  progress = pthread_getspecific (database->progress);
+  if (progress && vhstmt->reader)
+  {
+    sqlite3_progress_handler (vhstmt->db, DATABASE_PROGRESS_OPS,
+                              progress->cb, progress->data);
+    vhstmt->progress = 1;
+  }
+
+  if (query->err)
+  {
+    vh_log (VALHALLA_MSG_ERROR, "Too many values for the query: %s",
+            query->sql);
+    goto err;
+  }
+
+  vhstmt->sql = strdup (query->sql);
+  if (!vhstmt->sql)
+    goto err;
+
+  if (vhstmt->reader)
+    vhstmt->cache = database_cache_get (vhstmt->reader, query->sql);
+
+  if (vhstmt->cache)
+  {
+    VH_STATS_COUNTER_INC (database->st_cache_hit);
+    vhstmt->stmt = vhstmt->cache->stmt;
+  }
+  else
+  {
+    VH_STATS_COUNTER_INC (database->st_cache_miss);
+    database_query_plan (database, query->sql);
+
+    rc = sqlite3_prepare_v2 (vhstmt->db,
+                             query->sql, -1, &vhstmt->stmt, NULL);
+    if (rc != SQLITE_OK)
+    {
+      vh_log (VALHALLA_MSG_ERROR, "%s - query: %s",
+              sqlite3_errmsg (vhstmt->db), query->sql);
+      goto err;
+    }
+
+    if (vhstmt->reader)
+      vhstmt->cache =
+        database_cache_add (vhstmt->reader, query->sql, vhstmt->stmt);
+  }
+
+  for (i = 0; i < query->nb; i++)
+  {
+    const database_bind_t *bind = &query->binds[i];
+
+    if (bind->text)
+      rc = sqlite3_bind_text (vhstmt->stmt, i + 1,
+                              bind->text, -1, SQLITE_TRANSIENT);
+    else
+      rc = sqlite3_bind_int64 (vhstmt->stmt, i + 1, bind->id);
+
+    if (rc != SQLITE_OK)
+    {
+      vh_log (VALHALLA_MSG_ERROR, "%s - query: %s",
+              sqlite3_errmsg (vhstmt->db), query->sql);
+      goto err;
+    }
   }
 
+  return vhstmt;
+
+ err:
+  database_vhstmt_free (vhstmt);
+  return NULL;
+}
+
 static inline int
 database_sql_vhstmt (sqlite3 *db, valhalla_db_stmt_t *vhstmt)
 {
@@ -1743,14 +3336,15 @@ database_sql_vhstmt (sqlite3 *db, valhalla_db_stmt_t *vhstmt)
 
 static inline void
 database_list_get_restriction_common (database_t *database,
+                                      database_query_t *query,
                                       valhalla_db_restrict_t *restriction,
                                       char *sql)
 {
-  SQL_CONCAT_TYPE (sql, restriction->meta, META);
+  SQL_CONCAT_TYPE (query, sql, restriction->meta, META);
   if (restriction->data.text || restriction->data.id)
   {
     SQL_CONCAT (sql, SELECT_LIST_AND);
-    SQL_CONCAT_TYPE (sql, restriction->data, DATA);
+    SQL_CONCAT_TYPE (query, sql, restriction->data, DATA);
   }
 
   if (restriction->data.lang >= 0)
@@ -1759,46 +3353,59 @@ database_list_get_restriction_common (database_t *database,
 
     lang_id = database_langid_get (database, restriction->data.lang);
     SQL_CONCAT (sql, SELECT_LIST_AND);
-    SQL_CONCAT (sql, SELECT_LIST_WHERE_LANG_ID, lang_id);
+    SQL_CONCAT_ID (query, sql, SELECT_LIST_WHERE_LANG_ID, lang_id);
   }
 
   SQL_CONCAT (sql, SELECT_LIST_AND);
-  SQL_CONCAT (sql, SELECT_LIST_WHERE_PRIORITY, restriction->meta.priority);
+  SQL_CONCAT_ID (query, sql,
+                 SELECT_LIST_WHERE_PRIORITY, restriction->meta.priority);
 }
 
+/*
+ * SELECT sa.file_id FROM assoc_file_metadata AS sa
+ * <INNER JOIN data AS sd ON sd.data_id = sa.data_id>
+ * WHERE sa.meta_id = <ID|(SELECT meta_id FROM meta WHERE meta_name = "TEXT")>
+ *   AND sa.data_id = <ID|(SELECT data_id FROM data WHERE data_value = "TEXT")>
+ *   AND sd._lang_id = <ID>
+ *   AND sa.priority__ <= <PRIORITY>
+ */
 static void
-database_list_get_restriction_sub (database_t *database,
+database_list_get_restriction_set (database_t *database,
+                                   database_query_t *query,
                                    valhalla_db_restrict_t *restriction,
                                    char *sql)
 {
-  /* sub-query */
-  switch (restriction->op)
-  {
-  case VALHALLA_DB_OPERATOR_IN:
-    SQL_CONCAT (sql, SELECT_LIST_WHERE_SUB_IN);
-    break;
+  int lang = restriction->data.lang >= 0;
 
-  case VALHALLA_DB_OPERATOR_NOTIN:
-    SQL_CONCAT (sql, SELECT_LIST_WHERE_SUB_NOTIN);
-    break;
+  SQL_CONCAT (sql, SELECT_LIST_SET);
+  if (lang)
+    SQL_CONCAT (sql, SELECT_LIST_SET_LANG);
+  SQL_CONCAT (sql, SELECT_LIST_WHERE);
 
-  default:
-    return; /* impossible or bug */
+  SQL_CONCAT_TYPE (query, sql, restriction->meta, SET_META);
+  if (restriction->data.text || restriction->data.id)
+  {
+    SQL_CONCAT (sql, SELECT_LIST_AND);
+    SQL_CONCAT_TYPE (query, sql, restriction->data, SET_DATA);
   }
 
-  SQL_CONCAT (sql, SELECT_LIST_WHERE_SUB);
-
-  /* sub-where */
-  SQL_CONCAT (sql, SELECT_LIST_WHERE);
+  if (lang)
+  {
+    int64_t lang_id;
 
-  database_list_get_restriction_common (database, restriction, sql);
+    lang_id = database_langid_get (database, restriction->data.lang);
+    SQL_CONCAT (sql, SELECT_LIST_AND);
+    SQL_CONCAT_ID (query, sql, SELECT_LIST_WHERE_SET_LANG_ID, lang_id);
+  }
 
-  /* sub-end */
-  SQL_CONCAT (sql, SELECT_LIST_WHERE_SUB_END);
+  SQL_CONCAT (sql, SELECT_LIST_AND);
+  SQL_CONCAT_ID (query, sql,
+                 SELECT_LIST_WHERE_SET_PRIORITY, restriction->meta.priority);
 }
 
 static void
 database_list_get_restriction_equal (database_t *database,
+                                     database_query_t *query,
                                      valhalla_db_restrict_t *restriction,
                                      char *sql, int equal)
 {
@@ -1807,376 +3414,1186 @@ database_list_get_restriction_equal (database_t *database,
 
   SQL_CONCAT (sql, "( ");
 
-  database_list_get_restriction_common (database, restriction, sql);
+  database_list_get_restriction_common (database, query, restriction, sql);
+
+  SQL_CONCAT (sql, ") ");
+}
+
+/*
+ * The sets of files are intersected (IN) and subtracted (NOT IN) in only
+ * one sub-query:
+ *
+ * assoc.file_id IN (
+ *   <SET> INTERSECT <SET> ... EXCEPT <SET> ...
+ * )
+ *
+ * or without IN:
+ *
+ * assoc.file_id NOT IN (
+ *   <SET> UNION <SET> ...
+ * )
+ */
+static void
+database_list_get_restriction (database_t *database, database_query_t *query,
+                               valhalla_db_restrict_t *restriction)
+{
+  int in = 0, notin = 0, equal = 0;
+  char *sql = query->sql;
+  char sql_tmp[SQL_BUFFER] = "( ";
+  valhalla_db_restrict_t *it;
+
+  for (it = restriction; it; it = it->next)
+  {
+    if (!it->meta.id && !it->meta.text)
+      continue; /* a restriction without meta is wrong */
+
+    if (it->op != VALHALLA_DB_OPERATOR_IN)
+      continue;
+
+    SQL_CONCAT (sql, in ? SELECT_LIST_SET_INTERSECT : SELECT_LIST_WHERE_SUB_IN);
+    database_list_get_restriction_set (database, query, it, sql);
+    in = 1;
+  }
+
+  for (it = restriction; it; it = it->next)
+  {
+    if (!it->meta.id && !it->meta.text)
+      continue;
+
+    if (it->op != VALHALLA_DB_OPERATOR_NOTIN)
+      continue;
+
+    if (in)
+      SQL_CONCAT (sql, SELECT_LIST_SET_EXCEPT);
+    else
+      SQL_CONCAT (sql, notin ? SELECT_LIST_SET_UNION
+                             : SELECT_LIST_WHERE_SUB_NOTIN);
+    database_list_get_restriction_set (database, query, it, sql);
+    notin = 1;
+  }
+
+  if (in || notin)
+    SQL_CONCAT (sql, SELECT_LIST_WHERE_SUB_END);
+
+  for (it = restriction; it; it = it->next)
+  {
+    if (!it->meta.id && !it->meta.text)
+      continue;
+
+    if (it->op != VALHALLA_DB_OPERATOR_EQUAL)
+      continue;
+
+    database_list_get_restriction_equal (database, query, it, sql_tmp, equal);
+    equal = 1;
+  }
+
+  if (equal)
+  {
+    if (in || notin)
+      SQL_CONCAT (sql, SELECT_LIST_AND);
+    /* not with SQL_CONCAT(), the conditions can be longer than its buffer */
+    if (strlen (sql) + strlen (sql_tmp) < SQL_BUFFER)
+      strcat (sql, sql_tmp);
+    SQL_CONCAT (sql, ") ");
+  }
+}
+
+/*
+ * Resume token: <list><sort><id1>:<id2>:<text>
+ *
+ *  list  'm' (metalist) or 'f' (filelist)
+ *  sort  'v' (VALUE) or 'i' (ID)
+ *  id1   meta_id or file_id
+ *  id2   data_id or 0
+ *  text  data_value, file_path or nothing (sort by ID)
+ */
+static int
+database_page_token_parse (const char *token, char list,
+                           valhalla_db_sort_t sort,
+                           int64_t *id1, int64_t *id2, const char **text)
+{
+  char l, t;
+  int n = 0;
+
+  if (sscanf (token, "%c%c%"SCNi64":%"SCNi64":%n", &l, &t, id1, id2, &n) != 4
+      || !n)
+    return -1;
+
+  if (l != list || t != (sort == VALHALLA_DB_SORT_VALUE ? 'v' : 'i'))
+    return -1;
+
+  *text = token + n;
+  return 0;
+}
+
+char *
+vh_database_page_token (vh_unused database_t *database,
+                        valhalla_db_stmt_t *vhstmt)
+{
+  int size;
+  char *token;
+  int64_t id1, id2 = 0;
+  const char *text = "";
+
+  /* no current row */
+  if (!vhstmt || !vhstmt->page_list || !vhstmt->cnt)
+    return NULL;
+
+  id1 = VHSTMT_INT64 (vhstmt, 0);
+  if (vhstmt->page_list == 'm')
+    id2 = VHSTMT_INT64 (vhstmt, 1);
+
+  if (vhstmt->page_sort == VALHALLA_DB_SORT_VALUE)
+    text = VHSTMT_TEXT (vhstmt, vhstmt->page_list == 'm' ? 3 : 1);
+
+  if (!text)
+    return NULL;
+
+  size = snprintf (NULL, 0, "%c%c%"PRIi64":%"PRIi64":%s",
+                   vhstmt->page_list,
+                   vhstmt->page_sort == VALHALLA_DB_SORT_VALUE ? 'v' : 'i',
+                   id1, id2, text) + 1;
+  token = malloc (size);
+  if (!token)
+    return NULL;
+
+  snprintf (token, size, "%c%c%"PRIi64":%"PRIi64":%s",
+            vhstmt->page_list,
+            vhstmt->page_sort == VALHALLA_DB_SORT_VALUE ? 'v' : 'i',
+            id1, id2, text);
+  return token;
+}
+
+/* Steps of the query of a statement (one by line), useful for the tests. */
+char *
+vh_database_query_plan (vh_unused database_t *database,
+                        valhalla_db_stmt_t *vhstmt)
+{
+  if (!vhstmt)
+    return NULL;
+
+  return database_query_plan_get (vhstmt->db, vhstmt->sql);
+}
+
+/*
+ * The statements prepared by the thread are aborted (SQLITE_INTERRUPT) when
+ * the callback returns !=0. It is useful only with the read-only connections
+ * where a long query must be stopped as soon as possible. NULL to unset.
+ */
+void
+vh_database_progress_set (database_t *database,
+                          const database_progress_t *progress)
+{
+  pthread_setspecific (database->progress, progress);
+}
+
+/* Release a statement before the last row. */
+void
+vh_database_vhstmt_free (vh_unused database_t *database,
+                         valhalla_db_stmt_t *vhstmt)
+{
+  database_vhstmt_free (vhstmt);
+}
+
+const valhalla_db_metares_t *
+vh_database_metalist_read (database_t *database, valhalla_db_stmt_t *vhstmt)
+{
+  int rc;
+  valhalla_db_metares_t *metares = &vhstmt->u.metares;
+
+  rc = database_sql_vhstmt (vhstmt->db, vhstmt);
+  if (rc) /* no more row */
+    return NULL;
+
+  if (vhstmt->cnt != 7)
+    goto err;
+
+  metares->meta_id    = VHSTMT_INT64 (vhstmt, 0);
+  metares->meta_name  = VHSTMT_TEXT  (vhstmt, 2);
+  metares->data_id    = VHSTMT_INT64 (vhstmt, 1);
+  metares->data_value = VHSTMT_TEXT  (vhstmt, 3);
+  metares->external   = (int) VHSTMT_INT64 (vhstmt, 6);
+  metares->group      =
+    database_group_get (database, VHSTMT_INT64 (vhstmt, 5));
+  metares->lang       =
+    database_lang_get  (database, VHSTMT_INT64 (vhstmt, 4));
+
+  return metares;
+
+ err:
+  database_vhstmt_free (vhstmt);
+  return NULL;
+}
+
+/* Conditions of the metadata, shared by the lists and the counts. */
+static void
+database_metalist_where (database_t *database, database_query_t *query,
+                         valhalla_db_item_t *search,
+                         valhalla_file_type_t filetype,
+                         valhalla_db_restrict_t *restriction)
+{
+  char *sql = query->sql;
+
+  /* WHERE */
+  SQL_CONCAT (sql, SELECT_LIST_WHERE);
+
+  /*
+   * assoc.file_id IN (
+   *   SELECT file_id
+   *   FROM file
+   *   WHERE _type_id = <ID>
+   * )
+   * <AND>
+   */
+  if (filetype)
+  {
+    SQL_CONCAT_ID (query, sql, SELECT_LIST_METADATA_WHERE_TYPE_ID,
+                   database_file_typeid_get (database, filetype));
+    /* AND */
+    if (restriction || search->id || search->text)
+      SQL_CONCAT (sql, SELECT_LIST_AND);
+  }
+
+  /*
+   * -- The sets of files of the restrictions are composed in a sub query.
+   * assoc.file_id <IN|NOT IN> (
+   *   SELECT sa.file_id
+   *   FROM assoc_file_metadata AS sa
+   *   WHERE sa.meta_id = <ID|(SELECT meta_id ... "TEXT")>
+   *     AND sa.data_id = <ID|(SELECT data_id ... "TEXT")>
+   *     AND sa.priority__ <= <PRIORITY>
+   *   <INTERSECT|EXCEPT|UNION>
+   *   ...
+   * )
+   * <AND>
+   */
+  if (restriction)
+  {
+    database_list_get_restriction (database, query, restriction);
+    /* AND */
+    if (search->id || search->text)
+      SQL_CONCAT (sql, SELECT_LIST_AND);
+  }
+
+  /*
+   * -- Metadata and/or group to list in the results.
+   * meta.<meta_id|meta_name> = <ID|"TEXT">
+   */
+  SQL_CONCAT_TYPE (query, sql, *search, META);
+  if (search->group)
+  {
+    /* AND */
+    if (search->id || search->text)
+      SQL_CONCAT (sql, SELECT_LIST_AND);
+    /* assoc._grp_id = <ID> */
+    SQL_CONCAT_ID (query, sql, SELECT_LIST_WHERE_GROUP_ID,
+                   database_groupid_get (database, search->group));
+  }
+  if (search->lang >= 0)
+  {
+    /* AND */
+    if (search->group || search->id || search->text || restriction)
+      SQL_CONCAT (sql, SELECT_LIST_AND);
+    /* data._lang_id = <ID> */
+    SQL_CONCAT_ID (query, sql, SELECT_LIST_WHERE_LANG_ID,
+                   database_langid_get (database, search->lang));
+  }
+  /* AND */
+  if (search->group || search->id || search->text || restriction
+      || search->lang >= 0)
+    SQL_CONCAT (sql, SELECT_LIST_AND);
+  /* assoc.priority__ <= <PRIORITY> */
+  SQL_CONCAT_ID (query, sql, SELECT_LIST_WHERE_PRIORITY, search->priority);
+}
+
+valhalla_db_stmt_t *
+vh_database_metalist_get (database_t *database,
+                          valhalla_db_item_t *search,
+                          valhalla_file_type_t filetype,
+                          valhalla_db_restrict_t *restriction,
+                          const valhalla_db_page_t *page)
+{
+  valhalla_db_stmt_t *vhstmt;
+  int64_t id1 = 0, id2 = 0;
+  const char *text = NULL;
+  /*
+   * SELECT meta.meta_id, data.data_id,
+   *        meta.meta_name, data.data_value,
+   *        data._lang_id,
+   *        assoc._grp_id, assoc.external
+   * FROM (
+   *   data INNER JOIN assoc_file_metadata AS assoc
+   *   ON data.data_id = assoc.data_id
+   * ) INNER JOIN meta
+   * ON assoc.meta_id = meta.meta_id
+   */
+  database_query_t query = { .sql = SELECT_LIST_METADATA_FROM };
+  char *sql = query.sql;
+
+  if (page && page->token
+      && database_page_token_parse (page->token, 'm', page->sort,
+                                    &id1, &id2, &text))
+  {
+    vh_log (VALHALLA_MSG_ERROR, "invalid resume token: %s", page->token);
+    return NULL;
+  }
+
+  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
+  if (!vhstmt)
+    return NULL;
+
+  if (page)
+  {
+    vhstmt->page_list = 'm';
+    vhstmt->page_sort = page->sort;
+    if (page->sort == VALHALLA_DB_SORT_VALUE)
+      strcpy (sql, SELECT_LIST_METADATA_FROM_VALUE);
+  }
+
+  database_metalist_where (database, &query, search, filetype, restriction);
+
+  if (page)
+  {
+    const char *op  = page->desc ? "<"    : ">";
+    const char *ord = page->desc ? "DESC" : "ASC";
+    unsigned int n1, n2;
+
+    /*
+     * AND data.data_value >= <VALUE>
+     * AND (data.data_value > <VALUE> OR assoc.meta_id > <ID>)
+     */
+    if (page->token)
+    {
+      if (page->sort == VALHALLA_DB_SORT_VALUE)
+      {
+        n1 = database_query_bind (&query, 0, text);
+        n2 = database_query_bind (&query, id1, NULL);
+        SQL_CONCAT (sql, SELECT_LIST_AND);
+        SQL_CONCAT (sql, SELECT_LIST_METADATA_KEY_VALUE,
+                    op, n1, op, n1, op, n2);
+      }
+      else
+      {
+        n1 = database_query_bind (&query, id2, NULL);
+        n2 = database_query_bind (&query, id1, NULL);
+        SQL_CONCAT (sql, SELECT_LIST_AND);
+        SQL_CONCAT (sql, SELECT_LIST_METADATA_KEY_ID,
+                    op, n1, op, n1, op, n2);
+      }
+    }
+
+    /*
+     * GROUP BY data.data_value, assoc.meta_id
+     * ORDER BY data.data_value <ASC|DESC>, assoc.meta_id <ASC|DESC>
+     * LIMIT <SIZE>;
+     */
+    n1 = database_query_bind (&query,
+                              page->size ? (int64_t) page->size : -1, NULL);
+    SQL_CONCAT (sql, page->sort == VALHALLA_DB_SORT_VALUE
+                     ? SELECT_LIST_METADATA_END_VALUE
+                     : SELECT_LIST_METADATA_END_ID, ord, ord, n1);
+  }
+  else
+    /*
+     * GROUP BY assoc.meta_id, assoc.data_id
+     * ORDER BY data.data_value;
+     */
+    SQL_CONCAT (sql, SELECT_LIST_METADATA_END);
+
+  return database_vhstmt_prepare (database, &query, vhstmt);
+}
+
+const valhalla_db_fileres_t *
+vh_database_filelist_read (database_t *database, valhalla_db_stmt_t *vhstmt)
+{
+  int rc;
+  valhalla_db_fileres_t *fileres = &vhstmt->u.fileres;
+
+  rc = database_sql_vhstmt (vhstmt->db, vhstmt);
+  if (rc) /* no more row */
+    return NULL;
+
+  if (vhstmt->cnt != 3)
+    goto err;
+
+  fileres->id   = VHSTMT_INT64 (vhstmt, 0);
+  fileres->path = VHSTMT_TEXT  (vhstmt, 1);
+  fileres->type = database_file_type_get (database, VHSTMT_INT64 (vhstmt, 2));
+
+  return fileres;
+
+ err:
+  database_vhstmt_free (vhstmt);
+  return NULL;
+}
+
+/*
+ * Conditions of the files, shared by the lists and the counts. The last AND
+ * is added for the key of the page.
+ */
+static void
+database_filelist_where (database_t *database, database_query_t *query,
+                         valhalla_file_type_t filetype,
+                         valhalla_db_restrict_t *restriction, int key)
+{
+  char *sql = query->sql;
+
+  /* WHERE */
+  if (restriction || filetype || key)
+    SQL_CONCAT (sql, SELECT_LIST_WHERE);
+
+  /*
+   * -- The sets of files of the restrictions are composed in a sub query.
+   * assoc.file_id <IN|NOT IN> (
+   *   SELECT sa.file_id
+   *   FROM assoc_file_metadata AS sa
+   *   WHERE sa.meta_id = <ID|(SELECT meta_id ... "TEXT")>
+   *     AND sa.data_id = <ID|(SELECT data_id ... "TEXT")>
+   *     AND sa.priority__ <= <PRIORITY>
+   *   <INTERSECT|EXCEPT|UNION>
+   *   ...
+   * )
+   * <AND>
+   */
+  if (restriction)
+    database_list_get_restriction (database, query, restriction);
+
+  if (filetype)
+  {
+    /* AND */
+    if (restriction)
+      SQL_CONCAT (sql, SELECT_LIST_AND);
+    /* _type_id = <ID> */
+    SQL_CONCAT_ID (query, sql, SELECT_LIST_WHERE_TYPE_ID,
+                   database_file_typeid_get (database, filetype));
+  }
+
+  /* AND */
+  if (key && (restriction || filetype))
+    SQL_CONCAT (sql, SELECT_LIST_AND);
+}
+
+valhalla_db_stmt_t *
+vh_database_filelist_get (database_t *database,
+                          valhalla_file_type_t filetype,
+                          valhalla_db_restrict_t *restriction,
+                          const valhalla_db_page_t *page)
+{
+  valhalla_db_stmt_t *vhstmt;
+  int64_t id1 = 0, id2 = 0;
+  const char *text = NULL;
+  /*
+   * SELECT file_id, file_path, _type_id
+   * FROM file AS assoc
+   */
+  database_query_t query = { .sql = SELECT_LIST_FILE_FROM };
+  char *sql = query.sql;
+  int token = page && page->token;
+
+  if (token && database_page_token_parse (page->token, 'f', page->sort,
+                                          &id1, &id2, &text))
+  {
+    vh_log (VALHALLA_MSG_ERROR, "invalid resume token: %s", page->token);
+    return NULL;
+  }
+
+  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
+  if (!vhstmt)
+    return NULL;
+
+  if (page)
+  {
+    vhstmt->page_list = 'f';
+    vhstmt->page_sort = page->sort;
+  }
+
+  database_filelist_where (database, &query, filetype, restriction, token);
+
+  if (page)
+  {
+    const char *op  = page->desc ? "<"    : ">";
+    const char *ord = page->desc ? "DESC" : "ASC";
+    unsigned int n;
+
+    /* <file_path|file_id> > <PATH|ID> */
+    if (token)
+    {
+      if (page->sort == VALHALLA_DB_SORT_VALUE)
+      {
+        n = database_query_bind (&query, 0, text);
+        SQL_CONCAT (sql, SELECT_LIST_FILE_KEY_VALUE, op, n);
+      }
+      else
+      {
+        n = database_query_bind (&query, id1, NULL);
+        SQL_CONCAT (sql, SELECT_LIST_FILE_KEY_ID, op, n);
+      }
+    }
+
+    /* ORDER BY <file_path|file_id> <ASC|DESC> LIMIT <SIZE>; */
+    n = database_query_bind (&query,
+                             page->size ? (int64_t) page->size : -1, NULL);
+    SQL_CONCAT (sql, page->sort == VALHALLA_DB_SORT_VALUE
+                     ? SELECT_LIST_FILE_END_VALUE
+                     : SELECT_LIST_FILE_END_ID, ord, n);
+  }
+  else
+    /* ORDER BY file_id; */
+    SQL_CONCAT (sql, SELECT_LIST_FILE_END);
+
+  return database_vhstmt_prepare (database, &query, vhstmt);
+}
+
+/* Metadata of a row of SELECT_FILE_FROM or SELECT_FILES_FROM. */
+static void
+database_file_metares_get (database_t *database, valhalla_db_stmt_t *vhstmt,
+                           valhalla_db_metares_t *metares)
+{
+  metares->meta_id    = VHSTMT_INT64 (vhstmt, 2);
+  metares->meta_name  = VHSTMT_TEXT  (vhstmt, 4);
+  metares->data_id    = VHSTMT_INT64 (vhstmt, 3);
+  metares->data_value = VHSTMT_TEXT  (vhstmt, 5);
+  metares->external   = (int) VHSTMT_INT64 (vhstmt, 7);
+  metares->group      =
+    database_group_get (database, VHSTMT_INT64 (vhstmt, 1));
+  metares->lang       =
+    database_lang_get  (database, VHSTMT_INT64 (vhstmt, 6));
+}
+
+const valhalla_db_metares_t *
+vh_database_file_read (database_t *database, valhalla_db_stmt_t *vhstmt)
+{
+  int rc;
+  valhalla_db_metares_t *metares = &vhstmt->u.metares;
+
+  rc = database_sql_vhstmt (vhstmt->db, vhstmt);
+  if (rc) /* no more row */
+    return NULL;
+
+  if (vhstmt->cnt != 8)
+    goto err;
+
+  database_file_metares_get (database, vhstmt, metares);
+  return metares;
+
+ err:
+  database_vhstmt_free (vhstmt);
+  return NULL;
+}
+
+valhalla_db_stmt_t *
+vh_database_file_get (database_t *database,
+                      int64_t id, const char *path,
+                      valhalla_db_restrict_t *restriction)
+{
+  valhalla_db_stmt_t *vhstmt;
+  /*
+   * SELECT file.file_id, assoc._grp_id,
+   *        meta.meta_id, data.data_id,
+   *        meta.meta_name, data.data_value,
+   *        data._lang_id, assoc.external
+   * FROM ((
+   *     file INNER JOIN assoc_file_metadata AS assoc
+   *     ON file.file_id = assoc.file_id
+   *   ) INNER JOIN data
+   *   ON data.data_id = assoc.data_id
+   * ) INNER JOIN meta
+   * ON assoc.meta_id = meta.meta_id
+   */
+  database_query_t query = { .sql = SELECT_FILE_FROM };
+  char *sql = query.sql;
+
+  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
+  if (!vhstmt)
+    return NULL;
+
+  /* WHERE */
+  SQL_CONCAT (sql, SELECT_LIST_WHERE);
+
+  /*
+   * -- The restrictions must use only the type EQUAL.
+   * -- Every restriction is separated by OR.
+   * (
+   *   (
+   *     meta.<meta_id|meta_name> = <ID|"TEXT">
+   *       AND data.<data_id|data_value> = <ID|"TEXT">
+   *       AND data._lang_id = <ID>
+   *       AND assoc.priority__ <= <PRIORITY>
+   *   )
+   *   <OR>
+   * )
+   */
+  if (restriction)
+  {
+    database_list_get_restriction (database, &query, restriction);
+    /* AND */
+    SQL_CONCAT (sql, SELECT_LIST_AND);
+  }
+
+  /* file.<file_id|file_path> = <ID|"PATH"> */
+  if (id)
+    SQL_CONCAT_ID (&query, sql, SELECT_FILE_WHERE_FILE_ID, id);
+  else if (path)
+    SQL_CONCAT_TEXT (&query, sql, SELECT_FILE_WHERE_FILE_PATH, path);
+  else
+  {
+    database_vhstmt_free (vhstmt);
+    return NULL;
+  }
+
+  /* ORDER BY assoc.priority__; */
+  SQL_CONCAT (sql, SELECT_FILE_END);
+
+  return database_vhstmt_prepare (database, &query, vhstmt);
+}
+
+const valhalla_db_filemetares_t *
+vh_database_files_read (database_t *database, valhalla_db_stmt_t *vhstmt)
+{
+  int rc;
+  valhalla_db_filemetares_t *filemetares = &vhstmt->u.filemetares;
+
+  rc = database_sql_vhstmt (vhstmt->db, vhstmt);
+  if (rc) /* no more row */
+    return NULL;
+
+  if (vhstmt->cnt != 9)
+    goto err;
+
+  filemetares->file_id = VHSTMT_INT64 (vhstmt, 0);
+  filemetares->path    = VHSTMT_TEXT  (vhstmt, 8);
+  database_file_metares_get (database, vhstmt, &filemetares->meta);
+
+  return filemetares;
+
+ err:
+  database_vhstmt_free (vhstmt);
+  return NULL;
+}
+
+valhalla_db_stmt_t *
+vh_database_files_get (database_t *database,
+                       const int64_t *ids, unsigned int nb,
+                       valhalla_file_type_t filetype,
+                       valhalla_db_restrict_t *restriction,
+                       const char *const *metas)
+{
+  valhalla_db_stmt_t *vhstmt;
+  unsigned int i, size;
+  /*
+   * SELECT file.file_id, assoc._grp_id,
+   *        meta.meta_id, data.data_id,
+   *        meta.meta_name, data.data_value,
+   *        data._lang_id, assoc.external, file.file_path
+   * FROM ((
+   *     file INNER JOIN assoc_file_metadata AS assoc
+   *     ON file.file_id = assoc.file_id
+   *   ) INNER JOIN data
+   *   ON data.data_id = assoc.data_id
+   * ) INNER JOIN meta
+   * ON assoc.meta_id = meta.meta_id
+   */
+  database_query_t query = { .sql = SELECT_FILES_FROM };
+  char *sql = query.sql;
+
+  if (nb > VALHALLA_DB_FILES_MAX || (nb && !ids))
+  {
+    vh_log (VALHALLA_MSG_ERROR, "invalid list of %u files", nb);
+    return NULL;
+  }
+
+  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
+  if (!vhstmt)
+    return NULL;
+
+  /* WHERE like vh_database_filelist_get() */
+  database_filelist_where (database, &query,
+                           filetype, restriction, nb || metas);
+
+  /*
+   * file.file_id IN ( <ID>, ... )
+   *
+   * The list is padded with the last id up to a power of two, then only
+   * a few statements are prepared for all the sizes.
+   */
+  if (nb)
+  {
+    for (size = 8; size < nb; size <<= 1)
+      ;
+
+    SQL_CONCAT (sql, SELECT_FILES_WHERE_FILE_IN);
+    for (i = 0; i < size; i++)
+    {
+      unsigned int n =
+        database_query_bind (&query, ids[i < nb ? i : nb - 1], NULL);
+      if (i)
+        SQL_CONCAT (sql, SELECT_FILES_VALUE_NEXT);
+      SQL_CONCAT (sql, SELECT_FILES_VALUE, n);
+    }
+    SQL_CONCAT (sql, SELECT_LIST_WHERE_SUB_END);
+
+    /* AND */
+    if (metas)
+      SQL_CONCAT (sql, SELECT_LIST_AND);
+  }
+
+  /* meta.meta_name IN ( "NAME", ... ) */
+  if (metas)
+  {
+    SQL_CONCAT (sql, SELECT_FILES_WHERE_META_IN);
+    for (i = 0; metas[i]; i++)
+    {
+      unsigned int n = database_query_bind (&query, 0, metas[i]);
+      if (i)
+        SQL_CONCAT (sql, SELECT_FILES_VALUE_NEXT);
+      SQL_CONCAT (sql, SELECT_FILES_VALUE, n);
+    }
+    SQL_CONCAT (sql, SELECT_LIST_WHERE_SUB_END);
+  }
+
+  /* ORDER BY file.file_id, assoc.priority__; */
+  SQL_CONCAT (sql, SELECT_FILES_END);
+
+  return database_vhstmt_prepare (database, &query, vhstmt);
+}
+
+/* Key of the cache of the counts, the SQL and the values. */
+static char *
+database_query_key (const database_query_t *query)
+{
+  unsigned int i;
+  size_t size = strlen (query->sql) + 1;
+  char *key, *it;
+
+  for (i = 0; i < query->nb; i++)
+    size += 24 + (query->binds[i].text ? strlen (query->binds[i].text) : 0);
+
+  key = malloc (size);
+  if (!key)
+    return NULL;
+
+  it = key + sprintf (key, "%s", query->sql);
+  for (i = 0; i < query->nb; i++)
+  {
+    const database_bind_t *bind = &query->binds[i];
+
+    if (bind->text)
+      it += sprintf (it, "\n%u:%s", (unsigned) strlen (bind->text), bind->text);
+    else
+      it += sprintf (it, "\n%"PRIi64, bind->id);
+  }
+
+  return key;
+}
+
+/*
+ * All rows of the count are read at once, then the statement is released
+ * and the rows are shared with the cache.
+ */
+static database_facet_t *
+database_facet_exec (database_t *database, database_query_t *query)
+{
+  int rc;
+  unsigned int size = 0;
+  valhalla_db_stmt_t *vhstmt;
+  database_facet_t *facet;
+
+  facet = calloc (1, sizeof (database_facet_t));
+  if (!facet)
+    return NULL;
+
+  facet->refs = 1;
+
+  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
+  if (!vhstmt)
+    goto err;
 
-  SQL_CONCAT (sql, ") ");
-}
+  vhstmt = database_vhstmt_prepare (database, query, vhstmt);
+  if (!vhstmt)
+    goto err;
 
-static void
-database_list_get_restriction (database_t *database,
-                               valhalla_db_restrict_t *restriction, char *sql)
-{
-  int equal = 0, restr = 0;
-  char sql_tmp[SQL_BUFFER] = "( ";
+  vh_log (VALHALLA_MSG_VERBOSE, "query: %s", vhstmt->sql);
 
-  for (; restriction; restriction = restriction->next)
+  while ((rc = sqlite3_step (vhstmt->stmt)) == SQLITE_ROW)
   {
-    if (!restriction->meta.id && !restriction->meta.text)
-      continue; /* a restriction without meta is wrong */
+    const char *text;
+    valhalla_db_countres_t *row;
 
-    switch (restriction->op)
+    if (facet->nb == size)
     {
-    case VALHALLA_DB_OPERATOR_IN:
-    case VALHALLA_DB_OPERATOR_NOTIN:
-      database_list_get_restriction_sub (database, restriction, sql);
-      restr = 1;
-      break;
+      valhalla_db_countres_t *rows;
 
-    case VALHALLA_DB_OPERATOR_EQUAL:
-      database_list_get_restriction_equal (database,
-                                           restriction, sql_tmp, equal);
-      equal = 1;
-      break;
+      size = size ? 2 * size : 16;
+      rows = realloc (facet->rows, size * sizeof (*rows));
+      if (!rows)
+        goto err;
+      facet->rows = rows;
+    }
+
+    row = &facet->rows[facet->nb++];
+    memset (row, 0, sizeof (*row));
 
-    default:
+    /* only COUNT(*) for the files */
+    if (sqlite3_column_count (vhstmt->stmt) == 1)
+    {
+      row->count = (unsigned int) VHSTMT_INT64 (vhstmt, 0);
       continue;
     }
 
-    if (restriction->next
-        && (restriction->next->op == VALHALLA_DB_OPERATOR_IN ||
-            restriction->next->op == VALHALLA_DB_OPERATOR_NOTIN))
-      SQL_CONCAT (sql, SELECT_LIST_AND);
+    row->meta_id = VHSTMT_INT64 (vhstmt, 0);
+    row->data_id = VHSTMT_INT64 (vhstmt, 1);
+    row->count   = (unsigned int) VHSTMT_INT64 (vhstmt, 3);
+    text = VHSTMT_TEXT (vhstmt, 2);
+    if (text)
+      row->data_value = strdup (text);
   }
 
-  if (equal)
+  if (rc != SQLITE_DONE)
   {
-    if (restr)
-      SQL_CONCAT (sql, SELECT_LIST_AND);
-    SQL_CONCAT (sql, "%s", sql_tmp);
-    SQL_CONCAT (sql, ") ");
+    if (rc != SQLITE_INTERRUPT)
+      vh_log (VALHALLA_MSG_ERROR, "%s - query: %s",
+              sqlite3_errmsg (vhstmt->db), vhstmt->sql);
+    goto err;
   }
+
+  database_vhstmt_free (vhstmt);
+  return facet;
+
+ err:
+  database_vhstmt_free (vhstmt);
+  database_facet_free (facet);
+  return NULL;
 }
 
-const valhalla_db_metares_t *
-vh_database_metalist_read (database_t *database, valhalla_db_stmt_t *vhstmt)
+/*
+ * The rows are computed only if they are not in the cache for the current
+ * generation of the database.
+ */
+static database_facet_t *
+database_facet_get (database_t *database, database_query_t *query)
 {
-  int rc;
-  valhalla_db_metares_t *metares = &vhstmt->u.metares;
+  char *key;
+  unsigned int generation;
+  database_facet_t *facet;
 
-  rc = database_sql_vhstmt (database->db, vhstmt);
-  if (rc) /* no more row */
+  key = database_query_key (query);
+  if (!key)
     return NULL;
 
-  if (vhstmt->cnt != 7)
-    goto err;
+  facet = database_count_get (database, key);
+  if (facet)
+    goto out;
 
-  metares->meta_id    = (int64_t) strtoimax (vhstmt->cols[0], NULL, 10);
-  metares->meta_name  = vhstmt->cols[2];
-  metares->data_id    = (int64_t) strtoimax (vhstmt->cols[1], NULL, 10);
-  metares->data_value = vhstmt->cols[3];
-  metares->external   = (int)     strtol    (vhstmt->cols[6], NULL, 10);
-  metares->group      =
-    database_group_get (database,
-                        (int64_t) strtoimax (vhstmt->cols[5], NULL, 10));
-  metares->lang       =
-    database_lang_get  (database,
-                        (int64_t) strtoimax (vhstmt->cols[4], NULL, 10));
+  generation = database_generation_get (database);
+  facet = database_facet_exec (database, query);
+  if (facet)
+    database_count_add (database, key, facet, generation);
 
-  return metares;
+ out:
+  free (key);
+  return facet;
+}
 
- err:
-  sqlite3_finalize (vhstmt->stmt);
+const valhalla_db_countres_t *
+vh_database_facet_read (vh_unused database_t *database,
+                        valhalla_db_stmt_t *vhstmt)
+{
+  if (vhstmt->facet && vhstmt->facet_pos < vhstmt->facet->nb)
+    return &vhstmt->facet->rows[vhstmt->facet_pos++];
+
+  /* no more row */
   database_vhstmt_free (vhstmt);
   return NULL;
 }
 
 valhalla_db_stmt_t *
-vh_database_metalist_get (database_t *database,
-                          valhalla_db_item_t *search,
-                          valhalla_file_type_t filetype,
-                          valhalla_db_restrict_t *restriction)
+vh_database_facet_get (database_t *database,
+                       valhalla_db_item_t *facet, valhalla_db_item_t *counted,
+                       valhalla_file_type_t filetype,
+                       valhalla_db_restrict_t *restriction)
 {
   valhalla_db_stmt_t *vhstmt;
   /*
-   * SELECT meta.meta_id, data.data_id,
-   *        meta.meta_name, data.data_value,
-   *        data._lang_id,
-   *        assoc._grp_id, assoc.external
+   * SELECT meta.meta_id, data.data_id, data.data_value,
+   *        COUNT(DISTINCT assoc.file_id)
    * FROM (
    *   data INNER JOIN assoc_file_metadata AS assoc
    *   ON data.data_id = assoc.data_id
    * ) INNER JOIN meta
    * ON assoc.meta_id = meta.meta_id
    */
-  char sql[SQL_BUFFER] = SELECT_LIST_METADATA_FROM;
-
-  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
-  if (!vhstmt)
-    return NULL;
-
-  /* WHERE */
-  SQL_CONCAT (sql, SELECT_LIST_WHERE);
+  database_query_t query = { .sql = SELECT_COUNT_FACET_FROM };
+  char *sql = query.sql;
 
-  /*
-   * assoc.file_id IN (
-   *   SELECT file_id
-   *   FROM file
-   *   WHERE _type_id = <ID>
-   * )
-   * <AND>
-   */
-  if (filetype)
+  if (counted)
   {
-    SQL_CONCAT (sql, SELECT_LIST_METADATA_WHERE_TYPE_ID,
-                database_file_typeid_get (database, filetype));
-    /* AND */
-    if (restriction || search->id || search->text)
+    /*
+     * SELECT meta.meta_id, data.data_id, data.data_value,
+     *        COUNT(DISTINCT cnt.data_id)
+     * FROM ( (
+     *   data INNER JOIN assoc_file_metadata AS assoc
+     *   ON data.data_id = assoc.data_id
+     * ) INNER JOIN meta
+     * ON assoc.meta_id = meta.meta_id
+     * ) LEFT JOIN assoc_file_metadata AS cnt
+     * ON cnt.file_id = assoc.file_id
+     *   AND cnt.priority__ <= <PRIORITY>
+     *   AND cnt.meta_id = <ID|(SELECT meta_id ... "TEXT")>
+     *   AND cnt._grp_id = <ID>
+     */
+    strcpy (sql, SELECT_COUNT_FACET_FROM_COUNTED);
+    SQL_CONCAT (sql, SELECT_LIST_AND);
+    SQL_CONCAT_ID (&query, sql,
+                   SELECT_COUNT_WHERE_COUNT_PRIORITY, counted->priority);
+    if (counted->id || counted->text)
+    {
       SQL_CONCAT (sql, SELECT_LIST_AND);
-  }
-
-  /*
-   * -- A sub query is created by every restriction.
-   * -- Every restriction is separated by AND.
-   * assoc.file_id <IN|NOT IN> (
-   *   SELECT assoc.file_id
-   *   FROM (
-   *     data INNER JOIN assoc_file_metadata AS assoc
-   *     ON data.data_id = assoc.data_id
-   *   ) INNER JOIN meta
-   *   ON assoc.meta_id = meta.meta_id
-   *   WHERE meta.<meta_id|meta_name>  = <ID|"TEXT">
-   *     AND data.<data_id|data_value> = <ID|"TEXT">
-   *     AND data._lang_id = <ID>
-   *     AND assoc.priority__ <= <PRIORITY>
-   * )
-   * <AND>
-   */
-  if (restriction)
-  {
-    database_list_get_restriction (database, restriction, sql);
-    /* AND */
-    if (search->id || search->text)
+      SQL_CONCAT_TYPE (&query, sql, *counted, COUNT);
+    }
+    if (counted->group)
+    {
       SQL_CONCAT (sql, SELECT_LIST_AND);
+      SQL_CONCAT_ID (&query, sql, SELECT_COUNT_WHERE_COUNT_GROUP_ID,
+                     database_groupid_get (database, counted->group));
+    }
   }
 
-  /*
-   * -- Metadata and/or group to list in the results.
-   * meta.<meta_id|meta_name> = <ID|"TEXT">
-   */
-  SQL_CONCAT_TYPE (sql, *search, META);
-  if (search->group)
-  {
-    /* AND */
-    if (search->id || search->text)
-      SQL_CONCAT (sql, SELECT_LIST_AND);
-    /* assoc._grp_id = <ID> */
-    SQL_CONCAT (sql, SELECT_LIST_WHERE_GROUP_ID,
-                database_groupid_get (database, search->group));
-  }
-  if (search->lang >= 0)
-  {
-    /* AND */
-    if (search->group || search->id || search->text || restriction)
-      SQL_CONCAT (sql, SELECT_LIST_AND);
-    /* data._lang_id = <ID> */
-    SQL_CONCAT (sql, SELECT_LIST_WHERE_LANG_ID,
-                database_langid_get (database, search->lang));
-  }
-  /* AND */
-  if (search->group || search->id || search->text || restriction
-      || search->lang >= 0)
-    SQL_CONCAT (sql, SELECT_LIST_AND);
-  /* assoc.priority__ <= <PRIORITY> */
-  SQL_CONCAT (sql, SELECT_LIST_WHERE_PRIORITY, search->priority);
+  /* WHERE like vh_database_metalist_get() */
+  database_metalist_where (database, &query, facet, filetype, restriction);
 
   /*
    * GROUP BY assoc.meta_id, assoc.data_id
    * ORDER BY data.data_value;
    */
-  SQL_CONCAT (sql, SELECT_LIST_METADATA_END);
+  SQL_CONCAT (sql, SELECT_COUNT_FACET_END);
+
+  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
+  if (!vhstmt)
+    return NULL;
+
+  vhstmt->database = database;
+  vhstmt->facet    = database_facet_get (database, &query);
+  if (!vhstmt->facet)
+  {
+    database_vhstmt_free (vhstmt);
+    return NULL;
+  }
 
-  VH_DB_RETURN_SQL_PREPARE (database, sql, vhstmt)
+  return vhstmt;
 }
 
-const valhalla_db_fileres_t *
-vh_database_filelist_read (database_t *database, valhalla_db_stmt_t *vhstmt)
+int64_t
+vh_database_count (database_t *database,
+                   valhalla_file_type_t filetype,
+                   valhalla_db_restrict_t *restriction)
 {
-  int rc;
-  valhalla_db_fileres_t *fileres = &vhstmt->u.fileres;
-
-  rc = database_sql_vhstmt (database->db, vhstmt);
-  if (rc) /* no more row */
-    return NULL;
+  int64_t count = -1;
+  database_facet_t *facet;
+  /*
+   * SELECT COUNT(*)
+   * FROM file AS assoc
+   */
+  database_query_t query = { .sql = SELECT_COUNT_FILE_FROM };
 
-  if (vhstmt->cnt != 3)
-    goto err;
+  /* WHERE like vh_database_filelist_get() */
+  database_filelist_where (database, &query, filetype, restriction, 0);
 
-  fileres->id   = (int64_t) strtoimax (vhstmt->cols[0], NULL, 10);
-  fileres->path = vhstmt->cols[1];
-  fileres->type =
-    database_file_type_get (database,
-                            (int64_t) strtoimax (vhstmt->cols[2], NULL, 10));
+  facet = database_facet_get (database, &query);
+  if (!facet)
+    return -1;
 
-  return fileres;
+  if (facet->nb == 1)
+    count = facet->rows[0].count;
 
- err:
-  sqlite3_finalize (vhstmt->stmt);
-  database_vhstmt_free (vhstmt);
-  return NULL;
+  database_facet_release (database, facet);
+  return count;
 }
 
-valhalla_db_stmt_t *
-vh_database_filelist_get (database_t *database,
-                          valhalla_file_type_t filetype,
-                          valhalla_db_restrict_t *restriction)
+/*
+ * The last word of the text is a prefix in the FTS5 query (the word is not
+ * fully typed). The words are quoted in order to ignore the syntax of FTS5
+ * (AND, NEAR, *, ...).
+ *
+ *   la guerre de -> "la" "guerre" "de"*
+ *   la guerre    -> "la" "guerre"
+ */
+static char *
+database_search_match (const char *text)
 {
-  valhalla_db_stmt_t *vhstmt;
-  /*
-   * SELECT file_id, file_path, _type_id
-   * FROM file AS assoc
-   */
-  char sql[SQL_BUFFER] = SELECT_LIST_FILE_FROM;
+  char *match, *it;
+  int word = 0;
 
-  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
-  if (!vhstmt)
+  match = malloc (4 * strlen (text) + 2);
+  if (!match)
     return NULL;
 
-  /* WHERE */
-  if (restriction || filetype)
-    SQL_CONCAT (sql, SELECT_LIST_WHERE);
+  for (it = match; *text; text++)
+  {
+    if (isspace ((unsigned char) *text))
+    {
+      if (word)
+      {
+        strcpy (it, "\" ");
+        it += 2;
+      }
+      word = 0;
+      continue;
+    }
 
-  /*
-   * -- A sub query is created by every restriction.
-   * -- Every restriction is separated by AND.
-   * assoc.file_id <IN|NOT IN> (
-   *   SELECT assoc.file_id
-   *   FROM (
-   *     data INNER JOIN assoc_file_metadata AS assoc
-   *     ON data.data_id = assoc.data_id
-   *   ) INNER JOIN meta
-   *   ON assoc.meta_id = meta.meta_id
-   *   WHERE meta.<meta_id|meta_name>  = <ID|"TEXT">
-   *     AND data.<data_id|data_value> = <ID|"TEXT">
-   *     AND data._lang_id = <ID>
-   *     AND assoc.priority__ <= <PRIORITY>
-   * )
-   * <AND>
-   */
-  if (restriction)
-    database_list_get_restriction (database, restriction, sql);
+    if (!word)
+      *it++ = '"';
+    word = 1;
 
-  if (filetype)
+    if (*text == '"')
+      *it++ = '"';
+    *it++ = *text;
+  }
+
+  if (word)
   {
-    /* AND */
-    if (restriction)
-      SQL_CONCAT (sql, SELECT_LIST_AND);
-    /* _type_id = <ID> */
-    SQL_CONCAT (sql, SELECT_LIST_WHERE_TYPE_ID,
-                database_file_typeid_get (database, filetype));
+    strcpy (it, "\"*");
+    it += 2;
   }
+  *it = '\0';
 
-  /* ORDER BY file_id; */
-  SQL_CONCAT (sql, SELECT_LIST_FILE_END);
+  if (!*match)
+  {
+    free (match);
+    return NULL;
+  }
 
-  VH_DB_RETURN_SQL_PREPARE (database, sql, vhstmt)
+  return match;
 }
 
-const valhalla_db_metares_t *
-vh_database_file_read (database_t *database, valhalla_db_stmt_t *vhstmt)
+const valhalla_db_searchres_t *
+vh_database_search_read (database_t *database, valhalla_db_stmt_t *vhstmt)
 {
   int rc;
-  valhalla_db_metares_t *metares = &vhstmt->u.metares;
+  valhalla_db_searchres_t *searchres = &vhstmt->u.searchres;
 
-  rc = database_sql_vhstmt (database->db, vhstmt);
+  rc = database_sql_vhstmt (vhstmt->db, vhstmt);
   if (rc) /* no more row */
     return NULL;
 
-  if (vhstmt->cnt != 8)
+  if (vhstmt->cnt != 6)
     goto err;
 
-  metares->meta_id    = (int64_t) strtoimax (vhstmt->cols[2], NULL, 10);
-  metares->meta_name  = vhstmt->cols[4];
-  metares->data_id    = (int64_t) strtoimax (vhstmt->cols[3], NULL, 10);
-  metares->data_value = vhstmt->cols[5];
-  metares->external   = (int)     strtol    (vhstmt->cols[7], NULL, 10);
-  metares->group      =
-    database_group_get (database,
-                        (int64_t) strtoimax (vhstmt->cols[1], NULL, 10));
-  metares->lang       =
-    database_lang_get  (database,
-                        (int64_t) strtoimax (vhstmt->cols[6], NULL, 10));
+  searchres->file_id    = VHSTMT_INT64 (vhstmt, 0);
+  searchres->meta_id    = VHSTMT_INT64 (vhstmt, 1);
+  searchres->data_id    = VHSTMT_INT64 (vhstmt, 2);
+  searchres->meta_name  = VHSTMT_TEXT  (vhstmt, 3);
+  searchres->data_value = VHSTMT_TEXT  (vhstmt, 4);
+  searchres->group      =
+    database_group_get (database, VHSTMT_INT64 (vhstmt, 5));
 
-  return metares;
+  return searchres;
 
  err:
-  sqlite3_finalize (vhstmt->stmt);
   database_vhstmt_free (vhstmt);
   return NULL;
 }
 
+/* The metadata of the search and the type of the files. */
+static void
+database_search_where (database_t *database, database_query_t *query,
+                       valhalla_file_type_t filetype)
+{
+  const char *const *it;
+  char *sql = query->sql;
+
+  /* meta.meta_name IN ( <NAME>, ... ) */
+  SQL_CONCAT (sql, SELECT_SEARCH_WHERE_META_IN);
+  for (it = database_search_meta (database); *it; it++)
+  {
+    if (it != database_search_meta (database))
+      SQL_CONCAT (sql, SELECT_SEARCH_META_NEXT);
+    SQL_CONCAT_TEXT (query, sql, SELECT_SEARCH_META, *it);
+  }
+  SQL_CONCAT (sql, SELECT_LIST_WHERE_SUB_END);
+
+  /*
+   * AND assoc.file_id IN (
+   *   SELECT file_id
+   *   FROM file
+   *   WHERE _type_id = <ID>
+   * )
+   */
+  if (filetype)
+  {
+    SQL_CONCAT (sql, SELECT_LIST_AND);
+    SQL_CONCAT_ID (query, sql, SELECT_LIST_METADATA_WHERE_TYPE_ID,
+                   database_file_typeid_get (database, filetype));
+  }
+}
+
 valhalla_db_stmt_t *
-vh_database_file_get (database_t *database,
-                      int64_t id, const char *path,
-                      valhalla_db_restrict_t *restriction)
+vh_database_search_get (database_t *database, const char *text,
+                        valhalla_file_type_t filetype, unsigned int max)
 {
   valhalla_db_stmt_t *vhstmt;
+  char *match;
   /*
-   * SELECT file.file_id, assoc._grp_id,
-   *        meta.meta_id, data.data_id,
-   *        meta.meta_name, data.data_value,
-   *        data._lang_id, assoc.external
-   * FROM ((
-   *     file INNER JOIN assoc_file_metadata AS assoc
-   *     ON file.file_id = assoc.file_id
-   *   ) INNER JOIN data
-   *   ON data.data_id = assoc.data_id
-   * ) INNER JOIN meta
-   * ON assoc.meta_id = meta.meta_id
+   * SELECT assoc.file_id, meta.meta_id, data.data_id,
+   *        meta.meta_name, data.data_value, assoc._grp_id
+   * FROM (
+   *   SELECT rowid
+   *   FROM data_fts
    */
-  char sql[SQL_BUFFER] = SELECT_FILE_FROM;
+  database_query_t query = { .sql = SELECT_SEARCH_FROM };
+  char *sql = query.sql;
 
-  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
-  if (!vhstmt)
+  if (!database->fts || !text)
     return NULL;
 
-  /* WHERE */
-  SQL_CONCAT (sql, SELECT_LIST_WHERE);
+  match = database_search_match (text);
+  if (!match)
+    return NULL;
 
   /*
-   * -- The restrictions must use only the type EQUAL.
-   * -- Every restriction is separated by OR.
-   * (
-   *   (
-   *     meta.<meta_id|meta_name> = <ID|"TEXT">
-   *       AND data.<data_id|data_value> = <ID|"TEXT">
-   *       AND data._lang_id = <ID>
-   *       AND assoc.priority__ <= <PRIORITY>
+   *   WHERE data_fts MATCH <"WORD" ... "WORD"*>
+   *   AND EXISTS (
+   *     SELECT 1
+   *     FROM assoc_file_metadata AS assoc
+   *     INNER JOIN meta
+   *     ON assoc.meta_id = meta.meta_id
+   *     WHERE assoc.data_id = data_fts.rowid
+   *     AND <META AND TYPE>
    *   )
-   *   <OR>
-   * )
+   *   ORDER BY length (data_value), data_value
+   *   LIMIT <VALUES>
+   * ) AS fts
    */
-  if (restriction)
-  {
-    database_list_get_restriction (database, restriction, sql);
-    /* AND */
-    SQL_CONCAT (sql, SELECT_LIST_AND);
-  }
+  SQL_CONCAT_TEXT (&query, sql, SELECT_SEARCH_MATCH, match);
+  SQL_CONCAT (sql, SELECT_SEARCH_EXISTS);
+  database_search_where (database, &query, filetype);
+  SQL_CONCAT_ID (&query, sql, SELECT_SEARCH_VALUES, DATABASE_SEARCH_VALUES);
 
-  /* file.<file_id|file_path> = <ID|"PATH"> */
-  if (id)
-    SQL_CONCAT (sql, SELECT_FILE_WHERE_FILE_ID, id);
-  else if (path)
-    SQL_CONCAT (sql, SELECT_FILE_WHERE_FILE_PATH, path);
-  else
-  {
-    database_vhstmt_free (vhstmt);
-    return NULL;
-  }
+  /*
+   * INNER JOIN data
+   * ON data.data_id = fts.rowid
+   * INNER JOIN assoc_file_metadata AS assoc
+   * ON assoc.data_id = data.data_id
+   * INNER JOIN meta
+   * ON assoc.meta_id = meta.meta_id
+   * WHERE <META AND TYPE>
+   */
+  SQL_CONCAT (sql, SELECT_SEARCH_JOIN);
+  SQL_CONCAT (sql, SELECT_LIST_WHERE);
+  database_search_where (database, &query, filetype);
 
-  /* ORDER BY assoc.priority__; */
-  SQL_CONCAT (sql, SELECT_FILE_END);
+  /*
+   * ORDER BY length (data.data_value), data.data_value, assoc.file_id
+   * LIMIT <MAX>;
+   */
+  SQL_CONCAT_ID (&query, sql, SELECT_SEARCH_END, max ? (int64_t) max : -1);
 
-  VH_DB_RETURN_SQL_PREPARE (database, sql, vhstmt)
+  vhstmt = calloc (1, sizeof (valhalla_db_stmt_t));
+  if (vhstmt)
+    vhstmt = database_vhstmt_prepare (database, &query, vhstmt);
+
+  /* the value is copied by sqlite3_bind_text() */
+  free (match);
+  return vhstmt;
 }
 
 /******************************************************************************/
@@ -2197,7 +4614,7 @@ vh_database_metadata_insert (database_t *database, const char *path,
     return -1;
 
   file_id =
-    database_table_get_id (database, STMT_GET (STMT_SELECT_FILE_ID), path);
+    database_file_id_get (database, path);
   if (!file_id)
     return -1; /* file unknown */
 
@@ -2233,8 +4650,10 @@ vh_database_metadata_insert (database_t *database, const char *path,
     if (!data_id)
     {
       int64_t lang_id = database_langid_get (database, lang);
-      data_id = database_data_insert (database, data, lang_id);
+      data_id = database_data_insert (database, meta, data, lang_id);
     }
+    else
+      database_data_fts_insert (database, meta, data_id, data);
     group_id = database_groupid_get (database, group);
     database_assoc_filemd_insert (database,
                                   file_id, meta_id, data_id,
@@ -2273,7 +4692,7 @@ vh_database_metadata_update (database_t *database, const char *path,
 
   database_assoc_filemd_delete (database, file_id, meta_id, data_id);
   lang_id = database_langid_get (database, lang);
-  data_id = database_data_insert (database, ndata, lang_id);
+  data_id = database_data_insert (database, meta, ndata, lang_id);
   database_assoc_filemd_insert (database,
                                 file_id, meta_id, data_id,
                                 group_id, 1, VALHALLA_METADATA_PL_HIGHEST);
@@ -2330,7 +4749,7 @@ vh_database_metadata_priority (database_t *database, const char *path,
     file_id = database_file_id_by_metadata (database, path, meta, data);
   else
     file_id =
-      database_table_get_id (database, STMT_GET (STMT_SELECT_FILE_ID), path);
+      database_file_id_get (database, path);
 
   if (!file_id)
     return 0; /* association unknown */
@@ -24,17 +24,37 @@
 
 #include "utils.h"
 #include "list.h"
+#include "stats.h"
 
 typedef struct database_s database_t;
 
+/* Callback called during the steps, !=0 to abort the statement. */
+typedef struct database_progress_s {
+  int  (*cb) (void *data);
+  void  *data;
+} database_progress_t;
+
+typedef enum database_pragma {
+  DATABASE_PRAGMA_CACHE = 0,  /* KiB                      */
+  DATABASE_PRAGMA_JOURNAL,    /* valhalla_db_journal_t    */
+  DATABASE_PRAGMA_MMAP,       /* MiB                      */
+  DATABASE_PRAGMA_SYNC,       /* valhalla_db_sync_t       */
+  DATABASE_PRAGMA_TEMPSTORE,  /* valhalla_db_tempstore_t  */
+  DATABASE_PRAGMA_NB
+} database_pragma_t;
+
 void vh_database_file_insert (database_t *database, file_data_t *data);
 void vh_database_file_data_update (database_t *database, file_data_t *data);
 void vh_database_file_delete (database_t *database, const char *file);
+void vh_database_dir_delete (database_t *database, const char *dir);
 void vh_database_file_data_delete (database_t *database, const char *file);
 void vh_database_file_grab_insert (database_t *database, file_data_t *data);
 void vh_database_file_grab_update (database_t *database, file_data_t *data);
 void vh_database_file_grab_delete (database_t *database, const char *file);
 int64_t vh_database_file_get_mtime (database_t *db, const char *file);
+void vh_database_file_get_mtime_batch (database_t *database,
+                                       file_data_t **files, unsigned int nb,
+                                       int64_t *mtime, int *interrup);
 void vh_database_file_get_grabber (database_t *database,
                                    const char *file, list_t *l);
 void vh_database_file_insert_dlcontext (database_t *database,
@@ -52,28 +72,44 @@ void vh_database_file_checked_clear (database_t *database);
 const char *vh_database_file_get_checked_clear (database_t *database, int rst);
 const char *vh_database_file_get_outofpath_set (database_t *database, int rst);
 
+int vh_database_dir_get (database_t *database,
+                         dir_list_t *list, const char *sig);
+void vh_database_dir_set (database_t *database, dir_list_t *list);
+void vh_database_dir_checked (database_t *database, const char *dir);
+
+void vh_database_search_meta_add (database_t *database, const char *meta);
+void vh_database_search_sync (database_t *database);
+
 void vh_database_begin_transaction (database_t *database);
 void vh_database_end_transaction (database_t *database);
 void vh_database_step_transaction (database_t *database,
                                    unsigned int interval, int value);
 
-database_t *vh_database_init (const char *path);
+database_t *vh_database_init (const char *path, int file_index);
 void vh_database_uninit (database_t *database);
 int vh_database_cleanup (database_t *database);
+int vh_database_pragma_set (database_t *database,
+                            database_pragma_t pragma, int value);
+void vh_database_file_index_stats (database_t *database,
+                                   unsigned int *nb, size_t *size);
+void vh_database_cache_stats_set (database_t *database,
+                                  vh_stats_cnt_t *hit, vh_stats_cnt_t *miss);
 
 
 valhalla_db_stmt_t *
 vh_database_metalist_get (database_t *database,
                           valhalla_db_item_t *search,
                           valhalla_file_type_t filetype,
-                          valhalla_db_restrict_t *restriction);
+                          valhalla_db_restrict_t *restriction,
+                          const valhalla_db_page_t *page);
 const valhalla_db_metares_t *
 vh_database_metalist_read (database_t *database, valhalla_db_stmt_t *vhstmt);
 
 valhalla_db_stmt_t *
 vh_database_filelist_get (database_t *database,
                           valhalla_file_type_t filetype,
-                          valhalla_db_restrict_t *restriction);
+                          valhalla_db_restrict_t *restriction,
+                          const valhalla_db_page_t *page);
 const valhalla_db_fileres_t *
 vh_database_filelist_read (database_t *database, valhalla_db_stmt_t *vhstmt);
 
@@ -83,6 +119,38 @@ vh_database_file_get (database_t *database, int64_t id, const char *path,
 const valhalla_db_metares_t *
 vh_database_file_read (database_t *database, valhalla_db_stmt_t *vhstmt);
 
+valhalla_db_stmt_t *
+vh_database_files_get (database_t *database,
+                       const int64_t *ids, unsigned int nb,
+                       valhalla_file_type_t filetype,
+                       valhalla_db_restrict_t *restriction,
+                       const char *const *metas);
+const valhalla_db_filemetares_t *
+vh_database_files_read (database_t *database, valhalla_db_stmt_t *vhstmt);
+
+char *vh_database_page_token (database_t *database, valhalla_db_stmt_t *vhstmt);
+char *vh_database_query_plan (database_t *database, valhalla_db_stmt_t *vhstmt);
+void vh_database_progress_set (database_t *database,
+                               const database_progress_t *progress);
+void vh_database_vhstmt_free (database_t *database, valhalla_db_stmt_t *vhstmt);
+
+valhalla_db_stmt_t *
+vh_database_facet_get (database_t *database,
+                       valhalla_db_item_t *facet, valhalla_db_item_t *counted,
+                       valhalla_file_type_t filetype,
+                       valhalla_db_restrict_t *restriction);
+const valhalla_db_countres_t *
+vh_database_facet_read (database_t *database, valhalla_db_stmt_t *vhstmt);
+int64_t vh_database_count (database_t *database,
+                           valhalla_file_type_t filetype,
+                           valhalla_db_restrict_t *restriction);
+
+valhalla_db_stmt_t *
+vh_database_search_get (database_t *database, const char *text,
+                        valhalla_file_type_t filetype, unsigned int max);
+const valhalla_db_searchres_t *
+vh_database_search_read (database_t *database, valhalla_db_stmt_t *vhstmt);
+
 
 int vh_database_metadata_insert (database_t *database, const char *path,
                                  const char *meta, const char *data,
@@ -22,6 +22,7 @@
 #include <pthread.h>
 #include <semaphore.h>
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include <unistd.h>
 
@@ -59,6 +60,10 @@ struct dbmanager_s {
   vh_stats_cnt_t *st_delete;
   vh_stats_cnt_t *st_nochange;
   vh_stats_cnt_t *st_cleanup;
+  vh_stats_cnt_t *st_index_files;
+  vh_stats_cnt_t *st_index_bytes;
+  vh_stats_cnt_t *st_cache_hit;
+  vh_stats_cnt_t *st_cache_miss;
 };
 
 #define STATS_GROUP     "dbmanager"
@@ -67,6 +72,13 @@ struct dbmanager_s {
 #define STATS_DELETE    "delete"
 #define STATS_NOCHANGE  "nochange"
 #define STATS_CLEANUP   "cleanup"
+#define STATS_IDXFILES  "index_files"
+#define STATS_IDXBYTES  "index_bytes"
+#define STATS_HIT       "cache_hit"
+#define STATS_MISS      "cache_miss"
+
+/* Number of new files handled together, see dbmanager_newfile_flush(). */
+#define DBMANAGER_NEWFILE_BATCH 64
 
 
 static inline int
@@ -96,33 +108,218 @@ vh_dbmanager_extmd_free (dbmanager_extmd_t *extmd)
   free (extmd);
 }
 
+static void
+dbmanager_transaction_step (dbmanager_t *dbmanager, int grab)
+{
+  int interval;
+
+  interval  = (int) vh_stats_counter_read (dbmanager->st_insert);
+  interval += (int) vh_stats_counter_read (dbmanager->st_update);
+  interval += grab;
+  vh_database_step_transaction (dbmanager->database,
+                                dbmanager->commit_int, interval);
+}
+
+/*
+ * Handle a new file from the scanner. 1 is returned if the file is sent
+ * to the dispatcher, 0 if the file is unchanged (it must be acknowledged).
+ */
+static int
+dbmanager_newfile (dbmanager_t *dbmanager,
+                   file_data_t *pdata, int64_t mtime, int interrup)
+{
+  /*
+   * File is parsed only if mtime has changed, if the grabbing/downloading
+   * was interrupted or if it is unexistant in the database.
+   *
+   * 'interrup' takes three possible values.
+   *   0: the file is fully handled (set by ACTION_DB_END).
+   *  -1: the file is only inserted in the DB (set by ACTION_DB_NEWFILE),
+   *      but the data provided by the parser are not available. This
+   *      state is only useful in the case where an ondemand query is
+   *      running for the same file between ACTION_DB_NEWFILE and
+   *      ACTION_DB_INSERT_P.
+   *   1: the data from the parser are in the DB, but the file is not
+   *      fully handled by the grabbers and the downloader (set by
+   *      ACTION_DB_INSERT_P/UPDATE_P).
+   */
+  if (mtime >= 0)
+  {
+    /*
+     * Retrieve the list of all grabbers already handled for this file
+     * and search if there are files to download since the interruption.
+     * But if mtime has changed, the file must be _fully_ updated.
+     */
+    if (interrup == 1 && pdata->file.mtime == mtime)
+    {
+      vh_database_file_get_grabber (dbmanager->database,
+                                    pdata->file.path, pdata->grabber_list);
+      vh_database_file_get_dlcontext (dbmanager->database, pdata->file.path,
+                                      &pdata->list_downloader);
+    }
+    /*
+     * Delete all previous associations on the file because the main
+     * metadata have changed.
+     */
+    else if (pdata->file.mtime != mtime)
+    {
+      vh_database_file_data_delete (dbmanager->database, pdata->file.path);
+      vh_database_file_grab_delete (dbmanager->database, pdata->file.path);
+    }
+  }
+  else
+  {
+    vh_database_file_insert (dbmanager->database, pdata);
+    VH_STATS_COUNTER_INC (dbmanager->st_insert);
+  }
+
+  if (mtime < 0 || pdata->file.mtime != mtime || interrup == 1)
+  {
+    int act = mtime < 0 ? ACTION_DB_INSERT_P : ACTION_DB_UPDATE_P;
+    vh_dispatcher_action_send (VH_HANDLE->dispatcher,
+                               pdata->priority, act, pdata);
+    return 1;
+  }
+
+  if (pdata->od != OD_TYPE_DEF)
+    vh_event_handler_od_send (VH_HANDLE->event_handler,
+                              pdata->file.path,
+                              VALHALLA_EVENTOD_ENDED, NULL, NULL);
+  VH_STATS_COUNTER_INC (dbmanager->st_nochange);
+  return 0;
+}
+
+static int
+dbmanager_file_cmp (const void *a, const void *b)
+{
+  return strcmp ((*(file_data_t * const *) a)->file.path,
+                 (*(file_data_t * const *) b)->file.path);
+}
+
+/*
+ * Handle the new files of the scanner with one query for all mtimes
+ * (instead of two for each file). With a rescan, most of the files are
+ * unchanged and they are acknowledged together.
+ */
+static void
+dbmanager_newfile_flush (dbmanager_t *dbmanager,
+                         file_data_t **batch, unsigned int nb, int grab)
+{
+  unsigned int i, ack = 0;
+  int64_t mtime[DBMANAGER_NEWFILE_BATCH];
+  int interrup[DBMANAGER_NEWFILE_BATCH];
+  char dup[DBMANAGER_NEWFILE_BATCH];
+
+  qsort (batch, nb, sizeof (*batch), dbmanager_file_cmp);
+  vh_database_file_get_mtime_batch (dbmanager->database,
+                                    batch, nb, mtime, interrup);
+
+  /* the files are released in the loop */
+  for (i = 0; i < nb; i++)
+    dup[i] = i && !strcmp (batch[i - 1]->file.path, batch[i]->file.path);
+
+  for (i = 0; i < nb; i++)
+  {
+    file_data_t *pdata = batch[i];
+
+    /* the previous one (same file) has changed the database */
+    if (dup[i])
+    {
+      mtime[i] =
+        vh_database_file_get_mtime (dbmanager->database, pdata->file.path);
+      interrup[i] = mtime[i] < 0 ? -1 :
+        vh_database_file_get_interrupted (dbmanager->database,
+                                          pdata->file.path);
+    }
+
+    /* Manage BEGIN / COMMIT transactions */
+    dbmanager_transaction_step (dbmanager, grab);
+
+    if (dbmanager_newfile (dbmanager, pdata, mtime[i], interrup[i]))
+      continue;
+
+    vh_file_data_free (pdata);
+    ack++;
+  }
+
+  if (ack)
+    vh_scanner_action_send (VH_HANDLE->scanner, FIFO_QUEUE_PRIORITY_NORMAL,
+                            ACTION_ACKNOWLEDGE, VH_ACK_DATA (ack));
+}
+
+static void
+dbmanager_index_stats (dbmanager_t *dbmanager)
+{
+  unsigned int nb;
+  size_t size;
+
+  vh_database_file_index_stats (dbmanager->database, &nb, &size);
+  VH_STATS_COUNTER_SET (dbmanager->st_index_files, nb);
+  VH_STATS_COUNTER_SET (dbmanager->st_index_bytes, size);
+}
+
 static int
 dbmanager_queue (dbmanager_t *dbmanager)
 {
   int res;
   int e;
   int grab = 0;
+  int deleted = 0;
+  uint64_t updated = vh_stats_counter_read (dbmanager->st_update);
   void *data = NULL;
   file_data_t *pdata;
+  file_data_t *batch[DBMANAGER_NEWFILE_BATCH];
+  unsigned int batch_nb = 0;
 
   do
   {
-    int interval;
     e = ACTION_NO_OPERATION;
     data = NULL;
 
-    res = vh_fifo_queue_pop (dbmanager->fifo, &e, &data);
+    /* the new files are handled when the queue is empty (or the batch full) */
+    if (batch_nb)
+    {
+      res = vh_fifo_queue_trypop (dbmanager->fifo, &e, &data);
+      if (res == FIFO_QUEUE_ERROR_EMPTY)
+      {
+        dbmanager_newfile_flush (dbmanager, batch, batch_nb, grab);
+        batch_nb = 0;
+        continue;
+      }
+    }
+    else
+      res = vh_fifo_queue_pop (dbmanager->fifo, &e, &data);
     if (res || e == ACTION_NO_OPERATION)
       continue;
 
     if (e == ACTION_KILL_THREAD)
       goto out;
 
+    pdata = data;
+    if (e == ACTION_DB_NEWFILE && pdata && pdata->od == OD_TYPE_DEF)
+    {
+      batch[batch_nb++] = pdata;
+      if (batch_nb == DBMANAGER_NEWFILE_BATCH)
+      {
+        dbmanager_newfile_flush (dbmanager, batch, batch_nb, grab);
+        batch_nb = 0;
+      }
+      continue;
+    }
+
+    /* the order is preserved with the other actions */
+    if (batch_nb)
+    {
+      dbmanager_newfile_flush (dbmanager, batch, batch_nb, grab);
+      batch_nb = 0;
+    }
+
     if (e == ACTION_DB_NEXT_LOOP)
     {
       vh_dispatcher_action_send (VH_HANDLE->dispatcher,
                                  FIFO_QUEUE_PRIORITY_NORMAL, e, NULL);
 
+      dbmanager_index_stats (dbmanager);
       vh_stats_dump (VH_HANDLE->stats, NULL);
       goto out;
     }
@@ -186,16 +383,62 @@ dbmanager_queue (dbmanager_t *dbmanager)
       vh_dbmanager_extmd_free (extmd);
       continue;
     }
+
+    /* Directories Handling (scanner) */
+    case ACTION_DB_DIR_CHECKED:
+      if (!data)
+        continue;
+
+      vh_database_dir_checked (dbmanager->database, data);
+      free (data);
+      continue;
+
+    case ACTION_DB_DIRS:
+      if (!data)
+        continue;
+
+      vh_database_dir_set (dbmanager->database, data);
+      vh_dir_list_free (data);
+      continue;
+
+    /* Watch Mode Handling (scanner) */
+    case ACTION_DB_DELFILE:
+    case ACTION_DB_DELDIR:
+      if (!data)
+        continue;
+
+      if (e == ACTION_DB_DELFILE)
+        vh_database_file_delete (dbmanager->database, data);
+      else
+        vh_database_dir_delete (dbmanager->database, data);
+      VH_STATS_COUNTER_INC (dbmanager->st_delete);
+      deleted++;
+      free (data);
+      continue;
+
+    case ACTION_DB_COMMIT:
+    {
+      uint64_t upd = vh_stats_counter_read (dbmanager->st_update);
+
+      /* Clean all relations */
+      if (deleted || upd != updated)
+      {
+        int val = vh_database_cleanup (dbmanager->database);
+        if (val > 0)
+          VH_STATS_COUNTER_ACC (dbmanager->st_cleanup, (uint64_t) val);
+      }
+
+      deleted = 0;
+      updated = upd;
+      vh_database_end_transaction (dbmanager->database);
+      vh_database_begin_transaction (dbmanager->database);
+      dbmanager_index_stats (dbmanager);
+      continue;
+    }
     }
 
     /* Manage BEGIN / COMMIT transactions */
-    interval  = (int) vh_stats_counter_read (dbmanager->st_insert);
-    interval += (int) vh_stats_counter_read (dbmanager->st_update);
-    interval += grab;
-    vh_database_step_transaction (dbmanager->database,
-                                  dbmanager->commit_int, interval);
-
-    pdata = data;
+    dbmanager_transaction_step (dbmanager, grab);
 
     switch (e)
     {
@@ -221,8 +464,6 @@ dbmanager_queue (dbmanager_t *dbmanager)
       vh_database_file_grab_insert (dbmanager->database, pdata);
     case ACTION_DB_UPDATE_G:
     {
-      int res;
-
       if (e == ACTION_DB_UPDATE_G)
         vh_database_file_grab_update (dbmanager->database, pdata);
 
@@ -232,12 +473,11 @@ dbmanager_queue (dbmanager_t *dbmanager)
                                   VALHALLA_EVENTOD_GRABBED,
                                   pdata->grabber_name,
                                   pdata->meta_grabber);
-      res = vh_event_handler_md_send (VH_HANDLE->event_handler,
-                                      VALHALLA_EVENTMD_GRABBER,
-                                      pdata->grabber_name, &pdata->file,
-                                      pdata->meta_grabber);
-      if (res)
-        vh_metadata_free (pdata->meta_grabber);
+      vh_event_handler_md_send (VH_HANDLE->event_handler,
+                                VALHALLA_EVENTMD_GRABBER,
+                                pdata->grabber_name, &pdata->file,
+                                pdata->meta_grabber);
+      /* the items stay in the arena until the end of the file */
       pdata->meta_grabber = NULL;
 
       if (pdata->wait)
@@ -262,73 +502,20 @@ dbmanager_queue (dbmanager_t *dbmanager)
                                 &pdata->file, pdata->meta_parser);
       continue;
 
-    /* received from the scanner */
+    /* received from the scanner (only on-demand, the others are batched) */
     case ACTION_DB_NEWFILE:
     {
-      int interrup = 0;
+      int interrup = -1;
       int64_t mtime =
         vh_database_file_get_mtime (dbmanager->database, pdata->file.path);
-      /*
-       * File is parsed only if mtime has changed, if the grabbing/downloading
-       * was interrupted or if it is unexistant in the database.
-       *
-       * 'interrup' takes three possible values.
-       *   0: the file is fully handled (set by ACTION_DB_END).
-       *  -1: the file is only inserted in the DB (set by ACTION_DB_NEWFILE),
-       *      but the data provided by the parser are not available. This
-       *      state is only useful in the case where an ondemand query is
-       *      running for the same file between ACTION_DB_NEWFILE and
-       *      ACTION_DB_INSERT_P.
-       *   1: the data from the parser are in the DB, but the file is not
-       *      fully handled by the grabbers and the downloader (set by
-       *      ACTION_DB_INSERT_P/UPDATE_P).
-       */
+
       if (mtime >= 0)
-      {
         interrup =
           vh_database_file_get_interrupted (dbmanager->database,
                                             pdata->file.path);
-        /*
-         * Retrieve the list of all grabbers already handled for this file
-         * and search if there are files to download since the interruption.
-         * But if mtime has changed, the file must be _fully_ updated.
-         */
-        if (interrup == 1 && pdata->file.mtime == mtime)
-        {
-          vh_database_file_get_grabber (dbmanager->database,
-                                        pdata->file.path, pdata->grabber_list);
-          vh_database_file_get_dlcontext (dbmanager->database, pdata->file.path,
-                                          &pdata->list_downloader);
-        }
-        /*
-         * Delete all previous associations on the file because the main
-         * metadata have changed.
-         */
-        else if (pdata->file.mtime != mtime)
-        {
-          vh_database_file_data_delete (dbmanager->database, pdata->file.path);
-          vh_database_file_grab_delete (dbmanager->database, pdata->file.path);
-        }
-      }
-      else
-      {
-        vh_database_file_insert (dbmanager->database, pdata);
-        VH_STATS_COUNTER_INC (dbmanager->st_insert);
-      }
-
-      if (mtime < 0 || pdata->file.mtime != mtime || interrup == 1)
-      {
-        int act = mtime < 0 ? ACTION_DB_INSERT_P : ACTION_DB_UPDATE_P;
-        vh_dispatcher_action_send (VH_HANDLE->dispatcher,
-                                   pdata->priority, act, pdata);
+      if (dbmanager_newfile (dbmanager, pdata, mtime, interrup))
         continue;
-      }
-
-      if (pdata->od != OD_TYPE_DEF)
-        vh_event_handler_od_send (VH_HANDLE->event_handler,
-                                  pdata->file.path,
-                                  VALHALLA_EVENTOD_ENDED, NULL, NULL);
-      VH_STATS_COUNTER_INC (dbmanager->st_nochange);
+      break;
     }
     }
 
@@ -344,6 +531,10 @@ dbmanager_queue (dbmanager_t *dbmanager)
   e = ACTION_KILL_THREAD;
 
  out:
+  /* the files are dropped, they will be scanned again */
+  while (batch_nb)
+    vh_file_data_free (batch[--batch_nb]);
+
   /* Change files where interrupted__ is -1 to 1. */
   vh_database_file_interrupted_fix (dbmanager->database);
 
@@ -371,6 +562,9 @@ dbmanager_thread (void *arg)
    */
   vh_database_file_interrupted_fix (dbmanager->database);
 
+  /* The full-text index follows the list of the metadata. */
+  vh_database_search_sync (dbmanager->database);
+
   do
   {
     int stats_delete   = 0;
@@ -490,6 +684,18 @@ vh_dbmanager_fifo_get (dbmanager_t *dbmanager)
   return dbmanager->fifo;
 }
 
+/* For the asynchronous selections (the database is thread-safe). */
+database_t *
+vh_dbmanager_database_get (dbmanager_t *dbmanager)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return NULL;
+
+  return dbmanager->database;
+}
+
 void
 vh_dbmanager_pause (dbmanager_t *dbmanager)
 {
@@ -584,10 +790,19 @@ dbmanager_stats_dump (vh_stats_t *stats, void *data)
           vh_stats_counter_read (dbmanager->st_nochange));
   vh_log (VALHALLA_MSG_INFO, "Relations cleaned | %"PRIu64,
           vh_stats_counter_read (dbmanager->st_cleanup));
+  vh_log (VALHALLA_MSG_INFO, "Indexed files     | %"PRIu64,
+          vh_stats_counter_read (dbmanager->st_index_files));
+  vh_log (VALHALLA_MSG_INFO, "Index memory (B)  | %"PRIu64,
+          vh_stats_counter_read (dbmanager->st_index_bytes));
+  vh_log (VALHALLA_MSG_INFO, "Query cache hits  | %"PRIu64,
+          vh_stats_counter_read (dbmanager->st_cache_hit));
+  vh_log (VALHALLA_MSG_INFO, "Query cache miss  | %"PRIu64,
+          vh_stats_counter_read (dbmanager->st_cache_miss));
 }
 
 dbmanager_t *
-vh_dbmanager_init (valhalla_t *handle, const char *db, unsigned int commit_int)
+vh_dbmanager_init (valhalla_t *handle, const char *db,
+                   unsigned int commit_int, int file_index)
 {
   dbmanager_t *dbmanager;
 
@@ -604,7 +819,7 @@ vh_dbmanager_init (valhalla_t *handle, const char *db, unsigned int commit_int)
   if (!dbmanager->fifo)
     goto err;
 
-  dbmanager->database = vh_database_init (db);
+  dbmanager->database = vh_database_init (db, file_index);
   if (!dbmanager->database)
     goto err;
 
@@ -630,6 +845,20 @@ vh_dbmanager_init (valhalla_t *handle, const char *db, unsigned int commit_int)
     vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_NOCHANGE, NULL);
   dbmanager->st_cleanup =
     vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_CLEANUP,  NULL);
+  dbmanager->st_index_files =
+    vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_IDXFILES, NULL);
+  dbmanager->st_index_bytes =
+    vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_IDXBYTES, NULL);
+  dbmanager->st_cache_hit =
+    vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_HIT,      NULL);
+  dbmanager->st_cache_miss =
+    vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_MISS,     NULL);
+  dbmanager_index_stats (dbmanager);
+
+  /* public selections */
+  vh_database_cache_stats_set (dbmanager->database,
+                               dbmanager->st_cache_hit,
+                               dbmanager->st_cache_miss);
 
   return dbmanager;
 
@@ -675,6 +904,18 @@ vh_dbmanager_file_complete (dbmanager_t *dbmanager,
   return !res;
 }
 
+int
+vh_dbmanager_db_dir_get (dbmanager_t *dbmanager,
+                         dir_list_t *list, const char *sig)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager || !list)
+    return -1;
+
+  return vh_database_dir_get (dbmanager->database, list, sig);
+}
+
 void
 vh_dbmanager_db_dlcontext_save (dbmanager_t *dbmanager, file_data_t *data)
 {
@@ -697,6 +938,29 @@ vh_dbmanager_db_dlcontext_delete (dbmanager_t *dbmanager)
   vh_database_delete_dlcontext (dbmanager->database);
 }
 
+int
+vh_dbmanager_db_pragma_set (dbmanager_t *dbmanager,
+                            database_pragma_t pragma, int value)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return -1;
+
+  return vh_database_pragma_set (dbmanager->database, pragma, value);
+}
+
+void
+vh_dbmanager_db_search_meta_add (dbmanager_t *dbmanager, const char *meta)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return;
+
+  vh_database_search_meta_add (dbmanager->database, meta);
+}
+
 void
 vh_dbmanager_db_begin_transaction (dbmanager_t *dbmanager)
 {
@@ -723,7 +987,8 @@ valhalla_db_stmt_t *
 vh_dbmanager_db_metalist_get (dbmanager_t *dbmanager,
                               valhalla_db_item_t *search,
                               valhalla_file_type_t filetype,
-                              valhalla_db_restrict_t *restriction)
+                              valhalla_db_restrict_t *restriction,
+                              const valhalla_db_page_t *page)
 {
   vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
 
@@ -731,7 +996,7 @@ vh_dbmanager_db_metalist_get (dbmanager_t *dbmanager,
     return NULL;
 
   return vh_database_metalist_get (dbmanager->database,
-                                   search, filetype, restriction);
+                                   search, filetype, restriction, page);
 }
 
 const valhalla_db_metares_t *
@@ -749,14 +1014,16 @@ vh_dbmanager_db_metalist_read (dbmanager_t *dbmanager,
 valhalla_db_stmt_t *
 vh_dbmanager_db_filelist_get (dbmanager_t *dbmanager,
                               valhalla_file_type_t filetype,
-                              valhalla_db_restrict_t *restriction)
+                              valhalla_db_restrict_t *restriction,
+                              const valhalla_db_page_t *page)
 {
   vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
 
   if (!dbmanager)
     return NULL;
 
-  return vh_database_filelist_get (dbmanager->database, filetype, restriction);
+  return vh_database_filelist_get (dbmanager->database,
+                                   filetype, restriction, page);
 }
 
 const valhalla_db_fileres_t *
@@ -794,3 +1061,107 @@ vh_dbmanager_db_file_read (dbmanager_t *dbmanager, valhalla_db_stmt_t *vhstmt)
 
   return vh_database_file_read (dbmanager->database, vhstmt);
 }
+
+valhalla_db_stmt_t *
+vh_dbmanager_db_files_get (dbmanager_t *dbmanager,
+                           const int64_t *ids, unsigned int nb,
+                           valhalla_file_type_t filetype,
+                           valhalla_db_restrict_t *restriction,
+                           const char *const *metas)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return NULL;
+
+  return vh_database_files_get (dbmanager->database,
+                                ids, nb, filetype, restriction, metas);
+}
+
+const valhalla_db_filemetares_t *
+vh_dbmanager_db_files_read (dbmanager_t *dbmanager,
+                            valhalla_db_stmt_t *vhstmt)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return NULL;
+
+  return vh_database_files_read (dbmanager->database, vhstmt);
+}
+
+char *
+vh_dbmanager_db_page_token (dbmanager_t *dbmanager, valhalla_db_stmt_t *vhstmt)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return NULL;
+
+  return vh_database_page_token (dbmanager->database, vhstmt);
+}
+
+valhalla_db_stmt_t *
+vh_dbmanager_db_facet_get (dbmanager_t *dbmanager,
+                           valhalla_db_item_t *facet,
+                           valhalla_db_item_t *counted,
+                           valhalla_file_type_t filetype,
+                           valhalla_db_restrict_t *restriction)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return NULL;
+
+  return vh_database_facet_get (dbmanager->database,
+                                facet, counted, filetype, restriction);
+}
+
+const valhalla_db_countres_t *
+vh_dbmanager_db_facet_read (dbmanager_t *dbmanager,
+                            valhalla_db_stmt_t *vhstmt)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return NULL;
+
+  return vh_database_facet_read (dbmanager->database, vhstmt);
+}
+
+int64_t
+vh_dbmanager_db_count (dbmanager_t *dbmanager,
+                       valhalla_file_type_t filetype,
+                       valhalla_db_restrict_t *restriction)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return -1;
+
+  return vh_database_count (dbmanager->database, filetype, restriction);
+}
+
+valhalla_db_stmt_t *
+vh_dbmanager_db_search_get (dbmanager_t *dbmanager, const char *text,
+                            valhalla_file_type_t filetype, unsigned int max)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return NULL;
+
+  return vh_database_search_get (dbmanager->database, text, filetype, max);
+}
+
+const valhalla_db_searchres_t *
+vh_dbmanager_db_search_read (dbmanager_t *dbmanager,
+                             valhalla_db_stmt_t *vhstmt)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbmanager)
+    return NULL;
+
+  return vh_database_search_read (dbmanager->database, vhstmt);
+}
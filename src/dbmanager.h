@@ -24,6 +24,7 @@
 
 #include "fifo_queue.h"
 #include "utils.h"
+#include "database.h"
 
 typedef struct dbmanager_s dbmanager_t;
 
@@ -49,11 +50,12 @@ void vh_dbmanager_extmd_free (dbmanager_extmd_t *extmd);
 int vh_dbmanager_run (dbmanager_t *dbmanager, int priority);
 void vh_dbmanager_pause (dbmanager_t *dbmanager);
 fifo_queue_t *vh_dbmanager_fifo_get (dbmanager_t *dbmanager);
+database_t *vh_dbmanager_database_get (dbmanager_t *dbmanager);
 void vh_dbmanager_wait (dbmanager_t *dbmanager);
 void vh_dbmanager_stop (dbmanager_t *dbmanager, int f);
 void vh_dbmanager_uninit (dbmanager_t *dbmanager);
-dbmanager_t *vh_dbmanager_init (valhalla_t *handle,
-                                const char *db, unsigned int commit_int);
+dbmanager_t *vh_dbmanager_init (valhalla_t *handle, const char *db,
+                                unsigned int commit_int, int file_index);
 
 void vh_dbmanager_action_send (dbmanager_t *dbmanager,
                                fifo_queue_prio_t prio, int action, void *data);
@@ -61,9 +63,16 @@ void vh_dbmanager_action_send (dbmanager_t *dbmanager,
 int vh_dbmanager_file_complete (dbmanager_t *dbmanager,
                                 const char *file, int64_t mtime);
 
+int vh_dbmanager_db_dir_get (dbmanager_t *dbmanager,
+                             dir_list_t *list, const char *sig);
+
 void vh_dbmanager_db_dlcontext_save (dbmanager_t *dbmanager, file_data_t *data);
 void vh_dbmanager_db_dlcontext_delete (dbmanager_t *dbmanager);
 
+int vh_dbmanager_db_pragma_set (dbmanager_t *dbmanager,
+                                database_pragma_t pragma, int value);
+void vh_dbmanager_db_search_meta_add (dbmanager_t *dbmanager,
+                                      const char *meta);
 void vh_dbmanager_db_begin_transaction (dbmanager_t *dbmanager);
 void vh_dbmanager_db_end_transaction (dbmanager_t *dbmanager);
 
@@ -71,7 +80,8 @@ valhalla_db_stmt_t *
 vh_dbmanager_db_metalist_get (dbmanager_t *dbmanager,
                               valhalla_db_item_t *search,
                               valhalla_file_type_t filetype,
-                              valhalla_db_restrict_t *restriction);
+                              valhalla_db_restrict_t *restriction,
+                              const valhalla_db_page_t *page);
 const valhalla_db_metares_t *
 vh_dbmanager_db_metalist_read (dbmanager_t *dbmanager,
                                valhalla_db_stmt_t *vhstmt);
@@ -79,7 +89,8 @@ vh_dbmanager_db_metalist_read (dbmanager_t *dbmanager,
 valhalla_db_stmt_t *
 vh_dbmanager_db_filelist_get (dbmanager_t *dbmanager,
                               valhalla_file_type_t filetype,
-                              valhalla_db_restrict_t *restriction);
+                              valhalla_db_restrict_t *restriction,
+                              const valhalla_db_page_t *page);
 const valhalla_db_fileres_t *
 vh_dbmanager_db_filelist_read (dbmanager_t *dbmanager,
                                valhalla_db_stmt_t *vhstmt);
@@ -90,4 +101,37 @@ vh_dbmanager_db_file_get (dbmanager_t *dbmanager, int64_t id, const char *path,
 const valhalla_db_metares_t *
 vh_dbmanager_db_file_read (dbmanager_t *dbmanager, valhalla_db_stmt_t *vhstmt);
 
+valhalla_db_stmt_t *
+vh_dbmanager_db_files_get (dbmanager_t *dbmanager,
+                           const int64_t *ids, unsigned int nb,
+                           valhalla_file_type_t filetype,
+                           valhalla_db_restrict_t *restriction,
+                           const char *const *metas);
+const valhalla_db_filemetares_t *
+vh_dbmanager_db_files_read (dbmanager_t *dbmanager,
+                            valhalla_db_stmt_t *vhstmt);
+
+char *vh_dbmanager_db_page_token (dbmanager_t *dbmanager,
+                                  valhalla_db_stmt_t *vhstmt);
+
+valhalla_db_stmt_t *
+vh_dbmanager_db_facet_get (dbmanager_t *dbmanager,
+                           valhalla_db_item_t *facet,
+                           valhalla_db_item_t *counted,
+                           valhalla_file_type_t filetype,
+                           valhalla_db_restrict_t *restriction);
+const valhalla_db_countres_t *
+vh_dbmanager_db_facet_read (dbmanager_t *dbmanager,
+                            valhalla_db_stmt_t *vhstmt);
+int64_t vh_dbmanager_db_count (dbmanager_t *dbmanager,
+                               valhalla_file_type_t filetype,
+                               valhalla_db_restrict_t *restriction);
+
+valhalla_db_stmt_t *
+vh_dbmanager_db_search_get (dbmanager_t *dbmanager, const char *text,
+                            valhalla_file_type_t filetype, unsigned int max);
+const valhalla_db_searchres_t *
+vh_dbmanager_db_search_read (dbmanager_t *dbmanager,
+                             valhalla_db_stmt_t *vhstmt);
+
 #endif /* VALHALLA_DBMANAGER_H */
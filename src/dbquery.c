@@ -0,0 +1,1129 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif /* HAVE_EVENTFD */
+
+#include "valhalla.h"
+#include "valhalla_internals.h"
+#include "fifo_queue.h"
+#include "logs.h"
+#include "thread_utils.h"
+#include "utils.h"
+#include "database.h"
+#include "dbquery.h"
+
+#ifndef DBQUERY_NB_MAX
+#define DBQUERY_NB_MAX 8
+#endif /* DBQUERY_NB_MAX */
+
+typedef enum dbquery_type {
+  DBQUERY_METALIST,
+  DBQUERY_FILELIST,
+  DBQUERY_FILE,
+  DBQUERY_FILES,
+  DBQUERY_FACET,
+  DBQUERY_SEARCH,
+} dbquery_type_t;
+
+/* The arguments are copied because the query is run by an other thread. */
+typedef struct dbquery_job_s {
+  struct dbquery_job_s *next;   /* list of the queries not ended */
+  struct dbquery_s     *dbquery;
+  unsigned int          id;
+  dbquery_type_t        type;
+  int                   cancel;
+
+  valhalla_db_async_cb_t cb;
+  void                  *data;
+
+  valhalla_db_item_t      item;
+  valhalla_db_item_t      counted;
+  int                     counted_set;
+  valhalla_file_type_t    filetype;
+  valhalla_db_restrict_t *restriction;
+  valhalla_db_page_t      page;
+  int                     page_set;
+  int64_t                 file_id;
+  char                   *path;
+  char                   *text;
+  unsigned int            max;
+  int64_t                *ids;
+  unsigned int            ids_nb;
+  char                  **metas;  /* NULL-terminated */
+} dbquery_job_t;
+
+typedef struct dbquery_batch_s {
+  valhalla_db_batch_t     batch;  /* must be the first member */
+  struct dbquery_batch_s *next;   /* completion queue */
+  dbquery_type_t          type;
+} dbquery_batch_t;
+
+struct dbquery_s {
+  database_t   *database;
+  pthread_t     thread[DBQUERY_NB_MAX];
+  unsigned int  nb;
+  fifo_queue_t *fifo;
+  int           priority;
+
+  int             wait;
+  int             run;
+  pthread_mutex_t mutex_run;
+
+  /* queries pending or running, for the cancellation */
+  dbquery_job_t  *jobs;
+  unsigned int    id;
+  pthread_mutex_t mutex_jobs;
+
+  /* completion queue, the descriptor is readable when it is not empty */
+  dbquery_batch_t *done;
+  dbquery_batch_t *done_last;
+  int              fd[2];
+  pthread_mutex_t  mutex_done;
+};
+
+
+static inline int
+dbquery_is_stopped (dbquery_t *dbquery)
+{
+  int run;
+  pthread_mutex_lock (&dbquery->mutex_run);
+  run = dbquery->run;
+  pthread_mutex_unlock (&dbquery->mutex_run);
+  return !run;
+}
+
+static inline int
+dbquery_job_canceled (dbquery_job_t *job)
+{
+  int cancel;
+  pthread_mutex_lock (&job->dbquery->mutex_jobs);
+  cancel = job->cancel;
+  pthread_mutex_unlock (&job->dbquery->mutex_jobs);
+  return cancel;
+}
+
+/* Called by SQLite during the steps of the statements of the job. */
+static int
+dbquery_progress (void *data)
+{
+  return dbquery_job_canceled (data);
+}
+
+static inline char *
+dbquery_strdup (const char *str)
+{
+  return str ? strdup (str) : NULL;
+}
+
+static int
+dbquery_item_dup (valhalla_db_item_t *dst, const valhalla_db_item_t *src)
+{
+  *dst = *src;
+  dst->text = dbquery_strdup (src->text);
+  return src->text && !dst->text ? -1 : 0;
+}
+
+static void
+dbquery_job_free (dbquery_job_t *job)
+{
+  valhalla_db_restrict_t *it;
+
+  if (!job)
+    return;
+
+  for (it = job->restriction; it; it = it->next)
+  {
+    free ((void *) it->meta.text);
+    free ((void *) it->data.text);
+  }
+
+  /* the restrictions are allocated in one block */
+  free (job->restriction);
+  free ((void *) job->item.text);
+  free ((void *) job->counted.text);
+  free ((void *) job->page.token);
+  free (job->path);
+  free (job->text);
+  free (job->ids);
+  if (job->metas)
+  {
+    char **meta;
+    for (meta = job->metas; *meta; meta++)
+      free (*meta);
+    free (job->metas);
+  }
+  free (job);
+}
+
+static dbquery_job_t *
+dbquery_job_new (dbquery_t *dbquery, dbquery_type_t type,
+                 const valhalla_db_restrict_t *restriction,
+                 valhalla_db_async_cb_t cb, void *data)
+{
+  unsigned int i, nb = 0;
+  const valhalla_db_restrict_t *it;
+  dbquery_job_t *job;
+
+  job = calloc (1, sizeof (dbquery_job_t));
+  if (!job)
+    return NULL;
+
+  job->dbquery = dbquery;
+  job->type    = type;
+  job->cb      = cb;
+  job->data    = data;
+
+  for (it = restriction; it; it = it->next)
+    nb++;
+
+  if (!nb)
+    return job;
+
+  job->restriction = calloc (nb, sizeof (valhalla_db_restrict_t));
+  if (!job->restriction)
+    goto err;
+
+  for (i = 0, it = restriction; it; it = it->next, i++)
+  {
+    valhalla_db_restrict_t *r = &job->restriction[i];
+
+    r->next = i + 1 < nb ? &job->restriction[i + 1] : NULL;
+    r->op   = it->op;
+    if (dbquery_item_dup (&r->meta, &it->meta)
+        || dbquery_item_dup (&r->data, &it->data))
+      goto err;
+  }
+
+  return job;
+
+ err:
+  dbquery_job_free (job);
+  return NULL;
+}
+
+/* A job can not be canceled after this call. */
+static void
+dbquery_job_end (dbquery_t *dbquery, dbquery_job_t *job)
+{
+  dbquery_job_t **it;
+
+  pthread_mutex_lock (&dbquery->mutex_jobs);
+  for (it = &dbquery->jobs; *it; it = &(*it)->next)
+    if (*it == job)
+    {
+      *it = job->next;
+      break;
+    }
+  pthread_mutex_unlock (&dbquery->mutex_jobs);
+}
+
+/* The job is freed on error. */
+static unsigned int
+dbquery_job_send (dbquery_t *dbquery, dbquery_job_t *job)
+{
+  int res;
+  unsigned int id = 0;
+
+  pthread_mutex_lock (&dbquery->mutex_run);
+  if (!dbquery->run)
+    goto out;
+
+  pthread_mutex_lock (&dbquery->mutex_jobs);
+  id = ++dbquery->id;
+  if (!id) /* 0 is for the errors */
+    id = ++dbquery->id;
+  job->id   = id;
+  job->next = dbquery->jobs;
+  dbquery->jobs = job;
+  pthread_mutex_unlock (&dbquery->mutex_jobs);
+
+  /* the kill actions of vh_dbquery_stop() are pushed after the queries */
+  res = vh_fifo_queue_push (dbquery->fifo,
+                            FIFO_QUEUE_PRIORITY_NORMAL, ACTION_DB_QUERY, job);
+  if (res == FIFO_QUEUE_SUCCESS)
+    goto out;
+
+  dbquery_job_end (dbquery, job);
+  id = 0;
+
+ out:
+  pthread_mutex_unlock (&dbquery->mutex_run);
+  if (!id)
+    dbquery_job_free (job);
+  return id;
+}
+
+/* The descriptor is readable as long as the completion queue is not empty. */
+static void
+dbquery_fd_set (dbquery_t *dbquery, int readable)
+{
+#ifdef HAVE_EVENTFD
+  uint64_t v = 1;
+#else /* HAVE_EVENTFD */
+  char v = 0;
+#endif /* !HAVE_EVENTFD */
+
+  if (dbquery->fd[0] < 0)
+    return;
+
+  if (readable)
+  {
+    if (write (dbquery->fd[1], &v, sizeof (v)) < 0)
+      vh_log (VALHALLA_MSG_WARNING, "%s: write failed", __FUNCTION__);
+  }
+  else if (read (dbquery->fd[0], &v, sizeof (v)) < 0)
+    vh_log (VALHALLA_MSG_WARNING, "%s: read failed", __FUNCTION__);
+}
+
+static int
+dbquery_fd_open (dbquery_t *dbquery)
+{
+#ifdef HAVE_EVENTFD
+  dbquery->fd[0] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  dbquery->fd[1] = dbquery->fd[0];
+  return dbquery->fd[0] < 0 ? -1 : 0;
+#elif !defined (_WIN32)
+  unsigned int i;
+
+  if (pipe (dbquery->fd))
+  {
+    dbquery->fd[0] = dbquery->fd[1] = -1;
+    return -1;
+  }
+
+  for (i = 0; i < 2; i++)
+  {
+    fcntl (dbquery->fd[i], F_SETFL, O_NONBLOCK);
+    fcntl (dbquery->fd[i], F_SETFD, FD_CLOEXEC);
+  }
+  return 0;
+#else /* !_WIN32 */
+  return -1;
+#endif /* _WIN32 */
+}
+
+static void
+dbquery_fd_close (dbquery_t *dbquery)
+{
+  if (dbquery->fd[0] < 0)
+    return;
+
+  close (dbquery->fd[0]);
+  if (dbquery->fd[1] != dbquery->fd[0])
+    close (dbquery->fd[1]);
+}
+
+static size_t
+dbquery_row_size (dbquery_type_t type)
+{
+  switch (type)
+  {
+  default:
+  case DBQUERY_METALIST:
+  case DBQUERY_FILE:
+    return sizeof (valhalla_db_metares_t);
+
+  case DBQUERY_FILELIST:
+    return sizeof (valhalla_db_fileres_t);
+
+  case DBQUERY_FILES:
+    return sizeof (valhalla_db_filemetares_t);
+
+  case DBQUERY_FACET:
+    return sizeof (valhalla_db_countres_t);
+
+  case DBQUERY_SEARCH:
+    return sizeof (valhalla_db_searchres_t);
+  }
+}
+
+void
+vh_dbquery_batch_free (valhalla_db_batch_t *batch)
+{
+  unsigned int i;
+  dbquery_batch_t *b = (dbquery_batch_t *) batch;
+
+  if (!batch)
+    return;
+
+  for (i = 0; i < batch->nb; i++)
+    switch (b->type)
+    {
+    case DBQUERY_METALIST:
+    case DBQUERY_FILE:
+      free ((void *) batch->rows.metares[i].meta_name);
+      free ((void *) batch->rows.metares[i].data_value);
+      break;
+
+    case DBQUERY_FILELIST:
+      free ((void *) batch->rows.fileres[i].path);
+      break;
+
+    case DBQUERY_FILES:
+      free ((void *) batch->rows.filemetares[i].path);
+      free ((void *) batch->rows.filemetares[i].meta.meta_name);
+      free ((void *) batch->rows.filemetares[i].meta.data_value);
+      break;
+
+    case DBQUERY_FACET:
+      free ((void *) batch->rows.countres[i].data_value);
+      break;
+
+    case DBQUERY_SEARCH:
+      free ((void *) batch->rows.searchres[i].meta_name);
+      free ((void *) batch->rows.searchres[i].data_value);
+      break;
+    }
+
+  free ((void *) batch->rows.metares);
+  free ((void *) batch->token);
+  free (b);
+}
+
+static dbquery_batch_t *
+dbquery_batch_new (dbquery_job_t *job)
+{
+  dbquery_batch_t *batch;
+
+  batch = calloc (1, sizeof (dbquery_batch_t));
+  if (!batch)
+    return NULL;
+
+  batch->type       = job->type;
+  batch->batch.id   = job->id;
+  batch->batch.data = job->data;
+  batch->batch.rows.metares =
+    malloc (DBQUERY_BATCH_SIZE * dbquery_row_size (job->type));
+  if (!batch->batch.rows.metares)
+  {
+    free (batch);
+    return NULL;
+  }
+
+  return batch;
+}
+
+static void
+dbquery_batch_send (dbquery_t *dbquery,
+                    dbquery_job_t *job, dbquery_batch_t *batch)
+{
+  if (job->cb)
+  {
+    job->cb (&batch->batch, job->data);
+    return;
+  }
+
+  pthread_mutex_lock (&dbquery->mutex_done);
+  if (dbquery->done_last)
+    dbquery->done_last->next = batch;
+  else
+  {
+    dbquery->done = batch;
+    dbquery_fd_set (dbquery, 1);
+  }
+  dbquery->done_last = batch;
+  pthread_mutex_unlock (&dbquery->mutex_done);
+}
+
+static valhalla_db_stmt_t *
+dbquery_job_stmt (dbquery_t *dbquery, dbquery_job_t *job)
+{
+  const valhalla_db_page_t *page = job->page_set ? &job->page : NULL;
+
+  switch (job->type)
+  {
+  case DBQUERY_METALIST:
+    return vh_database_metalist_get (dbquery->database, &job->item,
+                                     job->filetype, job->restriction, page);
+
+  case DBQUERY_FILELIST:
+    return vh_database_filelist_get (dbquery->database,
+                                     job->filetype, job->restriction, page);
+
+  case DBQUERY_FILE:
+    return vh_database_file_get (dbquery->database,
+                                 job->file_id, job->path, job->restriction);
+
+  case DBQUERY_FILES:
+    return vh_database_files_get (dbquery->database, job->ids, job->ids_nb,
+                                  job->filetype, job->restriction,
+                                  (const char *const *) job->metas);
+
+  case DBQUERY_FACET:
+    return vh_database_facet_get (dbquery->database, &job->item,
+                                  job->counted_set ? &job->counted : NULL,
+                                  job->filetype, job->restriction);
+
+  case DBQUERY_SEARCH:
+    return vh_database_search_get (dbquery->database,
+                                   job->text, job->filetype, job->max);
+  }
+
+  return NULL;
+}
+
+/* Copy the next row in the batch, the statement is freed with the end. */
+static int
+dbquery_row_read (dbquery_t *dbquery, dbquery_job_t *job,
+                  valhalla_db_stmt_t *vhstmt, dbquery_batch_t *batch)
+{
+  database_t *database = dbquery->database;
+  const unsigned int n = batch->batch.nb;
+
+  switch (job->type)
+  {
+  case DBQUERY_METALIST:
+  case DBQUERY_FILE:
+  {
+    valhalla_db_metares_t *row;
+    const valhalla_db_metares_t *res =
+      job->type == DBQUERY_FILE ? vh_database_file_read (database, vhstmt)
+                                : vh_database_metalist_read (database, vhstmt);
+    if (!res)
+      return -1;
+
+    row = (valhalla_db_metares_t *) &batch->batch.rows.metares[n];
+    *row = *res;
+    row->meta_name  = dbquery_strdup (res->meta_name);
+    row->data_value = dbquery_strdup (res->data_value);
+    break;
+  }
+
+  case DBQUERY_FILELIST:
+  {
+    valhalla_db_fileres_t *row;
+    const valhalla_db_fileres_t *res =
+      vh_database_filelist_read (database, vhstmt);
+    if (!res)
+      return -1;
+
+    row = (valhalla_db_fileres_t *) &batch->batch.rows.fileres[n];
+    *row = *res;
+    row->path = dbquery_strdup (res->path);
+    break;
+  }
+
+  case DBQUERY_FILES:
+  {
+    valhalla_db_filemetares_t *row;
+    const valhalla_db_filemetares_t *res =
+      vh_database_files_read (database, vhstmt);
+    if (!res)
+      return -1;
+
+    row = (valhalla_db_filemetares_t *) &batch->batch.rows.filemetares[n];
+    *row = *res;
+    row->path            = dbquery_strdup (res->path);
+    row->meta.meta_name  = dbquery_strdup (res->meta.meta_name);
+    row->meta.data_value = dbquery_strdup (res->meta.data_value);
+    break;
+  }
+
+  case DBQUERY_FACET:
+  {
+    valhalla_db_countres_t *row;
+    const valhalla_db_countres_t *res =
+      vh_database_facet_read (database, vhstmt);
+    if (!res)
+      return -1;
+
+    row = (valhalla_db_countres_t *) &batch->batch.rows.countres[n];
+    *row = *res;
+    row->data_value = dbquery_strdup (res->data_value);
+    break;
+  }
+
+  case DBQUERY_SEARCH:
+  {
+    valhalla_db_searchres_t *row;
+    const valhalla_db_searchres_t *res =
+      vh_database_search_read (database, vhstmt);
+    if (!res)
+      return -1;
+
+    row = (valhalla_db_searchres_t *) &batch->batch.rows.searchres[n];
+    *row = *res;
+    row->meta_name  = dbquery_strdup (res->meta_name);
+    row->data_value = dbquery_strdup (res->data_value);
+    break;
+  }
+  }
+
+  batch->batch.nb++;
+  return 0;
+}
+
+static void
+dbquery_job_run (dbquery_t *dbquery, dbquery_job_t *job)
+{
+  unsigned int rows = 0;
+  char *token = NULL;
+  valhalla_db_stmt_t *vhstmt = NULL;
+  valhalla_db_async_t state = VALHALLA_DB_ASYNC_ROWS;
+  database_progress_t progress;
+
+  /* the long steps are aborted by vh_dbquery_cancel() */
+  progress.cb   = dbquery_progress;
+  progress.data = job;
+  vh_database_progress_set (dbquery->database, &progress);
+
+  if (!dbquery_job_canceled (job))
+    vhstmt = dbquery_job_stmt (dbquery, job);
+
+  if (!vhstmt)
+    state = dbquery_job_canceled (job) ? VALHALLA_DB_ASYNC_CANCELED
+                                       : VALHALLA_DB_ASYNC_ERROR;
+
+  do
+  {
+    dbquery_batch_t *batch;
+
+    batch = dbquery_batch_new (job);
+    if (!batch)
+    {
+      vh_log (VALHALLA_MSG_ERROR, "%s: query %u lost", __FUNCTION__, job->id);
+      vh_database_vhstmt_free (dbquery->database, vhstmt);
+      free (token);
+      dbquery_job_end (dbquery, job);
+      break;
+    }
+
+    while (state == VALHALLA_DB_ASYNC_ROWS
+           && batch->batch.nb < DBQUERY_BATCH_SIZE)
+    {
+      if (dbquery_job_canceled (job))
+      {
+        state = VALHALLA_DB_ASYNC_CANCELED;
+        break;
+      }
+
+      if (dbquery_row_read (dbquery, job, vhstmt, batch))
+      {
+        vhstmt = NULL;
+        /* the step is interrupted with a cancellation */
+        state = dbquery_job_canceled (job) ? VALHALLA_DB_ASYNC_CANCELED
+                                           : VALHALLA_DB_ASYNC_END;
+        break;
+      }
+
+      /* the token must be read before the next step */
+      if (job->page_set && ++rows == job->page.size)
+        token = vh_database_page_token (dbquery->database, vhstmt);
+    }
+
+    batch->batch.state = state;
+    if (state != VALHALLA_DB_ASYNC_ROWS)
+    {
+      if (state == VALHALLA_DB_ASYNC_END)
+        batch->batch.token = token;
+      else
+        free (token);
+      token = NULL;
+
+      vh_database_vhstmt_free (dbquery->database, vhstmt);
+      vhstmt = NULL;
+      dbquery_job_end (dbquery, job);
+    }
+
+    dbquery_batch_send (dbquery, job, batch);
+  }
+  while (state == VALHALLA_DB_ASYNC_ROWS);
+
+  vh_database_progress_set (dbquery->database, NULL);
+  dbquery_job_free (job);
+}
+
+static void *
+dbquery_thread (void *arg)
+{
+  int res, tid;
+  int e;
+  void *data = NULL;
+  dbquery_t *dbquery = arg;
+
+  if (!dbquery)
+    pthread_exit (NULL);
+
+  tid = vh_setpriority (dbquery->priority);
+
+  vh_log (VALHALLA_MSG_VERBOSE,
+          "[%s] tid: %i priority: %i", __FUNCTION__, tid, dbquery->priority);
+
+  /* the queries canceled by vh_dbquery_stop() are ended before the kill */
+  for (;;)
+  {
+    e = ACTION_NO_OPERATION;
+    data = NULL;
+
+    res = vh_fifo_queue_pop (dbquery->fifo, &e, &data);
+    if (res || e == ACTION_NO_OPERATION)
+      continue;
+
+    if (e == ACTION_KILL_THREAD)
+      break;
+
+    if (e == ACTION_DB_QUERY && data)
+      dbquery_job_run (dbquery, data);
+  }
+
+  pthread_exit (NULL);
+}
+
+int
+vh_dbquery_run (dbquery_t *dbquery, int priority)
+{
+  int res = DBQUERY_SUCCESS;
+  unsigned int i;
+  pthread_attr_t attr;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery)
+    return DBQUERY_ERROR_HANDLER;
+
+  dbquery->priority = priority;
+  dbquery->run      = 1;
+
+  pthread_attr_init (&attr);
+  pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_JOINABLE);
+
+  for (i = 0; i < dbquery->nb; i++)
+  {
+    res = pthread_create (&dbquery->thread[i], &attr, dbquery_thread, dbquery);
+    if (res)
+    {
+      res = DBQUERY_ERROR_THREAD;
+      break;
+    }
+  }
+
+  /* only the threads created are stopped */
+  if (res)
+  {
+    dbquery->nb = i;
+    if (!i)
+      dbquery->run = 0;
+  }
+
+  pthread_attr_destroy (&attr);
+  return res;
+}
+
+void
+vh_dbquery_stop (dbquery_t *dbquery, int f)
+{
+  unsigned int i;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery)
+    return;
+
+  if (f & STOP_FLAG_REQUEST && !dbquery_is_stopped (dbquery))
+  {
+    dbquery_job_t *job;
+
+    pthread_mutex_lock (&dbquery->mutex_run);
+    dbquery->run = 0;
+    pthread_mutex_unlock (&dbquery->mutex_run);
+
+    /* every query ends with a last batch, even when the threads stop */
+    pthread_mutex_lock (&dbquery->mutex_jobs);
+    for (job = dbquery->jobs; job; job = job->next)
+      job->cancel = 1;
+    pthread_mutex_unlock (&dbquery->mutex_jobs);
+
+    for (i = 0; i < dbquery->nb; i++)
+      vh_fifo_queue_push (dbquery->fifo,
+                          FIFO_QUEUE_PRIORITY_NORMAL, ACTION_KILL_THREAD, NULL);
+    dbquery->wait = 1;
+  }
+
+  if (f & STOP_FLAG_WAIT && dbquery->wait)
+  {
+    for (i = 0; i < dbquery->nb; i++)
+      pthread_join (dbquery->thread[i], NULL);
+    dbquery->wait = 0;
+  }
+}
+
+void
+vh_dbquery_uninit (dbquery_t *dbquery)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery)
+    return;
+
+  /* queries never started (no thread) */
+  while (dbquery->jobs)
+  {
+    dbquery_job_t *job = dbquery->jobs;
+    dbquery->jobs = job->next;
+    dbquery_job_free (job);
+  }
+
+  while (dbquery->done)
+  {
+    dbquery_batch_t *batch = dbquery->done;
+    dbquery->done = batch->next;
+    vh_dbquery_batch_free (&batch->batch);
+  }
+
+  vh_fifo_queue_free (dbquery->fifo);
+  dbquery_fd_close (dbquery);
+  pthread_mutex_destroy (&dbquery->mutex_run);
+  pthread_mutex_destroy (&dbquery->mutex_jobs);
+  pthread_mutex_destroy (&dbquery->mutex_done);
+
+  free (dbquery);
+}
+
+dbquery_t *
+vh_dbquery_init (database_t *database, unsigned int nb)
+{
+  dbquery_t *dbquery;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!database)
+    return NULL;
+
+  dbquery = calloc (1, sizeof (dbquery_t));
+  if (!dbquery)
+    return NULL;
+
+  dbquery->fd[0] = dbquery->fd[1] = -1;
+  pthread_mutex_init (&dbquery->mutex_run, NULL);
+  pthread_mutex_init (&dbquery->mutex_jobs, NULL);
+  pthread_mutex_init (&dbquery->mutex_done, NULL);
+
+  if (nb > ARRAY_NB_ELEMENTS (dbquery->thread))
+    goto err;
+
+  dbquery->fifo = vh_fifo_queue_new ();
+  if (!dbquery->fifo)
+    goto err;
+
+  dbquery->database = database;
+  dbquery->nb       = nb ? nb : DBQUERY_NUMBER_DEF;
+
+  /* the callbacks are still usable without the completion descriptor */
+  if (dbquery_fd_open (dbquery))
+    vh_log (VALHALLA_MSG_WARNING,
+            "%s: no descriptor for the completion queue", __FUNCTION__);
+
+  return dbquery;
+
+ err:
+  vh_dbquery_uninit (dbquery);
+  return NULL;
+}
+
+unsigned int
+vh_dbquery_metalist (dbquery_t *dbquery,
+                     valhalla_db_item_t *search,
+                     valhalla_file_type_t filetype,
+                     valhalla_db_restrict_t *restriction,
+                     const valhalla_db_page_t *page,
+                     valhalla_db_async_cb_t cb, void *data)
+{
+  dbquery_job_t *job;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery || !search)
+    return 0;
+
+  job = dbquery_job_new (dbquery, DBQUERY_METALIST, restriction, cb, data);
+  if (!job)
+    return 0;
+
+  job->filetype = filetype;
+  if (dbquery_item_dup (&job->item, search))
+    goto err;
+
+  if (page)
+  {
+    job->page     = *page;
+    job->page_set = 1;
+    job->page.token = dbquery_strdup (page->token);
+    if (page->token && !job->page.token)
+      goto err;
+  }
+
+  return dbquery_job_send (dbquery, job);
+
+ err:
+  dbquery_job_free (job);
+  return 0;
+}
+
+unsigned int
+vh_dbquery_filelist (dbquery_t *dbquery,
+                     valhalla_file_type_t filetype,
+                     valhalla_db_restrict_t *restriction,
+                     const valhalla_db_page_t *page,
+                     valhalla_db_async_cb_t cb, void *data)
+{
+  dbquery_job_t *job;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery)
+    return 0;
+
+  job = dbquery_job_new (dbquery, DBQUERY_FILELIST, restriction, cb, data);
+  if (!job)
+    return 0;
+
+  job->filetype = filetype;
+
+  if (page)
+  {
+    job->page     = *page;
+    job->page_set = 1;
+    job->page.token = dbquery_strdup (page->token);
+    if (page->token && !job->page.token)
+      goto err;
+  }
+
+  return dbquery_job_send (dbquery, job);
+
+ err:
+  dbquery_job_free (job);
+  return 0;
+}
+
+unsigned int
+vh_dbquery_file (dbquery_t *dbquery,
+                 int64_t id, const char *path,
+                 valhalla_db_restrict_t *restriction,
+                 valhalla_db_async_cb_t cb, void *data)
+{
+  dbquery_job_t *job;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery)
+    return 0;
+
+  job = dbquery_job_new (dbquery, DBQUERY_FILE, restriction, cb, data);
+  if (!job)
+    return 0;
+
+  job->file_id = id;
+  job->path    = dbquery_strdup (path);
+  if (path && !job->path)
+    goto err;
+
+  return dbquery_job_send (dbquery, job);
+
+ err:
+  dbquery_job_free (job);
+  return 0;
+}
+
+unsigned int
+vh_dbquery_files (dbquery_t *dbquery,
+                  const int64_t *ids, unsigned int nb,
+                  valhalla_file_type_t filetype,
+                  valhalla_db_restrict_t *restriction,
+                  const char *const *metas,
+                  valhalla_db_async_cb_t cb, void *data)
+{
+  unsigned int i;
+  dbquery_job_t *job;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery || (nb && !ids))
+    return 0;
+
+  job = dbquery_job_new (dbquery, DBQUERY_FILES, restriction, cb, data);
+  if (!job)
+    return 0;
+
+  job->filetype = filetype;
+
+  if (nb)
+  {
+    job->ids = malloc (nb * sizeof (*job->ids));
+    if (!job->ids)
+      goto err;
+    memcpy (job->ids, ids, nb * sizeof (*job->ids));
+    job->ids_nb = nb;
+  }
+
+  if (metas)
+  {
+    for (i = 0; metas[i]; i++)
+      ;
+    job->metas = calloc (i + 1, sizeof (*job->metas));
+    if (!job->metas)
+      goto err;
+
+    for (i = 0; metas[i]; i++)
+    {
+      job->metas[i] = strdup (metas[i]);
+      if (!job->metas[i])
+        goto err;
+    }
+  }
+
+  return dbquery_job_send (dbquery, job);
+
+ err:
+  dbquery_job_free (job);
+  return 0;
+}
+
+unsigned int
+vh_dbquery_facet (dbquery_t *dbquery,
+                  valhalla_db_item_t *facet, valhalla_db_item_t *counted,
+                  valhalla_file_type_t filetype,
+                  valhalla_db_restrict_t *restriction,
+                  valhalla_db_async_cb_t cb, void *data)
+{
+  dbquery_job_t *job;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery || !facet)
+    return 0;
+
+  job = dbquery_job_new (dbquery, DBQUERY_FACET, restriction, cb, data);
+  if (!job)
+    return 0;
+
+  job->filetype = filetype;
+  if (dbquery_item_dup (&job->item, facet))
+    goto err;
+
+  if (counted)
+  {
+    job->counted_set = 1;
+    if (dbquery_item_dup (&job->counted, counted))
+      goto err;
+  }
+
+  return dbquery_job_send (dbquery, job);
+
+ err:
+  dbquery_job_free (job);
+  return 0;
+}
+
+unsigned int
+vh_dbquery_search (dbquery_t *dbquery, const char *text,
+                   valhalla_file_type_t filetype, unsigned int max,
+                   valhalla_db_async_cb_t cb, void *data)
+{
+  dbquery_job_t *job;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery || !text)
+    return 0;
+
+  job = dbquery_job_new (dbquery, DBQUERY_SEARCH, NULL, cb, data);
+  if (!job)
+    return 0;
+
+  job->filetype = filetype;
+  job->max      = max;
+  job->text     = strdup (text);
+  if (!job->text)
+  {
+    dbquery_job_free (job);
+    return 0;
+  }
+
+  return dbquery_job_send (dbquery, job);
+}
+
+void
+vh_dbquery_cancel (dbquery_t *dbquery, unsigned int id)
+{
+  dbquery_job_t *job;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery || !id)
+    return;
+
+  /* the running step is aborted by dbquery_progress() */
+  pthread_mutex_lock (&dbquery->mutex_jobs);
+  for (job = dbquery->jobs; job; job = job->next)
+    if (job->id == id)
+    {
+      job->cancel = 1;
+      break;
+    }
+  pthread_mutex_unlock (&dbquery->mutex_jobs);
+}
+
+int
+vh_dbquery_fd (dbquery_t *dbquery)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery)
+    return -1;
+
+  return dbquery->fd[0];
+}
+
+valhalla_db_batch_t *
+vh_dbquery_pop (dbquery_t *dbquery)
+{
+  dbquery_batch_t *batch;
+
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!dbquery)
+    return NULL;
+
+  pthread_mutex_lock (&dbquery->mutex_done);
+  batch = dbquery->done;
+  if (batch)
+  {
+    dbquery->done = batch->next;
+    if (!dbquery->done)
+    {
+      dbquery->done_last = NULL;
+      dbquery_fd_set (dbquery, 0);
+    }
+    batch->next = NULL;
+  }
+  pthread_mutex_unlock (&dbquery->mutex_done);
+
+  return batch ? &batch->batch : NULL;
+}
@@ -0,0 +1,83 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef VALHALLA_DBQUERY_H
+#define VALHALLA_DBQUERY_H
+
+#include "database.h"
+
+typedef struct dbquery_s dbquery_t;
+
+enum dbquery_errno {
+  DBQUERY_ERROR_HANDLER = -2,
+  DBQUERY_ERROR_THREAD  = -1,
+  DBQUERY_SUCCESS       =  0,
+};
+
+#define DBQUERY_NUMBER_DEF 2
+
+/* Max number of rows in a batch. */
+#define DBQUERY_BATCH_SIZE 64
+
+
+int vh_dbquery_run (dbquery_t *dbquery, int priority);
+void vh_dbquery_stop (dbquery_t *dbquery, int f);
+void vh_dbquery_uninit (dbquery_t *dbquery);
+dbquery_t *vh_dbquery_init (database_t *database, unsigned int nb);
+
+unsigned int vh_dbquery_metalist (dbquery_t *dbquery,
+                                  valhalla_db_item_t *search,
+                                  valhalla_file_type_t filetype,
+                                  valhalla_db_restrict_t *restriction,
+                                  const valhalla_db_page_t *page,
+                                  valhalla_db_async_cb_t cb, void *data);
+unsigned int vh_dbquery_filelist (dbquery_t *dbquery,
+                                  valhalla_file_type_t filetype,
+                                  valhalla_db_restrict_t *restriction,
+                                  const valhalla_db_page_t *page,
+                                  valhalla_db_async_cb_t cb, void *data);
+unsigned int vh_dbquery_file (dbquery_t *dbquery,
+                              int64_t id, const char *path,
+                              valhalla_db_restrict_t *restriction,
+                              valhalla_db_async_cb_t cb, void *data);
+unsigned int vh_dbquery_files (dbquery_t *dbquery,
+                               const int64_t *ids, unsigned int nb,
+                               valhalla_file_type_t filetype,
+                               valhalla_db_restrict_t *restriction,
+                               const char *const *metas,
+                               valhalla_db_async_cb_t cb, void *data);
+unsigned int vh_dbquery_facet (dbquery_t *dbquery,
+                               valhalla_db_item_t *facet,
+                               valhalla_db_item_t *counted,
+                               valhalla_file_type_t filetype,
+                               valhalla_db_restrict_t *restriction,
+                               valhalla_db_async_cb_t cb, void *data);
+unsigned int vh_dbquery_search (dbquery_t *dbquery, const char *text,
+                                valhalla_file_type_t filetype,
+                                unsigned int max,
+                                valhalla_db_async_cb_t cb, void *data);
+
+void vh_dbquery_cancel (dbquery_t *dbquery, unsigned int id);
+int vh_dbquery_fd (dbquery_t *dbquery);
+valhalla_db_batch_t *vh_dbquery_pop (dbquery_t *dbquery);
+void vh_dbquery_batch_free (valhalla_db_batch_t *batch);
+
+#endif /* VALHALLA_DBQUERY_H */
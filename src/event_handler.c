@@ -383,7 +383,7 @@ vh_event_handler_od_send (event_handler_t *event_handler, const char *file,
   {
     const metadata_t *tag = NULL;
 
-    edata->keys = vh_list_new (0, NULL);
+    edata->keys = vh_list_new (0, NULL, NULL);
 
     while (!vh_metadata_get (meta, "", METADATA_IGNORE_SUFFIX, &tag))
       vh_list_append (edata->keys, tag->name, strlen (tag->name) + 1);
@@ -429,17 +429,13 @@ vh_event_handler_md_send (event_handler_t *event_handler,
   if (!data)
     return -1;
 
-  if (e == VALHALLA_EVENTMD_PARSER)
+  /* the metadata of the file are released with its arena */
+  vh_metadata_dup (&data->meta, meta);
+  if (!data->meta)
   {
-    vh_metadata_dup (&data->meta, meta);
-    if (!data->meta)
-    {
-      free (data);
-      return -1;
-    }
+    free (data);
+    return -1;
   }
-  else
-    data->meta = meta;
 
   data->file.path  = strdup (file->path);
   data->file.mtime = file->mtime;
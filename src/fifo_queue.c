@@ -20,58 +20,358 @@
  */
 
 #include <pthread.h>
-#include <semaphore.h>
+#include <sched.h>
 #include <stdlib.h>
 
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif /* __linux__ */
+
 #include "fifo_queue.h"
 
+/*
+ * Each queue has two lanes (normal and high priority). A lane is a bounded
+ * MPMC ring buffer where every slot carries a sequence number (D. Vyukov's
+ * algorithm). The producers and the consumers are lock-free as long as the
+ * ring is not full. When a ring is full, the items are appended to an
+ * overflow list (protected by the mutex) in order to keep the unbounded
+ * behaviour of the queue. The threads are pushing in the queues of each
+ * others, then a blocking push would lead to deadlocks.
+ *
+ * The consumers are sleeping on a futex (a counter of available items).
+ */
+
+#define FIFO_QUEUE_RING_SIZE     1024 /* must be a power of two */
+#define FIFO_QUEUE_CACHELINE     64
+
+#define ATOMIC_LOAD(p)          __atomic_load_n (p, __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, v)      __atomic_store_n (p, v, __ATOMIC_RELEASE)
+#define ATOMIC_XCHG(p, v)       __atomic_exchange_n (p, v, __ATOMIC_ACQ_REL)
+#define ATOMIC_CAS(p, o, n) \
+  __atomic_compare_exchange_n (p, o, n, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define ATOMIC_ADD(p, v)        __atomic_add_fetch (p, v, __ATOMIC_SEQ_CST)
+#define ATOMIC_SUB(p, v)        __atomic_sub_fetch (p, v, __ATOMIC_SEQ_CST)
+
+typedef struct fifo_queue_slot_s {
+  unsigned long seq;
+  int id;
+  void *data;
+} fifo_queue_slot_t;
+
 typedef struct fifo_queue_item_s {
   int id;
   void *data;
   struct fifo_queue_item_s *next;
 } fifo_queue_item_t;
 
+typedef struct fifo_queue_lane_s {
+  unsigned long head;
+  char pad0[FIFO_QUEUE_CACHELINE - sizeof (unsigned long)];
+  unsigned long tail;
+  char pad1[FIFO_QUEUE_CACHELINE - sizeof (unsigned long)];
+
+  fifo_queue_slot_t *slot;
+  unsigned long mask;
+
+  /* overflow list (protected by fifo_queue_s::mutex) */
+  int ovf_nb;
+  fifo_queue_item_t *ovf;
+  fifo_queue_item_t *ovf_last;
+} fifo_queue_lane_t;
+
 struct fifo_queue_s {
-  fifo_queue_item_t *item;
-  fifo_queue_item_t *item_last;
+  fifo_queue_lane_t lane[2]; /* indexed by fifo_queue_prio_t */
+
+  int avail;   /* number of items available for the consumers (futex) */
+  int waiters;
+  int wake;    /* a wake-up is pending */
   pthread_mutex_t mutex;
-  sem_t sem;
+#ifndef __linux__
+  pthread_mutex_t mutex_wait;
+  pthread_cond_t  cond_wait;
+#endif /* !__linux__ */
 };
 
+/*
+ * Special value for a slot where the entry was moved in the high lane by
+ * vh_fifo_queue_moveup(). These slots are ignored by the consumers.
+ */
+static char fifo_queue_tombstone;
+#define FIFO_QUEUE_TOMBSTONE ((void *) &fifo_queue_tombstone)
+
+
+static void
+fifo_queue_wait (fifo_queue_t *queue)
+{
+  ATOMIC_ADD (&queue->waiters, 1);
+  /* a previous wake-up can be stale, it must not hide the next one */
+  ATOMIC_STORE (&queue->wake, 0);
+#ifdef __linux__
+  syscall (SYS_futex, &queue->avail, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+#else
+  pthread_mutex_lock (&queue->mutex_wait);
+  if (!ATOMIC_LOAD (&queue->avail))
+    pthread_cond_wait (&queue->cond_wait, &queue->mutex_wait);
+  pthread_mutex_unlock (&queue->mutex_wait);
+#endif /* __linux__ */
+  ATOMIC_SUB (&queue->waiters, 1);
+  ATOMIC_STORE (&queue->wake, 0);
+}
+
+/*
+ * Only one wake-up is sent at a time. The producer does not enter in the
+ * kernel for each item when the consumer is not already running (very
+ * common with one CPU). The woken consumer wakes the next one if more
+ * items are available (see fifo_queue_reserve()).
+ */
+static void
+fifo_queue_wake (fifo_queue_t *queue)
+{
+  if (!ATOMIC_LOAD (&queue->waiters) || ATOMIC_XCHG (&queue->wake, 1))
+    return;
+
+#ifdef __linux__
+  syscall (SYS_futex, &queue->avail, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+  pthread_mutex_lock (&queue->mutex_wait);
+  pthread_cond_signal (&queue->cond_wait);
+  pthread_mutex_unlock (&queue->mutex_wait);
+#endif /* __linux__ */
+}
+
+/*
+ * Reserve one item, sleep as long as the queue is empty (or return -1 if
+ * \p wait is 0).
+ */
+static int
+fifo_queue_reserve (fifo_queue_t *queue, int wait)
+{
+  int avail;
+
+  for (;;)
+  {
+    avail = ATOMIC_LOAD (&queue->avail);
+    if (avail > 0)
+    {
+      if (!ATOMIC_CAS (&queue->avail, &avail, avail - 1))
+        continue;
+
+      if (avail > 1)
+        fifo_queue_wake (queue);
+      return 0;
+    }
+
+    if (!wait)
+      return -1;
+
+    fifo_queue_wait (queue);
+  }
+}
+
+static int
+fifo_queue_ring_push (fifo_queue_lane_t *lane, int id, void *data)
+{
+  fifo_queue_slot_t *slot;
+  unsigned long pos, seq;
+  long diff;
+
+  pos = __atomic_load_n (&lane->tail, __ATOMIC_RELAXED);
+  for (;;)
+  {
+    slot = &lane->slot[pos & lane->mask];
+    seq  = ATOMIC_LOAD (&slot->seq);
+    diff = (long) (seq - pos);
+
+    if (!diff)
+    {
+      if (ATOMIC_CAS (&lane->tail, &pos, pos + 1))
+        break;
+    }
+    else if (diff < 0)
+      return -1; /* full */
+    else
+      pos = __atomic_load_n (&lane->tail, __ATOMIC_RELAXED);
+  }
+
+  slot->id = id;
+  ATOMIC_STORE (&slot->data, data);
+  ATOMIC_STORE (&slot->seq, pos + 1);
+  return 0;
+}
+
+static int
+fifo_queue_ring_pop (fifo_queue_lane_t *lane, int *id, void **data)
+{
+  fifo_queue_slot_t *slot;
+  unsigned long pos, seq;
+  long diff;
+
+  pos = __atomic_load_n (&lane->head, __ATOMIC_RELAXED);
+  for (;;)
+  {
+    slot = &lane->slot[pos & lane->mask];
+    seq  = ATOMIC_LOAD (&slot->seq);
+    diff = (long) (seq - (pos + 1));
+
+    if (!diff)
+    {
+      if (ATOMIC_CAS (&lane->head, &pos, pos + 1))
+        break;
+    }
+    else if (diff < 0)
+      return -1; /* empty */
+    else
+      pos = __atomic_load_n (&lane->head, __ATOMIC_RELAXED);
+  }
+
+  *id   = slot->id;
+  *data = ATOMIC_XCHG (&slot->data, NULL);
+  ATOMIC_STORE (&slot->seq, pos + lane->mask + 1);
+  return 0;
+}
+
+static int
+fifo_queue_ovf_push (fifo_queue_lane_t *lane, int id, void *data)
+{
+  fifo_queue_item_t *item;
+
+  item = calloc (1, sizeof (fifo_queue_item_t));
+  if (!item)
+    return -1;
+
+  item->id   = id;
+  item->data = data;
+
+  if (lane->ovf)
+    lane->ovf_last->next = item;
+  else
+    lane->ovf = item;
+  lane->ovf_last = item;
+  ATOMIC_ADD (&lane->ovf_nb, 1);
+
+  return 0;
+}
+
+static int
+fifo_queue_lane_push (fifo_queue_t *queue,
+                      fifo_queue_lane_t *lane, int id, void *data)
+{
+  int res;
+
+  /*
+   * The items must go in the overflow list as long as this one is not
+   * empty, else the order would be broken.
+   */
+  if (!ATOMIC_LOAD (&lane->ovf_nb) && !fifo_queue_ring_push (lane, id, data))
+    return 0;
+
+  pthread_mutex_lock (&queue->mutex);
+  if (!lane->ovf_nb && !fifo_queue_ring_push (lane, id, data))
+    res = 0;
+  else
+    res = fifo_queue_ovf_push (lane, id, data);
+  pthread_mutex_unlock (&queue->mutex);
+
+  return res;
+}
+
+static int
+fifo_queue_lane_pop (fifo_queue_t *queue,
+                     fifo_queue_lane_t *lane, int *id, void **data)
+{
+  fifo_queue_item_t *item;
+
+  if (!fifo_queue_ring_pop (lane, id, data))
+    return 0;
+
+  if (!ATOMIC_LOAD (&lane->ovf_nb))
+    return -1;
+
+  pthread_mutex_lock (&queue->mutex);
+  item = lane->ovf;
+  if (item)
+  {
+    lane->ovf = item->next;
+    ATOMIC_SUB (&lane->ovf_nb, 1);
+  }
+  pthread_mutex_unlock (&queue->mutex);
+
+  if (!item)
+    return -1;
+
+  *id   = item->id;
+  *data = item->data;
+  free (item);
+  return 0;
+}
 
 fifo_queue_t *
 vh_fifo_queue_new (void)
 {
+  unsigned int i, j;
   fifo_queue_t *queue;
 
   queue = calloc (1, sizeof (fifo_queue_t));
   if (!queue)
     return NULL;
 
+  for (i = 0; i < sizeof (queue->lane) / sizeof (*queue->lane); i++)
+  {
+    fifo_queue_lane_t *lane = &queue->lane[i];
+
+    lane->slot = calloc (FIFO_QUEUE_RING_SIZE, sizeof (fifo_queue_slot_t));
+    if (!lane->slot)
+      goto err;
+
+    lane->mask = FIFO_QUEUE_RING_SIZE - 1;
+    for (j = 0; j < FIFO_QUEUE_RING_SIZE; j++)
+      lane->slot[j].seq = j;
+  }
+
   pthread_mutex_init (&queue->mutex, NULL);
-  sem_init (&queue->sem, 0, 0);
+#ifndef __linux__
+  pthread_mutex_init (&queue->mutex_wait, NULL);
+  pthread_cond_init (&queue->cond_wait, NULL);
+#endif /* !__linux__ */
 
   return queue;
+
+ err:
+  for (i = 0; i < sizeof (queue->lane) / sizeof (*queue->lane); i++)
+    free (queue->lane[i].slot);
+  free (queue);
+  return NULL;
 }
 
 void
 vh_fifo_queue_free (fifo_queue_t *queue)
 {
+  unsigned int i;
   fifo_queue_item_t *item, *next;
 
   if (!queue)
     return;
 
-  item = queue->item;
-  while (item)
+  for (i = 0; i < sizeof (queue->lane) / sizeof (*queue->lane); i++)
   {
-    next = item->next;
-    free (item);
-    item = next;
+    item = queue->lane[i].ovf;
+    while (item)
+    {
+      next = item->next;
+      free (item);
+      item = next;
+    }
+
+    free (queue->lane[i].slot);
   }
 
   pthread_mutex_destroy (&queue->mutex);
-  sem_destroy (&queue->sem);
+#ifndef __linux__
+  pthread_mutex_destroy (&queue->mutex_wait);
+  pthread_cond_destroy (&queue->cond_wait);
+#endif /* !__linux__ */
 
   free (queue);
 }
@@ -80,90 +380,116 @@ int
 vh_fifo_queue_push (fifo_queue_t *queue,
                     fifo_queue_prio_t p, int id, void *data)
 {
-  fifo_queue_item_t *item;
+  fifo_queue_lane_t *lane;
 
   if (!queue)
     return FIFO_QUEUE_ERROR_QUEUE;
 
-  pthread_mutex_lock (&queue->mutex);
-
-  item = queue->item;
-  if (item)
-  {
-    switch (p)
-    {
-    default:
-    case FIFO_QUEUE_PRIORITY_NORMAL:
-      queue->item_last->next = calloc (1, sizeof (fifo_queue_item_t));
-      item = queue->item_last->next;
-      if (item)
-        queue->item_last = item;
-      break;
-
-    case FIFO_QUEUE_PRIORITY_HIGH:
-      item = calloc (1, sizeof (fifo_queue_item_t));
-      if (!item)
-        break;
-      item->next = queue->item;
-      queue->item = item;
-      break;
-    }
-  }
-  else
-  {
-    item = calloc (1, sizeof (fifo_queue_item_t));
-    queue->item = item;
-    queue->item_last = item;
-  }
+  lane = &queue->lane[p == FIFO_QUEUE_PRIORITY_HIGH
+                      ? FIFO_QUEUE_PRIORITY_HIGH : FIFO_QUEUE_PRIORITY_NORMAL];
 
-  if (!item)
-  {
-    pthread_mutex_unlock (&queue->mutex);
+  if (fifo_queue_lane_push (queue, lane, id, data))
     return FIFO_QUEUE_ERROR_MALLOC;
-  }
-
-  item->id = id;
-  item->data = data;
 
   /* new entry in the queue is ok */
-  sem_post (&queue->sem);
-
-  pthread_mutex_unlock (&queue->mutex);
+  ATOMIC_ADD (&queue->avail, 1);
+  fifo_queue_wake (queue);
 
   return FIFO_QUEUE_SUCCESS;
 }
 
-int
-vh_fifo_queue_pop (fifo_queue_t *queue, int *id, void **data)
+static int
+fifo_queue_pop (fifo_queue_t *queue, int *id, void **data, int wait)
 {
-  fifo_queue_item_t *item, *next;
+  int i, _id;
+  void *_data;
 
   if (!queue)
     return FIFO_QUEUE_ERROR_QUEUE;
 
   /* wait on the queue */
-  sem_wait (&queue->sem);
+  if (fifo_queue_reserve (queue, wait))
+    return FIFO_QUEUE_ERROR_EMPTY;
 
-  pthread_mutex_lock (&queue->mutex);
-  item = queue->item;
-  if (!item)
+  /*
+   * An item is reserved, but it can be not visible yet (a producer has not
+   * finished to write a slot). Then we loop until to find it.
+   */
+  for (;;)
   {
-    pthread_mutex_unlock (&queue->mutex);
-    return FIFO_QUEUE_ERROR_EMPTY;
+    for (i = FIFO_QUEUE_PRIORITY_HIGH; i >= FIFO_QUEUE_PRIORITY_NORMAL; i--)
+    {
+      if (fifo_queue_lane_pop (queue, &queue->lane[i], &_id, &_data))
+        continue;
+
+      /* moved in the high lane, the reservation is kept */
+      if (_data == FIFO_QUEUE_TOMBSTONE)
+      {
+        i = FIFO_QUEUE_PRIORITY_HIGH + 1;
+        continue;
+      }
+
+      if (id)
+        *id = _id;
+      if (data)
+        *data = _data;
+      return FIFO_QUEUE_SUCCESS;
+    }
+
+    sched_yield ();
   }
+}
 
-  if (id)
-    *id = item->id;
-  if (data)
-    *data = item->data;
+int
+vh_fifo_queue_pop (fifo_queue_t *queue, int *id, void **data)
+{
+  return fifo_queue_pop (queue, id, data, 1);
+}
 
-  /* remove the entry and go to the next */
-  next = item->next;
-  free (item);
-  queue->item = next;
-  pthread_mutex_unlock (&queue->mutex);
+int
+vh_fifo_queue_trypop (fifo_queue_t *queue, int *id, void **data)
+{
+  return fifo_queue_pop (queue, id, data, 0);
+}
 
-  return FIFO_QUEUE_SUCCESS;
+/*
+ * The search and the move-up are slow paths (only used with the ondemand
+ * thread when all other threads are paused). They are serialized by the
+ * mutex but they can race with the lock-free consumers; a slot is always
+ * checked with its sequence number and it is only taken with a CAS on its
+ * data.
+ */
+
+static fifo_queue_slot_t *
+fifo_queue_ring_search (fifo_queue_lane_t *lane, int *id, void **data,
+                        const void *tocmp,
+                        int (*cmp_fct) (const void *tocmp,
+                                        int id, const void *data))
+{
+  unsigned long pos, tail;
+
+  tail = ATOMIC_LOAD (&lane->tail);
+  for (pos = ATOMIC_LOAD (&lane->head); (long) (tail - pos) > 0; pos++)
+  {
+    fifo_queue_slot_t *slot = &lane->slot[pos & lane->mask];
+    void *d;
+
+    if (ATOMIC_LOAD (&slot->seq) != pos + 1)
+      continue;
+
+    d = ATOMIC_LOAD (&slot->data);
+    if (!d || d == FIFO_QUEUE_TOMBSTONE)
+      continue;
+
+    if (!cmp_fct (tocmp, slot->id, d))
+    {
+      *id   = slot->id;
+      *data = d;
+      return slot;
+    }
+  }
+
+  return NULL;
 }
 
 void *
@@ -171,6 +497,7 @@ vh_fifo_queue_search (fifo_queue_t *queue, int *id, const void *tocmp,
                       int (*cmp_fct) (const void *tocmp,
                                       int id, const void *data))
 {
+  int i;
   void *data = NULL;
   fifo_queue_item_t *item;
 
@@ -179,13 +506,24 @@ vh_fifo_queue_search (fifo_queue_t *queue, int *id, const void *tocmp,
 
   pthread_mutex_lock (&queue->mutex);
 
-  for (item = queue->item; item; item = item->next)
-    if (!cmp_fct (tocmp, item->id, item->data))
-    {
-      *id  = item->id;
-      data = item->data;
+  for (i = FIFO_QUEUE_PRIORITY_HIGH; i >= FIFO_QUEUE_PRIORITY_NORMAL; i--)
+  {
+    fifo_queue_lane_t *lane = &queue->lane[i];
+
+    if (fifo_queue_ring_search (lane, id, &data, tocmp, cmp_fct))
       break;
-    }
+
+    for (item = lane->ovf; item; item = item->next)
+      if (!cmp_fct (tocmp, item->id, item->data))
+      {
+        *id  = item->id;
+        data = item->data;
+        break;
+      }
+
+    if (data)
+      break;
+  }
 
   pthread_mutex_unlock (&queue->mutex);
 
@@ -197,6 +535,10 @@ vh_fifo_queue_moveup (fifo_queue_t *queue, const void *tomove,
                       int (*cmp_fct) (const void *tocmp,
                                       int id, const void *data))
 {
+  int id;
+  void *data;
+  fifo_queue_slot_t *slot;
+  fifo_queue_lane_t *lane;
   fifo_queue_item_t *item, *item_p = NULL;
 
   if (!queue || !tomove || !cmp_fct)
@@ -204,21 +546,55 @@ vh_fifo_queue_moveup (fifo_queue_t *queue, const void *tomove,
 
   pthread_mutex_lock (&queue->mutex);
 
-  for (item = queue->item; item; item = item->next)
-  {
+  /* Already in the high lane? */
+  lane = &queue->lane[FIFO_QUEUE_PRIORITY_HIGH];
+  if (fifo_queue_ring_search (lane, &id, &data, tomove, cmp_fct))
+    goto out;
+  for (item = lane->ovf; item; item = item->next)
     if (!cmp_fct (tomove, item->id, item->data))
+      goto out;
+
+  lane = &queue->lane[FIFO_QUEUE_PRIORITY_NORMAL];
+  slot = fifo_queue_ring_search (lane, &id, &data, tomove, cmp_fct);
+  if (slot)
+  {
+    /* Lost against a consumer, nothing to move. */
+    if (!ATOMIC_CAS (&slot->data, &data, FIFO_QUEUE_TOMBSTONE))
+      goto out;
+  }
+  else
+  {
+    for (item = lane->ovf; item; item = item->next)
     {
-      if (!item_p)
+      if (!cmp_fct (tomove, item->id, item->data))
         break;
-      item_p->next = item->next;
-      if (!item_p->next)
-        queue->item_last = item_p;
-      item->next = queue->item;
-      queue->item = item;
-      break;
+      item_p = item;
     }
-    item_p = item;
+
+    if (!item)
+      goto out;
+
+    if (item_p)
+      item_p->next = item->next;
+    else
+      lane->ovf = item->next;
+    if (lane->ovf_last == item)
+      lane->ovf_last = item_p;
+    ATOMIC_SUB (&lane->ovf_nb, 1);
+
+    id   = item->id;
+    data = item->data;
+    free (item);
   }
 
+  /*
+   * The entry is pushed in the high lane without a new reservation because
+   * the tombstone (or the removed overflow item) is not counted anymore.
+   */
+  lane = &queue->lane[FIFO_QUEUE_PRIORITY_HIGH];
+  if (lane->ovf_nb || fifo_queue_ring_push (lane, id, data))
+    fifo_queue_ovf_push (lane, id, data);
+
+ out:
   pthread_mutex_unlock (&queue->mutex);
 }
@@ -0,0 +1,291 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "file_index.h"
+
+/*
+ * Hash table (open addressing, linear probing) of the files. The path and
+ * the data are in the same allocation. A removed entry is replaced by a
+ * tombstone until the next resize.
+ */
+
+#define FILE_INDEX_SIZE_MIN 64
+
+typedef struct file_index_entry_s {
+  file_index_data_t data;
+  char              path[];
+} file_index_entry_t;
+
+typedef struct file_index_slot_s {
+  uint32_t            hash;
+  file_index_entry_t *entry;
+} file_index_slot_t;
+
+struct file_index_s {
+  file_index_slot_t *slots;
+  unsigned int       size;    /* power of 2 */
+  unsigned int       nb;
+  unsigned int       deleted; /* tombstones */
+  size_t             bytes;   /* size of the entries */
+};
+
+static file_index_entry_t g_deleted;
+#define FILE_INDEX_DELETED (&g_deleted)
+
+
+static uint32_t
+file_index_hash (const char *path)
+{
+  uint32_t hash = 2166136261U; /* FNV-1a */
+
+  for (; *path; path++)
+  {
+    hash ^= (unsigned char) *path;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+/*
+ * Return the slot of the path, or NULL if it is not found. In this case,
+ * \p free_slot is the slot where the path can be inserted.
+ */
+static file_index_slot_t *
+file_index_lookup (file_index_t *index, const char *path, uint32_t hash,
+                   file_index_slot_t **free_slot)
+{
+  unsigned int i, mask = index->size - 1;
+  file_index_slot_t *tomb = NULL;
+
+  /* there is always at least one free slot */
+  for (i = hash & mask;; i = (i + 1) & mask)
+  {
+    file_index_slot_t *slot = &index->slots[i];
+
+    if (!slot->entry)
+    {
+      if (free_slot)
+        *free_slot = tomb ? tomb : slot;
+      return NULL;
+    }
+
+    if (slot->entry == FILE_INDEX_DELETED)
+    {
+      if (!tomb)
+        tomb = slot;
+      continue;
+    }
+
+    if (slot->hash == hash && !strcmp (slot->entry->path, path))
+      return slot;
+  }
+}
+
+static int
+file_index_resize (file_index_t *index, unsigned int size)
+{
+  unsigned int i;
+  file_index_slot_t *slots, *old = index->slots;
+  unsigned int old_size = index->size;
+
+  slots = calloc (size, sizeof (*slots));
+  if (!slots)
+    return -1;
+
+  index->slots   = slots;
+  index->size    = size;
+  index->deleted = 0;
+
+  for (i = 0; i < old_size; i++)
+  {
+    file_index_slot_t *slot;
+
+    if (!old[i].entry || old[i].entry == FILE_INDEX_DELETED)
+      continue;
+
+    file_index_lookup (index, old[i].entry->path, old[i].hash, &slot);
+    *slot = old[i];
+  }
+
+  free (old);
+  return 0;
+}
+
+file_index_data_t *
+vh_file_index_get (file_index_t *index, const char *path)
+{
+  file_index_slot_t *slot;
+
+  if (!index || !path || !index->nb)
+    return NULL;
+
+  slot = file_index_lookup (index, path, file_index_hash (path), NULL);
+  return slot ? &slot->entry->data : NULL;
+}
+
+int
+vh_file_index_set (file_index_t *index,
+                   const char *path, const file_index_data_t *data)
+{
+  uint32_t hash;
+  size_t len;
+  file_index_slot_t *slot, *free_slot = NULL;
+  file_index_entry_t *entry;
+
+  if (!index || !path || !data)
+    return -1;
+
+  hash = file_index_hash (path);
+
+  if (index->size)
+  {
+    slot = file_index_lookup (index, path, hash, &free_slot);
+    if (slot)
+    {
+      slot->entry->data = *data;
+      return 0;
+    }
+  }
+
+  /* max load factor of 3/4 (with the tombstones) */
+  if ((index->nb + index->deleted + 1) * 4 > index->size * 3)
+  {
+    unsigned int size = index->size ? index->size : FILE_INDEX_SIZE_MIN;
+
+    /* the size is not changed if there are a lot of tombstones */
+    if ((index->nb + 1) * 2 > size)
+      size *= 2;
+
+    if (file_index_resize (index, size))
+      return -1;
+
+    file_index_lookup (index, path, hash, &free_slot);
+  }
+
+  len = strlen (path) + 1;
+  entry = malloc (sizeof (*entry) + len);
+  if (!entry)
+    return -1;
+
+  entry->data = *data;
+  memcpy (entry->path, path, len);
+
+  if (free_slot->entry == FILE_INDEX_DELETED)
+    index->deleted--;
+
+  free_slot->hash  = hash;
+  free_slot->entry = entry;
+  index->nb++;
+  index->bytes += sizeof (*entry) + len;
+  return 0;
+}
+
+static void
+file_index_slot_del (file_index_t *index, file_index_slot_t *slot)
+{
+  index->bytes -= sizeof (*slot->entry) + strlen (slot->entry->path) + 1;
+  free (slot->entry);
+  slot->entry = FILE_INDEX_DELETED;
+  index->nb--;
+  index->deleted++;
+}
+
+void
+vh_file_index_del (file_index_t *index, const char *path)
+{
+  file_index_slot_t *slot;
+
+  if (!index || !path || !index->nb)
+    return;
+
+  slot = file_index_lookup (index, path, file_index_hash (path), NULL);
+  if (slot)
+    file_index_slot_del (index, slot);
+}
+
+/*
+ * The entry is removed from the index when the function returns a value
+ * different of 0.
+ */
+void
+vh_file_index_foreach (file_index_t *index,
+                       int (*each_fct) (void *data, const char *path,
+                                        file_index_data_t *fdata),
+                       void *data)
+{
+  unsigned int i;
+
+  if (!index || !each_fct)
+    return;
+
+  for (i = 0; i < index->size; i++)
+  {
+    file_index_slot_t *slot = &index->slots[i];
+
+    if (!slot->entry || slot->entry == FILE_INDEX_DELETED)
+      continue;
+
+    if (each_fct (data, slot->entry->path, &slot->entry->data))
+      file_index_slot_del (index, slot);
+  }
+}
+
+unsigned int
+vh_file_index_count (file_index_t *index)
+{
+  return index ? index->nb : 0;
+}
+
+size_t
+vh_file_index_memory (file_index_t *index)
+{
+  if (!index)
+    return 0;
+
+  return sizeof (*index) + index->size * sizeof (*index->slots) + index->bytes;
+}
+
+void
+vh_file_index_free (file_index_t *index)
+{
+  unsigned int i;
+
+  if (!index)
+    return;
+
+  for (i = 0; i < index->size; i++)
+    if (index->slots[i].entry && index->slots[i].entry != FILE_INDEX_DELETED)
+      free (index->slots[i].entry);
+
+  free (index->slots);
+  free (index);
+}
+
+file_index_t *
+vh_file_index_new (void)
+{
+  return calloc (1, sizeof (file_index_t));
+}
@@ -0,0 +1,51 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef VALHALLA_FILE_INDEX_H
+#define VALHALLA_FILE_INDEX_H
+
+#include <stddef.h>
+#include <inttypes.h>
+
+typedef struct file_index_s file_index_t;
+
+/* Copy of the columns of the table 'file' used by the dbmanager. */
+typedef struct file_index_data_s {
+  int64_t id;
+  int64_t mtime;
+  int     interrupted;
+} file_index_data_t;
+
+
+file_index_t *vh_file_index_new (void);
+void vh_file_index_free (file_index_t *index);
+file_index_data_t *vh_file_index_get (file_index_t *index, const char *path);
+int vh_file_index_set (file_index_t *index,
+                       const char *path, const file_index_data_t *data);
+void vh_file_index_del (file_index_t *index, const char *path);
+void vh_file_index_foreach (file_index_t *index,
+                            int (*each_fct) (void *data, const char *path,
+                                             file_index_data_t *fdata),
+                            void *data);
+unsigned int vh_file_index_count (file_index_t *index);
+size_t vh_file_index_memory (file_index_t *index);
+
+#endif /* VALHALLA_FILE_INDEX_H */
@@ -109,8 +109,9 @@ grabber_allocine_get (grabber_allocine_t *allocine, file_data_t *fdata,
     /* special trick to retrieve english title,
      *  used by next grabbers to find cover and fan arts.
      */
-    vh_metadata_add_auto (&fdata->meta_grabber, VALHALLA_METADATA_TITLE,
-                          (char *) tmp, VALHALLA_LANG_EN, allocine->pl);
+    vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
+                          VALHALLA_METADATA_TITLE, (char *) tmp,
+                          VALHALLA_LANG_EN, allocine->pl);
     xmlFree (tmp);
   }
 
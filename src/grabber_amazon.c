@@ -334,7 +334,7 @@ grabber_amazon_init (void *priv, const grabber_param_t *param)
   if (!amazon->hd)
     return -1;
 
-  amazon->list = vh_list_new (MAX_LIST_DEPTH, NULL);
+  amazon->list = vh_list_new (MAX_LIST_DEPTH, NULL, NULL);
   if (!amazon->list)
     return -1;
 
@@ -397,8 +397,9 @@ grabber_amazon_grab (void *priv, file_data_t *data)
   res = grabber_amazon_check (amazon, cover);
   if (!res)
   {
-    vh_metadata_add_auto (&data->meta_grabber, VALHALLA_METADATA_COVER,
-                          cover, VALHALLA_LANG_UNDEF, amazon->pl);
+    vh_metadata_add_auto (&data->meta_grabber, data->arena,
+                          VALHALLA_METADATA_COVER, cover, VALHALLA_LANG_UNDEF,
+                          amazon->pl);
     free (cover);
     return 0;
   }
@@ -428,8 +429,9 @@ grabber_amazon_grab (void *priv, file_data_t *data)
   free (escaped_keywords);
   if (!res)
   {
-    vh_metadata_add_auto (&data->meta_grabber, VALHALLA_METADATA_COVER,
-                          cover, VALHALLA_LANG_UNDEF, amazon->pl);
+    vh_metadata_add_auto (&data->meta_grabber, data->arena,
+                          VALHALLA_METADATA_COVER, cover, VALHALLA_LANG_UNDEF,
+                          amazon->pl);
     vh_file_dl_add (&data->list_downloader, url, cover, VALHALLA_DL_COVER);
     free (url);
   }
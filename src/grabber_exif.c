@@ -65,7 +65,7 @@ exif_content_foreach_func (ExifEntry *entry, void *data)
   for (pl = exif->pl; pl->metadata; pl++)
     ;
 
-  vh_metadata_add (&fdata->meta_grabber,
+  vh_metadata_add (&fdata->meta_grabber, fdata->arena,
                    exif_tag_get_name (entry->tag),
                    exif_entry_get_value (entry, buf, BUF_SIZE),
                    VALHALLA_META_GRP_TECHNICAL,
@@ -141,7 +141,7 @@ grabber_exif_grab (void *priv, file_data_t *data)
     orientation = exif_get_short (e->data, bo);
 
     snprintf (val, sizeof (val), "%d", orientation);
-    vh_metadata_add_auto (&data->meta_grabber,
+    vh_metadata_add_auto (&data->meta_grabber, data->arena,
                           VALHALLA_METADATA_PICTURE_ORIENTATION,
                           val, VALHALLA_LANG_UNDEF, exif->pl);
   }
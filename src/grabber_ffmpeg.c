@@ -58,14 +58,13 @@ grabber_ffmpeg_codec_name (enum AVCodecID id)
 
 static int
 grabber_ffmpeg_properties_get (grabber_ffmpeg_t *ffmpeg,
-                               AVFormatContext *ctx, file_data_t *data)
+                               const lavf_utils_props_t *props,
+                               file_data_t *data)
 {
-  int res;
   unsigned int i;
   unsigned int audio_streams = 0, video_streams = 0, sub_streams = 0;
 
-  res = avformat_find_stream_info (ctx, NULL);
-  if (res < 0)
+  if (props->error)
   {
     vh_log (VALHALLA_MSG_VERBOSE,
             "FFmpeg can't find stream info: %s", data->file.path);
@@ -76,60 +75,54 @@ grabber_ffmpeg_properties_get (grabber_ffmpeg_t *ffmpeg,
    * The duration is in microsecond. We save in millisecond in order to
    * have the same unit as libplayer.
    */
-  if (data->file.type != VALHALLA_FILE_TYPE_IMAGE && ctx->duration)
-    vh_grabber_parse_int64 (data, ROUNDED_DIV (ctx->duration, 1000),
+  if (data->file.type != VALHALLA_FILE_TYPE_IMAGE && props->duration)
+    vh_grabber_parse_int64 (data, ROUNDED_DIV (props->duration, 1000),
                             VALHALLA_METADATA_DURATION, ffmpeg->pl);
 
-  for (i = 0; i < ctx->nb_streams; i++)
+  for (i = 0; i < props->nb_streams; i++)
   {
     float value;
     const char *name;
-    AVStream *st = ctx->streams[i];
-    AVCodecParameters *codec = st->codecpar;
+    const lavf_utils_stream_t *st = &props->streams[i];
 
-    switch (codec->codec_type)
+    switch (st->type)
     {
     case AVMEDIA_TYPE_AUDIO:
       audio_streams++;
-      name = grabber_ffmpeg_codec_name (codec->codec_id);
+      name = grabber_ffmpeg_codec_name (st->codec_id);
       if (name)
-        vh_metadata_add_auto (&data->meta_grabber,
+        vh_metadata_add_auto (&data->meta_grabber, data->arena,
                               VALHALLA_METADATA_AUDIO_CODEC,
                               name, VALHALLA_LANG_UNDEF, ffmpeg->pl);
-      vh_grabber_parse_int (data, codec->channels,
+      vh_grabber_parse_int (data, st->channels,
                             VALHALLA_METADATA_AUDIO_CHANNELS, ffmpeg->pl);
-      if (codec->bit_rate)
-        vh_grabber_parse_int (data, codec->bit_rate,
+      if (st->bit_rate)
+        vh_grabber_parse_int (data, st->bit_rate,
                               VALHALLA_METADATA_AUDIO_BITRATE, ffmpeg->pl);
       break;
 
     case AVMEDIA_TYPE_VIDEO:
       /* Common part (image + video) */
       video_streams++;
-      name = grabber_ffmpeg_codec_name (codec->codec_id);
+      name = grabber_ffmpeg_codec_name (st->codec_id);
       if (name)
-        vh_metadata_add_auto (&data->meta_grabber,
+        vh_metadata_add_auto (&data->meta_grabber, data->arena,
                               VALHALLA_METADATA_VIDEO_CODEC,
                               name, VALHALLA_LANG_UNDEF, ffmpeg->pl);
-      vh_grabber_parse_int (data, codec->width,
+      vh_grabber_parse_int (data, st->width,
                             VALHALLA_METADATA_WIDTH, ffmpeg->pl);
-      vh_grabber_parse_int (data, codec->height,
+      vh_grabber_parse_int (data, st->height,
                             VALHALLA_METADATA_HEIGHT, ffmpeg->pl);
 
       /* Only for video */
       if (data->file.type == VALHALLA_FILE_TYPE_IMAGE)
         break;
 
-      if (codec->bit_rate)
-        vh_grabber_parse_int (data, codec->bit_rate,
+      if (st->bit_rate)
+        vh_grabber_parse_int (data, st->bit_rate,
                               VALHALLA_METADATA_VIDEO_BITRATE, ffmpeg->pl);
 
-      if (st->sample_aspect_ratio.num)
-        value = codec->width * st->sample_aspect_ratio.num
-                / (float) (codec->height * st->sample_aspect_ratio.den);
-      else
-        value = codec->width * codec->sample_aspect_ratio.num
-                / (float) (codec->height * codec->sample_aspect_ratio.den);
+      value = st->width * st->sar_num / (float) (st->height * st->sar_den);
       /*
        * Save in integer with a ratio of 10000 like the constant
        * PLAYER_VIDEO_ASPECT_RATIO_MULT with libplayer (player.h).
@@ -204,17 +197,24 @@ grabber_ffmpeg_grab (void *priv, file_data_t *data)
   grabber_ffmpeg_t *ffmpeg = priv;
   int res;
   AVFormatContext *ctx;
+  lavf_utils_props_t *props;
 
   vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
 
-  ctx = vh_lavf_utils_open_input_file (data->file.path);
+  /* The properties are already read by the parser (combined pass). */
+  if (data->props)
+    return grabber_ffmpeg_properties_get (ffmpeg, data->props, data);
+
+  ctx = vh_lavf_utils_open_input_file (data->file.path, NULL);
   if (!ctx)
     return -1;
 
-  res = grabber_ffmpeg_properties_get (ffmpeg, ctx, data);
+  props = vh_lavf_utils_props_get (ctx);
+  res = props ? grabber_ffmpeg_properties_get (ffmpeg, props, data) : -1;
   /* TODO: res = grabber_ffmpeg_snapshot (ctx, data, pos); */
 
-  avformat_close_input (&ctx);
+  free (props);
+  vh_lavf_utils_close_input_file (&ctx);
   return res;
 }
 
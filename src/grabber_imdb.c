@@ -110,8 +110,9 @@ grabber_imdb_get (grabber_imdb_t *imdb, file_data_t *fdata,
     /* special trick to retrieve english title,
      *  used by next grabbers to find cover and fan arts.
      */
-    vh_metadata_add_auto (&fdata->meta_grabber, VALHALLA_METADATA_TITLE,
-                          (char *) tmp, VALHALLA_LANG_EN, imdb->pl);
+    vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
+                          VALHALLA_METADATA_TITLE, (char *) tmp,
+                          VALHALLA_LANG_EN, imdb->pl);
     xmlFree (tmp);
   }
 
@@ -146,7 +146,7 @@ grabber_lastfm_init (void *priv, const grabber_param_t *param)
   if (!lastfm)
     return -1;
 
-  lastfm->list = vh_list_new (MAX_LIST_DEPTH, NULL);
+  lastfm->list = vh_list_new (MAX_LIST_DEPTH, NULL, NULL);
   if (!lastfm->list)
     return -1;
 
@@ -214,16 +214,18 @@ grabber_lastfm_grab (void *priv, file_data_t *data)
   res = grabber_lastfm_check (lastfm, cover);
   if (!res)
   {
-    vh_metadata_add_auto (&data->meta_grabber, VALHALLA_METADATA_COVER,
-                          cover, VALHALLA_LANG_UNDEF, lastfm->pl);
+    vh_metadata_add_auto (&data->meta_grabber, data->arena,
+                          VALHALLA_METADATA_COVER, cover, VALHALLA_LANG_UNDEF,
+                          lastfm->pl);
     goto out;
   }
 
   res = grabber_lastfm_get (lastfm->handler, &url, artist, alb);
   if (!res)
   {
-    vh_metadata_add_auto (&data->meta_grabber, VALHALLA_METADATA_COVER,
-                          cover, VALHALLA_LANG_UNDEF, lastfm->pl);
+    vh_metadata_add_auto (&data->meta_grabber, data->arena,
+                          VALHALLA_METADATA_COVER, cover, VALHALLA_LANG_UNDEF,
+                          lastfm->pl);
     vh_file_dl_add (&data->list_downloader, url, cover, VALHALLA_DL_COVER);
     free (url);
   }
@@ -59,6 +59,7 @@ typedef struct grabber_tmdb_s {
 
 typedef struct grabber_tmdb_data_s {
   metadata_t **meta_grabber;
+  arena_t *arena;
   grabber_tmdb_t *tmdb;
 } grabber_tmdb_data_t;
 
@@ -95,7 +96,7 @@ grabber_tmdb_get_picture (file_data_t *fdata, const char *keywords,
   snprintf (name, sizeof (name), "%s-%s", type, keywords);
   cover = vh_md5sum (name);
 
-  vh_metadata_add_auto (&fdata->meta_grabber,
+  vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
                         type, cover, VALHALLA_LANG_UNDEF, pl);
   vh_file_dl_add (&fdata->list_downloader, url, cover, dl);
 
@@ -127,8 +128,9 @@ grabber_tmdb_genres (json_object *json, grabber_tmdb_data_t *data)
   if (!genre)
     return;
 
-  vh_metadata_add_auto (data->meta_grabber, VALHALLA_METADATA_CATEGORY,
-                        genre, VALHALLA_LANG_EN, data->tmdb->pl);
+  vh_metadata_add_auto (data->meta_grabber, data->arena,
+                        VALHALLA_METADATA_CATEGORY, genre, VALHALLA_LANG_EN,
+                        data->tmdb->pl);
   free (genre);
 }
 
@@ -139,8 +141,9 @@ grabber_tmdb_countries (json_object *json, grabber_tmdb_data_t *data)
   if (!country)
     return;
 
-  vh_metadata_add_auto (data->meta_grabber, VALHALLA_METADATA_COUNTRY,
-                        country, VALHALLA_LANG_EN, data->tmdb->pl);
+  vh_metadata_add_auto (data->meta_grabber, data->arena,
+                        VALHALLA_METADATA_COUNTRY, country, VALHALLA_LANG_EN,
+                        data->tmdb->pl);
   free (country);
 }
 
@@ -164,8 +167,9 @@ grabber_tmdb_cast (json_object *json, grabber_tmdb_data_t *data)
 
   free (name);
 
-  vh_metadata_add_auto (data->meta_grabber, VALHALLA_METADATA_ACTOR,
-                        str, VALHALLA_LANG_UNDEF, data->tmdb->pl);
+  vh_metadata_add_auto (data->meta_grabber, data->arena,
+                        VALHALLA_METADATA_ACTOR, str, VALHALLA_LANG_UNDEF,
+                        data->tmdb->pl);
 }
 
 static void
@@ -197,8 +201,9 @@ grabber_tmdb_crew (json_object *json, grabber_tmdb_data_t *data)
   for (int i = 0; casting_mapping[i].job; i++)
     if (!strcasecmp (job, casting_mapping[i].job))
     {
-      vh_metadata_add_auto (data->meta_grabber, casting_mapping[i].meta,
-                            name, VALHALLA_LANG_UNDEF, data->tmdb->pl);
+      vh_metadata_add_auto (data->meta_grabber, data->arena,
+                            casting_mapping[i].meta, name,
+                            VALHALLA_LANG_UNDEF, data->tmdb->pl);
       break;
     }
 
@@ -220,6 +225,7 @@ grabber_tmdb_get (grabber_tmdb_t *tmdb, file_data_t *fdata,
 
   grabber_tmdb_data_t data = {
     .meta_grabber = &fdata->meta_grabber,
+    .arena = fdata->arena,
     .tmdb = tmdb,
   };
 
@@ -258,8 +264,9 @@ grabber_tmdb_get (grabber_tmdb_t *tmdb, file_data_t *fdata,
   value_s = vh_json_get_str (doc, "overview");
   if (value_s)
   {
-    vh_metadata_add_auto (&fdata->meta_grabber, VALHALLA_METADATA_SYNOPSIS,
-                          value_s, VALHALLA_LANG_EN, tmdb->pl);
+    vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
+                          VALHALLA_METADATA_SYNOPSIS, value_s, VALHALLA_LANG_EN,
+                          tmdb->pl);
     free (value_s);
   }
 
@@ -273,8 +280,9 @@ grabber_tmdb_get (grabber_tmdb_t *tmdb, file_data_t *fdata,
   value_s = vh_json_get_str (doc, "release_date");
   if (value_s)
   {
-    vh_metadata_add_auto (&fdata->meta_grabber, VALHALLA_METADATA_DATE,
-                          value_s, VALHALLA_LANG_EN, tmdb->pl);
+    vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
+                          VALHALLA_METADATA_DATE, value_s, VALHALLA_LANG_EN,
+                          tmdb->pl);
     free (value_s);
   }
 
@@ -282,8 +290,9 @@ grabber_tmdb_get (grabber_tmdb_t *tmdb, file_data_t *fdata,
   value_s = vh_json_get_str (doc, "vote_average");
   if (value_s)
   {
-    vh_metadata_add_auto (&fdata->meta_grabber, VALHALLA_METADATA_RATING,
-                          value_s, VALHALLA_LANG_EN, tmdb->pl);
+    vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
+                          VALHALLA_METADATA_RATING, value_s, VALHALLA_LANG_EN,
+                          tmdb->pl);
     free (value_s);
   }
 
@@ -93,7 +93,8 @@ grabber_tvdb_parse_list (file_data_t *fdata, xmlNode *node, const char *tag,
     value = strtok_r ((char *) tmp, "|", &saveptr);
     while (value)
     {
-      vh_metadata_add_auto (&fdata->meta_grabber, name, value, lang, pl);
+      vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena, name, value,
+                            lang, pl);
       value = strtok_r (NULL, "|", &saveptr);
     }
     xmlFree (tmp);
@@ -123,7 +124,7 @@ grabber_tvdb_get_picture (file_data_t *fdata, const char *keywords,
   snprintf (name, sizeof (name), "%s-%s", metadata_name, keywords);
   cover = vh_md5sum (name);
 
-  vh_metadata_add_auto (&fdata->meta_grabber,
+  vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
                         metadata_name, cover, VALHALLA_LANG_UNDEF, pl);
   vh_file_dl_add (&fdata->list_downloader, complete_url, cover, dl);
   free (cover);
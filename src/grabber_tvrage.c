@@ -131,7 +131,7 @@ grabber_tvrage_get (grabber_tvrage_t *tvrage, file_data_t *fdata,
   tmp = vh_xml_get_prop_value_from_tree_by_attr (n, "aka", "country", "FR");
   if (tmp)
   {
-    vh_metadata_add_auto (&fdata->meta_grabber,
+    vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
                           VALHALLA_METADATA_TITLE_ALTERNATIVE,
                           (char *) tmp, VALHALLA_LANG_FR, tvrage->pl);
     xmlFree (tmp);
@@ -159,7 +159,7 @@ grabber_tvrage_get (grabber_tvrage_t *tvrage, file_data_t *fdata,
     tmp = vh_xml_get_prop_value_from_tree (node, "genre");
     if (tmp)
     {
-      vh_metadata_add_auto (&fdata->meta_grabber,
+      vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
                             VALHALLA_METADATA_CATEGORY,
                             (char *) tmp, VALHALLA_LANG_EN, tvrage->pl);
       xmlFree (tmp);
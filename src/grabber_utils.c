@@ -52,7 +52,8 @@ vh_grabber_parse_int (file_data_t *fdata, int val,
   char v[32] = { 0 };
 
   snprintf (v, sizeof (v), "%d", val);
-  vh_metadata_add_auto (&fdata->meta_grabber, name, v, VALHALLA_LANG_UNDEF, pl);
+  vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena, name, v,
+                        VALHALLA_LANG_UNDEF, pl);
 }
 
 void
@@ -62,7 +63,8 @@ vh_grabber_parse_int64 (file_data_t *fdata, int64_t val,
   char v[32] = { 0 };
 
   snprintf (v, sizeof (v), "%"PRIi64, val);
-  vh_metadata_add_auto (&fdata->meta_grabber, name, v, VALHALLA_LANG_UNDEF, pl);
+  vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena, name, v,
+                        VALHALLA_LANG_UNDEF, pl);
 }
 
 void
@@ -72,7 +74,8 @@ vh_grabber_parse_float (file_data_t *fdata, float val,
   char v[32] = { 0 };
 
   snprintf (v, sizeof (v), "%.5f", val);
-  vh_metadata_add_auto (&fdata->meta_grabber, name, v, VALHALLA_LANG_UNDEF, pl);
+  vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena, name, v,
+                        VALHALLA_LANG_UNDEF, pl);
 }
 
 #ifdef USE_XML
@@ -89,7 +92,8 @@ vh_grabber_parse_str (file_data_t *fdata, xmlNode *nd, const char *tag,
   vh_xml_search_str (nd, tag, &res);
   if (res)
   {
-    vh_metadata_add_auto (&fdata->meta_grabber, name, res, lang, pl);
+    vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena, name, res, lang,
+                          pl);
     free (res);
     res = NULL;
   }
@@ -135,7 +139,8 @@ grabber_parse_list (file_data_t *fdata, xmlNode *node,
       continue;
     }
 
-      vh_metadata_add_auto (&fdata->meta_grabber, meta, (char *) tmp, lang, pl);
+      vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena, meta,
+                            (char *) tmp, lang, pl);
       xmlFree (tmp);
   }
 }
@@ -179,7 +184,7 @@ grabber_add_person (file_data_t *fdata,
     else
       snprintf (str, sizeof (str), "%s", name);
     free (name);
-    vh_metadata_add_auto (&fdata->meta_grabber,
+    vh_metadata_add_auto (&fdata->meta_grabber, fdata->arena,
                           cat, str, VALHALLA_LANG_UNDEF, pl);
   }
 
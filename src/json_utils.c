@@ -92,7 +92,7 @@ tokenize (const char *path)
   if (!token)
     goto out;
 
-  tokens = vh_list_new (0, (void *) item_free);
+  tokens = vh_list_new (0, (void *) item_free, NULL);
 
   while (token)
   {
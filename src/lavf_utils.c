@@ -20,77 +20,93 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <libavformat/avformat.h>
 
 #include "valhalla.h"
 #include "valhalla_internals.h"
+#include "utils.h"
+#include "osdep.h"
 #include "logs.h"
 #include "lavf_utils.h"
 
+/* Sorted by suffix (bsearch), the suffixes are lowercase. */
 static const struct fileext_s {
   const char *fmtname;
   const char *suffix;
 } g_fileext[] = {
-  { "ape",                     "apl"  },
-  { "ape",                     "mac"  },
-  { "daud",                    "302"  },
-  { "dv",                      "dif"  },
-  { "flic",                    "fli"  },
-  { "flic",                    "flc"  },
   { "h264",                    "264"  },
-  { "h264",                    "h26l" },
+  { "daud",                    "302"  },
+  { "mov,mp4,m4a,3gp,3g2,mj2", "3g2"  },
+  { "mov,mp4,m4a,3gp,3g2,mj2", "3gp"  },
+  { "oma",                     "aa3"  },
+  { "ape",                     "apl"  },
   { "image2",                  "bmp"  },
+  { "ingenient",               "cgi"  },
+  { "rawvideo",                "cif"  },
+  { "dv",                      "dif"  },
   { "image2",                  "dpx"  },
+  { "flic",                    "flc"  },
+  { "flic",                    "fli"  },
   { "image2",                  "gif"  },
+  { "h264",                    "h26l" },
   { "image2",                  "im1"  },
-  { "image2",                  "im8"  },
   { "image2",                  "im24" },
+  { "image2",                  "im8"  },
   { "image2",                  "jp2"  },
   { "image2",                  "jpeg" },
   { "image2",                  "jpg"  },
-  { "image2",                  "pcx"  },
+  { "mpeg1video",              "m1v"  },
+  { "mp3",                     "m2a"  },
+  { "mov,mp4,m4a,3gp,3g2,mj2", "m4a"  },
+  { "ape",                     "mac"  },
+  { "mov,mp4,m4a,3gp,3g2,mj2", "mj2"  },
+  { "mjpeg",                   "mjpg" },
+  { "matroska",                "mkv"  },
+  { "mov,mp4,m4a,3gp,3g2,mj2", "mov"  },
+  { "mp3",                     "mp2"  },
+  { "mov,mp4,m4a,3gp,3g2,mj2", "mp4"  },
+  { "mpeg1video",              "mpeg" },
+  { "mpeg1video",              "mpg"  },
   { "image2",                  "pbm"  },
+  { "image2",                  "pcx"  },
   { "image2",                  "pgm"  },
   { "image2",                  "png"  },
   { "image2",                  "pnm"  },
   { "image2",                  "ppm"  },
   { "image2",                  "ptx"  },
+  { "rawvideo",                "qcif" },
   { "image2",                  "ras"  },
+  { "rawvideo",                "rgb"  },
   { "image2",                  "rs"   },
   { "image2",                  "sgi"  },
+  { "siff",                    "son"  },
   { "image2",                  "sun"  },
   { "image2",                  "tga"  },
+  { "truehd",                  "thd"  },
   { "image2",                  "tif"  },
   { "image2",                  "tiff" },
-  { "ingenient",               "cgi"  },
-  { "matroska",                "mkv"  },
-  { "mjpeg",                   "mjpg" },
-  { "mov,mp4,m4a,3gp,3g2,mj2", "3g2"  },
-  { "mov,mp4,m4a,3gp,3g2,mj2", "3gp"  },
-  { "mov,mp4,m4a,3gp,3g2,mj2", "m4a"  },
-  { "mov,mp4,m4a,3gp,3g2,mj2", "mov"  },
-  { "mov,mp4,m4a,3gp,3g2,mj2", "mp4"  },
-  { "mov,mp4,m4a,3gp,3g2,mj2", "mj2"  },
-  { "mpeg1video",              "m1v"  },
-  { "mpeg1video",              "mpeg" },
-  { "mpeg1video",              "mpg"  },
-  { "mp3",                     "m2a"  },
-  { "mp3",                     "mp2"  },
   { "nc",                      "v"    },
-  { "oma",                     "aa3"  },
-  { "rawvideo",                "cif"  },
-  { "rawvideo",                "qcif" },
-  { "rawvideo",                "rgb"  },
-  { "rawvideo",                "yuv"  },
-  { "siff",                    "son"  },
   { "siff",                    "vb"   },
-  { "truehd",                  "thd"  },
   { "yuv4mpegpipe",            "y4m"  },
-  { NULL,                      NULL   },
+  { "rawvideo",                "yuv"  },
 };
 
+static int
+lavf_utils_fileext_cmp (const void *key, const void *elem)
+{
+  const struct fileext_s *ext = elem;
+  return strcasecmp (key, ext->suffix);
+}
+
 const char *
 vh_lavf_utils_fmtname_get (const char *suffix)
 {
@@ -99,11 +115,9 @@ vh_lavf_utils_fmtname_get (const char *suffix)
   if (!suffix)
     return NULL;
 
-  for (it = g_fileext; it->fmtname; it++)
-    if (!strcasecmp (suffix, it->suffix))
-      return it->fmtname;
-
-  return suffix;
+  it = bsearch (suffix, g_fileext, ARRAY_NB_ELEMENTS (g_fileext),
+                sizeof (*g_fileext), lavf_utils_fileext_cmp);
+  return it ? it->fmtname : suffix;
 }
 
 static const char *
@@ -123,6 +137,218 @@ suffix_fmt_guess (const char *file)
 
 #define PROBE_BUF_MIN 2048
 #define PROBE_BUF_MAX (1 << 20)
+#define IO_BUF_SIZE   32768
+
+/* Buffer for the probes, reused for all the files of a thread. */
+typedef struct lavf_utils_buf_s {
+  uint8_t *data;
+  size_t   size;
+} lavf_utils_buf_t;
+
+/*
+ * Opaque of the AVIOContext. The file is opened only one time, the bytes
+ * already read by the probe are given to the demuxer without a new read.
+ */
+typedef struct lavf_utils_io_s {
+  int               fd;
+  int64_t           pos;
+  int64_t           size;
+  lavf_utils_buf_t *buf;
+  int64_t           probe_size; /* bytes of the probe in buf->data */
+} lavf_utils_io_t;
+
+static pthread_key_t  g_buf_key;
+static pthread_once_t g_buf_once = PTHREAD_ONCE_INIT;
+
+
+static void
+lavf_utils_buf_free (void *data)
+{
+  lavf_utils_buf_t *buf = data;
+
+  if (!buf)
+    return;
+
+  free (buf->data);
+  free (buf);
+}
+
+static void
+lavf_utils_buf_key (void)
+{
+  pthread_key_create (&g_buf_key, lavf_utils_buf_free);
+}
+
+/*
+ * The buffer of the thread is taken while a file is open, then a second
+ * file opened by the same thread uses its own buffer.
+ */
+static lavf_utils_buf_t *
+lavf_utils_buf_take (void)
+{
+  lavf_utils_buf_t *buf;
+
+  pthread_once (&g_buf_once, lavf_utils_buf_key);
+
+  buf = pthread_getspecific (g_buf_key);
+  if (buf)
+  {
+    pthread_setspecific (g_buf_key, NULL);
+    return buf;
+  }
+
+  return calloc (1, sizeof (lavf_utils_buf_t));
+}
+
+static void
+lavf_utils_buf_give (lavf_utils_buf_t *buf)
+{
+  if (!buf)
+    return;
+
+  if (pthread_getspecific (g_buf_key)
+      || pthread_setspecific (g_buf_key, buf))
+    lavf_utils_buf_free (buf);
+}
+
+static int
+lavf_utils_buf_grow (lavf_utils_buf_t *buf, size_t size)
+{
+  uint8_t *data;
+
+  if (size <= buf->size)
+    return 0;
+
+  data = realloc (buf->data, size);
+  if (!data)
+    return -1;
+
+  buf->data = data;
+  buf->size = size;
+  return 0;
+}
+
+static int
+lavf_utils_io_read (void *opaque, uint8_t *buf, int size)
+{
+  ssize_t n;
+  lavf_utils_io_t *io = opaque;
+
+  if (io->pos < io->probe_size)
+  {
+    n = FFMIN (size, io->probe_size - io->pos);
+    memcpy (buf, io->buf->data + io->pos, n);
+  }
+  else
+  {
+    n = pread (io->fd, buf, size, io->pos);
+    if (n < 0)
+      return AVERROR (errno);
+  }
+
+  if (!n)
+    return AVERROR_EOF;
+
+  io->pos += n;
+  return n;
+}
+
+static int64_t
+lavf_utils_io_seek (void *opaque, int64_t offset, int whence)
+{
+  lavf_utils_io_t *io = opaque;
+
+  switch (whence & ~AVSEEK_FORCE)
+  {
+  case AVSEEK_SIZE:
+    return io->size;
+
+  case SEEK_SET:
+    break;
+
+  case SEEK_CUR:
+    offset += io->pos;
+    break;
+
+  case SEEK_END:
+    offset += io->size;
+    break;
+
+  default:
+    return AVERROR (EINVAL);
+  }
+
+  if (offset < 0)
+    return AVERROR (EINVAL);
+
+  io->pos = offset;
+  return offset;
+}
+
+static void
+lavf_utils_io_free (AVIOContext *pb)
+{
+  lavf_utils_io_t *io;
+
+  if (!pb)
+    return;
+
+  io = pb->opaque;
+  if (io)
+  {
+    close (io->fd);
+    lavf_utils_buf_give (io->buf);
+    free (io);
+  }
+
+  av_freep (&pb->buffer);
+  avio_context_free (&pb);
+}
+
+static AVIOContext *
+lavf_utils_io_new (const char *file)
+{
+  struct stat st;
+  uint8_t *data;
+  AVIOContext *pb;
+  lavf_utils_io_t *io;
+
+  io = calloc (1, sizeof (lavf_utils_io_t));
+  if (!io)
+    return NULL;
+
+  io->fd = open (file, O_RDONLY);
+  if (io->fd < 0)
+  {
+    free (io);
+    return NULL;
+  }
+
+  io->size = fstat (io->fd, &st) ? -1 : st.st_size;
+  io->buf  = lavf_utils_buf_take ();
+  if (!io->buf)
+    goto err;
+
+  data = av_malloc (IO_BUF_SIZE);
+  if (!data)
+    goto err;
+
+  pb = avio_alloc_context (data, IO_BUF_SIZE, 0, io,
+                           lavf_utils_io_read, NULL, lavf_utils_io_seek);
+  if (!pb)
+  {
+    av_free (data);
+    goto err;
+  }
+
+  return pb;
+
+ err:
+  close (io->fd);
+  lavf_utils_buf_give (io->buf);
+  free (io);
+  return NULL;
+}
 
 /*
  * This function is fully inspired of (libavformat/utils.c v52.28.0
@@ -134,13 +360,16 @@ suffix_fmt_guess (const char *file)
  * buffer. Here, the test is only for _one_ fmt and returns the score
  * (if > score_max) provided by fmt->probe().
  *
+ * Only the missing bytes are read for each size of the probe, and they are
+ * kept in the buffer of the thread for the demuxer.
+ *
  * WARNING: this function depends of some internal behaviours of libavformat
  *          and can be "broken" with future versions of FFmpeg.
  */
 static int
-lavf_utils_probe (AVInputFormat *fmt, const char *file)
+lavf_utils_probe (AVInputFormat *fmt, const char *file,
+                  lavf_utils_io_t *io, int p_max)
 {
-  FILE *fd;
   int rc = 0;
   int p_size;
   AVProbeData p_data;
@@ -154,33 +383,33 @@ lavf_utils_probe (AVInputFormat *fmt, const char *file)
 
   /* No file should be opened here. */
   if (fmt->flags & AVFMT_NOFILE)
-  {
-    rc = fmt->read_probe (&p_data);
-    goto out;
-  }
+    return fmt->read_probe (&p_data);
 
-  fd = fopen (file, "rb");
-  if (!fd)
+  if (!io)
     return 0;
 
-  for (p_size = PROBE_BUF_MIN; p_size <= PROBE_BUF_MAX; p_size <<= 1)
+  for (p_size = PROBE_BUF_MIN; p_size <= p_max; p_size <<= 1)
   {
     int score;
-    int score_max = p_size < PROBE_BUF_MAX ? AVPROBE_SCORE_MAX / 4 : 0;
+    int score_max = p_size <= p_max >> 1 ? AVPROBE_SCORE_MAX / 4 : 0;
+    ssize_t n;
 
-    p_data.buf = realloc (p_data.buf, p_size + AVPROBE_PADDING_SIZE);
-    if (!p_data.buf)
+    if (lavf_utils_buf_grow (io->buf, p_size + AVPROBE_PADDING_SIZE))
       break;
 
-    p_data.buf_size = fread (p_data.buf, 1, p_size, fd);
-    if (p_data.buf_size != p_size) /* EOF is reached? */
+    n = pread (io->fd, io->buf->data + io->probe_size,
+               p_size - io->probe_size, io->probe_size);
+    if (n < 0)
       break;
 
-    memset (p_data.buf + p_data.buf_size, 0, AVPROBE_PADDING_SIZE);
-
-    if (fseek (fd, 0, SEEK_SET))
+    io->probe_size += n;
+    if (io->probe_size != p_size) /* EOF is reached? */
       break;
 
+    p_data.buf      = io->buf->data;
+    p_data.buf_size = p_size;
+    memset (p_data.buf + p_size, 0, AVPROBE_PADDING_SIZE);
+
     score = fmt->read_probe (&p_data);
     if (score > score_max)
     {
@@ -189,21 +418,18 @@ lavf_utils_probe (AVInputFormat *fmt, const char *file)
     }
   }
 
-  fclose (fd);
-
- out:
-  if (p_data.buf)
-    free (p_data.buf);
   return rc;
 }
 
 AVFormatContext *
-vh_lavf_utils_open_input_file (const char *file)
+vh_lavf_utils_open_input_file (const char *file, const lavf_utils_cfg_t *cfg)
 {
   int res;
+  int p_max = PROBE_BUF_MAX;
   const char *name;
   AVFormatContext   *ctx;
   AVInputFormat     *fmt = NULL;
+  AVIOContext       *pb  = NULL;
 
   ctx = avformat_alloc_context ();
   if (!ctx)
@@ -211,6 +437,16 @@ vh_lavf_utils_open_input_file (const char *file)
 
   ctx->flags |= AVFMT_FLAG_IGNIDX;
 
+  if (cfg && cfg->probesize)
+  {
+    ctx->probesize        = cfg->probesize;
+    ctx->format_probesize = cfg->probesize;
+    p_max = FFMAX (PROBE_BUF_MIN, FFMIN (PROBE_BUF_MAX, cfg->probesize));
+  }
+
+  if (cfg && cfg->analyzeduration)
+    ctx->max_analyze_duration = cfg->analyzeduration;
+
   /*
    * Try a format in function of the suffix.
    * We gain a lot of speed if the fmt is already the right.
@@ -219,22 +455,105 @@ vh_lavf_utils_open_input_file (const char *file)
   if (name)
     fmt = av_find_input_format (name);
 
+  /* The file is read with pread() on only one descriptor. */
+  if (!fmt || !(fmt->flags & AVFMT_NOFILE))
+  {
+    pb = lavf_utils_io_new (file);
+    if (!pb)
+    {
+      vh_log (VALHALLA_MSG_WARNING, "can't open file : %s", file);
+      avformat_free_context (ctx);
+      return NULL;
+    }
+
+    ctx->pb     = pb;
+    ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+  }
+
   if (fmt)
   {
-    int score = lavf_utils_probe (fmt, file);
+    int score = lavf_utils_probe (fmt, file, pb ? pb->opaque : NULL, p_max);
     vh_log (VALHALLA_MSG_VERBOSE,
             "Probe score (%i) [%s] : %s", score, name, file);
     if (!score) /* Bad score? */
       fmt = NULL;
   }
 
+  /* The context is freed on error, but not the custom I/O. */
   res = avformat_open_input (&ctx, file, fmt, NULL);
   if (res)
   {
     vh_log (VALHALLA_MSG_WARNING,
             "FFmpeg can't open file (%i) : %s", res, file);
+    lavf_utils_io_free (pb);
     return NULL;
   }
 
   return ctx;
 }
+
+void
+vh_lavf_utils_close_input_file (AVFormatContext **ctx)
+{
+  AVIOContext *pb;
+
+  if (!ctx || !*ctx)
+    return;
+
+  pb = (*ctx)->flags & AVFMT_FLAG_CUSTOM_IO ? (*ctx)->pb : NULL;
+  avformat_close_input (ctx);
+  lavf_utils_io_free (pb);
+}
+
+lavf_utils_props_t *
+vh_lavf_utils_props_get (AVFormatContext *ctx)
+{
+  unsigned int i;
+  lavf_utils_props_t *props;
+
+  if (!ctx)
+    return NULL;
+
+  if (avformat_find_stream_info (ctx, NULL) < 0)
+  {
+    props = calloc (1, sizeof (lavf_utils_props_t));
+    if (props)
+      props->error = 1;
+    return props;
+  }
+
+  props = calloc (1, sizeof (lavf_utils_props_t)
+                     + ctx->nb_streams * sizeof (lavf_utils_stream_t));
+  if (!props)
+    return NULL;
+
+  props->duration   = ctx->duration;
+  props->nb_streams = ctx->nb_streams;
+
+  for (i = 0; i < ctx->nb_streams; i++)
+  {
+    const AVStream *st = ctx->streams[i];
+    const AVCodecParameters *codec = st->codecpar;
+    lavf_utils_stream_t *it = &props->streams[i];
+
+    it->type     = codec->codec_type;
+    it->codec_id = codec->codec_id;
+    it->bit_rate = codec->bit_rate;
+    it->channels = codec->channels;
+    it->width    = codec->width;
+    it->height   = codec->height;
+
+    if (st->sample_aspect_ratio.num)
+    {
+      it->sar_num = st->sample_aspect_ratio.num;
+      it->sar_den = st->sample_aspect_ratio.den;
+    }
+    else
+    {
+      it->sar_num = codec->sample_aspect_ratio.num;
+      it->sar_den = codec->sample_aspect_ratio.den;
+    }
+  }
+
+  return props;
+}
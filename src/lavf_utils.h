@@ -22,7 +22,35 @@
 #ifndef VALHALLA_LAVF_UTILS
 #define VALHALLA_LAVF_UTILS
 
+typedef struct lavf_utils_cfg_s {
+  int64_t probesize;       /* bytes, 0 for the FFmpeg default        */
+  int64_t analyzeduration; /* microseconds, 0 for the FFmpeg default */
+} lavf_utils_cfg_t;
+
+/* Properties of a stream, the types are the enums of FFmpeg. */
+typedef struct lavf_utils_stream_s {
+  int     type;     /* enum AVMediaType */
+  int     codec_id; /* enum AVCodecID */
+  int64_t bit_rate;
+  int     channels;
+  int     width;
+  int     height;
+  int     sar_num;  /* aspect ratio of the stream, else of the codec */
+  int     sar_den;
+} lavf_utils_stream_t;
+
+/* Result of avformat_find_stream_info(), without the context. */
+typedef struct lavf_utils_props_s {
+  int                 error;    /* the streams can't be found */
+  int64_t             duration; /* AV_TIME_BASE */
+  unsigned int        nb_streams;
+  lavf_utils_stream_t streams[];
+} lavf_utils_props_t;
+
 const char *vh_lavf_utils_fmtname_get (const char *suffix);
-AVFormatContext *vh_lavf_utils_open_input_file (const char *file);
+AVFormatContext *vh_lavf_utils_open_input_file (const char *file,
+                                                const lavf_utils_cfg_t *cfg);
+void vh_lavf_utils_close_input_file (AVFormatContext **ctx);
+lavf_utils_props_t *vh_lavf_utils_props_get (AVFormatContext *ctx);
 
 #endif /* VALHALLA_LAVF_UTILS */
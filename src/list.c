@@ -35,13 +35,14 @@ struct list_s {
   void (*free_fct) (void *data);
   unsigned int depth; /* 0: infinite */
   unsigned int cnt;
+  arena_t *arena;     /* the items are released with the arena */
 };
 
 
 static inline void
 list_item_free (list_t *list, list_item_t *item)
 {
-  if (!list || !item)
+  if (!list || !item || list->arena)
     return;
 
   if (item->data)
@@ -63,20 +64,15 @@ vh_list_append (list_t *list, const void *data, size_t len)
   if (!list || !data)
     return;
 
-  if (!list->item)
-  {
-    list->item = calloc (1, sizeof (list_item_t));
-    item = list->item;
-  }
-  else
-  {
-    list->item_last->next = calloc (1, sizeof (list_item_t));
-    item = list->item_last->next;
-  }
-
+  item = vh_arena_alloc (list->arena, sizeof (list_item_t));
   if (!item)
     return;
 
+  if (!list->item)
+    list->item = item;
+  else
+    list->item_last->next = item;
+
   /* Remove the older item to preserve the depth. */
   if (list->depth && list->cnt >= list->depth)
   {
@@ -89,22 +85,28 @@ vh_list_append (list_t *list, const void *data, size_t len)
 
   list->item_last = item;
 
-  item->data = calloc (1, len);
+  item->data = vh_arena_alloc (list->arena, len);
   if (item->data)
     memcpy (item->data, data, len);
 }
 
+/*
+ * With an arena, the items removed (depth) or emptied are released only
+ * with the arena and free_fct is not used.
+ */
 list_t *
-vh_list_new (unsigned int depth, void (*free_fct) (void *data))
+vh_list_new (unsigned int depth,
+             void (*free_fct) (void *data), arena_t *arena)
 {
   list_t *list;
 
-  list = calloc (1, sizeof (list_t));
+  list = vh_arena_alloc (arena, sizeof (list_t));
   if (!list)
     return NULL;
 
   list->free_fct = free_fct;
   list->depth    = depth;
+  list->arena    = arena;
   return list;
 }
 
@@ -136,7 +138,8 @@ vh_list_free (list_t *list)
     return;
 
   vh_list_empty (list);
-  free (list);
+  if (!list->arena)
+    free (list);
 }
 
 void *
@@ -22,11 +22,14 @@
 #ifndef VALHALLA_LIST_H
 #define VALHALLA_LIST_H
 
+#include "arena.h"
+
 typedef struct list_s list_t;
 
 
 void vh_list_append (list_t *list, const void *data, size_t len);
-list_t *vh_list_new (unsigned int depth, void (*free_fct) (void *data));
+list_t *vh_list_new (unsigned int depth,
+                     void (*free_fct) (void *data), arena_t *arena);
 void vh_list_free (list_t *list);
 void vh_list_empty (list_t *list);
 void *vh_list_foreach (const list_t *list, void *data,
@@ -21,6 +21,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "valhalla.h"
 #include "valhalla_internals.h"
@@ -29,88 +30,69 @@
 #include "logs.h"
 
 
-static const struct {
+/* Sorted by name (bsearch), the names are lowercase. */
+static const struct metadata_group_s {
   const char *meta;
   valhalla_meta_grp_t grp;
 } metadata_group_mapping[] = {
-
-  /* Classification */
-  { VALHALLA_METADATA_CATEGORY,            VALHALLA_META_GRP_CLASSIFICATION },
-  { VALHALLA_METADATA_EPISODE,             VALHALLA_META_GRP_CLASSIFICATION },
-  { VALHALLA_METADATA_GENRE,               VALHALLA_META_GRP_CLASSIFICATION },
-  { VALHALLA_METADATA_MPAA,                VALHALLA_META_GRP_CLASSIFICATION },
-  { VALHALLA_METADATA_RUNTIME,             VALHALLA_META_GRP_CLASSIFICATION },
-  { VALHALLA_METADATA_SEASON,              VALHALLA_META_GRP_CLASSIFICATION },
-  { VALHALLA_METADATA_SYNOPSIS,            VALHALLA_META_GRP_CLASSIFICATION },
-  { VALHALLA_METADATA_SYNOPSIS_SHOW,       VALHALLA_META_GRP_CLASSIFICATION },
-
-  /* Commercial */
-  { VALHALLA_METADATA_BUDGET,              VALHALLA_META_GRP_COMMERCIAL     },
-  { VALHALLA_METADATA_COUNTRY,             VALHALLA_META_GRP_COMMERCIAL     },
-  { VALHALLA_METADATA_REVENUE,             VALHALLA_META_GRP_COMMERCIAL     },
-  { VALHALLA_METADATA_STUDIO,              VALHALLA_META_GRP_COMMERCIAL     },
-
-  /* Entities */
   { VALHALLA_METADATA_ACTOR,               VALHALLA_META_GRP_ENTITIES       },
+  { VALHALLA_METADATA_ALBUM,               VALHALLA_META_GRP_TITLES         },
   { VALHALLA_METADATA_ARTIST,              VALHALLA_META_GRP_ENTITIES       },
+  { VALHALLA_METADATA_AUDIO_BITRATE,       VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_AUDIO_CHANNELS,      VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_AUDIO_CODEC,         VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_AUDIO_LANG,          VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_AUDIO_STREAMS,       VALHALLA_META_GRP_TECHNICAL      },
   { VALHALLA_METADATA_AUTHOR,              VALHALLA_META_GRP_ENTITIES       },
+  { VALHALLA_METADATA_BUDGET,              VALHALLA_META_GRP_COMMERCIAL     },
   { VALHALLA_METADATA_CASTING,             VALHALLA_META_GRP_ENTITIES       },
+  { VALHALLA_METADATA_CATEGORY,            VALHALLA_META_GRP_CLASSIFICATION },
   { VALHALLA_METADATA_COMPOSER,            VALHALLA_META_GRP_ENTITIES       },
-  { VALHALLA_METADATA_CREDITS,             VALHALLA_META_GRP_ENTITIES       },
-  { VALHALLA_METADATA_DIRECTOR,            VALHALLA_META_GRP_ENTITIES       },
-  { VALHALLA_METADATA_DIRECTOR_PHOTO,      VALHALLA_META_GRP_ENTITIES       },
-  { VALHALLA_METADATA_EDITOR,              VALHALLA_META_GRP_ENTITIES       },
-  { VALHALLA_METADATA_PRODUCER,            VALHALLA_META_GRP_ENTITIES       },
-  { VALHALLA_METADATA_WRITER,              VALHALLA_META_GRP_ENTITIES       },
-
-  /* Miscellaneous */
+  { VALHALLA_METADATA_COUNTRY,             VALHALLA_META_GRP_COMMERCIAL     },
   { VALHALLA_METADATA_COVER,               VALHALLA_META_GRP_MISCELLANEOUS  },
   { VALHALLA_METADATA_COVER_SEASON,        VALHALLA_META_GRP_MISCELLANEOUS  },
   { VALHALLA_METADATA_COVER_SHOW,          VALHALLA_META_GRP_MISCELLANEOUS  },
   { VALHALLA_METADATA_COVER_SHOW_HEADER,   VALHALLA_META_GRP_MISCELLANEOUS  },
-  { VALHALLA_METADATA_FAN_ART,             VALHALLA_META_GRP_MISCELLANEOUS  },
-  { VALHALLA_METADATA_LYRICS,              VALHALLA_META_GRP_MISCELLANEOUS  },
-  { VALHALLA_METADATA_THUMBNAIL,           VALHALLA_META_GRP_MISCELLANEOUS  },
-
-  /* Organizational */
-  { VALHALLA_METADATA_TRACK,               VALHALLA_META_GRP_ORGANIZATIONAL },
-
-  /* Personal */
-  { VALHALLA_METADATA_PLAY_COUNT,          VALHALLA_META_GRP_PERSONAL       },
-  { VALHALLA_METADATA_RATING,              VALHALLA_META_GRP_PERSONAL       },
-  { VALHALLA_METADATA_WATCHED,             VALHALLA_META_GRP_PERSONAL       },
-
-  /* Technical */
-  { VALHALLA_METADATA_AUDIO_BITRATE,       VALHALLA_META_GRP_TECHNICAL      },
-  { VALHALLA_METADATA_AUDIO_CHANNELS,      VALHALLA_META_GRP_TECHNICAL      },
-  { VALHALLA_METADATA_AUDIO_CODEC,         VALHALLA_META_GRP_TECHNICAL      },
-  { VALHALLA_METADATA_AUDIO_LANG,          VALHALLA_META_GRP_TECHNICAL      },
-  { VALHALLA_METADATA_AUDIO_STREAMS,       VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_CREDITS,             VALHALLA_META_GRP_ENTITIES       },
+  { VALHALLA_METADATA_DATE,                VALHALLA_META_GRP_TEMPORAL       },
+  { VALHALLA_METADATA_DIRECTOR,            VALHALLA_META_GRP_ENTITIES       },
+  { VALHALLA_METADATA_DIRECTOR_PHOTO,      VALHALLA_META_GRP_ENTITIES       },
   { VALHALLA_METADATA_DURATION,            VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_EDITOR,              VALHALLA_META_GRP_ENTITIES       },
+  { VALHALLA_METADATA_EPISODE,             VALHALLA_META_GRP_CLASSIFICATION },
+  { VALHALLA_METADATA_FAN_ART,             VALHALLA_META_GRP_MISCELLANEOUS  },
   { VALHALLA_METADATA_FILESIZE,            VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_GENRE,               VALHALLA_META_GRP_CLASSIFICATION },
   { VALHALLA_METADATA_HEIGHT,              VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_LYRICS,              VALHALLA_META_GRP_MISCELLANEOUS  },
+  { VALHALLA_METADATA_MPAA,                VALHALLA_META_GRP_CLASSIFICATION },
   { VALHALLA_METADATA_PICTURE_ORIENTATION, VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_PLAY_COUNT,          VALHALLA_META_GRP_PERSONAL       },
+  { VALHALLA_METADATA_PREMIERED,           VALHALLA_META_GRP_TEMPORAL       },
+  { VALHALLA_METADATA_PRODUCER,            VALHALLA_META_GRP_ENTITIES       },
+  { VALHALLA_METADATA_RATING,              VALHALLA_META_GRP_PERSONAL       },
+  { VALHALLA_METADATA_REVENUE,             VALHALLA_META_GRP_COMMERCIAL     },
+  { VALHALLA_METADATA_RUNTIME,             VALHALLA_META_GRP_CLASSIFICATION },
+  { VALHALLA_METADATA_SEASON,              VALHALLA_META_GRP_CLASSIFICATION },
+  { VALHALLA_METADATA_STUDIO,              VALHALLA_META_GRP_COMMERCIAL     },
   { VALHALLA_METADATA_SUB_LANG,            VALHALLA_META_GRP_TECHNICAL      },
   { VALHALLA_METADATA_SUB_STREAMS,         VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_SYNOPSIS,            VALHALLA_META_GRP_CLASSIFICATION },
+  { VALHALLA_METADATA_SYNOPSIS_SHOW,       VALHALLA_META_GRP_CLASSIFICATION },
+  { VALHALLA_METADATA_THUMBNAIL,           VALHALLA_META_GRP_MISCELLANEOUS  },
+  { VALHALLA_METADATA_TITLE,               VALHALLA_META_GRP_TITLES         },
+  { VALHALLA_METADATA_TITLE_ALTERNATIVE,   VALHALLA_META_GRP_TITLES         },
+  { VALHALLA_METADATA_TITLE_SHOW,          VALHALLA_META_GRP_TITLES         },
+  { VALHALLA_METADATA_TITLE_STREAM,        VALHALLA_META_GRP_TITLES         },
+  { VALHALLA_METADATA_TRACK,               VALHALLA_META_GRP_ORGANIZATIONAL },
   { VALHALLA_METADATA_VIDEO_ASPECT,        VALHALLA_META_GRP_TECHNICAL      },
   { VALHALLA_METADATA_VIDEO_BITRATE,       VALHALLA_META_GRP_TECHNICAL      },
   { VALHALLA_METADATA_VIDEO_CODEC,         VALHALLA_META_GRP_TECHNICAL      },
   { VALHALLA_METADATA_VIDEO_STREAMS,       VALHALLA_META_GRP_TECHNICAL      },
+  { VALHALLA_METADATA_WATCHED,             VALHALLA_META_GRP_PERSONAL       },
   { VALHALLA_METADATA_WIDTH,               VALHALLA_META_GRP_TECHNICAL      },
-
-  /* Temporal */
-  { VALHALLA_METADATA_DATE,                VALHALLA_META_GRP_TEMPORAL       },
-  { VALHALLA_METADATA_PREMIERED,           VALHALLA_META_GRP_TEMPORAL       },
+  { VALHALLA_METADATA_WRITER,              VALHALLA_META_GRP_ENTITIES       },
   { VALHALLA_METADATA_YEAR,                VALHALLA_META_GRP_TEMPORAL       },
-
-  /* Titles */
-  { VALHALLA_METADATA_ALBUM,               VALHALLA_META_GRP_TITLES         },
-  { VALHALLA_METADATA_TITLE,               VALHALLA_META_GRP_TITLES         },
-  { VALHALLA_METADATA_TITLE_ALTERNATIVE,   VALHALLA_META_GRP_TITLES         },
-  { VALHALLA_METADATA_TITLE_SHOW,          VALHALLA_META_GRP_TITLES         },
-  { VALHALLA_METADATA_TITLE_STREAM,        VALHALLA_META_GRP_TITLES         },
-
-  { NULL,                                  VALHALLA_META_GRP_NIL            },
 };
 
 static const char *const metadata_group_str[] = {
@@ -149,6 +131,22 @@ static const struct {
 const size_t vh_metadata_lang_size =
   ARRAY_NB_ELEMENTS (metadata_lang_str);
 
+#define METADATA_ATOM_BUCKETS 512
+
+/*
+ * Interned names for all the handles of the process. The atoms are never
+ * released, the buckets are read without lock and a new atom is published
+ * at the head of its bucket when it is complete.
+ */
+typedef struct metadata_atom_entry_s {
+  metadata_atom_t atom;
+  struct metadata_atom_entry_s *next;
+} metadata_atom_entry_t;
+
+static metadata_atom_entry_t *g_atom_bucket[METADATA_ATOM_BUCKETS];
+static unsigned int g_atom_nb;
+static pthread_mutex_t g_atom_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 const char *
 vh_metadata_group_str (valhalla_meta_grp_t group)
@@ -172,20 +170,107 @@ vh_metadata_lang_str (valhalla_lang_t lang,
     *llong = metadata_lang_str[lang].llong;
 }
 
+static unsigned int
+metadata_atom_hash (const char *name)
+{
+  unsigned int hash = 2166136261U; /* FNV-1a */
+
+  for (; *name; name++)
+  {
+    hash ^= (unsigned char) VH_TOLOWER (*name);
+    hash *= 16777619U;
+  }
+
+  return hash % METADATA_ATOM_BUCKETS;
+}
+
+/* The hash ignores the case, then all the cases of a name are in a bucket. */
+static const metadata_atom_t *
+metadata_atom_find (const char *name, unsigned int hash, int nocase)
+{
+  const metadata_atom_entry_t *it;
+
+  it = __atomic_load_n (&g_atom_bucket[hash], __ATOMIC_ACQUIRE);
+  for (; it; it = it->next)
+    if (nocase ? !strcasecmp (name, it->atom.name)
+               : !strcmp (name, it->atom.name))
+      return &it->atom;
+
+  return NULL;
+}
+
+/*
+ * The atom is the same for all the cases of a name, the interned name is
+ * in lowercase. The pointers can be compared instead of the names.
+ */
+const metadata_atom_t *
+vh_metadata_atom_get (const char *name)
+{
+  unsigned int hash;
+  size_t len;
+  const metadata_atom_t *atom;
+  metadata_atom_entry_t *entry;
+
+  if (!name)
+    return NULL;
+
+  hash = metadata_atom_hash (name);
+  atom = metadata_atom_find (name, hash, 1);
+  if (atom)
+    return atom;
+
+  pthread_mutex_lock (&g_atom_mutex);
+
+  /* maybe added by an other thread */
+  atom = metadata_atom_find (name, hash, 1);
+  if (atom)
+    goto out;
+
+  len   = strlen (name) + 1;
+  entry = malloc (sizeof (metadata_atom_entry_t) + len);
+  if (!entry)
+    goto out;
+
+  memcpy (entry + 1, name, len);
+  vh_strtolower ((char *) (entry + 1));
+  entry->atom.name  = (const char *) (entry + 1);
+  entry->atom.id    = ++g_atom_nb;
+  entry->atom.group = vh_metadata_group_get (entry->atom.name);
+  entry->next       = g_atom_bucket[hash];
+  __atomic_store_n (&g_atom_bucket[hash], entry, __ATOMIC_RELEASE);
+  atom = &entry->atom;
+
+ out:
+  pthread_mutex_unlock (&g_atom_mutex);
+  return atom;
+}
+
 int
 vh_metadata_get (const metadata_t *meta,
                  const char *name, int flags, const metadata_t **tag)
 {
+  const metadata_atom_t *atom = NULL;
+
   if (!meta || !tag || !name)
     return -1;
 
+  /*
+   * The name must be the same as the lowercase name of the atom. A name
+   * without atom is in no list.
+   */
+  if (!(flags & METADATA_IGNORE_SUFFIX))
+  {
+    atom = metadata_atom_find (name, metadata_atom_hash (name), 0);
+    if (!atom)
+      return -1;
+  }
+
   if (*tag)
     meta = (*tag)->next;
 
   for (; meta; meta = meta->next)
-    if (flags & METADATA_IGNORE_SUFFIX
-        ? !strncmp (name, meta->name, strlen (name))
-        : !strcmp (name, meta->name))
+    if (atom ? meta->atom == atom
+             : !strncmp (name, meta->name, strlen (name)))
       break;
 
   if (!meta)
@@ -195,35 +280,51 @@ vh_metadata_get (const metadata_t *meta,
   return 0;
 }
 
+static metadata_t *
+metadata_new (arena_t *arena, const metadata_atom_t *atom, const char *value)
+{
+  metadata_t *it;
+  const size_t len = strlen (value) + 1;
+
+  it = vh_arena_alloc (arena, sizeof (metadata_t) + len);
+  if (!it)
+    return NULL;
+
+  it->atom  = atom;
+  it->name  = atom->name;
+  it->value = (char *) (it + 1);
+  memcpy (it->value, value, len);
+  return it;
+}
+
+static void
+metadata_append (metadata_t **meta, metadata_t *it)
+{
+  if (!*meta)
+    *meta = it;
+  else
+    (*meta)->last->next = it;
+  (*meta)->last = it;
+}
+
 void
 vh_metadata_dup (metadata_t **dst, const metadata_t *src)
 {
-  metadata_t *st = NULL, *tmp = NULL;
+  metadata_t *st = NULL, *tmp;
 
   if (!dst || !src)
     return;
 
   for (; src; src = src->next)
   {
-    if (tmp)
-    {
-      tmp->next = calloc (1, sizeof (metadata_t));
-      tmp = tmp->next;
-    }
-    else
-      tmp = calloc (1, sizeof (metadata_t));
-
+    tmp = metadata_new (NULL, src->atom, src->value);
     if (!tmp)
       goto err;
 
-    tmp->name     = strdup (src->name);
-    tmp->value    = strdup (src->value);
     tmp->lang     = src->lang;
     tmp->group    = src->group;
     tmp->priority = src->priority;
-
-    if (!st)
-      st = tmp;
+    metadata_append (&st, tmp);
   }
 
   *dst = st;
@@ -234,6 +335,7 @@ vh_metadata_dup (metadata_t **dst, const metadata_t *src)
   *dst = NULL;
 }
 
+/* Only for the lists which are not in an arena. */
 void
 vh_metadata_free (metadata_t *meta)
 {
@@ -241,52 +343,60 @@ vh_metadata_free (metadata_t *meta)
 
   while (meta)
   {
-    free (meta->name);
-    free (meta->value);
     tmp = meta->next;
     free (meta);
     meta = tmp;
   }
 }
 
-void
-vh_metadata_add (metadata_t **meta,
-                 const char *name, const char *value, valhalla_lang_t lang,
-                 valhalla_meta_grp_t group, valhalla_metadata_pl_t priority)
+static void
+metadata_add (metadata_t **meta, arena_t *arena,
+              const metadata_atom_t *atom, const char *value,
+              valhalla_lang_t lang,
+              valhalla_meta_grp_t group, valhalla_metadata_pl_t priority)
 {
   metadata_t *it;
 
-  if (!meta || !name || !value || !*value)
-    return;
-
-  if (!*meta)
-  {
-    *meta = calloc (1, sizeof (metadata_t));
-    it = *meta;
-  }
-  else
-  {
-    for (it = *meta; it->next; it = it->next)
-      ;
-    it->next = calloc (1, sizeof (metadata_t));
-    it = it->next;
-  }
-
+  it = metadata_new (arena, atom, value);
   if (!it)
     return;
 
-  it->name  = strdup (name);
-  vh_strtolower (it->name);
-
-  it->value    = strdup (value);
   it->lang     = lang;
   it->group    = group;
   it->priority = priority;
+  metadata_append (meta, it);
 
   vh_log (VALHALLA_MSG_VERBOSE,
           "Adding new metadata '%s' with value '%s'.", it->name, it->value);
 }
 
+/*
+ * Without arena (NULL), the list must be released by vh_metadata_free(),
+ * else the list is released with the arena. All the items of a list must
+ * use the same arena.
+ */
+void
+vh_metadata_add (metadata_t **meta, arena_t *arena,
+                 const char *name, const char *value, valhalla_lang_t lang,
+                 valhalla_meta_grp_t group, valhalla_metadata_pl_t priority)
+{
+  const metadata_atom_t *atom;
+
+  if (!meta || !name || !value || !*value)
+    return;
+
+  atom = vh_metadata_atom_get (name);
+  if (atom)
+    metadata_add (meta, arena, atom, value, lang, group, priority);
+}
+
+static int
+metadata_group_cmp (const void *key, const void *elem)
+{
+  const struct metadata_group_s *grp = elem;
+  return strcasecmp (key, grp->meta);
+}
+
 static inline valhalla_metadata_pl_t
 metadata_priority_get (const char *name, const metadata_plist_t *pl)
 {
@@ -296,30 +406,39 @@ metadata_priority_get (const char *name, const metadata_plist_t *pl)
   return pl->priority;
 }
 
+valhalla_meta_grp_t
+vh_metadata_group_get (const char *name)
+{
+  const struct metadata_group_s *it;
+
+  if (!name)
+    return VALHALLA_META_GRP_MISCELLANEOUS;
+
+  it = bsearch (name, metadata_group_mapping,
+                ARRAY_NB_ELEMENTS (metadata_group_mapping),
+                sizeof (*metadata_group_mapping), metadata_group_cmp);
+  return it ? it->grp : VALHALLA_META_GRP_MISCELLANEOUS;
+}
+
 void
-vh_metadata_add_auto (metadata_t **meta,
+vh_metadata_add_auto (metadata_t **meta, arena_t *arena,
                       const char *name, const char *value,
                       valhalla_lang_t lang, const metadata_plist_t *pl)
 {
-  unsigned int i;
-  valhalla_meta_grp_t grp;
+  const metadata_atom_t *atom;
   valhalla_metadata_pl_t priority;
 
   if (!meta || !name || !value || !*value)
     return;
 
-  grp = VALHALLA_META_GRP_MISCELLANEOUS;
-  for (i = 0; metadata_group_mapping[i].meta; i++)
-    if (!strcasecmp (name, metadata_group_mapping[i].meta))
-    {
-      grp = metadata_group_mapping[i].grp;
-      break;
-    }
+  atom = vh_metadata_atom_get (name);
+  if (!atom)
+    return;
 
   priority =
-    pl ? metadata_priority_get (name, pl) : VALHALLA_METADATA_PL_NORMAL;
+    pl ? metadata_priority_get (atom->name, pl) : VALHALLA_METADATA_PL_NORMAL;
 
-  vh_metadata_add (meta, name, value, lang, grp, priority);
+  metadata_add (meta, arena, atom, value, lang, atom->group, priority);
 }
 
 void
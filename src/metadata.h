@@ -23,10 +23,25 @@
 #define VALHALLA_METADATA
 
 #include "valhalla.h"
+#include "arena.h"
 
+/* Interned name of a metadata, see vh_metadata_atom_get(). */
+typedef struct metadata_atom_s {
+  const char         *name;  /* lowercase */
+  unsigned int        id;    /* from 1, index for the caches of the ids */
+  valhalla_meta_grp_t group; /* vh_metadata_group_get() */
+} metadata_atom_t;
+
+/*
+ * The value is in the same block as the item and the name is the one of
+ * the atom. A list is allocated with malloc() or in an arena (see
+ * vh_metadata_add()).
+ */
 typedef struct metadata_s {
   struct metadata_s *next;
-  char *name;
+  struct metadata_s *last; /* only for the first item, for the appends */
+  const metadata_atom_t *atom;
+  const char *name;
   char *value;
   valhalla_lang_t lang;
   valhalla_meta_grp_t group;
@@ -46,16 +61,18 @@ extern const size_t vh_metadata_lang_size;
 const char *vh_metadata_group_str (valhalla_meta_grp_t group);
 void vh_metadata_lang_str (valhalla_lang_t lang,
                            const char **lshort, const char **llong);
+const metadata_atom_t *vh_metadata_atom_get (const char *name);
 int vh_metadata_get (const metadata_t *meta,
                      const char *name, int flags, const metadata_t **tag);
 void vh_metadata_free (metadata_t *meta);
-void vh_metadata_add (metadata_t **meta, const char *name,
+void vh_metadata_add (metadata_t **meta, arena_t *arena, const char *name,
                       const char *value, valhalla_lang_t lang,
                       valhalla_meta_grp_t group,
                       valhalla_metadata_pl_t priority);
-void vh_metadata_add_auto (metadata_t **meta, const char *name,
-                           const char *value, valhalla_lang_t lang,
-                           const metadata_plist_t *pl);
+valhalla_meta_grp_t vh_metadata_group_get (const char *name);
+void vh_metadata_add_auto (metadata_t **meta, arena_t *arena,
+                           const char *name, const char *value,
+                           valhalla_lang_t lang, const metadata_plist_t *pl);
 void vh_metadata_dup (metadata_t **dst, const metadata_t *src);
 void vh_metadata_plist_dump (const metadata_plist_t *pl);
 valhalla_metadata_pl_t vh_metadata_plist_read (metadata_plist_t *pl,
@@ -40,6 +40,11 @@
 #undef WIN32_LEAN_AND_MEAN
 #endif /* OSDEP_CLOCK_GETTIME_WINDOWS */
 
+#ifdef OSDEP_PREAD
+#include <sys/types.h>
+#include <unistd.h>
+#endif /* OSDEP_PREAD */
+
 #include "utils.h"
 #include "osdep.h"
 
@@ -245,6 +250,18 @@ vh_lstat (const char *path, struct stat *buf)
 }
 #endif /* OSDEP_LSTAT */
 
+#ifdef OSDEP_PREAD
+/* The offset of the descriptor is changed, it must not be shared. */
+ssize_t
+vh_pread (int fd, void *buf, size_t count, off_t offset)
+{
+  if (lseek (fd, offset, SEEK_SET) != offset)
+    return -1;
+
+  return read (fd, buf, count);
+}
+#endif /* OSDEP_PREAD */
+
 int
 vh_osdep_init (void)
 {
@@ -66,6 +66,11 @@ int vh_lstat (const char *path, struct stat *buf);
 #undef  lstat
 #define lstat vh_lstat
 #endif /* OSDEP_LSTAT */
+#ifdef OSDEP_PREAD
+ssize_t vh_pread (int fd, void *buf, size_t count, off_t offset);
+#undef  pread
+#define pread vh_pread
+#endif /* OSDEP_PREAD */
 
 int vh_osdep_init (void);
 
@@ -21,8 +21,11 @@
 
 #define _GNU_SOURCE
 #include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include <libavformat/avformat.h>
 
@@ -33,6 +36,7 @@
 #include "fifo_queue.h"
 #include "logs.h"
 #include "lavf_utils.h"
+#include "tag_reader.h"
 #include "metadata.h"
 #include "thread_utils.h"
 #include "dbmanager.h"
@@ -58,8 +62,13 @@ struct parser_s {
   unsigned int  nb;
   int           priority;
 
-  int    decrapifier;
-  char **bl_list;
+  int                 decrapifier;
+  char              **bl_list;
+  struct parser_bl_s *bl; /* bl_list compiled by vh_parser_run() */
+
+  lavf_utils_cfg_t lavf;
+  int              streaminfo;
+  int              tagreader;
 
   int             wait;
   int             run;
@@ -84,57 +93,266 @@ parser_is_stopped (parser_t *parser)
 #define PATTERN_SEASON  "SE"
 #define PATTERN_EPISODE "EP"
 
+#define PATTERN_SIZE_MAX 64
+
+/*
+ * A pattern is compiled like the format of sscanf() which was used before
+ * ("%n" keyword "%n" where NUM is "%*u", SE and EP are "%u"). The ops are
+ * interpreted like with the sscanf() of the glibc, then the results are
+ * the same without building and parsing a format for each filename.
+ */
+typedef enum parser_pattern_op {
+  PATTERN_OP_CHAR = 0,  /* literal character */
+  PATTERN_OP_SPACE,     /* skip the spaces before the next op */
+  PATTERN_OP_PERCENT,   /* "%%" */
+  PATTERN_OP_NUMBER,    /* "%u" or "%*u" */
+  PATTERN_OP_POS,       /* "%n" */
+  PATTERN_OP_FAIL,      /* truncated conversion */
+} parser_pattern_op_t;
+
+typedef enum parser_pattern_arg {
+  PATTERN_ARG_LEN_S = 0,
+  PATTERN_ARG_LEN_E,
+  PATTERN_ARG_SE,
+  PATTERN_ARG_EP,
+  PATTERN_ARG_NONE,     /* "%*u" or no argument */
+} parser_pattern_arg_t;
+
+typedef struct parser_pattern_s {
+  struct {
+    uint8_t op;
+    uint8_t c;
+    uint8_t arg;
+  } ops[PATTERN_SIZE_MAX];
+  unsigned int nb;
+  int          both; /* SE and EP */
+} parser_pattern_t;
+
 static void
-parser_decrap_pattern (char *str, const char *bl,
-                       unsigned int *se, unsigned int *ep)
+parser_decrap_pattern_compile (parser_pattern_t *pattern, const char *bl)
 {
-  char pattern[64];
-  int res, len_s = 0, len_e = 0;
+  char fmt[PATTERN_SIZE_MAX];
   char *it, *it1, *it2;
+  const char *f;
+  unsigned int i = 0, nb_args;
+  parser_pattern_arg_t args[4];
 
-  /* prepare pattern */
-  snprintf (pattern, sizeof (pattern), "%%n%s%%n", bl);
-  while ((it = strstr (pattern, PATTERN_NUMBER)))
+  /* prepare the format like for sscanf() */
+  snprintf (fmt, sizeof (fmt), "%%n%s%%n", bl);
+  while ((it = strstr (fmt, PATTERN_NUMBER)))
     memcpy (it, "%*u", 3);
 
-  it1 = strstr (pattern, PATTERN_SEASON);
-  it2 = strstr (pattern, PATTERN_EPISODE);
+  it1 = strstr (fmt, PATTERN_SEASON);
+  it2 = strstr (fmt, PATTERN_EPISODE);
   if (it1)
     memcpy (it1, "%u", 2);
   if (it2)
     memcpy (it2, "%u", 2);
 
+  /* arguments passed to sscanf() */
+  args[0] = PATTERN_ARG_LEN_S;
+  if (it1 && it2)
+  {
+    args[1] = it1 < it2 ? PATTERN_ARG_SE : PATTERN_ARG_EP;
+    args[2] = it1 < it2 ? PATTERN_ARG_EP : PATTERN_ARG_SE;
+    args[3] = PATTERN_ARG_LEN_E;
+    nb_args = 4;
+  }
+  else if (it1 || it2)
+  {
+    args[1] = it1 ? PATTERN_ARG_SE : PATTERN_ARG_EP;
+    args[2] = PATTERN_ARG_LEN_E;
+    nb_args = 3;
+  }
+  else
+  {
+    args[1] = PATTERN_ARG_LEN_E;
+    nb_args = 2;
+  }
+
+  pattern->both = it1 && it2;
+  pattern->nb   = 0;
+
+  for (f = fmt; *f; f++)
+  {
+    uint8_t op, c, arg = PATTERN_ARG_NONE;
+
+    if (*f != '%')
+    {
+      op = VH_ISSPACE (*f) ? PATTERN_OP_SPACE : PATTERN_OP_CHAR;
+      pattern->ops[pattern->nb].op  = op;
+      pattern->ops[pattern->nb].c   = (uint8_t) *f;
+      pattern->ops[pattern->nb].arg = arg;
+      pattern->nb++;
+      continue;
+    }
+
+    f++;
+    c = *f;
+    if (*f == '*')
+      f++;
+    else if (*f == 'n' || *f == 'u')
+      arg = i < nb_args ? args[i++] : PATTERN_ARG_NONE;
+
+    switch (*f)
+    {
+    case '%':
+      op = PATTERN_OP_PERCENT;
+      break;
+
+    case 'n':
+      op = PATTERN_OP_POS;
+      break;
+
+    case 'u':
+      op = PATTERN_OP_NUMBER;
+      break;
+
+    default:
+      op = PATTERN_OP_FAIL;
+      break;
+    }
+
+    pattern->ops[pattern->nb].op  = op;
+    pattern->ops[pattern->nb].c   = c;
+    pattern->ops[pattern->nb].arg = arg;
+    pattern->nb++;
+
+    if (!*f)
+      break;
+  }
+}
+
+/* Same as sscanf (str, format, args...) with the compiled format. */
+static int
+parser_decrap_pattern_scan (const char *str,
+                            const parser_pattern_t *pattern, void **args)
+{
+  unsigned int i;
+  int done = 0, skip = 0;
+  const char *it = str;
+
+  for (i = 0; i < pattern->nb; i++)
+  {
+    const uint8_t op  = pattern->ops[i].op;
+    const uint8_t arg = pattern->ops[i].arg;
+    unsigned long val = 0;
+    int neg = 0, digits = 0;
+
+    switch (op)
+    {
+    case PATTERN_OP_SPACE:
+      skip = 1;
+      continue;
+
+    case PATTERN_OP_FAIL:
+      return done;
+
+    case PATTERN_OP_CHAR:
+      if (!*it)
+        goto eof;
+      if (skip)
+        while (VH_ISSPACE (*it))
+          if (!*++it)
+            goto eof;
+      skip = 0;
+      if (*it != (char) pattern->ops[i].c)
+        return done;
+      it++;
+      continue;
+
+    default:
+      break;
+    }
+
+    /* the conversions (except %n) skip the spaces */
+    if (skip || op != PATTERN_OP_POS)
+      while (VH_ISSPACE (*it))
+        it++;
+    skip = 0;
+
+    if (op == PATTERN_OP_POS)
+    {
+      if (arg != PATTERN_ARG_NONE)
+        *(int *) args[arg] = it - str;
+      continue;
+    }
+
+    if (!*it)
+      goto eof;
+
+    if (op == PATTERN_OP_PERCENT)
+    {
+      if (*it != '%')
+        return done;
+      it++;
+      continue;
+    }
+
+    /* PATTERN_OP_NUMBER, like strtoul() */
+    if (*it == '-' || *it == '+')
+      neg = *it++ == '-';
+
+    for (; *it >= '0' && *it <= '9'; it++, digits++)
+      if (val != ULONG_MAX)
+        val = val > (ULONG_MAX - (*it - '0')) / 10
+              ? ULONG_MAX : val * 10 + (*it - '0');
+
+    if (!digits)
+      return done;
+
+    if (neg && val != ULONG_MAX)
+      val = -val;
+
+    if (pattern->ops[i].c == '*') /* "%*u" */
+      continue;
+
+    if (arg != PATTERN_ARG_NONE)
+      *(unsigned int *) args[arg] = (unsigned int) val;
+    done++;
+  }
+
+  return done;
+
+ eof:
+  return done ? done : EOF;
+}
+
+static void
+parser_decrap_pattern (char *str, const parser_pattern_t *pattern,
+                       unsigned int *se, unsigned int *ep)
+{
+  int res, len_s = 0, len_e = 0;
+  char *it;
+  void *args[] = {
+    [PATTERN_ARG_LEN_S] = &len_s,
+    [PATTERN_ARG_LEN_E] = &len_e,
+    [PATTERN_ARG_SE]    = se,
+    [PATTERN_ARG_EP]    = ep,
+  };
+
   /* search pattern in the string */
-  it = str;
-  do
+  for (it = str; ; it += len_s + 1)
   {
     len_s = 0;
-    if (!it1 && it2) /* only EP */
-      res = sscanf (it, pattern, &len_s, ep, &len_e);
-    else if (!it2 && it1) /* only SE */
-      res = sscanf (it, pattern, &len_s, se, &len_e);
-    else if (it1 && it2) /* SE & EP */
+    res = parser_decrap_pattern_scan (it, pattern, args);
+    if (pattern->both)
     {
-      if (it1 < it2)
-        res = sscanf (it, pattern, &len_s, se, ep, &len_e);
-      else
-        res = sscanf (it, pattern, &len_s, ep, se, &len_e);
       /* Both must return something with sscanf. */
       if (!*ep)
         *se = 0;
       if (!*se)
         *ep = 0;
     }
-    else /* NUM */
-      res = sscanf (it, pattern, &len_s, &len_e);
-    it += len_s + 1;
+
+    if (len_e || res == EOF || !*it)
+      break;
   }
-  while (!len_e && res != EOF);
 
   if (len_e <= len_s)
     return;
 
-  it--;
+  it += len_s;
 
   /*
    * Check if the pattern found is not into a string. Space, start or end
@@ -154,51 +372,331 @@ parser_decrap_pattern (char *str, const char *bl,
 }
 /* } VH_TEST (parser_decrap_pattern) */
 
+/* VH_TEST (parser_decrap_blacklist) { */
+#define BL_MATCH_NB 64
+
+/*
+ * The keywords are compiled in one automaton (Aho-Corasick) where all the
+ * occurrences are found with one pass on the filename. The keywords are
+ * still applied in the order of the list because a keyword can hide an
+ * other one. A keyword is found with the first occurrence which is not
+ * already trimmed, like with strcasestr() on the string. The patterns and
+ * the keywords with spaces (the trimmed parts can create new occurrences)
+ * are applied on the string like before.
+ */
+typedef struct parser_bl_word_s {
+  const char       *str;
+  size_t            size;    /* 0 if not in the automaton */
+  parser_pattern_t *pattern; /* NUM, SE or EP */
+  int               next;    /* next word with the same end state */
+} parser_bl_word_t;
+
+typedef struct parser_bl_s {
+  parser_bl_word_t *word;
+  unsigned int      nb;
+
+  /* patterns and keywords with spaces, not in the automaton */
+  unsigned int     *scan;
+  unsigned int      nb_scan;
+
+  uint8_t           cls[256];  /* char -> class (case insensitive) */
+  unsigned int      nb_cls;
+  unsigned int     *delta;     /* state * nb_cls + class -> state */
+  int              *out;       /* first word ending with the state */
+  unsigned int     *out_link;  /* next state with a word, 0 for none */
+} parser_bl_t;
+
+typedef struct parser_bl_match_s {
+  unsigned int word;
+  size_t       pos;
+} parser_bl_match_t;
+
 static void
-parser_decrap_blacklist (char **list, char *str, metadata_t **meta)
+parser_bl_free (parser_bl_t *bl)
+{
+  unsigned int i;
+
+  if (!bl)
+    return;
+
+  for (i = 0; bl->word && i < bl->nb; i++)
+    free (bl->word[i].pattern);
+
+  free (bl->word);
+  free (bl->scan);
+  free (bl->delta);
+  free (bl->out);
+  free (bl->out_link);
+  free (bl);
+}
+
+static int
+parser_bl_automaton (parser_bl_t *bl)
 {
-  char **l;
+  unsigned int i, c, head = 0, tail = 0, states = 1, nb_states = 1;
+  unsigned int *fail = NULL, *queue = NULL;
+  const unsigned int nc = bl->nb_cls;
+
+  for (i = 0; i < bl->nb; i++)
+    states += bl->word[i].size;
+
+  bl->delta    = calloc (states * nc, sizeof (*bl->delta));
+  bl->out      = malloc (states * sizeof (*bl->out));
+  bl->out_link = calloc (states, sizeof (*bl->out_link));
+  fail         = calloc (states, sizeof (*fail));
+  queue        = malloc (states * sizeof (*queue));
+  if (!bl->delta || !bl->out || !bl->out_link || !fail || !queue)
+    goto err;
 
-  for (l = list; l && *l; l++)
+  for (i = 0; i < states; i++)
+    bl->out[i] = -1;
+
+  /* trie of the words */
+  for (i = 0; i < bl->nb; i++)
   {
-    size_t size;
-    char *p;
+    unsigned int s = 0;
+    const char *it;
+
+    if (!bl->word[i].size)
+      continue;
+
+    for (it = bl->word[i].str; *it; it++)
+    {
+      unsigned int *t = &bl->delta[s * nc + bl->cls[(uint8_t) *it]];
+      if (!*t)
+        *t = nb_states++;
+      s = *t;
+    }
+
+    bl->word[i].next = bl->out[s];
+    bl->out[s] = i;
+  }
+
+  /* failure links (breadth-first), the missing transitions are completed */
+  for (c = 0; c < nc; c++)
+    if (bl->delta[c])
+      queue[tail++] = bl->delta[c];
+
+  while (head < tail)
+  {
+    const unsigned int s = queue[head++];
+
+    for (c = 0; c < nc; c++)
+    {
+      unsigned int *t = &bl->delta[s * nc + c];
+      const unsigned int f = bl->delta[fail[s] * nc + c];
+
+      if (!*t)
+      {
+        *t = f;
+        continue;
+      }
+
+      fail[*t] = f;
+      bl->out_link[*t] = bl->out[f] >= 0 ? f : bl->out_link[f];
+      queue[tail++] = *t;
+    }
+  }
+
+  free (fail);
+  free (queue);
+  return 0;
 
-    if (   strstr (*l, PATTERN_NUMBER)
-        || strstr (*l, PATTERN_SEASON)
-        || strstr (*l, PATTERN_EPISODE))
+ err:
+  free (fail);
+  free (queue);
+  return -1;
+}
+
+static parser_bl_t *
+parser_bl_compile (char **list)
+{
+  unsigned int i, c;
+  parser_bl_t *bl;
+
+  bl = calloc (1, sizeof (parser_bl_t));
+  if (!bl)
+    return NULL;
+
+  bl->nb   = vh_get_list_length (list);
+  bl->word = calloc (bl->nb + 1, sizeof (*bl->word));
+  bl->scan = calloc (bl->nb + 1, sizeof (*bl->scan));
+  if (!bl->word || !bl->scan)
+    goto err;
+
+  bl->nb_cls = 1; /* 0 for the chars which are not in the keywords */
+  for (i = 0; i < bl->nb; i++)
+  {
+    parser_bl_word_t *word = &bl->word[i];
+    const char *it;
+
+    word->str  = list[i];
+    word->next = -1;
+
+    if (   strstr (word->str, PATTERN_NUMBER)
+        || strstr (word->str, PATTERN_SEASON)
+        || strstr (word->str, PATTERN_EPISODE))
+    {
+      word->pattern = malloc (sizeof (*word->pattern));
+      if (!word->pattern)
+        goto err;
+      parser_decrap_pattern_compile (word->pattern, word->str);
+      bl->scan[bl->nb_scan++] = i;
+      continue;
+    }
+
+    if (strchr (word->str, ' '))
+    {
+      bl->scan[bl->nb_scan++] = i;
+      continue;
+    }
+
+    word->size = strlen (word->str);
+    for (it = word->str; *it; it++)
     {
-      unsigned int i, se = 0, ep = 0;
+      uint8_t *cls = &bl->cls[VH_TOLOWER (*it)];
+      if (!*cls)
+        *cls = bl->nb_cls++;
+    }
+  }
+
+  /* the same class for the uppercase and the lowercase chars */
+  for (c = 0; c < 256; c++)
+    bl->cls[c] = bl->cls[VH_TOLOWER (c)];
+
+  if (parser_bl_automaton (bl))
+    goto err;
+
+  return bl;
+
+ err:
+  parser_bl_free (bl);
+  return NULL;
+}
 
-      parser_decrap_pattern (str, *l, &se, &ep);
-      for (i = 0; i < 2; i++)
+static int
+parser_bl_match_cmp (const void *m1, const void *m2)
+{
+  const parser_bl_match_t *a = m1, *b = m2;
+
+  if (a->word != b->word)
+    return a->word < b->word ? -1 : 1;
+  return a->pos < b->pos ? -1 : a->pos > b->pos;
+}
+
+static void
+parser_decrap_word (char *str, char *p, size_t size)
+{
+  if (!VH_ISGRAPH (*(p + size)) && (p == str || !VH_ISGRAPH (*(p - 1))))
+    memset (p, ' ', size);
+}
+
+static void
+parser_decrap_blacklist (const parser_bl_t *bl, char *str,
+                         metadata_t **meta, arena_t *arena)
+{
+  unsigned int i, m, s = 0, nb = 0, max = BL_MATCH_NB;
+  parser_bl_match_t buf[BL_MATCH_NB], *match = buf;
+  const char *it;
+
+  if (!bl)
+    return;
+
+  /* all occurrences of the keywords in one pass */
+  for (it = str; *it; it++)
+  {
+    unsigned int o;
+
+    s = bl->delta[s * bl->nb_cls + bl->cls[(uint8_t) *it]];
+    for (o = s; o; o = bl->out_link[o])
+    {
+      int w;
+
+      for (w = bl->out[o]; w >= 0; w = bl->word[w].next)
       {
-        unsigned int val = i ? ep : se;
-        char v[32];
-
-        if (!val)
-          continue;
-
-        snprintf (v, sizeof (v), "%u", val);
-        if (i)
-          vh_metadata_add_auto (meta, VALHALLA_METADATA_EPISODE,
-                                v, VALHALLA_LANG_UNDEF, NULL);
-        else
-          vh_metadata_add_auto (meta, VALHALLA_METADATA_SEASON,
-                                v, VALHALLA_LANG_UNDEF, NULL);
+        if (nb == max)
+        {
+          parser_bl_match_t *tmp;
+
+          max *= 2;
+          tmp = match == buf ? malloc (max * sizeof (*match))
+                             : realloc (match, max * sizeof (*match));
+          if (!tmp)
+            goto out;
+          if (match == buf)
+            memcpy (tmp, buf, sizeof (buf));
+          match = tmp;
+        }
+
+        match[nb].word = w;
+        match[nb].pos  = it + 1 - str - bl->word[w].size;
+        nb++;
       }
+    }
+  }
+
+  if (nb > 1)
+    qsort (match, nb, sizeof (*match), parser_bl_match_cmp);
+
+  /* apply the keywords in the order of the list */
+  for (i = 0, m = 0; i < bl->nb_scan || m < nb;)
+  {
+    const parser_bl_word_t *word;
+    unsigned int w, j, se = 0, ep = 0;
+    char *p;
+
+    if (m < nb && (i >= bl->nb_scan || match[m].word < bl->scan[i]))
+    {
+      w    = match[m].word;
+      word = &bl->word[w];
+
+      /* the first occurrence which is not trimmed */
+      for (; m < nb && match[m].word == w; m++)
+        if (!strncasecmp (str + match[m].pos, word->str, word->size))
+        {
+          parser_decrap_word (str, str + match[m].pos, word->size);
+          break;
+        }
+
+      while (m < nb && match[m].word == w)
+        m++;
       continue;
     }
 
-    p = strcasestr (str, *l);
-    if (!p)
+    word = &bl->word[bl->scan[i++]];
+
+    if (!word->pattern)
+    {
+      p = strcasestr (str, word->str);
+      if (p)
+        parser_decrap_word (str, p, strlen (word->str));
       continue;
+    }
 
-    size = strlen (*l);
-    if (!VH_ISGRAPH (*(p + size)) && (p == str || !VH_ISGRAPH (*(p - 1))))
-      memset (p, ' ', size);
+    parser_decrap_pattern (str, word->pattern, &se, &ep);
+    for (j = 0; j < 2; j++)
+    {
+      unsigned int val = j ? ep : se;
+      char v[32];
+
+      if (!val)
+        continue;
+
+      snprintf (v, sizeof (v), "%u", val);
+      if (j)
+        vh_metadata_add_auto (meta, arena, VALHALLA_METADATA_EPISODE,
+                              v, VALHALLA_LANG_UNDEF, NULL);
+      else
+        vh_metadata_add_auto (meta, arena, VALHALLA_METADATA_SEASON,
+                              v, VALHALLA_LANG_UNDEF, NULL);
+    }
   }
+
+ out:
+  if (match != buf)
+    free (match);
 }
+/* } VH_TEST (parser_decrap_blacklist) */
 
 static void
 parser_decrap_cleanup (char *str)
@@ -240,7 +738,8 @@ parser_decrap_cleanup (char *str)
 }
 
 static char *
-parser_decrapify (parser_t *parser, const char *file, metadata_t **meta)
+parser_decrapify (parser_t *parser, const char *file,
+                  metadata_t **meta, arena_t *arena)
 {
   char *it, *filename, *res;
   char *file_tmp = strdup (file);
@@ -267,7 +766,7 @@ parser_decrapify (parser_t *parser, const char *file, metadata_t **meta)
     if (IS_TO_DECRAPIFY (*it))
       *it = ' ';
 
-  parser_decrap_blacklist (parser->bl_list, filename, meta);
+  parser_decrap_blacklist (parser->bl, filename, meta, arena);
   parser_decrap_cleanup (filename);
 
   res = strdup (filename);
@@ -279,7 +778,7 @@ parser_decrapify (parser_t *parser, const char *file, metadata_t **meta)
 }
 
 static metadata_t *
-parser_metadata_get (parser_t *parser, AVFormatContext *ctx, const char *file)
+parser_metadata_get (AVFormatContext *ctx, arena_t *arena)
 {
   unsigned int i;
   metadata_t *meta = NULL;
@@ -294,7 +793,7 @@ parser_metadata_get (parser_t *parser, AVFormatContext *ctx, const char *file)
     return NULL;
 
   while ((tag = av_dict_get (ctx->metadata, "", tag, AV_DICT_IGNORE_SUFFIX)))
-    vh_metadata_add_auto (&meta, tag->key, tag->value,
+    vh_metadata_add_auto (&meta, arena, tag->key, tag->value,
                           VALHALLA_LANG_UNDEF, &pl);
 
   for (i = 0; i < ctx->nb_streams; i++)
@@ -309,29 +808,36 @@ parser_metadata_get (parser_t *parser, AVFormatContext *ctx, const char *file)
           && !strcasecmp (key, VALHALLA_METADATA_TITLE))
         key = VALHALLA_METADATA_TITLE_STREAM;
 
-      vh_metadata_add_auto (&meta, key, tag->value,
+      vh_metadata_add_auto (&meta, arena, key, tag->value,
                             VALHALLA_LANG_UNDEF, &pl);
     }
   }
 
-  if (!meta)
+  return meta;
+}
+
+static void
+parser_metadata_title (parser_t *parser, const char *file,
+                       metadata_t **meta, arena_t *arena)
+{
+  const metadata_t *title_tag = NULL;
+
+  if (!*meta)
     vh_log (VALHALLA_MSG_VERBOSE, "no available metadata for %s", file);
 
   /* if necessary, use the filename as title */
   if (parser->decrapifier
-      && vh_metadata_get (meta, VALHALLA_METADATA_TITLE, 0, &title_tag))
+      && vh_metadata_get (*meta, VALHALLA_METADATA_TITLE, 0, &title_tag))
   {
-    char *title = parser_decrapify (parser, file, &meta);
+    char *title = parser_decrapify (parser, file, meta, arena);
     if (title)
     {
-      vh_metadata_add (&meta, VALHALLA_METADATA_TITLE, title,
+      vh_metadata_add (meta, arena, VALHALLA_METADATA_TITLE, title,
                        VALHALLA_LANG_UNDEF, VALHALLA_META_GRP_TITLES,
                        VALHALLA_METADATA_PL_NORMAL);
       free (title);
     }
   }
-
-  return meta;
 }
 
 static valhalla_file_type_t
@@ -372,14 +878,31 @@ parser_metadata (parser_t *parser, file_data_t *data)
 {
   AVFormatContext *ctx;
 
-  ctx = vh_lavf_utils_open_input_file (data->file.path);
+  /* the streams are only read with lavf */
+  if (parser->tagreader && !parser->streaminfo
+      && !vh_tag_reader_get (data->file.path,
+                             &data->meta_parser, data->arena))
+  {
+    data->file.type = VALHALLA_FILE_TYPE_AUDIO;
+    parser_metadata_title (parser, data->file.path,
+                           &data->meta_parser, data->arena);
+    return;
+  }
+
+  ctx = vh_lavf_utils_open_input_file (data->file.path, &parser->lavf);
   if (!ctx)
     return;
 
   data->file.type = parser_stream_info (ctx);
-  data->meta_parser = parser_metadata_get (parser, ctx, data->file.path);
+  data->meta_parser = parser_metadata_get (ctx, data->arena);
+  parser_metadata_title (parser, data->file.path,
+                         &data->meta_parser, data->arena);
 
-  avformat_close_input (&ctx);
+  /* The streams for the grabber ffmpeg, while the file is still open. */
+  if (parser->streaminfo)
+    data->props = vh_lavf_utils_props_get (ctx);
+
+  vh_lavf_utils_close_input_file (&ctx);
 }
 
 static void *
@@ -442,6 +965,13 @@ vh_parser_run (parser_t *parser, int priority)
   if (!parser)
     return PARSER_ERROR_HANDLER;
 
+  if (parser->decrapifier && parser->bl_list)
+  {
+    parser->bl = parser_bl_compile (parser->bl_list);
+    if (!parser->bl)
+      vh_log (VALHALLA_MSG_ERROR, "the blacklist can not be compiled");
+  }
+
   parser->priority = priority;
   parser->run      = 1;
 
@@ -494,6 +1024,51 @@ vh_parser_bl_keyword_add (parser_t *parser, const char *keyword)
   parser->bl_list[n - 1] = strdup (keyword);
 }
 
+void
+vh_parser_probesize_set (parser_t *parser, int size)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!parser || size < 0)
+    return;
+
+  parser->lavf.probesize = size;
+}
+
+void
+vh_parser_streaminfo_set (parser_t *parser, int enable)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!parser)
+    return;
+
+  parser->streaminfo = !!enable;
+}
+
+void
+vh_parser_tagreader_set (parser_t *parser, int enable)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!parser)
+    return;
+
+  parser->tagreader = !!enable;
+}
+
+void
+vh_parser_analyzeduration_set (parser_t *parser, int duration)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!parser || duration < 0)
+    return;
+
+  /* milliseconds to AV_TIME_BASE */
+  parser->lavf.analyzeduration = (int64_t) duration * 1000;
+}
+
 fifo_queue_t *
 vh_parser_fifo_get (parser_t *parser)
 {
@@ -564,6 +1139,8 @@ vh_parser_uninit (parser_t *parser)
     free (parser->bl_list);
   }
 
+  parser_bl_free (parser->bl);
+
   vh_fifo_queue_free (parser->fifo);
   pthread_mutex_destroy (&parser->mutex_run);
   VH_THREAD_PAUSE_UNINIT (parser)
@@ -595,6 +1172,7 @@ vh_parser_init (valhalla_t *handle, unsigned int nb, unsigned int decrapifier)
   parser->valhalla    = handle; /* VH_HANDLE */
   parser->nb          = nb ? nb : PARSER_NUMBER_DEF;
   parser->decrapifier = !!decrapifier;
+  parser->tagreader   = 1;
 
   pthread_mutex_init (&parser->mutex_run, NULL);
   VH_THREAD_PAUSE_INIT (parser)
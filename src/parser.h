@@ -44,6 +44,10 @@ parser_t *vh_parser_init (valhalla_t *handle,
                           unsigned int nb, unsigned int decrapifier);
 
 void vh_parser_bl_keyword_add (parser_t *parser, const char *keyword);
+void vh_parser_probesize_set (parser_t *parser, int size);
+void vh_parser_analyzeduration_set (parser_t *parser, int duration);
+void vh_parser_streaminfo_set (parser_t *parser, int enable);
+void vh_parser_tagreader_set (parser_t *parser, int enable);
 
 void vh_parser_action_send (parser_t *parser,
                             fifo_queue_prio_t prio, int action, void *data);
@@ -19,15 +19,25 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _GNU_SOURCE
 #include <pthread.h>
 #include <semaphore.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <string.h>
+#include <time.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
+#ifdef HAVE_INOTIFY
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif /* HAVE_INOTIFY */
+
 #include "valhalla.h"
 #include "valhalla_internals.h"
 #include "utils.h"
@@ -38,18 +48,120 @@
 #include "timer_thread.h"
 #include "dbmanager.h"
 #include "event_handler.h"
+#include "stats.h"
 #include "scanner.h"
 
 #ifndef PATH_RECURSIVENESS_MAX
 #define PATH_RECURSIVENESS_MAX 42
 #endif /* PATH_RECURSIVENESS_MAX */
 
+#ifndef SCANNER_NB_MAX
+#define SCANNER_NB_MAX 16
+#endif /* SCANNER_NB_MAX */
+
 #define VH_HANDLE scanner->valhalla
 
+#define STATS_GROUP     "scanner"
+#define STATS_STAT      "stat"
+#define STATS_NOSTAT    "nostat"
+#define STATS_DIRSKIP   "dirskip"
+#define STATS_FILESKIP  "fileskip"
+#define STATS_WATCH     "watch"
+
+#ifdef HAVE_INOTIFY
+#define SCANNER_WATCH_MASK \
+  (IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO \
+   | IN_ONLYDIR)
+#endif /* HAVE_INOTIFY */
+
+/* VH_TEST (scanner_suffixes) { */
+/* Accepted suffixes in lowercase, sorted for bsearch(). */
+typedef struct scanner_suffixes_s {
+  char         **list;
+  unsigned int   nb;
+} scanner_suffixes_t;
+
+static int
+scanner_suffixes_cmp (const void *key, const void *elem)
+{
+  return strcasecmp (key, *(char *const *) elem);
+}
+
+static void
+scanner_suffixes_free (scanner_suffixes_t *suffixes)
+{
+  unsigned int i;
+
+  for (i = 0; i < suffixes->nb; i++)
+    free (suffixes->list[i]);
+  free (suffixes->list);
+
+  suffixes->list = NULL;
+  suffixes->nb   = 0;
+}
+
+/* Return 1 if the suffix is already in the set, -1 on error. */
+static int
+scanner_suffixes_add (scanner_suffixes_t *suffixes, const char *suffix)
+{
+  unsigned int pos;
+  char **list, *lower;
+
+  for (pos = 0; pos < suffixes->nb; pos++)
+  {
+    int res = strcasecmp (suffix, suffixes->list[pos]);
+    if (!res)
+      return 1;
+    if (res < 0)
+      break;
+  }
+
+  lower = strdup (suffix);
+  if (!lower)
+    return -1;
+  vh_strtolower (lower);
+
+  list = realloc (suffixes->list, (suffixes->nb + 1) * sizeof (*list));
+  if (!list)
+  {
+    free (lower);
+    return -1;
+  }
+
+  memmove (list + pos + 1, list + pos, (suffixes->nb - pos) * sizeof (*list));
+  list[pos] = lower;
+  suffixes->list = list;
+  suffixes->nb++;
+  return 0;
+}
+
+/*
+ * Each part of the name after a dot is a suffix ("a.tar.gz" gives "tar.gz"
+ * then "gz"). Only the last component of the path is checked.
+ */
+static int
+scanner_suffixes_get (const scanner_suffixes_t *suffixes, const char *file)
+{
+  const char *it;
+
+  if (!suffixes->nb)
+    return -1;
+
+  it = strrchr (file, '/');
+  for (it = strchr (it ? it : file, '.'); it; it = strchr (it + 1, '.'))
+    if (bsearch (it + 1, suffixes->list, suffixes->nb,
+                 sizeof (*suffixes->list), scanner_suffixes_cmp))
+      return 0;
+
+  return -1;
+}
+/* } VH_TEST (scanner_suffixes) */
+
 struct scanner_s {
   valhalla_t   *valhalla;
   pthread_t     thread;
   fifo_queue_t *fifo;
+  unsigned int  nb;
   int           priority;
   int           loop;
 
@@ -67,9 +179,92 @@ struct scanner_s {
     int recursive;
     int nb_files;
   } *paths;
-  char **suffix;
+  char             **suffix;
+  scanner_suffixes_t suffixes; /* lowercase copy of the suffixes */
+
+  /* directories cache */
+  int         dircache;
+  int         dirs_err;
+  time_t      loop_time;
+  dir_list_t  dirs;     /* directories of the last complete loop */
+  dir_list_t  dirs_new; /* directories of the current loop */
+
+  /* watch mode */
+  int watch;
+#ifdef HAVE_INOTIFY
+  int                     watch_fd;      /* inotify */
+  int                     watch_pipe[2]; /* wake up the watch loop */
+  int                     watch_pending; /* files sent, waiting for ACKs */
+  pthread_mutex_t         watch_mutex;
+  struct scanner_watch_s *watches;       /* sorted by wd */
+  unsigned int            watches_nb;
+  unsigned int            watches_size;
+  struct scanner_job_s   *unwatched;     /* the limit of watches is reached */
+  unsigned int            unwatched_nb;
+  unsigned int            unwatched_size;
+#endif /* HAVE_INOTIFY */
+
+  vh_stats_cnt_t *st_stat;
+  vh_stats_cnt_t *st_nostat;
+  vh_stats_cnt_t *st_dirskip;
+  vh_stats_cnt_t *st_fileskip;
+  vh_stats_cnt_t *st_watch;
 };
 
+/*
+ * A directory to be read by a walker. The path is already concatenated
+ * with its parent.
+ */
+typedef struct scanner_job_s {
+  char *path;
+  int   recursive;
+} scanner_job_t;
+
+/* A directory watched with inotify. */
+typedef struct scanner_watch_s {
+  int   wd;
+  int   recursive; /* for the subdirectories */
+  char *path;
+} scanner_watch_t;
+
+/*
+ * Each walker has its own deque of directories. The owner pushes and pops
+ * at the bottom (depth-first), the other walkers steal at the top (the
+ * biggest subtrees in general).
+ */
+typedef struct scanner_deque_s {
+  pthread_mutex_t mutex;
+  scanner_job_t  *jobs;
+  unsigned int    size;
+  unsigned int    top;
+  unsigned int    bottom;
+} scanner_deque_t;
+
+struct scanner_walk_s;
+
+typedef struct scanner_walker_s {
+  struct scanner_walk_s *walk;
+  pthread_t       thread;
+  unsigned int    id;
+  scanner_deque_t deque;
+  int             files;
+  dir_list_t      dirs;
+  int             dirs_err;
+} scanner_walker_t;
+
+/* Pool of walkers for one path. */
+typedef struct scanner_walk_s {
+  scanner_t        *scanner;
+  scanner_walker_t *walker;
+  unsigned int      nb;
+
+  int             pending; /* directories pushed but not read yet */
+  unsigned int    gen;     /* incremented for each push */
+  unsigned int    idle;
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+} scanner_walk_t;
+
 
 static void
 path_free (struct path_s *path)
@@ -85,181 +280,1262 @@ path_free (struct path_s *path)
   }
 }
 
-static struct path_s *
-path_new (const char *location, int recursive)
+static struct path_s *
+path_new (const char *location, int recursive)
+{
+  char *it;
+  struct path_s *path;
+
+  if (!location)
+    return NULL;
+
+  path = calloc (1, sizeof (struct path_s));
+  if (!path)
+    return NULL;
+
+  path->location = strdup (location);
+  it = strrchr (path->location, '/');
+  if (it && it != path->location && *(it + 1) == '\0')
+    *it = '\0';
+
+  path->recursive = recursive ? PATH_RECURSIVENESS_MAX : 0;
+  return path;
+}
+
+static int
+path_cmp (struct path_s *path, const char *file)
+{
+  for (; path; path = path->next)
+    if (strstr (file, path->location) == file)
+    {
+      int sf = 0;
+      const char *it;
+
+      if (!path->recursive)
+        return -1;
+
+      it = file + strlen (path->location);
+      while ((it = strchr (it, '/')))
+      {
+        it++;
+        sf++;
+      }
+
+      if (path->recursive < sf)
+        return -1;
+      return 0;
+    }
+
+  return -1;
+}
+
+static int
+suffix_cmp (scanner_t *scanner, const char *file)
+{
+  if (!file)
+    return -1;
+
+  if (!scanner->suffix) /* always accepted */
+    return 0;
+
+  return scanner_suffixes_get (&scanner->suffixes, file);
+}
+
+static inline int
+scanner_is_stopped (scanner_t *scanner)
+{
+  int run;
+  pthread_mutex_lock (&scanner->mutex_run);
+  run = scanner->run;
+  pthread_mutex_unlock (&scanner->mutex_run);
+  return !run;
+}
+
+static int
+scanner_deque_push (scanner_deque_t *deque, char *path, int recursive)
+{
+  pthread_mutex_lock (&deque->mutex);
+
+  if (deque->bottom == deque->size)
+  {
+    if (deque->top)
+    {
+      memmove (deque->jobs, deque->jobs + deque->top,
+               (deque->bottom - deque->top) * sizeof (*deque->jobs));
+      deque->bottom -= deque->top;
+      deque->top = 0;
+    }
+    else
+    {
+      unsigned int size = deque->size ? 2 * deque->size : 64;
+      scanner_job_t *jobs;
+
+      jobs = realloc (deque->jobs, size * sizeof (*deque->jobs));
+      if (!jobs)
+      {
+        pthread_mutex_unlock (&deque->mutex);
+        return -1;
+      }
+
+      deque->jobs = jobs;
+      deque->size = size;
+    }
+  }
+
+  deque->jobs[deque->bottom].path      = path;
+  deque->jobs[deque->bottom].recursive = recursive;
+  deque->bottom++;
+
+  pthread_mutex_unlock (&deque->mutex);
+  return 0;
+}
+
+static int
+scanner_deque_pop (scanner_deque_t *deque, scanner_job_t *job, int steal)
+{
+  int res = -1;
+
+  pthread_mutex_lock (&deque->mutex);
+
+  if (deque->top < deque->bottom)
+  {
+    *job = steal ? deque->jobs[deque->top++] : deque->jobs[--deque->bottom];
+    if (deque->top == deque->bottom)
+      deque->top = deque->bottom = 0;
+    res = 0;
+  }
+
+  pthread_mutex_unlock (&deque->mutex);
+  return res;
+}
+
+static void
+scanner_walk_done (scanner_walk_t *walk)
+{
+  pthread_mutex_lock (&walk->mutex);
+  walk->pending--;
+  if (!walk->pending)
+    pthread_cond_broadcast (&walk->cond);
+  pthread_mutex_unlock (&walk->mutex);
+}
+
+static void
+scanner_walk_push (scanner_walker_t *walker, char *path, int recursive)
+{
+  scanner_walk_t *walk = walker->walk;
+
+  /*
+   * The directory is pending before to be visible, else a thief can read
+   * it and finish it before the increment, and the walkers see the end.
+   */
+  pthread_mutex_lock (&walk->mutex);
+  walk->pending++;
+  pthread_mutex_unlock (&walk->mutex);
+
+  if (scanner_deque_push (&walker->deque, path, recursive))
+  {
+    free (path);
+    scanner_walk_done (walk);
+    return;
+  }
+
+  /* the idle walkers can steal it now */
+  pthread_mutex_lock (&walk->mutex);
+  walk->gen++;
+  if (walk->idle)
+    pthread_cond_signal (&walk->cond);
+  pthread_mutex_unlock (&walk->mutex);
+}
+
+static char *
+scanner_path_new (const char *path, const char *name)
+{
+  char *file;
+  size_t size;
+
+  size = strlen (path) + strlen (name) + 2;
+  file = malloc (size);
+  if (!file)
+    return NULL;
+
+  snprintf (file, size, "%s%s%s",
+            path, *path == '/' && *(path + 1) == '\0' ? "" : "/", name);
+  return file;
+}
+
+#ifdef HAVE_INOTIFY
+static unsigned int
+scanner_watch_lower (scanner_t *scanner, int wd)
+{
+  unsigned int lo = 0, hi = scanner->watches_nb;
+
+  while (lo < hi)
+  {
+    unsigned int mid = (lo + hi) / 2;
+    if (scanner->watches[mid].wd < wd)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+static scanner_watch_t *
+scanner_watch_get (scanner_t *scanner, int wd)
+{
+  unsigned int i = scanner_watch_lower (scanner, wd);
+
+  if (i < scanner->watches_nb && scanner->watches[i].wd == wd)
+    return &scanner->watches[i];
+  return NULL;
+}
+
+/*
+ * Without watch, the directory is scanned again after each timeout
+ * (see scanner_watch_loop).
+ */
+static void
+scanner_unwatched_add (scanner_t *scanner, const char *path, int recursive)
+{
+  char *dup;
+
+  dup = strdup (path);
+  if (!dup)
+    return;
+
+  pthread_mutex_lock (&scanner->watch_mutex);
+
+  if (scanner->unwatched_nb == scanner->unwatched_size)
+  {
+    unsigned int size = scanner->unwatched_size ? 2 * scanner->unwatched_size
+                                                : 64;
+    scanner_job_t *jobs;
+
+    jobs = realloc (scanner->unwatched, size * sizeof (*jobs));
+    if (!jobs)
+    {
+      pthread_mutex_unlock (&scanner->watch_mutex);
+      free (dup);
+      return;
+    }
+
+    scanner->unwatched      = jobs;
+    scanner->unwatched_size = size;
+  }
+
+  scanner->unwatched[scanner->unwatched_nb].path      = dup;
+  scanner->unwatched[scanner->unwatched_nb].recursive = recursive;
+  scanner->unwatched_nb++;
+
+  pthread_mutex_unlock (&scanner->watch_mutex);
+}
+
+static void
+scanner_watch_add (scanner_t *scanner, const char *path, int recursive)
+{
+  int wd;
+  unsigned int i;
+  char *dup;
+
+  wd = inotify_add_watch (scanner->watch_fd, path, SCANNER_WATCH_MASK);
+  if (wd < 0)
+  {
+    if (errno == ENOSPC || errno == ENOMEM)
+      scanner_unwatched_add (scanner, path, recursive);
+    return;
+  }
+
+  dup = strdup (path);
+  if (!dup)
+    goto err;
+
+  pthread_mutex_lock (&scanner->watch_mutex);
+
+  i = scanner_watch_lower (scanner, wd);
+  if (i < scanner->watches_nb && scanner->watches[i].wd == wd)
+    free (scanner->watches[i].path); /* the same directory again */
+  else
+  {
+    if (scanner->watches_nb == scanner->watches_size)
+    {
+      unsigned int size = scanner->watches_size ? 2 * scanner->watches_size
+                                                : 64;
+      scanner_watch_t *watches;
+
+      watches = realloc (scanner->watches, size * sizeof (*watches));
+      if (!watches)
+      {
+        pthread_mutex_unlock (&scanner->watch_mutex);
+        free (dup);
+        goto err;
+      }
+
+      scanner->watches      = watches;
+      scanner->watches_size = size;
+    }
+
+    memmove (scanner->watches + i + 1, scanner->watches + i,
+             (scanner->watches_nb - i) * sizeof (*scanner->watches));
+    scanner->watches_nb++;
+    scanner->watches[i].wd = wd;
+  }
+
+  scanner->watches[i].path      = dup;
+  scanner->watches[i].recursive = recursive;
+
+  pthread_mutex_unlock (&scanner->watch_mutex);
+  return;
+
+ err:
+  inotify_rm_watch (scanner->watch_fd, wd);
+}
+
+/* Remove the watches on a directory and its subdirectories. */
+static void
+scanner_watch_rm (scanner_t *scanner, const char *dir)
+{
+  unsigned int i, j;
+  size_t len = strlen (dir);
+
+  pthread_mutex_lock (&scanner->watch_mutex);
+
+  for (i = j = 0; i < scanner->watches_nb; i++)
+  {
+    const char *path = scanner->watches[i].path;
+
+    if (!strncmp (path, dir, len) && (path[len] == '\0' || path[len] == '/'))
+    {
+      inotify_rm_watch (scanner->watch_fd, scanner->watches[i].wd);
+      free (scanner->watches[i].path);
+      continue;
+    }
+
+    scanner->watches[j++] = scanner->watches[i];
+  }
+  scanner->watches_nb = j;
+
+  pthread_mutex_unlock (&scanner->watch_mutex);
+}
+#endif /* HAVE_INOTIFY */
+
+static void
+scanner_dircache_record (scanner_walker_t *walker,
+                         const char *path, int64_t mtime, int nb_files)
+{
+  scanner_t *scanner = walker->walk->scanner;
+
+  /*
+   * A directory changed in the same second than the beginning of the loop
+   * can be changed again without a different mtime.
+   */
+  if (mtime >= scanner->loop_time)
+    mtime = -1;
+
+  if (vh_dir_list_add (&walker->dirs, path, mtime, nb_files))
+    walker->dirs_err = 1;
+}
+
+/*
+ * Skip a directory if its mtime is the same than in the last complete loop.
+ * The files are already known by the dbmanager, only the subdirectories
+ * are pushed.
+ */
+static int
+scanner_dircache_skip (scanner_walker_t *walker,
+                       const char *path, int64_t mtime, int recursive)
+{
+  scanner_t *scanner = walker->walk->scanner;
+  dir_data_t *dir;
+  char *prefix;
+  size_t len;
+  unsigned int i;
+  dir_list_t *dirs = &scanner->dirs;
+
+  if (mtime < 0)
+    return -1;
+
+  dir = vh_dir_list_get (dirs, path);
+  if (!dir || dir->mtime != mtime)
+    return -1;
+
+  if (dir->nb_files)
+  {
+    char *data = strdup (path);
+    if (!data)
+      return -1;
+
+    vh_dbmanager_action_send (VH_HANDLE->dbmanager,
+                              FIFO_QUEUE_PRIORITY_NORMAL,
+                              ACTION_DB_DIR_CHECKED, data);
+  }
+
+  scanner_dircache_record (walker, path, mtime, dir->nb_files);
+  VH_STATS_COUNTER_INC (scanner->st_dirskip);
+  VH_STATS_COUNTER_ACC (scanner->st_fileskip, dir->nb_files);
+
+  if (!recursive)
+    return 0;
+
+  prefix = scanner_path_new (path, "");
+  if (!prefix)
+  {
+    walker->dirs_err = 1; /* the subdirectories are lost */
+    return 0;
+  }
+
+  /* the subdirectories are just after "path/" in the sorted list */
+  len = strlen (prefix);
+  for (i = vh_dir_list_lower (dirs, prefix);
+       i < dirs->nb && !strncmp (dirs->dirs[i].path, prefix, len); i++)
+  {
+    char *sub;
+
+    if (strchr (dirs->dirs[i].path + len, '/'))
+      continue;
+
+    sub = strdup (dirs->dirs[i].path);
+    if (sub)
+      scanner_walk_push (walker, sub, recursive);
+  }
+
+  free (prefix);
+  return 0;
+}
+
+static void
+scanner_readdir (scanner_walker_t *walker, const char *path, int recursive)
+{
+  DIR *dirp;
+  struct dirent *dp;
+  struct stat st;
+  char *file;
+  unsigned int nb_stat = 0, nb_nostat = 0;
+  int nb_files = 0;
+  int64_t mtime = -1;
+  scanner_t *scanner = walker->walk->scanner;
+#ifdef HAVE_FSTATAT
+  int fd;
+#endif /* HAVE_FSTATAT */
+
+  /* the mtime must be retrieved before reading the entries */
+  if (scanner->dircache)
+  {
+    if (stat (path, &st))
+      return;
+    mtime = st.st_mtime;
+  }
+
+  if (recursive > 0)
+  {
+    recursive--;
+    if (!recursive)
+      vh_log (VALHALLA_MSG_WARNING,
+              "[scanner_thread] Max recursiveness reached : %s", path);
+  }
+
+#ifdef HAVE_INOTIFY
+  /* the watch must be added before reading the entries */
+  if (scanner->watch_fd >= 0)
+    scanner_watch_add (scanner, path, recursive);
+#endif /* HAVE_INOTIFY */
+
+  if (scanner->dircache
+      && !scanner_dircache_skip (walker, path, mtime, recursive))
+    return;
+
+#ifdef HAVE_FSTATAT
+  fd = open (path, O_RDONLY | O_DIRECTORY);
+  if (fd < 0)
+    goto err;
+
+  dirp = fdopendir (fd);
+  if (!dirp)
+  {
+    close (fd);
+    goto err;
+  }
+#else
+  dirp = opendir (path);
+  if (!dirp)
+    goto err;
+#endif /* HAVE_FSTATAT */
+
+  do
+  {
+    dp = readdir (dirp);
+    if (!dp)
+      break;
+
+    if (!strcmp (dp->d_name, ".") || !strcmp (dp->d_name, ".."))
+      continue;
+
+    file = NULL;
+
+#ifdef DT_UNKNOWN
+    /*
+     * The type is often known without stat. Only the regular files accepted
+     * by the suffixes must be stat'ed (for the mtime).
+     */
+    switch (dp->d_type)
+    {
+    case DT_UNKNOWN:
+      break;
+
+    case DT_REG:
+      if (!suffix_cmp (scanner, dp->d_name))
+        break;
+      nb_nostat++;
+      continue;
+
+    case DT_DIR:
+      nb_nostat++;
+      if (recursive)
+        goto dir;
+      continue;
+
+    default: /* symlinks, devices, ... */
+      nb_nostat++;
+      continue;
+    }
+#endif /* DT_UNKNOWN */
+
+    nb_stat++;
+#ifdef HAVE_FSTATAT
+    if (fstatat (fd, dp->d_name, &st, AT_SYMLINK_NOFOLLOW))
+      continue;
+#else
+    file = scanner_path_new (path, dp->d_name);
+    if (!file)
+      continue;
+
+    if (lstat (file, &st))
+    {
+      free (file);
+      continue;
+    }
+#endif /* HAVE_FSTATAT */
+
+    if (S_ISREG (st.st_mode) && !suffix_cmp (scanner, dp->d_name))
+    {
+      file_data_t *data;
+
+      if (!file)
+        file = scanner_path_new (path, dp->d_name);
+      if (!file)
+        continue;
+
+      data = vh_file_data_new (file, &st, 0, OD_TYPE_DEF,
+                               FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
+      if (data)
+      {
+        vh_dbmanager_action_send (VH_HANDLE->dbmanager,
+                                  data->priority, ACTION_DB_NEWFILE, data);
+        walker->files++;
+        nb_files++;
+      }
+    }
+    else if (S_ISDIR (st.st_mode) && recursive)
+      goto dir;
+
+    free (file);
+    continue;
+
+  dir:
+    if (!file)
+      file = scanner_path_new (path, dp->d_name);
+
+    /* the walker (or a thief) will read this directory later */
+    if (file)
+      scanner_walk_push (walker, file, recursive);
+  }
+  while (!scanner_is_stopped (scanner));
+
+  closedir (dirp);
+
+  VH_STATS_COUNTER_ACC (scanner->st_stat,   nb_stat);
+  VH_STATS_COUNTER_ACC (scanner->st_nostat, nb_nostat);
+
+  if (scanner->dircache)
+    scanner_dircache_record (walker, path, mtime, nb_files);
+  return;
+
+ err:
+  /* unreadable, it must be tried again with the next loop */
+  if (scanner->dircache)
+    scanner_dircache_record (walker, path, -1, 0);
+}
+
+static int
+scanner_walk_steal (scanner_walker_t *walker, scanner_job_t *job)
+{
+  unsigned int i;
+  scanner_walk_t *walk = walker->walk;
+
+  for (i = 1; i < walk->nb; i++)
+  {
+    scanner_walker_t *victim = &walk->walker[(walker->id + i) % walk->nb];
+    if (!scanner_deque_pop (&victim->deque, job, 1))
+      return 0;
+  }
+
+  return -1;
+}
+
+static void *
+scanner_walker_thread (void *arg)
+{
+  scanner_walker_t *walker = arg;
+  scanner_walk_t *walk = walker->walk;
+  scanner_t *scanner = walk->scanner;
+  scanner_job_t job;
+  unsigned int gen;
+
+  if (walker->id)
+    vh_setpriority (scanner->priority);
+
+  for (;;)
+  {
+    pthread_mutex_lock (&walk->mutex);
+    gen = walk->gen;
+    pthread_mutex_unlock (&walk->mutex);
+
+    if (!scanner_deque_pop (&walker->deque, &job, 0)
+        || !scanner_walk_steal (walker, &job))
+    {
+      /* the remaining directories are dropped on stop */
+      if (!scanner_is_stopped (scanner))
+        scanner_readdir (walker, job.path, job.recursive);
+      free (job.path);
+      scanner_walk_done (walk);
+      continue;
+    }
+
+    pthread_mutex_lock (&walk->mutex);
+    if (!walk->pending)
+    {
+      pthread_mutex_unlock (&walk->mutex);
+      break;
+    }
+
+    /* nothing to steal, wait for new directories */
+    if (gen == walk->gen)
+    {
+      walk->idle++;
+      pthread_cond_wait (&walk->cond, &walk->mutex);
+      walk->idle--;
+    }
+    pthread_mutex_unlock (&walk->mutex);
+  }
+
+  return NULL;
+}
+
+static void
+scanner_dircache_merge (scanner_t *scanner, scanner_walker_t *walker)
+{
+  dir_list_t *list = &scanner->dirs_new;
+
+  if (walker->dirs_err)
+    scanner->dirs_err = 1;
+
+  if (!walker->dirs.nb)
+    goto out;
+
+  if (list->nb + walker->dirs.nb > list->size)
+  {
+    dir_data_t *dirs;
+
+    dirs = realloc (list->dirs,
+                    (list->nb + walker->dirs.nb) * sizeof (*list->dirs));
+    if (!dirs)
+    {
+      scanner->dirs_err = 1;
+      goto out;
+    }
+
+    list->dirs = dirs;
+    list->size = list->nb + walker->dirs.nb;
+  }
+
+  /* the paths are moved */
+  memcpy (list->dirs + list->nb,
+          walker->dirs.dirs, walker->dirs.nb * sizeof (*list->dirs));
+  list->nb += walker->dirs.nb;
+  walker->dirs.nb = 0;
+
+ out:
+  vh_dir_list_clear (&walker->dirs);
+}
+
+/*
+ * Walk a path with a pool of walkers. The current thread is the first
+ * walker. The number of files sent to the dbmanager is returned.
+ */
+static int
+scanner_walk (scanner_t *scanner, struct path_s *path)
+{
+  unsigned int i, started;
+  int files = 0;
+  char *location;
+  scanner_walk_t walk;
+
+  memset (&walk, 0, sizeof (walk));
+
+  walk.walker = calloc (scanner->nb, sizeof (*walk.walker));
+  if (!walk.walker)
+    return 0;
+
+  walk.scanner = scanner;
+  walk.nb      = scanner->nb;
+  pthread_mutex_init (&walk.mutex, NULL);
+  pthread_cond_init (&walk.cond, NULL);
+
+  for (i = 0; i < walk.nb; i++)
+  {
+    walk.walker[i].walk = &walk;
+    walk.walker[i].id   = i;
+    pthread_mutex_init (&walk.walker[i].deque.mutex, NULL);
+  }
+
+  location = strdup (path->location);
+  if (location)
+    scanner_walk_push (&walk.walker[0], location, path->recursive);
+
+  /* the deques of the walkers not started are always empty */
+  for (started = 1; started < walk.nb; started++)
+    if (pthread_create (&walk.walker[started].thread, NULL,
+                        scanner_walker_thread, &walk.walker[started]))
+      break;
+
+  scanner_walker_thread (&walk.walker[0]);
+
+  for (i = 0; i < started; i++)
+  {
+    if (i)
+      pthread_join (walk.walker[i].thread, NULL);
+    files += walk.walker[i].files;
+  }
+
+  for (i = 0; i < walk.nb; i++)
+  {
+    scanner_dircache_merge (scanner, &walk.walker[i]);
+    free (walk.walker[i].deque.jobs);
+    pthread_mutex_destroy (&walk.walker[i].deque.mutex);
+  }
+
+  pthread_mutex_destroy (&walk.mutex);
+  pthread_cond_destroy (&walk.cond);
+  free (walk.walker);
+
+  return files;
+}
+
+static void
+scanner_dircache_load (scanner_t *scanner)
+{
+  char *sig = NULL;
+  size_t size = 1;
+  char **it;
+
+  /* the cache depends of the suffixes */
+  for (it = scanner->suffix; it && *it; it++)
+    size += strlen (*it) + 1;
+
+  sig = calloc (1, size);
+  if (!sig)
+    return;
+
+  for (it = scanner->suffix; it && *it; it++)
+  {
+    if (it != scanner->suffix)
+      strcat (sig, ",");
+    strcat (sig, *it);
+  }
+
+  vh_dbmanager_db_dir_get (VH_HANDLE->dbmanager, &scanner->dirs, sig);
+  free (sig);
+
+  vh_log (VALHALLA_MSG_INFO,
+          "[%s] %u directories in the cache", __FUNCTION__, scanner->dirs.nb);
+}
+
+/*
+ * Called at the end of a complete loop. The directories of this loop are
+ * used by the next one and saved in the database by the dbmanager.
+ */
+static void
+scanner_dircache_update (scanner_t *scanner)
+{
+  unsigned int i, j;
+  dir_list_t *list;
+
+  vh_dir_list_clear (&scanner->dirs);
+  scanner->dirs = scanner->dirs_new;
+  memset (&scanner->dirs_new, 0, sizeof (scanner->dirs_new));
+
+  /* some entries are missing, all directories must be read again */
+  if (scanner->dirs_err)
+  {
+    vh_dir_list_clear (&scanner->dirs);
+    scanner->dirs_err = 0;
+  }
+
+  vh_dir_list_sort (&scanner->dirs);
+
+  /* the same directory can be reached with two paths */
+  for (i = j = 0; i < scanner->dirs.nb; i++)
+    if (j && !strcmp (scanner->dirs.dirs[j - 1].path,
+                      scanner->dirs.dirs[i].path))
+      free (scanner->dirs.dirs[i].path);
+    else
+      scanner->dirs.dirs[j++] = scanner->dirs.dirs[i];
+  scanner->dirs.nb = j;
+
+  list = calloc (1, sizeof (*list));
+  if (!list)
+    return;
+
+  for (i = 0; i < scanner->dirs.nb; i++)
+    if (vh_dir_list_add (list, scanner->dirs.dirs[i].path,
+                         scanner->dirs.dirs[i].mtime,
+                         scanner->dirs.dirs[i].nb_files))
+    {
+      vh_dir_list_free (list);
+      return;
+    }
+
+  /* high priority in order to be handled before the end of the dbmanager */
+  vh_dbmanager_action_send (VH_HANDLE->dbmanager,
+                            FIFO_QUEUE_PRIORITY_HIGH, ACTION_DB_DIRS, list);
+}
+
+/* Only a part of the paths is walked, the cache is not changed. */
+static void
+scanner_dircache_drop (scanner_t *scanner)
+{
+  vh_dir_list_clear (&scanner->dirs_new);
+  scanner->dirs_err = 0;
+}
+
+/*
+ * Walk the paths and wait until that all files are parsed and inserted in
+ * the database (wait all ACKs). The files already sent by the watch mode
+ * are waited too. The cache of the directories is updated only when all
+ * paths are walked.
+ */
+static int
+scanner_loop (scanner_t *scanner, struct path_s *paths)
+{
+  int files = 0;
+  struct path_s *path;
+
+  vh_event_handler_gl_send (VH_HANDLE->event_handler,
+                            VALHALLA_EVENTGL_SCANNER_BEGIN);
+
+  scanner->loop_time = time (NULL);
+
+  for (path = paths; path; path = path->next)
+  {
+    vh_log (VALHALLA_MSG_INFO,
+            "[%s] Start scanning : %s", __FUNCTION__, path->location);
+
+    path->nb_files = scanner_walk (scanner, path);
+    files += path->nb_files;
+
+    vh_log (VALHALLA_MSG_INFO,
+            "[%s] End scanning   : %i files", __FUNCTION__, path->nb_files);
+  }
+
+  vh_event_handler_gl_send (VH_HANDLE->event_handler,
+                            VALHALLA_EVENTGL_SCANNER_END);
+
+#ifdef HAVE_INOTIFY
+  files += scanner->watch_pending;
+  scanner->watch_pending = 0;
+#endif /* HAVE_INOTIFY */
+
+  while (files > 0)
+  {
+    int e;
+    void *data = NULL;
+
+    vh_fifo_queue_pop (scanner->fifo, &e, &data);
+    if (e == ACTION_ACKNOWLEDGE)
+      files -= VH_ACK_NB (data);
+
+    if (scanner_is_stopped (scanner))
+      return -1;
+  }
+
+  vh_event_handler_gl_send (VH_HANDLE->event_handler,
+                            VALHALLA_EVENTGL_SCANNER_ACKS);
+
+  if (scanner->dircache)
+  {
+    if (paths == scanner->paths)
+      scanner_dircache_update (scanner);
+    else
+      scanner_dircache_drop (scanner);
+  }
+
+  return 0;
+}
+
+static void
+scanner_next_loop (scanner_t *scanner)
+{
+  vh_dbmanager_action_send (VH_HANDLE->dbmanager,
+                            FIFO_QUEUE_PRIORITY_NORMAL,
+                            ACTION_DB_NEXT_LOOP, NULL);
+  vh_event_handler_gl_send (VH_HANDLE->event_handler,
+                            VALHALLA_EVENTGL_SCANNER_SLEEP);
+}
+
+#ifdef HAVE_INOTIFY
+static int
+scanner_job_cmp (const void *a, const void *b)
 {
-  char *it;
-  struct path_s *path;
+  return strcmp (((const scanner_job_t *) a)->path,
+                 ((const scanner_job_t *) b)->path);
+}
 
-  if (!location)
+/*
+ * Get the directories which can not be watched. A directory is dropped
+ * when one of its parents is already in the list (recursively).
+ */
+static struct path_s *
+scanner_unwatched_get (scanner_t *scanner)
+{
+  unsigned int i, nb;
+  scanner_job_t *jobs;
+  struct path_s *paths = NULL;
+
+  pthread_mutex_lock (&scanner->watch_mutex);
+  jobs = scanner->unwatched;
+  nb   = scanner->unwatched_nb;
+  scanner->unwatched      = NULL;
+  scanner->unwatched_nb   = 0;
+  scanner->unwatched_size = 0;
+  pthread_mutex_unlock (&scanner->watch_mutex);
+
+  if (!jobs)
     return NULL;
 
-  path = calloc (1, sizeof (struct path_s));
-  if (!path)
-    return NULL;
+  qsort (jobs, nb, sizeof (*jobs), scanner_job_cmp);
 
-  path->location = strdup (location);
-  it = strrchr (path->location, '/');
-  if (it && it != path->location && *(it + 1) == '\0')
-    *it = '\0';
+  for (i = 0; i < nb; i++)
+  {
+    char *it, *tmp;
+    int skip = 0;
+    struct path_s *path;
 
-  path->recursive = recursive ? PATH_RECURSIVENESS_MAX : 0;
-  return path;
-}
+    if (i && !strcmp (jobs[i - 1].path, jobs[i].path))
+      continue;
 
-static int
-path_cmp (struct path_s *path, const char *file)
-{
-  for (; path; path = path->next)
-    if (strstr (file, path->location) == file)
-    {
-      int sf = 0;
-      const char *it;
+    tmp = strdup (jobs[i].path);
+    if (!tmp)
+      continue;
 
-      if (!path->recursive)
-        return -1;
+    for (it = strchr (tmp + 1, '/'); it && !skip; it = strchr (it + 1, '/'))
+    {
+      scanner_job_t key, *res;
+
+      *it = '\0';
+      key.path = tmp;
+      res = bsearch (&key, jobs, nb, sizeof (*jobs), scanner_job_cmp);
+      if (res && res->recursive)
+        skip = 1;
+      *it = '/';
+    }
 
-      it = file + strlen (path->location);
-      while ((it = strchr (it, '/')))
-      {
-        it++;
-        sf++;
-      }
+    if (skip)
+    {
+      free (tmp);
+      continue;
+    }
 
-      if (path->recursive < sf)
-        return -1;
-      return 0;
+    path = calloc (1, sizeof (*path));
+    if (!path)
+    {
+      free (tmp);
+      continue;
     }
 
-  return -1;
+    path->location  = tmp;
+    path->recursive = jobs[i].recursive;
+    path->next      = paths;
+    paths = path;
+  }
+
+  for (i = 0; i < nb; i++)
+    free (jobs[i].path);
+  free (jobs);
+
+  return paths;
 }
 
+/*
+ * Handle an event of inotify. The new or modified files are sent to the
+ * dbmanager like with a loop, the deleted (or renamed) files and
+ * directories are removed from the database. -1 is returned when all
+ * paths must be scanned again.
+ */
 static int
-suffix_cmp (char **suffix, const char *file)
+scanner_watch_event (scanner_t *scanner,
+                     const struct inotify_event *ev, int *dirty)
 {
-  const char *it;
+  scanner_watch_t *watch;
+  char *file = NULL;
+  int recursive;
 
-  if (!file)
+  if (ev->mask & IN_Q_OVERFLOW)
+  {
+    vh_log (VALHALLA_MSG_WARNING,
+            "[%s] Events lost, all paths will be scanned again", __FUNCTION__);
     return -1;
+  }
+
+  pthread_mutex_lock (&scanner->watch_mutex);
+
+  watch = scanner_watch_get (scanner, ev->wd);
+  if (watch && ev->mask & IN_IGNORED)
+  {
+    /* the directory is no longer watched (removed, unmounted, ...) */
+    free (watch->path);
+    memmove (watch, watch + 1, (scanner->watches + scanner->watches_nb
+                                - watch - 1) * sizeof (*watch));
+    scanner->watches_nb--;
+  }
+  else if (watch && ev->len)
+    file = scanner_path_new (watch->path, ev->name);
+  recursive = watch ? watch->recursive : 0;
 
-  if (!suffix) /* always accepted */
+  pthread_mutex_unlock (&scanner->watch_mutex);
+
+  if (!file)
     return 0;
 
-  for (; *suffix; suffix++)
+  VH_STATS_COUNTER_INC (scanner->st_watch);
+
+  if (ev->mask & IN_ISDIR)
   {
-    it = vh_strrcasestr (file, *suffix);
-    if (it && (it > file)
-        && *(it + strlen (*suffix)) == '\0' && *(it - 1) == '.')
+    if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+    {
+      scanner_watch_rm (scanner, file);
+      vh_dbmanager_action_send (VH_HANDLE->dbmanager,
+                                FIFO_QUEUE_PRIORITY_NORMAL,
+                                ACTION_DB_DELDIR, file);
+      *dirty = 1;
       return 0;
+    }
+
+    /* new directory, it is walked like a path */
+    if (recursive && ev->mask & (IN_CREATE | IN_MOVED_TO))
+    {
+      int files;
+      struct path_s path;
+
+      memset (&path, 0, sizeof (path));
+      path.location  = file;
+      path.recursive = recursive;
+      files = scanner_walk (scanner, &path);
+      if (files)
+      {
+        scanner->watch_pending += files;
+        *dirty = 1;
+      }
+
+      if (scanner->dircache)
+        scanner_dircache_drop (scanner);
+    }
+  }
+  else if (suffix_cmp (scanner, ev->name))
+    ;
+  else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+  {
+    vh_dbmanager_action_send (VH_HANDLE->dbmanager,
+                              FIFO_QUEUE_PRIORITY_NORMAL,
+                              ACTION_DB_DELFILE, file);
+    *dirty = 1;
+    return 0;
   }
+  /* IN_CREATE is ignored, IN_CLOSE_WRITE follows */
+  else if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+  {
+    struct stat st;
+    file_data_t *data;
 
-  return -1;
+    if (!lstat (file, &st) && S_ISREG (st.st_mode))
+    {
+      data = vh_file_data_new (file, &st, 0, OD_TYPE_DEF,
+                               FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
+      if (data)
+      {
+        vh_dbmanager_action_send (VH_HANDLE->dbmanager,
+                                  data->priority, ACTION_DB_NEWFILE, data);
+        scanner->watch_pending++;
+        *dirty = 1;
+      }
+    }
+  }
+
+  free (file);
+  return 0;
 }
 
-static inline int
-scanner_is_stopped (scanner_t *scanner)
+static uint64_t
+scanner_watch_clock (void)
 {
-  int run;
-  pthread_mutex_lock (&scanner->mutex_run);
-  run = scanner->run;
-  pthread_mutex_unlock (&scanner->mutex_run);
-  return !run;
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
+/*
+ * Wait for the events of inotify until the scanner is stopped. The
+ * directories which can not be watched are scanned again after each
+ * timeout. When all files are handled (all ACKs), the changes are
+ * committed.
+ */
 static void
-scanner_readdir (scanner_t *scanner,
-                 const char *path, const char *dir, int recursive, int *files)
+scanner_watch_loop (scanner_t *scanner)
 {
-  DIR *dirp;
-  struct dirent *dp;
-  struct stat st;
-  char *file;
-  char *new_path;
-  size_t size;
+  int dirty = 0;
+  uint64_t next = scanner_watch_clock () + scanner->timeout;
+  char buf[4096]
+    __attribute__ ((aligned (__alignof__ (struct inotify_event))));
 
-  if (!scanner || !path)
-    return;
+  vh_log (VALHALLA_MSG_INFO,
+          "[%s] Watch mode : %u directories watched",
+          __FUNCTION__, scanner->watches_nb);
 
-  if (dir)
+  for (;;)
   {
-    size_t size = strlen (path) + strlen (dir) + 2;
-    new_path = malloc (size);
-    if (!new_path)
-      return;
+    int e, rescan = 0, timeout = -1;
+    void *data = NULL;
+    ssize_t len;
+    struct pollfd fds[2];
+    struct path_s *paths = NULL;
 
-    snprintf (new_path, size, "%s%s%s",
-              path, *path == '/' && *(path + 1) == '\0' ? "" : "/", dir);
-  }
-  else
-    new_path = strdup (path);
+    if (dirty && !scanner->watch_pending)
+    {
+      vh_dbmanager_action_send (VH_HANDLE->dbmanager,
+                                FIFO_QUEUE_PRIORITY_NORMAL,
+                                ACTION_DB_COMMIT, NULL);
+      dirty = 0;
+    }
 
-  dirp = opendir (new_path);
-  if (!dirp)
-  {
-    free (new_path);
-    return;
-  }
+    /* the ACKs can not be polled */
+    if (scanner->watch_pending)
+      timeout = 100;
+    else if (scanner->timeout)
+    {
+      uint64_t now = scanner_watch_clock ();
+      timeout = next > now ? (int) ((next - now) / 1000000) + 1 : 0;
+    }
 
-  if (recursive > 0)
-  {
-    recursive--;
-    if (!recursive)
-      vh_log (VALHALLA_MSG_WARNING,
-              "[scanner_thread] Max recursiveness reached : %s", new_path);
-  }
+    fds[0].fd     = scanner->watch_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = scanner->watch_pipe[0];
+    fds[1].events = POLLIN;
 
-  do
-  {
-    dp = readdir (dirp);
-    if (!dp)
+    if (poll (fds, 2, timeout) < 0 && errno != EINTR)
+    {
+      vh_log (VALHALLA_MSG_ERROR, "[%s] poll failed", __FUNCTION__);
       break;
+    }
 
-    if (!strcmp (dp->d_name, ".") || !strcmp (dp->d_name, ".."))
-      continue;
-
-    size = strlen (new_path) + strlen (dp->d_name) + 2;
-
-    file = malloc (size);
-    if (!file)
-      continue;
+    if (scanner_is_stopped (scanner))
+      break;
 
-    snprintf (file, size, "%s/%s", new_path, dp->d_name);
-    if (lstat (file, &st))
+    /* vh_scanner_wakeup() */
+    if (fds[1].revents & POLLIN)
     {
-      free (file);
-      continue;
+      while (read (scanner->watch_pipe[0], buf, sizeof (buf)) > 0)
+        ;
+      rescan = 1;
     }
 
-    if (S_ISREG (st.st_mode) && !suffix_cmp (scanner->suffix, dp->d_name))
-    {
-      file_data_t *data;
+    if (fds[0].revents & POLLIN)
+      while ((len = read (scanner->watch_fd, buf, sizeof (buf))) > 0)
+      {
+        const char *it;
+        const struct inotify_event *ev;
+
+        for (it = buf; it < buf + len; it += sizeof (*ev) + ev->len)
+        {
+          ev = (const struct inotify_event *) it;
+          if (scanner_watch_event (scanner, ev, &dirty))
+            rescan = 1;
+        }
+      }
 
-      data = vh_file_data_new (file, &st, 0, OD_TYPE_DEF,
-                               FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
-      if (data)
+    while (!vh_fifo_queue_trypop (scanner->fifo, &e, &data))
+      if (e == ACTION_ACKNOWLEDGE)
       {
-        vh_dbmanager_action_send (VH_HANDLE->dbmanager,
-                                  data->priority, ACTION_DB_NEWFILE, data);
-        (*files)++;
+        scanner->watch_pending -= VH_ACK_NB (data);
+        if (scanner->watch_pending < 0)
+          scanner->watch_pending = 0;
       }
+
+    if (rescan)
+      paths = scanner->paths;
+    else if (scanner->timeout && scanner_watch_clock () >= next)
+      paths = scanner_unwatched_get (scanner);
+    else
+      continue;
+
+    if (paths)
+    {
+      int res = scanner_loop (scanner, paths);
+
+      if (paths != scanner->paths)
+        path_free (paths);
+      if (res)
+        break;
+
+      /* the deleted files are detected by the dbmanager */
+      scanner_next_loop (scanner);
+      dirty = 0;
     }
-    else if (S_ISDIR (st.st_mode) && recursive)
-      scanner_readdir (scanner, new_path, dp->d_name, recursive, files);
 
-    free (file);
+    next = scanner_watch_clock () + scanner->timeout;
   }
-  while (!scanner_is_stopped (scanner));
+}
 
-  closedir (dirp);
-  free (new_path);
+static int
+scanner_watch_init (scanner_t *scanner)
+{
+  scanner->watch_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  if (scanner->watch_fd < 0)
+    return -1;
+
+  if (pipe2 (scanner->watch_pipe, O_NONBLOCK | O_CLOEXEC))
+  {
+    close (scanner->watch_fd);
+    scanner->watch_fd = -1;
+    return -1;
+  }
+
+  return 0;
+}
+
+static void
+scanner_watch_wakeup (scanner_t *scanner)
+{
+  /* if the pipe is full, the watch loop is already woken up */
+  if (write (scanner->watch_pipe[1], "w", 1) < 0)
+    return;
 }
+#endif /* HAVE_INOTIFY */
 
 static void *
 scanner_thread (void *arg)
 {
   int i, tid;
   scanner_t *scanner = arg;
-  struct path_s *path;
 
   if (!scanner)
     pthread_exit (NULL);
@@ -285,58 +1561,19 @@ scanner_thread (void *arg)
       goto kill;
   }
 
+  if (scanner->dircache)
+    scanner_dircache_load (scanner);
+
   for (i = scanner->loop; i; i = i > 0 ? i - 1 : i)
   {
-    vh_event_handler_gl_send (VH_HANDLE->event_handler,
-                              VALHALLA_EVENTGL_SCANNER_BEGIN);
-
-    for (path = scanner->paths; path; path = path->next)
-    {
-      vh_log (VALHALLA_MSG_INFO,
-              "[%s] Start scanning : %s", __FUNCTION__, path->location);
-
-      path->nb_files = 0;
-      scanner_readdir (scanner,
-                       path->location, NULL, path->recursive, &path->nb_files);
-
-      vh_log (VALHALLA_MSG_INFO,
-              "[%s] End scanning   : %i files", __FUNCTION__, path->nb_files);
-    }
-
-    vh_event_handler_gl_send (VH_HANDLE->event_handler,
-                              VALHALLA_EVENTGL_SCANNER_END);
-
-    /*
-     * Wait until that all files are parsed and inserted in the database
-     * for each path (wait all ACKs).
-     */
-    for (path = scanner->paths; path; path = path->next)
-    {
-      int files = path->nb_files;
-      while (files)
-      {
-        int e;
-        vh_fifo_queue_pop (scanner->fifo, &e, NULL);
-        if (e == ACTION_ACKNOWLEDGE)
-          files--;
-
-        if (scanner_is_stopped (scanner))
-          goto kill;
-      }
-    }
-
-    vh_event_handler_gl_send (VH_HANDLE->event_handler,
-                              VALHALLA_EVENTGL_SCANNER_ACKS);
+    if (scanner_loop (scanner, scanner->paths))
+      goto kill;
 
-    /* It is not the last loop ?  */
-    if (i != 1)
+    /* It is not the last loop ? (the watch mode begins after the first) */
+    if (i != 1 || scanner->watch)
     {
-      vh_dbmanager_action_send (VH_HANDLE->dbmanager,
-                                FIFO_QUEUE_PRIORITY_NORMAL,
-                                ACTION_DB_NEXT_LOOP, NULL);
-      vh_event_handler_gl_send (VH_HANDLE->event_handler,
-                                VALHALLA_EVENTGL_SCANNER_SLEEP);
-      if (scanner->timeout)
+      scanner_next_loop (scanner);
+      if (scanner->timeout && !scanner->watch)
         vh_timer_thread_sleep (scanner->timer, scanner->timeout);
     }
 
@@ -344,6 +1581,14 @@ scanner_thread (void *arg)
       goto kill;
   }
 
+#ifdef HAVE_INOTIFY
+  if (scanner->watch)
+  {
+    scanner_watch_loop (scanner);
+    goto kill;
+  }
+#endif /* HAVE_INOTIFY */
+
   vh_event_handler_gl_send (VH_HANDLE->event_handler,
                             VALHALLA_EVENTGL_SCANNER_EXIT);
 
@@ -359,6 +1604,14 @@ vh_scanner_wakeup (scanner_t *scanner)
   if (!scanner)
     return;
 
+#ifdef HAVE_INOTIFY
+  if (scanner->watch)
+  {
+    scanner_watch_wakeup (scanner);
+    return;
+  }
+#endif /* HAVE_INOTIFY */
+
   vh_timer_thread_wakeup (scanner->timer);
 }
 
@@ -390,6 +1643,22 @@ vh_scanner_run (scanner_t *scanner,
   /* -1 for infinite loop */
   scanner->loop = loop < 1 ? -1 : loop;
 
+  if (scanner->watch)
+  {
+#ifdef HAVE_INOTIFY
+    /* only the first loop, then the changes are watched */
+    if (!scanner_watch_init (scanner))
+      scanner->loop = 1;
+    else
+#endif /* HAVE_INOTIFY */
+    {
+      vh_log (VALHALLA_MSG_WARNING,
+              "[%s] inotify is not available, watch mode disabled",
+              __FUNCTION__);
+      scanner->watch = 0;
+    }
+  }
+
   scanner->priority = priority;
   scanner->run      = 1;
 
@@ -449,6 +1718,10 @@ vh_scanner_stop (scanner_t *scanner, int f)
                         FIFO_QUEUE_PRIORITY_HIGH, ACTION_KILL_THREAD, NULL);
     scanner->wait = 1;
     vh_timer_thread_stop (scanner->timer);
+#ifdef HAVE_INOTIFY
+    if (scanner->watch)
+      scanner_watch_wakeup (scanner);
+#endif /* HAVE_INOTIFY */
   }
 
   if (f & STOP_FLAG_WAIT && scanner->wait)
@@ -479,6 +1752,30 @@ vh_scanner_uninit (scanner_t *scanner)
     free (scanner->suffix);
   }
 
+  scanner_suffixes_free (&scanner->suffixes);
+
+  vh_dir_list_clear (&scanner->dirs);
+  vh_dir_list_clear (&scanner->dirs_new);
+
+#ifdef HAVE_INOTIFY
+  if (scanner->watch_fd >= 0)
+  {
+    close (scanner->watch_fd);
+    close (scanner->watch_pipe[0]);
+    close (scanner->watch_pipe[1]);
+  }
+
+  while (scanner->watches_nb)
+    free (scanner->watches[--scanner->watches_nb].path);
+  free (scanner->watches);
+
+  while (scanner->unwatched_nb)
+    free (scanner->unwatched[--scanner->unwatched_nb].path);
+  free (scanner->unwatched);
+
+  pthread_mutex_destroy (&scanner->watch_mutex);
+#endif /* HAVE_INOTIFY */
+
   vh_fifo_queue_free (scanner->fifo);
   pthread_mutex_destroy (&scanner->mutex_run);
 
@@ -531,24 +1828,22 @@ vh_scanner_suffix_cmp (scanner_t *scanner, const char *file)
   if (!scanner)
     return -1;
 
-  return suffix_cmp (scanner->suffix, file);
+  return suffix_cmp (scanner, file);
 }
 
 void
 vh_scanner_suffix_add (scanner_t *scanner, const char *suffix)
 {
   int n;
-  char *const *it;
 
   vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
 
-  if (!scanner)
+  if (!scanner || !suffix)
     return;
 
   /* check if the suffix is already in the list */
-  for (it = scanner->suffix; it && *it; it++)
-    if (!strcasecmp (*it, suffix))
-      return;
+  if (scanner_suffixes_add (&scanner->suffixes, suffix))
+    return;
 
   n = vh_get_list_length (scanner->suffix) + 1;
 
@@ -561,8 +1856,54 @@ vh_scanner_suffix_add (scanner_t *scanner, const char *suffix)
   scanner->suffix[n - 1] = strdup (suffix);
 }
 
+void
+vh_scanner_dircache_set (scanner_t *scanner, int enable)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!scanner)
+    return;
+
+  scanner->dircache = !!enable;
+}
+
+void
+vh_scanner_watch_set (scanner_t *scanner, int enable)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!scanner)
+    return;
+
+  scanner->watch = !!enable;
+}
+
+static void
+scanner_stats_dump (vh_stats_t *stats, void *data)
+{
+  scanner_t *scanner = data;
+
+  if (!stats || !scanner)
+    return;
+
+  vh_log (VALHALLA_MSG_INFO, "==============================");
+  vh_log (VALHALLA_MSG_INFO, "Statistics dump (" STATS_GROUP ")");
+  vh_log (VALHALLA_MSG_INFO, "~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+
+  vh_log (VALHALLA_MSG_INFO, "Stat calls          | %"PRIu64,
+          vh_stats_counter_read (scanner->st_stat));
+  vh_log (VALHALLA_MSG_INFO, "Stat calls avoided  | %"PRIu64,
+          vh_stats_counter_read (scanner->st_nostat));
+  vh_log (VALHALLA_MSG_INFO, "Dirs skipped        | %"PRIu64,
+          vh_stats_counter_read (scanner->st_dirskip));
+  vh_log (VALHALLA_MSG_INFO, "Files skipped       | %"PRIu64,
+          vh_stats_counter_read (scanner->st_fileskip));
+  vh_log (VALHALLA_MSG_INFO, "Watch events        | %"PRIu64,
+          vh_stats_counter_read (scanner->st_watch));
+}
+
 scanner_t *
-vh_scanner_init (valhalla_t *handle)
+vh_scanner_init (valhalla_t *handle, unsigned int nb)
 {
   scanner_t *scanner;
 
@@ -575,6 +1916,14 @@ vh_scanner_init (valhalla_t *handle)
   if (!scanner)
     return NULL;
 
+#ifdef HAVE_INOTIFY
+  scanner->watch_fd = -1;
+  pthread_mutex_init (&scanner->watch_mutex, NULL);
+#endif /* HAVE_INOTIFY */
+
+  if (nb > SCANNER_NB_MAX)
+    goto err;
+
   scanner->fifo = vh_fifo_queue_new ();
   if (!scanner->fifo)
     goto err;
@@ -584,9 +1933,23 @@ vh_scanner_init (valhalla_t *handle)
     goto err;
 
   scanner->valhalla = handle; /* VH_HANDLE */
+  scanner->nb       = nb ? nb : SCANNER_NUMBER_DEF;
 
   pthread_mutex_init (&scanner->mutex_run, NULL);
 
+  /* init statistics */
+  vh_stats_grp_add (handle->stats, STATS_GROUP, scanner_stats_dump, scanner);
+  scanner->st_stat =
+    vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_STAT,     NULL);
+  scanner->st_nostat =
+    vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_NOSTAT,   NULL);
+  scanner->st_dirskip =
+    vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_DIRSKIP,  NULL);
+  scanner->st_fileskip =
+    vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_FILESKIP, NULL);
+  scanner->st_watch =
+    vh_stats_grp_counter_add (handle->stats, STATS_GROUP, STATS_WATCH,    NULL);
+
   return scanner;
 
  err:
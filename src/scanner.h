@@ -33,6 +33,8 @@ enum scanner_errno {
   SCANNER_SUCCESS       =  0,
 };
 
+#define SCANNER_NUMBER_DEF 1
+
 
 void vh_scanner_wakeup (scanner_t *scanner);
 int vh_scanner_run (scanner_t *scanner,
@@ -41,13 +43,15 @@ void vh_scanner_wait (scanner_t *scanner);
 fifo_queue_t *vh_scanner_fifo_get (scanner_t *scanner);
 void vh_scanner_stop (scanner_t *scanner, int f);
 void vh_scanner_uninit (scanner_t *scanner);
-scanner_t *vh_scanner_init (valhalla_t *handle);
+scanner_t *vh_scanner_init (valhalla_t *handle, unsigned int nb);
 
 int vh_scanner_path_cmp (scanner_t *scanner, const char *file);
 void vh_scanner_path_add (scanner_t *scanner,
                           const char *location, int recursive);
 int vh_scanner_suffix_cmp (scanner_t *scanner, const char *file);
 void vh_scanner_suffix_add (scanner_t *scanner, const char *suffix);
+void vh_scanner_dircache_set (scanner_t *scanner, int enable);
+void vh_scanner_watch_set (scanner_t *scanner, int enable);
 
 void vh_scanner_action_send (scanner_t *scanner,
                              fifo_queue_prio_t prio, int action, void *data);
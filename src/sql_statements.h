@@ -22,23 +22,6 @@
 #ifndef VALHALLA_SQL_STATEMENTS_H
 #define VALHALLA_SQL_STATEMENTS_H
 
-/*
- * PRIi64 is replaced by I64i with inttypes.h provided by MinGW. These SQL
- * statements are built with sqlite3_snprintf() [1]. This one does not use
- * the functions from MSVC, then I64i is not known by SQLite.
- *
- * Note that %lli is supported only by sqlite3_snprintf(). With the *printf
- * functions of MSVC, %ll is considered like %l. It is for this reason that
- * MinGW uses %I64i instead of %lli in inttypes.h.
- *
- * [1]: see SQL_CONCAT() in database.c
- */
-#ifdef _WIN32
-#define VH_I64 "lli"
-#else /* _WIN32 */
-#define VH_I64 PRIi64
-#endif /* !_WIN32 */
-
 /******************************************************************************/
 /*                                                                            */
 /*                                 Controls                                   */
@@ -139,6 +122,51 @@
    "PRIMARY KEY (file_id, grabber_id) "                   \
  ");"
 
+#define CREATE_TABLE_DIR                                  \
+ "CREATE TABLE IF NOT EXISTS dir ( "                      \
+   "dir_id           INTEGER PRIMARY KEY AUTOINCREMENT, " \
+   "dir_path         TEXT    NOT NULL UNIQUE, "           \
+   "dir_mtime        INTEGER NOT NULL, "                  \
+   "dir_nb           INTEGER NOT NULL "                   \
+ ");"
+
+/*
+ * Ids which can be unused after a delete, see the cleanup triggers. They are
+ * in the database (and not in memory) in order to survive to a restart.
+ */
+#define CREATE_TABLE_CLEANUP_FILE                         \
+ "CREATE TABLE IF NOT EXISTS cleanup_file ( "             \
+   "file_id          INTEGER PRIMARY KEY "                \
+ ");"
+
+#define CREATE_TABLE_CLEANUP_META                         \
+ "CREATE TABLE IF NOT EXISTS cleanup_meta ( "             \
+   "meta_id          INTEGER PRIMARY KEY "                \
+ ");"
+
+#define CREATE_TABLE_CLEANUP_DATA                         \
+ "CREATE TABLE IF NOT EXISTS cleanup_data ( "             \
+   "data_id          INTEGER PRIMARY KEY "                \
+ ");"
+
+#define CREATE_TABLE_CLEANUP_GRABBER                      \
+ "CREATE TABLE IF NOT EXISTS cleanup_grabber ( "          \
+   "grabber_id       INTEGER PRIMARY KEY "                \
+ ");"
+
+/*
+ * Full-text index (FTS5) of the values of some metadata (titles, ...). The
+ * rowid is the data_id. The prefixes of 1 to 3 characters are indexed for
+ * the searches while typing.
+ */
+#define CREATE_TABLE_DATA_FTS                             \
+ "CREATE VIRTUAL TABLE IF NOT EXISTS data_fts "           \
+ "USING fts5 ( "                                          \
+   "data_value, "                                         \
+   "prefix = '1 2 3', "                                   \
+   "tokenize = 'unicode61 remove_diacritics 2' "          \
+ ");"
+
 /******************************************************************************/
 /*                                                                            */
 /*                              Create indexes                                */
@@ -157,9 +185,28 @@
  "CREATE INDEX IF NOT EXISTS "    \
  "outofpath_idx ON file (outofpath__);"
 
-#define CREATE_INDEX_ASSOC        \
+/*
+ * Covering index for the sets of files of the restrictions, see
+ * SELECT_LIST_SET. The priority is only read in the index.
+ */
+#define CREATE_INDEX_ASSOC                    \
+ "CREATE INDEX IF NOT EXISTS "                \
+ "assoc_file_idx ON assoc_file_metadata "     \
+ "(meta_id, data_id, file_id, priority__);"
+
+/* The previous index (meta_id, data_id) is a prefix of assoc_file_idx. */
+#define DROP_INDEX_ASSOC          \
+ "DROP INDEX IF EXISTS assoc_idx;"
+
+/* Used by the cleanup and by the pages of metadata (sorted by data). */
+#define CREATE_INDEX_ASSOC_DATA   \
  "CREATE INDEX IF NOT EXISTS "    \
- "assoc_idx ON assoc_file_metadata (meta_id, data_id);"
+ "assoc_data_meta_idx ON assoc_file_metadata (data_id, meta_id);"
+
+/* Used by the cleanup of the grabbers, the key begins with the file_id. */
+#define CREATE_INDEX_ASSOC_GRABBER \
+ "CREATE INDEX IF NOT EXISTS "     \
+ "assoc_grabber_idx ON assoc_file_grabber (grabber_id);"
 
 #define CREATE_INDEX_FK_FILE      \
  "CREATE INDEX IF NOT EXISTS "    \
@@ -169,6 +216,40 @@
  "CREATE INDEX IF NOT EXISTS "    \
  "grp_fk_idx ON assoc_file_metadata (_grp_id);"
 
+/******************************************************************************/
+/*                                                                            */
+/*                              Create triggers                               */
+/*                                                                            */
+/******************************************************************************/
+
+/*
+ * The triggers are temporary (only for this connection), then the database
+ * can still be used by an other program.
+ */
+
+#define CREATE_TRIGGER_CLEANUP_FILE                          \
+ "CREATE TEMP TRIGGER IF NOT EXISTS cleanup_file_trg "      \
+ "AFTER DELETE ON main.file "                               \
+ "BEGIN "                                                   \
+   "INSERT OR IGNORE INTO cleanup_file VALUES (OLD.file_id); " \
+ "END;"
+
+#define CREATE_TRIGGER_CLEANUP_ASSOC_FILE_METADATA           \
+ "CREATE TEMP TRIGGER IF NOT EXISTS cleanup_assoc_md_trg "  \
+ "AFTER DELETE ON main.assoc_file_metadata "                \
+ "BEGIN "                                                   \
+   "INSERT OR IGNORE INTO cleanup_meta VALUES (OLD.meta_id); " \
+   "INSERT OR IGNORE INTO cleanup_data VALUES (OLD.data_id); " \
+ "END;"
+
+#define CREATE_TRIGGER_CLEANUP_ASSOC_FILE_GRABBER            \
+ "CREATE TEMP TRIGGER IF NOT EXISTS cleanup_assoc_gr_trg "  \
+ "AFTER DELETE ON main.assoc_file_grabber "                 \
+ "BEGIN "                                                   \
+   "INSERT OR IGNORE INTO cleanup_grabber "                 \
+   "VALUES (OLD.grabber_id); "                              \
+ "END;"
+
 /******************************************************************************/
 /*                                                                            */
 /*                                 Updater                                    */
@@ -212,9 +293,37 @@
  "ORDER BY assoc.priority__;"
 
 #define SELECT_FILE_WHERE_FILE_ID \
- "file.file_id = %"VH_I64" "
+ "file.file_id = ?%u "
 #define SELECT_FILE_WHERE_FILE_PATH \
- "file.file_path = '%q' "
+ "file.file_path = ?%u "
+
+/* Files selection (metadata of several files) */
+
+#define SELECT_FILES_FROM                                              \
+ "SELECT file.file_id, assoc._grp_id, "                                \
+        "meta.meta_id, data.data_id, "                                 \
+        "meta.meta_name, data.data_value, "                            \
+        "data._lang_id, assoc.external, file.file_path "               \
+ "FROM (( "                                                            \
+     "file INNER JOIN assoc_file_metadata AS assoc "                   \
+     "ON file.file_id = assoc.file_id "                                \
+   ") INNER JOIN data "                                                \
+   "ON data.data_id = assoc.data_id "                                  \
+ ") INNER JOIN meta "                                                  \
+ "ON assoc.meta_id = meta.meta_id "
+
+/* The rows of a file are consecutive. */
+#define SELECT_FILES_END \
+ "ORDER BY file.file_id, assoc.priority__;"
+
+#define SELECT_FILES_WHERE_FILE_IN \
+ "file.file_id IN ( "
+#define SELECT_FILES_WHERE_META_IN \
+ "meta.meta_name IN ( "
+#define SELECT_FILES_VALUE \
+ "?%u "
+#define SELECT_FILES_VALUE_NEXT \
+ ", "
 
 /* File list selection */
 
@@ -225,8 +334,18 @@
 #define SELECT_LIST_FILE_END \
  "ORDER BY file_id;"
 
+/* Keyset pagination, %s is '>' or '<' (ASC or DESC). */
+#define SELECT_LIST_FILE_KEY_VALUE \
+ "file_path %s ?%u "
+#define SELECT_LIST_FILE_KEY_ID \
+ "file_id %s ?%u "
+#define SELECT_LIST_FILE_END_VALUE \
+ "ORDER BY file_path %s LIMIT ?%u;"
+#define SELECT_LIST_FILE_END_ID \
+ "ORDER BY file_id %s LIMIT ?%u;"
+
 #define SELECT_LIST_WHERE_TYPE_ID \
- "_type_id = %"VH_I64" "
+ "_type_id = ?%u "
 
 /* Metadata list selection */
 
@@ -245,13 +364,136 @@
  "assoc.file_id IN ( "                      \
    "SELECT file_id "                        \
    "FROM file "                             \
-   "WHERE _type_id = %"VH_I64" "            \
+   "WHERE _type_id = ?%u "                  \
  ") "
 
 #define SELECT_LIST_METADATA_END          \
  "GROUP BY assoc.meta_id, assoc.data_id " \
  "ORDER BY data.data_value;"
 
+/*
+ * With the pages sorted by value, the rows are read in the order of the
+ * index on data_value (CROSS JOIN), then SQLite can stop at the LIMIT
+ * instead of sorting all rows.
+ */
+#define SELECT_LIST_METADATA_FROM_VALUE                   \
+ "SELECT meta.meta_id, data.data_id, "                    \
+        "meta.meta_name, data.data_value, "               \
+        "data._lang_id, "                                 \
+        "assoc._grp_id, assoc.external "                  \
+ "FROM ( "                                                \
+   "data CROSS JOIN assoc_file_metadata AS assoc "        \
+   "ON data.data_id = assoc.data_id "                     \
+ ") INNER JOIN meta "                                     \
+ "ON assoc.meta_id = meta.meta_id "
+
+/* Keyset pagination, %s is '>' or '<' (ASC or DESC). */
+#define SELECT_LIST_METADATA_KEY_VALUE                    \
+ "data.data_value %s= ?%u "                               \
+ "AND (data.data_value %s ?%u OR assoc.meta_id %s ?%u) "
+#define SELECT_LIST_METADATA_KEY_ID                       \
+ "assoc.data_id %s= ?%u "                                 \
+ "AND (assoc.data_id %s ?%u OR assoc.meta_id %s ?%u) "
+#define SELECT_LIST_METADATA_END_VALUE                    \
+ "GROUP BY data.data_value, assoc.meta_id "               \
+ "ORDER BY data.data_value %s, assoc.meta_id %s LIMIT ?%u;"
+#define SELECT_LIST_METADATA_END_ID                       \
+ "GROUP BY assoc.data_id, assoc.meta_id "                 \
+ "ORDER BY assoc.data_id %s, assoc.meta_id %s LIMIT ?%u;"
+
+/* Counts selection */
+
+#define SELECT_COUNT_FILE_FROM  \
+ "SELECT COUNT(*) "             \
+ "FROM file AS assoc "
+
+/* Files by metadata. */
+#define SELECT_COUNT_FACET_FROM                           \
+ "SELECT meta.meta_id, data.data_id, data.data_value, "   \
+        "COUNT(DISTINCT assoc.file_id) "                  \
+ "FROM ( "                                                \
+   "data INNER JOIN assoc_file_metadata AS assoc "        \
+   "ON data.data_id = assoc.data_id "                     \
+ ") INNER JOIN meta "                                     \
+ "ON assoc.meta_id = meta.meta_id "
+
+/*
+ * Values of an other metadata (counted) by metadata. The files without the
+ * counted metadata are kept with LEFT JOIN (count of 0).
+ */
+#define SELECT_COUNT_FACET_FROM_COUNTED                   \
+ "SELECT meta.meta_id, data.data_id, data.data_value, "   \
+        "COUNT(DISTINCT cnt.data_id) "                    \
+ "FROM ( ( "                                              \
+   "data INNER JOIN assoc_file_metadata AS assoc "        \
+   "ON data.data_id = assoc.data_id "                     \
+ ") INNER JOIN meta "                                     \
+ "ON assoc.meta_id = meta.meta_id "                       \
+ ") LEFT JOIN assoc_file_metadata AS cnt "                \
+ "ON cnt.file_id = assoc.file_id "
+
+#define SELECT_LIST_WHERE_COUNT_ID \
+ "cnt.meta_id = ?%u "
+#define SELECT_LIST_WHERE_COUNT_NAME \
+ "cnt.meta_id IN (SELECT meta_id FROM meta WHERE meta_name = ?%u) "
+#define SELECT_COUNT_WHERE_COUNT_GROUP_ID \
+ "cnt._grp_id = ?%u "
+#define SELECT_COUNT_WHERE_COUNT_PRIORITY \
+ "cnt.priority__ <= ?%u "
+
+#define SELECT_COUNT_FACET_END            \
+ "GROUP BY assoc.meta_id, assoc.data_id " \
+ "ORDER BY data.data_value;"
+
+/* Full-text search */
+
+/*
+ * The values are found in the full-text index, then they are joined with
+ * the files. The values are restricted to the metadata of the search (and
+ * to the type of the files) before to keep only the shortest ones, which
+ * are the closest to the text.
+ */
+#define SELECT_SEARCH_FROM                                \
+ "SELECT assoc.file_id, meta.meta_id, data.data_id, "     \
+        "meta.meta_name, data.data_value, assoc._grp_id " \
+ "FROM ( "                                                \
+   "SELECT rowid "                                        \
+   "FROM data_fts "
+#define SELECT_SEARCH_MATCH                               \
+   "WHERE data_fts MATCH ?%u "
+#define SELECT_SEARCH_EXISTS                              \
+   "AND EXISTS ( "                                        \
+     "SELECT 1 "                                          \
+     "FROM assoc_file_metadata AS assoc "                 \
+     "INNER JOIN meta "                                   \
+     "ON assoc.meta_id = meta.meta_id "                   \
+     "WHERE assoc.data_id = data_fts.rowid "              \
+     "AND "
+#define SELECT_SEARCH_VALUES                              \
+   ") "                                                   \
+   "ORDER BY length (data_value), data_value "            \
+   "LIMIT ?%u "                                           \
+ ") AS fts "
+#define SELECT_SEARCH_JOIN                                \
+ "INNER JOIN data "                                       \
+ "ON data.data_id = fts.rowid "                           \
+ "INNER JOIN assoc_file_metadata AS assoc "               \
+ "ON assoc.data_id = data.data_id "                       \
+ "INNER JOIN meta "                                       \
+ "ON assoc.meta_id = meta.meta_id "
+
+#define SELECT_SEARCH_WHERE_META_IN \
+ "meta.meta_name IN ( "
+#define SELECT_SEARCH_META \
+ "?%u "
+#define SELECT_SEARCH_META_NEXT \
+ ", "
+
+#define SELECT_SEARCH_END                                 \
+ "ORDER BY length (data.data_value), data.data_value, "   \
+          "assoc.file_id "                                \
+ "LIMIT ?%u;"
+
 /* Common */
 
 #define SELECT_LIST_WHERE \
@@ -261,34 +503,60 @@
    "assoc.file_id IN ( "
 #define SELECT_LIST_WHERE_SUB_NOTIN \
    "assoc.file_id NOT IN ( "
-#define SELECT_LIST_WHERE_SUB                          \
-     "SELECT assoc.file_id "                           \
-     "FROM ( "                                         \
-       "data INNER JOIN assoc_file_metadata AS assoc " \
-       "ON data.data_id = assoc.data_id "              \
-     ") INNER JOIN meta "                              \
-     "ON assoc.meta_id = meta.meta_id "
 #define SELECT_LIST_WHERE_SUB_END \
    ") "
 
+/*
+ * Set of files for a restriction. The names are resolved to ids only once
+ * (the sub-queries are not correlated), then the set is read in the
+ * covering index assoc_file_idx. The data are joined only for a language.
+ */
+#define SELECT_LIST_SET \
+     "SELECT sa.file_id FROM assoc_file_metadata AS sa "
+#define SELECT_LIST_SET_LANG \
+     "INNER JOIN data AS sd ON sd.data_id = sa.data_id "
+#define SELECT_LIST_SET_INTERSECT \
+     "INTERSECT "
+#define SELECT_LIST_SET_EXCEPT \
+     "EXCEPT "
+#define SELECT_LIST_SET_UNION \
+     "UNION "
+
+#define SELECT_LIST_WHERE_SET_META_NAME \
+ "sa.meta_id = (SELECT meta_id FROM meta WHERE meta_name = ?%u) "
+#define SELECT_LIST_WHERE_SET_META_ID \
+ "sa.meta_id = ?%u "
+#define SELECT_LIST_WHERE_SET_DATA_NAME \
+ "sa.data_id = (SELECT data_id FROM data WHERE data_value = ?%u) "
+#define SELECT_LIST_WHERE_SET_DATA_ID \
+ "sa.data_id = ?%u "
+#define SELECT_LIST_WHERE_SET_LANG_ID \
+ "sd._lang_id = ?%u "
+#define SELECT_LIST_WHERE_SET_PRIORITY \
+ "sa.priority__ <= ?%u "
+
 #define SELECT_LIST_AND \
  "AND "
 #define SELECT_LIST_OR \
  "OR "
+/*
+ * The values are bound to the numbered parameters, then the query depends
+ * only on the shape of the selection.
+ */
 #define SELECT_LIST_WHERE_META_NAME \
- "meta.meta_name = '%q' "
+ "meta.meta_name = ?%u "
 #define SELECT_LIST_WHERE_META_ID \
- "meta.meta_id = %"VH_I64" "
+ "meta.meta_id = ?%u "
 #define SELECT_LIST_WHERE_DATA_NAME \
- "data.data_value = '%q' "
+ "data.data_value = ?%u "
 #define SELECT_LIST_WHERE_DATA_ID \
- "data.data_id = %"VH_I64" "
+ "data.data_id = ?%u "
 #define SELECT_LIST_WHERE_LANG_ID \
- "data._lang_id = %"VH_I64" "
+ "data._lang_id = ?%u "
 #define SELECT_LIST_WHERE_GROUP_ID \
- "assoc._grp_id = %"VH_I64" "
+ "assoc._grp_id = ?%u "
 #define SELECT_LIST_WHERE_PRIORITY \
- "assoc.priority__ <= %i " /* << highest,  >> lowest */
+ "assoc.priority__ <= ?%u " /* << highest,  >> lowest */
 
 /* Internal */
 
@@ -307,6 +575,22 @@
  "FROM file "             \
  "WHERE file_path = ?;"
 
+/* The unused parameters are NULL, see vh_database_file_get_mtime_batch() */
+#define SELECT_FILE_MTIME_BATCH_NB 32
+#define SELECT_FILE_MTIME_BATCH                       \
+ "SELECT file_path, file_mtime, interrupted__ "      \
+ "FROM file "                                        \
+ "WHERE file_path IN (?, ?, ?, ?, ?, ?, ?, ?, "      \
+ "                    ?, ?, ?, ?, ?, ?, ?, ?, "      \
+ "                    ?, ?, ?, ?, ?, ?, ?, ?, "      \
+ "                    ?, ?, ?, ?, ?, ?, ?, ?) "      \
+ "ORDER BY file_path;"
+
+/* Sequential scan for the in-memory index, see vh_database_init() */
+#define SELECT_FILE_INDEX                                    \
+ "SELECT file_id, file_path, file_mtime, interrupted__ "    \
+ "FROM file;"
+
 #define SELECT_TYPE_ID   \
  "SELECT type_id "       \
  "FROM type "            \
@@ -377,6 +661,17 @@
  "FROM file "                     \
  "WHERE outofpath__ = 1;"
 
+/* The order must be the same as strcmp() (BINARY collation). */
+#define SELECT_DIR                     \
+ "SELECT dir_path, dir_mtime, dir_nb " \
+ "FROM dir "                           \
+ "ORDER BY dir_path;"
+
+#define SELECT_FILE_DIR_CHECK       \
+ "SELECT file_path, interrupted__ " \
+ "FROM file "                       \
+ "WHERE outofpath__ = 0;"
+
 #define SELECT_FILE_GRABBER_NAME                      \
  "SELECT grabber.grabber_name "                       \
  "FROM ( "                                            \
@@ -412,6 +707,11 @@
  "           outofpath__) "   \
  "VALUES (?, ?, 1, -1, ?);"
 
+#define INSERT_DIR                         \
+ "INSERT "                                 \
+ "INTO dir (dir_path, dir_mtime, dir_nb) " \
+ "VALUES (?, ?, ?);"
+
 #define INSERT_TYPE        \
  "INSERT "                 \
  "INTO type (type_name) "  \
@@ -460,6 +760,28 @@
  "INTO assoc_file_grabber (file_id, grabber_id) "                 \
  "VALUES (?, ?);"
 
+/* A value can be shared by several metadata, it is indexed only once. */
+#define INSERT_DATA_FTS                                           \
+ "INSERT "                                                        \
+ "INTO data_fts (rowid, data_value) "                             \
+ "SELECT ?1, ?2 "                                                 \
+ "WHERE NOT EXISTS (SELECT 1 FROM data_fts WHERE rowid = ?1);"
+
+/* Values of a metadata which are not yet in the full-text index. */
+#define INSERT_DATA_FTS_META                                      \
+ "INSERT "                                                        \
+ "INTO data_fts (rowid, data_value) "                             \
+ "SELECT DISTINCT data.data_id, data.data_value "                 \
+ "FROM ( "                                                        \
+   "data INNER JOIN assoc_file_metadata AS assoc "                \
+   "ON data.data_id = assoc.data_id "                             \
+ ") INNER JOIN meta "                                             \
+ "ON assoc.meta_id = meta.meta_id "                               \
+ "WHERE meta.meta_name = ? "                                      \
+   "AND NOT EXISTS ( "                                            \
+     "SELECT 1 FROM data_fts WHERE rowid = data.data_id "         \
+   ");"
+
 /******************************************************************************/
 /*                                                                            */
 /*                                  Update                                    */
@@ -479,6 +801,18 @@
  "UPDATE file "                   \
  "SET checked__ = 0;"
 
+/*
+ * Only the files directly in the directory. The first argument is the
+ * directory with a trailing '/', the second is the same string where the
+ * '/' is replaced by '0' (the next character) and the third is the length
+ * of the first argument plus one.
+ */
+#define UPDATE_FILE_CHECKED_DIR            \
+ "UPDATE file "                            \
+ "SET checked__ = 1 "                      \
+ "WHERE file_path > ? AND file_path < ? "  \
+ "AND instr (substr (file_path, ?), '/') = 0;"
+
 #define UPDATE_FILE_INTERRUP_CLEAR \
  "UPDATE file "                    \
  "SET interrupted__ = 0 "          \
@@ -521,6 +855,11 @@
  "DELETE FROM file " \
  "WHERE file_path = ?;"
 
+/* Files in a directory and its subdirectories, see UPDATE_FILE_CHECKED_DIR */
+#define DELETE_FILE_DIR  \
+ "DELETE FROM file " \
+ "WHERE file_path > ? AND file_path < ?;"
+
 #define DELETE_ASSOC_FILE_METADATA  \
  "DELETE FROM assoc_file_metadata " \
  "WHERE file_id = ? AND external = 0;"
@@ -536,41 +875,74 @@
 #define DELETE_DLCONTEXT  \
  "DELETE FROM dlcontext;"
 
-/* Cleanup */
-
-#define CLEANUP_META                \
- "DELETE FROM meta "                \
- "WHERE meta_id NOT IN ( "          \
-   "SELECT meta_id "                \
-   "FROM assoc_file_metadata "      \
- ");"
+#define DELETE_DATA_FTS  \
+ "DELETE FROM data_fts;"
 
-#define CLEANUP_DATA                \
- "DELETE FROM data "                \
- "WHERE data_id NOT IN ( "          \
-   "SELECT data_id "                \
-   "FROM assoc_file_metadata "      \
- ");"
-
-#define CLEANUP_GRABBER             \
- "DELETE FROM grabber "             \
- "WHERE grabber_id NOT IN ( "       \
-   "SELECT grabber_id "             \
-   "FROM assoc_file_grabber "       \
- ");"
+#define DELETE_DIR  \
+ "DELETE FROM dir;"
 
-#define CLEANUP_ASSOC_FILE_METADATA \
- "DELETE FROM assoc_file_metadata " \
- "WHERE file_id NOT IN ( "          \
-   "SELECT file_id "                \
-   "FROM file "                     \
- ");"
+/*
+ * Cleanup
+ *
+ * Only the ids collected by the triggers are checked, then the cost depends
+ * on the number of deletes and not on the size of the database.
+ */
 
-#define CLEANUP_ASSOC_FILE_GRABBER  \
- "DELETE FROM assoc_file_grabber "  \
- "WHERE file_id NOT IN ( "          \
-   "SELECT file_id "                \
-   "FROM file "                     \
- ");"
+#define CLEANUP_META                                      \
+ "DELETE FROM meta "                                      \
+ "WHERE meta_id IN (SELECT meta_id FROM cleanup_meta) "   \
+   "AND NOT EXISTS ( "                                    \
+     "SELECT 1 "                                          \
+     "FROM assoc_file_metadata "                          \
+     "WHERE assoc_file_metadata.meta_id = meta.meta_id "  \
+   ");"
+
+#define CLEANUP_DATA                                      \
+ "DELETE FROM data "                                      \
+ "WHERE data_id IN (SELECT data_id FROM cleanup_data) "   \
+   "AND NOT EXISTS ( "                                    \
+     "SELECT 1 "                                          \
+     "FROM assoc_file_metadata "                          \
+     "WHERE assoc_file_metadata.data_id = data.data_id "  \
+   ");"
+
+/* The values are removed from the index only when they are deleted. */
+#define CLEANUP_DATA_FTS                                  \
+ "DELETE FROM data_fts "                                  \
+ "WHERE rowid IN (SELECT data_id FROM cleanup_data) "     \
+   "AND NOT EXISTS ( "                                    \
+     "SELECT 1 "                                          \
+     "FROM data "                                         \
+     "WHERE data.data_id = data_fts.rowid "               \
+   ");"
+
+#define CLEANUP_GRABBER                                         \
+ "DELETE FROM grabber "                                         \
+ "WHERE grabber_id IN (SELECT grabber_id FROM cleanup_grabber) " \
+   "AND NOT EXISTS ( "                                          \
+     "SELECT 1 "                                                \
+     "FROM assoc_file_grabber "                                 \
+     "WHERE assoc_file_grabber.grabber_id = grabber.grabber_id " \
+   ");"
+
+#define CLEANUP_ASSOC_FILE_METADATA                       \
+ "DELETE FROM assoc_file_metadata "                       \
+ "WHERE file_id IN (SELECT file_id FROM cleanup_file);"
+
+#define CLEANUP_ASSOC_FILE_GRABBER                        \
+ "DELETE FROM assoc_file_grabber "                        \
+ "WHERE file_id IN (SELECT file_id FROM cleanup_file);"
+
+#define CLEANUP_FILE_CLEAR    \
+ "DELETE FROM cleanup_file;"
+
+#define CLEANUP_META_CLEAR    \
+ "DELETE FROM cleanup_meta;"
+
+#define CLEANUP_DATA_CLEAR    \
+ "DELETE FROM cleanup_data;"
+
+#define CLEANUP_GRABBER_CLEAR \
+ "DELETE FROM cleanup_grabber;"
 
 #endif /* VALHALLA_SQL_STATEMENTS_H */
@@ -177,6 +177,17 @@ vh_stats_counter (vh_stats_cnt_t *counter, uint64_t val)
   pthread_mutex_unlock (&counter->mutex);
 }
 
+void
+vh_stats_counter_set (vh_stats_cnt_t *counter, uint64_t val)
+{
+  if (!counter)
+    return;
+
+  pthread_mutex_lock (&counter->mutex);
+  counter->count = val;
+  pthread_mutex_unlock (&counter->mutex);
+}
+
 vh_stats_tmr_t *
 vh_stats_grp_timer_add (vh_stats_t *stats,
                         const char *grp, const char *tmr, const char *sub)
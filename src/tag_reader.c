@@ -0,0 +1,1234 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "valhalla.h"
+#include "valhalla_internals.h"
+#include "utils.h"
+#include "osdep.h"
+#include "logs.h"
+#include "metadata.h"
+#include "tag_reader.h"
+
+/*
+ * The head of the file is read in a window with one pread(). When a tag is
+ * not in this window (ID3v2 with a big picture, 'moov' atom at the end of
+ * a MP4 file, ...), the window is moved with a second pread().
+ */
+
+#define TAG_READER_WINDOW   (64 * 1024)
+#define TAG_READER_SIZE_MAX (16 * 1024 * 1024) /* larger tags are for lavf */
+
+#define ID3V1_SIZE          128
+#define ID3V2_HEADER_SIZE   10
+#define FLAC_VORBIS_COMMENT 4
+#define OGG_HEADER_SIZE     27
+
+#define RB16(p) ((uint32_t) (p)[0] << 8 | (p)[1])
+#define RB24(p) ((uint32_t) (p)[0] << 16 | RB16 ((p) + 1))
+#define RB32(p) ((uint32_t) (p)[0] << 24 | RB24 ((p) + 1))
+#define RL32(p) ((uint32_t) (p)[3] << 24 | (uint32_t) (p)[2] << 16 \
+                 | (uint32_t) (p)[1] << 8 | (p)[0])
+#define SYNCSAFE32(p) ((uint32_t) ((p)[0] & 0x7F) << 21   \
+                       | (uint32_t) ((p)[1] & 0x7F) << 14 \
+                       | (uint32_t) ((p)[2] & 0x7F) << 7  \
+                       | ((p)[3] & 0x7F))
+
+/* MPEG audio frame header (not the reserved values, not ADTS). */
+#define MPA_SYNC(p)                  \
+ ((p)[0] == 0xFF                     \
+  && ((p)[1] & 0xE0) == 0xE0         \
+  && ((p)[1] & 0x18) != 0x08         \
+  && ((p)[1] & 0x06)                 \
+  && ((p)[2] & 0xF0) != 0xF0         \
+  && ((p)[2] & 0x0C) != 0x0C)
+
+typedef struct tag_reader_s {
+  int         fd;
+  off_t       size;     /* of the file */
+  uint8_t    *win;
+  off_t       win_off;
+  size_t      win_len;
+  size_t      win_size; /* allocated */
+  metadata_t *meta;
+  arena_t    *arena;
+} tag_reader_t;
+
+/* Conversion of the tags to the keys of libavformat. */
+typedef struct tag_reader_key_s {
+  const char *tag;
+  const char *key;
+} tag_reader_key_t;
+
+static const tag_reader_key_t tag_reader_id3v2_keys[] = {
+  /* ID3v2.2 */
+  { "TAL",  "album"         },
+  { "TCO",  "genre"         },
+  { "TCP",  "compilation"   },
+  { "TEN",  "encoded_by"    },
+  { "TP1",  "artist"        },
+  { "TP2",  "album_artist"  },
+  { "TP3",  "performer"     },
+  { "TRK",  "track"         },
+  { "TT2",  "title"         },
+  /* ID3v2.3 and ID3v2.4 */
+  { "TALB", "album"         },
+  { "TCOM", "composer"      },
+  { "TCON", "genre"         },
+  { "TCOP", "copyright"     },
+  { "TENC", "encoded_by"    },
+  { "TIT2", "title"         },
+  { "TLAN", "language"      },
+  { "TPE1", "artist"        },
+  { "TPE2", "album_artist"  },
+  { "TPE3", "performer"     },
+  { "TPOS", "disc"          },
+  { "TPUB", "publisher"     },
+  { "TRCK", "track"         },
+  { "TSSE", "encoder"       },
+  /* ID3v2.4 */
+  { "TCMP", "compilation"   },
+  { "TDEN", "creation_time" },
+  { "TDRC", "date"          },
+  { "TDRL", "date"          },
+  { "TIT1", "grouping"      },
+  { "TSOA", "album-sort"    },
+  { "TSOP", "artist-sort"   },
+  { "TSOT", "title-sort"    },
+  { NULL,   NULL            }
+};
+
+static const tag_reader_key_t tag_reader_vorbis_keys[] = {
+  { "ALBUMARTIST", "album_artist" },
+  { "DESCRIPTION", "comment"      },
+  { "DISCNUMBER",  "disc"         },
+  { "TRACKNUMBER", "track"        },
+  { NULL,          NULL           }
+};
+
+static const tag_reader_key_t tag_reader_mp4_keys[] = {
+  { "\xA9" "alb", "album"         },
+  { "\xA9" "ART", "artist"        },
+  { "\xA9" "cmt", "comment"       },
+  { "\xA9" "cpy", "copyright"     },
+  { "\xA9" "day", "date"          },
+  { "\xA9" "enc", "encoder"       },
+  { "\xA9" "gen", "genre"         },
+  { "\xA9" "grp", "grouping"      },
+  { "\xA9" "lyr", "lyrics"        },
+  { "\xA9" "nam", "title"         },
+  { "\xA9" "too", "encoder"       },
+  { "\xA9" "wrt", "composer"      },
+  { "aART",       "album_artist"  },
+  { "cpil",       "compilation"   },
+  { "cprt",       "copyright"     },
+  { "desc",       "description"   },
+  { "disk",       "disc"          },
+  { "gnre",       "genre"         },
+  { "ldes",       "synopsis"      },
+  { "trkn",       "track"         },
+  { "tven",       "episode_id"    },
+  { "tves",       "episode_sort"  },
+  { "tvnn",       "network"       },
+  { "tvsh",       "show"          },
+  { "tvsn",       "season_number" },
+  { NULL,         NULL            }
+};
+
+static const char *const tag_reader_genres[] = {
+  "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge",
+  "Hip-Hop", "Jazz", "Metal", "New Age", "Oldies", "Other", "Pop", "R&B",
+  "Rap", "Reggae", "Rock", "Techno", "Industrial", "Alternative", "Ska",
+  "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient",
+  "Trip-Hop", "Vocal", "Jazz+Funk", "Fusion", "Trance", "Classical",
+  "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+  "AlternRock", "Bass", "Soul", "Punk", "Space", "Meditative",
+  "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic", "Darkwave",
+  "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream",
+  "Southern Rock", "Comedy", "Cult", "Gangsta", "Top 40", "Christian Rap",
+  "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave",
+  "Psychadelic", "Rave", "Showtunes", "Trailer", "Lo-Fi", "Tribal",
+  "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll",
+  "Hard Rock", "Folk", "Folk-Rock", "National Folk", "Swing",
+  "Fast Fusion", "Bebob", "Latin", "Revival", "Celtic", "Bluegrass",
+  "Avantgarde", "Gothic Rock", "Progressive Rock", "Psychedelic Rock",
+  "Symphonic Rock", "Slow Rock", "Big Band", "Chorus", "Easy Listening",
+  "Acoustic", "Humour", "Speech", "Chanson", "Opera", "Chamber Music",
+  "Sonata", "Symphony", "Booty Bass", "Primus", "Porn Groove", "Satire",
+  "Slow Jam", "Club", "Tango", "Samba", "Folklore", "Ballad",
+  "Power Ballad", "Rhythmic Soul", "Freestyle", "Duet", "Punk Rock",
+  "Drum Solo", "A capella", "Euro-House", "Dance Hall", "Goa",
+  "Drum & Bass", "Club-House", "Hardcore", "Terror", "Indie", "BritPop",
+  "Negerpunk", "Polsk Punk", "Beat", "Christian Gangsta", "Heavy Metal",
+  "Black Metal", "Crossover", "Contemporary Christian", "Christian Rock",
+  "Merengue", "Salsa", "Thrash Metal", "Anime", "JPop", "Synthpop",
+  "Abstract", "Art Rock", "Baroque", "Bhangra", "Big Beat", "Breakbeat",
+  "Chillout", "Downtempo", "Dub", "EBM", "Eclectic", "Electro",
+  "Electroclash", "Emo", "Experimental", "Garage", "Global", "IDM",
+  "Illbient", "Industro-Goth", "Jam Band", "Krautrock", "Leftfield",
+  "Lounge", "Math Rock", "New Romantic", "Nu-Breakz", "Post-Punk",
+  "Post-Rock", "Psytrance", "Shoegaze", "Space Rock", "Trop Rock",
+  "World Music", "Neoclassical", "Audiobook", "Audio Theatre",
+  "Neue Deutsche Welle", "Podcast", "Indie Rock", "G-Funk", "Dubstep",
+  "Garage Rock", "Psybient",
+};
+
+static const metadata_plist_t tag_reader_pl = {
+  .metadata = NULL,
+  .priority = VALHALLA_METADATA_PL_HIGHEST
+};
+
+
+/* Bytes of the file, the pointer is valid until the next call. */
+static const uint8_t *
+tag_reader_region (tag_reader_t *tr, off_t off, size_t len)
+{
+  size_t size;
+  ssize_t n;
+
+  if (off < 0 || off > tr->size || len > (size_t) (tr->size - off)
+      || len > TAG_READER_SIZE_MAX)
+    return NULL;
+
+  if (off >= tr->win_off
+      && off + (off_t) len <= tr->win_off + (off_t) tr->win_len)
+    return tr->win + (off - tr->win_off);
+
+  size = len > TAG_READER_WINDOW ? len : TAG_READER_WINDOW;
+  if ((off_t) size > tr->size - off)
+    size = tr->size - off;
+
+  if (size > tr->win_size)
+  {
+    uint8_t *win = realloc (tr->win, size);
+    if (!win)
+      return NULL;
+    tr->win      = win;
+    tr->win_size = size;
+  }
+
+  tr->win_len = 0;
+  n = pread (tr->fd, tr->win, size, off);
+  if (n < 0 || (size_t) n < len)
+    return NULL;
+
+  tr->win_off = off;
+  tr->win_len = n;
+  return tr->win;
+}
+
+/* The value is freed. */
+static void
+tag_reader_add (tag_reader_t *tr, const char *key, char *value)
+{
+  if (!value)
+    return;
+
+  if (key && *key)
+    vh_metadata_add_auto (&tr->meta, tr->arena, key, value,
+                          VALHALLA_LANG_UNDEF, &tag_reader_pl);
+  free (value);
+}
+
+static const char *
+tag_reader_key (const tag_reader_key_t *keys, const char *tag)
+{
+  for (; keys->tag; keys++)
+    if (!strcasecmp (keys->tag, tag))
+      return keys->key;
+
+  return tag;
+}
+
+static const char *
+tag_reader_genre (unsigned int genre)
+{
+  return genre < ARRAY_NB_ELEMENTS (tag_reader_genres)
+         ? tag_reader_genres[genre] : NULL;
+}
+
+static char *
+tag_reader_utf8_put (char *it, uint32_t c)
+{
+  if (c < 0x80)
+    *it++ = c;
+  else if (c < 0x800)
+  {
+    *it++ = 0xC0 | c >> 6;
+    *it++ = 0x80 | (c & 0x3F);
+  }
+  else if (c < 0x10000)
+  {
+    *it++ = 0xE0 | c >> 12;
+    *it++ = 0x80 | (c >> 6 & 0x3F);
+    *it++ = 0x80 | (c & 0x3F);
+  }
+  else
+  {
+    *it++ = 0xF0 | c >> 18;
+    *it++ = 0x80 | (c >> 12 & 0x3F);
+    *it++ = 0x80 | (c >> 6 & 0x3F);
+    *it++ = 0x80 | (c & 0x3F);
+  }
+
+  return it;
+}
+
+static char *
+tag_reader_latin1 (const uint8_t *s, size_t len)
+{
+  char *str, *it;
+
+  str = malloc (2 * len + 1);
+  if (!str)
+    return NULL;
+
+  for (it = str; len && *s; s++, len--)
+    it = tag_reader_utf8_put (it, *s);
+  *it = '\0';
+
+  return str;
+}
+
+static char *
+tag_reader_utf16 (const uint8_t *s, size_t len, int be)
+{
+  char *str, *it;
+
+  str = malloc (len / 2 * 3 + 1);
+  if (!str)
+    return NULL;
+
+  for (it = str; len >= 2; s += 2, len -= 2)
+  {
+    uint32_t c = be ? (uint32_t) s[0] << 8 | s[1] : (uint32_t) s[1] << 8 | s[0];
+
+    if (!c)
+      break;
+
+    if (c >= 0xD800 && c < 0xE000)
+    {
+      uint32_t c2;
+
+      if (c >= 0xDC00 || len < 4)
+        continue;
+
+      c2 = be ? (uint32_t) s[2] << 8 | s[3] : (uint32_t) s[3] << 8 | s[2];
+      if (c2 < 0xDC00 || c2 >= 0xE000)
+        continue;
+
+      c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+      s += 2;
+      len -= 2;
+    }
+
+    it = tag_reader_utf8_put (it, c);
+  }
+  *it = '\0';
+
+  return str;
+}
+
+/******************************************************************************/
+/*                                                                            */
+/*                                   ID3                                      */
+/*                                                                            */
+/******************************************************************************/
+
+typedef struct id3v2_date_s {
+  char year[5];
+  char ddmm[5];
+} id3v2_date_t;
+
+/* String of a frame, the data is moved after the terminator. */
+static char *
+tag_reader_id3v2_str (int enc, const uint8_t **data, size_t *size)
+{
+  const uint8_t *s = *data;
+  size_t len, skip, n = *size;
+  char *str;
+  int be = 1;
+
+  switch (enc)
+  {
+  case 0: /* ISO-8859-1 */
+  case 3: /* UTF-8 */
+    for (len = 0; len < n && s[len]; len++)
+      ;
+    str = enc ? strndup ((const char *) s, len) : tag_reader_latin1 (s, len);
+    skip = len < n ? len + 1 : len;
+    break;
+
+  case 1: /* UTF-16 with BOM */
+  case 2: /* UTF-16BE */
+    if (enc == 1)
+    {
+      if (n < 2)
+        return NULL;
+      if (s[0] == 0xFF && s[1] == 0xFE)
+        be = 0;
+      else if (s[0] != 0xFE || s[1] != 0xFF)
+        return NULL;
+      s += 2;
+      n -= 2;
+    }
+    for (len = 0; len + 1 < n && (s[len] || s[len + 1]); len += 2)
+      ;
+    str = tag_reader_utf16 (s, len, be);
+    skip = len + 1 < n ? len + 2 : n;
+    break;
+
+  default:
+    return NULL;
+  }
+
+  *data = s + skip;
+  *size = n - skip;
+  return str;
+}
+
+static void
+tag_reader_id3v2_frame (tag_reader_t *tr, const char *id,
+                        const uint8_t *data, size_t size, id3v2_date_t *date)
+{
+  int enc;
+  int genre;
+  char *desc, *value;
+
+  if (size < 1)
+    return;
+
+  enc = *data++;
+  size--;
+
+  /* user text, the description is the key */
+  if (!strcmp (id, "TXXX") || !strcmp (id, "TXX"))
+  {
+    desc  = tag_reader_id3v2_str (enc, &data, &size);
+    value = tag_reader_id3v2_str (enc, &data, &size);
+    tag_reader_add (tr, desc, value);
+    free (desc);
+    return;
+  }
+
+  if (!strcmp (id, "COMM") || !strcmp (id, "COM"))
+  {
+    char *key = NULL;
+
+    if (size < 3)
+      return;
+
+    data += 3; /* language */
+    size -= 3;
+    desc  = tag_reader_id3v2_str (enc, &data, &size);
+    value = tag_reader_id3v2_str (enc, &data, &size);
+    if (desc && *desc)
+    {
+      key = malloc (strlen (desc) + sizeof ("comment-"));
+      if (key)
+        sprintf (key, "comment-%s", desc);
+    }
+    tag_reader_add (tr, key ? key : "comment", value);
+    free (key);
+    free (desc);
+    return;
+  }
+
+  if (*id != 'T')
+    return;
+
+  value = tag_reader_id3v2_str (enc, &data, &size);
+  if (!value)
+    return;
+
+  /* merged later like libavformat, when the values are valid */
+  if ((!strcmp (id, "TYER") || !strcmp (id, "TYE"))
+      && strlen (value) == 4 && strspn (value, "0123456789") == 4)
+  {
+    strcpy (date->year, value);
+    free (value);
+    return;
+  }
+
+  if ((!strcmp (id, "TDAT") || !strcmp (id, "TDA"))
+      && strlen (value) == 4 && strspn (value, "0123456789") == 4)
+  {
+    strcpy (date->ddmm, value);
+    free (value);
+    return;
+  }
+
+  if ((!strcmp (id, "TCON") || !strcmp (id, "TCO"))
+      && (sscanf (value, "(%d)", &genre) == 1
+          || sscanf (value, "%d", &genre) == 1)
+      && genre >= 0 && tag_reader_genre (genre))
+  {
+    free (value);
+    value = strdup (tag_reader_genre (genre));
+  }
+
+  tag_reader_add (tr, tag_reader_key (tag_reader_id3v2_keys, id), value);
+}
+
+/* Remove the 0x00 after each 0xFF, the data is copied. */
+static uint8_t *
+tag_reader_id3v2_unsync (const uint8_t *data, size_t *size)
+{
+  size_t i, j;
+  uint8_t *res;
+
+  res = malloc (*size ? *size : 1);
+  if (!res)
+    return NULL;
+
+  for (i = j = 0; i < *size; i++)
+  {
+    res[j++] = data[i];
+    if (data[i] == 0xFF && i + 1 < *size && !data[i + 1])
+      i++;
+  }
+
+  *size = j;
+  return res;
+}
+
+static void
+tag_reader_id3v2_parse (tag_reader_t *tr, const uint8_t *data, size_t size,
+                        int version, int flags)
+{
+  char id[5];
+  size_t idlen, hlen, ext;
+  uint8_t *tag = NULL;
+  id3v2_date_t date;
+
+  /* compression of the whole tag in ID3v2.2 */
+  if (version == 2 && flags & 0x40)
+    return;
+
+  memset (&date, 0, sizeof (date));
+
+  /* the frames sizes are for the synchronised data before ID3v2.4 */
+  if (version < 4 && flags & 0x80)
+  {
+    tag = tag_reader_id3v2_unsync (data, &size);
+    if (!tag)
+      return;
+    data = tag;
+  }
+
+  if (version > 2 && flags & 0x40)
+  {
+    if (size < 4)
+      goto out;
+    ext = version == 3 ? RB32 (data) + 4 : SYNCSAFE32 (data);
+    if (ext > size)
+      goto out;
+    data += ext;
+    size -= ext;
+  }
+
+  idlen = version == 2 ? 3 : 4;
+  hlen  = version == 2 ? 6 : 10;
+
+  while (size >= hlen)
+  {
+    size_t i, fsize;
+    unsigned int fflags = 0;
+    const uint8_t *frame;
+    uint8_t *fdata = NULL;
+
+    for (i = 0; i < idlen; i++)
+      if ((data[i] < 'A' || data[i] > 'Z') && (data[i] < '0' || data[i] > '9'))
+        goto out; /* padding */
+    memcpy (id, data, idlen);
+    id[idlen] = '\0';
+
+    if (version == 2)
+      fsize = RB24 (data + 3);
+    else
+    {
+      fsize  = version == 3 ? RB32 (data + 4) : SYNCSAFE32 (data + 4);
+      fflags = RB16 (data + 8);
+    }
+
+    data += hlen;
+    size -= hlen;
+    if (fsize > size)
+      break;
+
+    frame = data;
+    data += fsize;
+    size -= fsize;
+
+    /* compressed or encrypted frames are ignored */
+    if ((version == 3 && fflags & 0x00C0) || (version == 4 && fflags & 0x000C))
+      continue;
+
+    if (version == 4)
+    {
+      if (fflags & 0x0001) /* data length indicator */
+      {
+        if (fsize < 4)
+          continue;
+        frame += 4;
+        fsize -= 4;
+      }
+
+      if (fflags & 0x0002 || flags & 0x80)
+      {
+        fdata = tag_reader_id3v2_unsync (frame, &fsize);
+        if (!fdata)
+          continue;
+        frame = fdata;
+      }
+    }
+
+    tag_reader_id3v2_frame (tr, id, frame, fsize, &date);
+    free (fdata);
+  }
+
+ out:
+  if (*date.year)
+  {
+    char buf[16];
+
+    if (*date.ddmm)
+      snprintf (buf, sizeof (buf), "%s-%.2s-%.2s",
+                date.year, date.ddmm + 2, date.ddmm);
+    else
+      snprintf (buf, sizeof (buf), "%s", date.year);
+    tag_reader_add (tr, "date", strdup (buf));
+  }
+  else if (*date.ddmm)
+    tag_reader_add (tr, "TDAT", strdup (date.ddmm));
+
+  free (tag);
+}
+
+/* Returns the offset after the tag, the next 4 bytes are in the window. */
+static off_t
+tag_reader_id3v2 (tag_reader_t *tr)
+{
+  const uint8_t *p;
+  int version, flags;
+  size_t size, end;
+
+  p = tag_reader_region (tr, 0, ID3V2_HEADER_SIZE);
+  if (!p)
+    return -1;
+
+  version = p[3];
+  flags   = p[5];
+  if (version < 2 || version > 4 || p[4] == 0xFF
+      || (p[6] | p[7] | p[8] | p[9]) & 0x80)
+    return -1;
+
+  size = SYNCSAFE32 (p + 6);
+  end  = ID3V2_HEADER_SIZE + size + (version == 4 && flags & 0x10 ? 10 : 0);
+
+  p = tag_reader_region (tr, 0, end + 4);
+  if (!p)
+    return -1;
+
+  tag_reader_id3v2_parse (tr, p + ID3V2_HEADER_SIZE, size, version, flags);
+  return end;
+}
+
+static char *
+tag_reader_id3v1_str (const uint8_t *s, size_t len)
+{
+  char *str, *it;
+
+  str = tag_reader_latin1 (s, len);
+  if (!str)
+    return NULL;
+
+  for (it = str + strlen (str); it > str && it[-1] == ' '; it--)
+    ;
+  *it = '\0';
+
+  return str;
+}
+
+static void
+tag_reader_id3v1 (tag_reader_t *tr)
+{
+  const uint8_t *p;
+  char buf[16];
+
+  if (tr->size < ID3V1_SIZE)
+    return;
+
+  p = tag_reader_region (tr, tr->size - ID3V1_SIZE, ID3V1_SIZE);
+  if (!p || memcmp (p, "TAG", 3))
+    return;
+
+  tag_reader_add (tr, "title",  tag_reader_id3v1_str (p + 3,  30));
+  tag_reader_add (tr, "artist", tag_reader_id3v1_str (p + 33, 30));
+  tag_reader_add (tr, "album",  tag_reader_id3v1_str (p + 63, 30));
+  tag_reader_add (tr, "date",   tag_reader_id3v1_str (p + 93, 4));
+
+  /* ID3v1.1 */
+  if (!p[125] && p[126])
+  {
+    tag_reader_add (tr, "comment", tag_reader_id3v1_str (p + 97, 28));
+    snprintf (buf, sizeof (buf), "%u", p[126]);
+    tag_reader_add (tr, "track", strdup (buf));
+  }
+  else
+    tag_reader_add (tr, "comment", tag_reader_id3v1_str (p + 97, 30));
+
+  if (tag_reader_genre (p[127]))
+    tag_reader_add (tr, "genre", strdup (tag_reader_genre (p[127])));
+}
+
+/******************************************************************************/
+/*                                                                            */
+/*                          FLAC and Ogg Vorbis/Opus                          */
+/*                                                                            */
+/******************************************************************************/
+
+static void
+tag_reader_vorbis_comment (tag_reader_t *tr, const uint8_t *p, size_t size)
+{
+  uint32_t len, nb;
+
+  if (size < 4)
+    return;
+
+  len = RL32 (p); /* vendor */
+  if (len > size - 4)
+    return;
+  p    += 4 + len;
+  size -= 4 + len;
+
+  if (size < 4)
+    return;
+  nb = RL32 (p);
+  p    += 4;
+  size -= 4;
+
+  for (; nb && size >= 4; nb--)
+  {
+    const uint8_t *eq;
+
+    len = RL32 (p);
+    p    += 4;
+    size -= 4;
+    if (len > size)
+      break;
+
+    eq = memchr (p, '=', len);
+    if (eq && eq != p)
+    {
+      char *key = strndup ((const char *) p, eq - p);
+
+      /* the pictures and the chapters are not metadata for lavf */
+      if (key && strcasecmp (key, "METADATA_BLOCK_PICTURE")
+          && strncasecmp (key, "CHAPTER", 7))
+        tag_reader_add (tr, tag_reader_key (tag_reader_vorbis_keys, key),
+                        strndup ((const char *) eq + 1, len - (eq - p) - 1));
+      free (key);
+    }
+
+    p    += len;
+    size -= len;
+  }
+}
+
+static int
+tag_reader_flac (tag_reader_t *tr, off_t off)
+{
+  const uint8_t *p;
+  int first = 1;
+
+  for (;;)
+  {
+    int last, type;
+    size_t len;
+
+    p = tag_reader_region (tr, off, 4);
+    if (!p)
+      return -1;
+
+    last = p[0] & 0x80;
+    type = p[0] & 0x7F;
+    len  = RB24 (p + 1);
+
+    /* the first block is STREAMINFO */
+    if (type == 127 || (first && type))
+      return -1;
+
+    if (type == FLAC_VORBIS_COMMENT)
+    {
+      p = tag_reader_region (tr, off + 4, len);
+      if (!p)
+        return -1;
+
+      tag_reader_vorbis_comment (tr, p, len);
+      return 0;
+    }
+
+    if (last)
+      return 0;
+
+    off  += 4 + len;
+    first = 0;
+  }
+}
+
+/*
+ * The first page has only the identification header. The comment header is
+ * the second packet, it can be on several pages.
+ */
+static int
+tag_reader_ogg (tag_reader_t *tr)
+{
+  const uint8_t *p;
+  uint8_t lacing[255];
+  uint8_t *pkt = NULL;
+  size_t pkt_len = 0;
+  uint32_t serial = 0;
+  unsigned int page;
+  off_t off = 0;
+  int opus = 0, done = 0, res = -1;
+
+  for (page = 0; !done; page++)
+  {
+    unsigned int i, nsegs;
+    size_t len = 0, pos = 0;
+
+    p = tag_reader_region (tr, off, OGG_HEADER_SIZE);
+    if (!p || memcmp (p, "OggS", 4) || p[4])
+      goto out;
+
+    /* other streams (video, ...) are for lavf */
+    if (!page)
+    {
+      if (!(p[5] & 0x02))
+        goto out;
+      serial = RL32 (p + 14);
+    }
+    else if (p[5] & 0x02 || RL32 (p + 14) != serial)
+      goto out;
+
+    nsegs = p[26];
+    p = tag_reader_region (tr, off + OGG_HEADER_SIZE, nsegs);
+    if (!p)
+      goto out;
+
+    memcpy (lacing, p, nsegs);
+    for (i = 0; i < nsegs; i++)
+      len += lacing[i];
+
+    off += OGG_HEADER_SIZE + nsegs;
+    p = tag_reader_region (tr, off, len);
+    if (!p)
+      goto out;
+    off += len;
+
+    if (!page)
+    {
+      if (len >= 8 && !memcmp (p, "OpusHead", 8))
+        opus = 1;
+      else if (len < 7 || memcmp (p, "\x01vorbis", 7))
+        goto out;
+      continue;
+    }
+
+    for (i = 0; i < nsegs && !done; i++)
+    {
+      uint8_t *tmp;
+
+      if (pkt_len + lacing[i] > TAG_READER_SIZE_MAX)
+        goto out;
+
+      tmp = realloc (pkt, pkt_len + lacing[i] + 1);
+      if (!tmp)
+        goto out;
+      pkt = tmp;
+
+      memcpy (pkt + pkt_len, p + pos, lacing[i]);
+      pkt_len += lacing[i];
+      pos     += lacing[i];
+      done = lacing[i] < 255;
+    }
+  }
+
+  if (opus && pkt_len >= 8 && !memcmp (pkt, "OpusTags", 8))
+    tag_reader_vorbis_comment (tr, pkt + 8, pkt_len - 8);
+  else if (!opus && pkt_len >= 7 && !memcmp (pkt, "\x03vorbis", 7))
+    tag_reader_vorbis_comment (tr, pkt + 7, pkt_len - 7);
+  else
+    goto out;
+
+  res = 0;
+
+ out:
+  free (pkt);
+  return res;
+}
+
+/******************************************************************************/
+/*                                                                            */
+/*                                  MP4                                       */
+/*                                                                            */
+/******************************************************************************/
+
+/* Next atom of a buffer, the payload is returned. */
+static const uint8_t *
+tag_reader_mp4_atom (const uint8_t **data, size_t *size,
+                     const uint8_t **type, size_t *len)
+{
+  const uint8_t *p = *data;
+  size_t asize;
+
+  if (*size < 8)
+    return NULL;
+
+  asize = RB32 (p);
+  if (!asize)
+    asize = *size;
+  if (asize < 8 || asize > *size)
+    return NULL;
+
+  *type  = p + 4;
+  *len   = asize - 8;
+  *data  = p + asize;
+  *size -= asize;
+  return p + 8;
+}
+
+static const uint8_t *
+tag_reader_mp4_child (const uint8_t *data, size_t size,
+                      const char *name, size_t *len)
+{
+  const uint8_t *p, *type;
+
+  while ((p = tag_reader_mp4_atom (&data, &size, &type, len)))
+    if (!memcmp (type, name, 4))
+      return p;
+
+  return NULL;
+}
+
+static const char *
+tag_reader_mp4_key (const uint8_t *type)
+{
+  const tag_reader_key_t *keys;
+
+  for (keys = tag_reader_mp4_keys; keys->tag; keys++)
+    if (!memcmp (keys->tag, type, 4))
+      return keys->key;
+
+  return NULL;
+}
+
+static char *
+tag_reader_mp4_value (const uint8_t *type, const uint8_t *data, size_t size)
+{
+  char buf[32];
+  uint32_t wkt;
+  int64_t v = 0;
+  size_t i;
+
+  if (size < 8)
+    return NULL;
+
+  wkt   = RB24 (data + 1);
+  data += 8; /* type and locale */
+  size -= 8;
+
+  if (!memcmp (type, "trkn", 4) || !memcmp (type, "disk", 4))
+  {
+    if (size < 6)
+      return NULL;
+    if (RB16 (data + 4))
+      snprintf (buf, sizeof (buf), "%u/%u", RB16 (data + 2), RB16 (data + 4));
+    else
+      snprintf (buf, sizeof (buf), "%u", RB16 (data + 2));
+    return strdup (buf);
+  }
+
+  if (!memcmp (type, "gnre", 4))
+  {
+    if (size < 2 || !RB16 (data) || !tag_reader_genre (RB16 (data) - 1))
+      return NULL;
+    return strdup (tag_reader_genre (RB16 (data) - 1));
+  }
+
+  switch (wkt)
+  {
+  case 1: /* UTF-8 */
+    return strndup ((const char *) data, size);
+
+  case 21: /* signed integer */
+    if (size != 1 && size != 2 && size != 4 && size != 8)
+      return NULL;
+    for (i = 0; i < size; i++)
+      v = v << 8 | data[i];
+    if (size < 8 && v & (INT64_C (1) << (size * 8 - 1)))
+      v -= INT64_C (1) << (size * 8);
+    snprintf (buf, sizeof (buf), "%" PRIi64, v);
+    return strdup (buf);
+
+  default:
+    return NULL;
+  }
+}
+
+static void
+tag_reader_mp4_ilst (tag_reader_t *tr, const uint8_t *data, size_t size)
+{
+  const uint8_t *p, *type;
+  size_t len;
+
+  while ((p = tag_reader_mp4_atom (&data, &size, &type, &len)))
+  {
+    const uint8_t *d;
+    const char *key;
+    char *name = NULL;
+    size_t dlen;
+
+    /* freeform, the key is in the 'name' atom */
+    if (!memcmp (type, "----", 4))
+    {
+      d = tag_reader_mp4_child (p, len, "name", &dlen);
+      if (d && dlen > 4)
+        name = strndup ((const char *) d + 4, dlen - 4);
+      key = name;
+    }
+    else
+      key = tag_reader_mp4_key (type);
+
+    d = key ? tag_reader_mp4_child (p, len, "data", &dlen) : NULL;
+    if (d)
+      tag_reader_add (tr, key, tag_reader_mp4_value (type, d, dlen));
+    free (name);
+  }
+}
+
+static int
+tag_reader_mp4_moov (tag_reader_t *tr, const uint8_t *data, size_t size)
+{
+  const uint8_t *p, *type, *ilst = NULL;
+  size_t len, ilst_len = 0;
+  int audio = 0;
+
+  while ((p = tag_reader_mp4_atom (&data, &size, &type, &len)))
+  {
+    if (!memcmp (type, "trak", 4))
+    {
+      p = tag_reader_mp4_child (p, len, "mdia", &len);
+      if (p)
+        p = tag_reader_mp4_child (p, len, "hdlr", &len);
+      if (!p || len < 12)
+        continue;
+
+      /* the video files are for lavf */
+      if (!memcmp (p + 8, "vide", 4))
+        return -1;
+      if (!memcmp (p + 8, "soun", 4))
+        audio = 1;
+    }
+    else if (!memcmp (type, "udta", 4))
+    {
+      p = tag_reader_mp4_child (p, len, "meta", &len);
+      if (!p)
+        continue;
+
+      /* version and flags (not with QuickTime) */
+      if (len >= 4 && !RB32 (p))
+      {
+        p   += 4;
+        len -= 4;
+      }
+
+      p = tag_reader_mp4_child (p, len, "ilst", &len);
+      if (p)
+      {
+        ilst     = p;
+        ilst_len = len;
+      }
+    }
+  }
+
+  if (!audio)
+    return -1;
+
+  if (ilst)
+    tag_reader_mp4_ilst (tr, ilst, ilst_len);
+  return 0;
+}
+
+static int
+tag_reader_mp4 (tag_reader_t *tr)
+{
+  const uint8_t *p;
+  off_t off = 0;
+
+  while (tr->size - off >= 8)
+  {
+    uint64_t size;
+    size_t hlen = 8;
+
+    p = tag_reader_region (tr, off, tr->size - off >= 16 ? 16 : 8);
+    if (!p)
+      return -1;
+
+    size = RB32 (p);
+    if (size == 1)
+    {
+      if (tr->size - off < 16)
+        return -1;
+      size = (uint64_t) RB32 (p + 8) << 32 | RB32 (p + 12);
+      hlen = 16;
+    }
+    else if (!size)
+      size = tr->size - off;
+
+    if (size < hlen || size > (uint64_t) (tr->size - off))
+      return -1;
+
+    if (!memcmp (p + 4, "moov", 4))
+    {
+      if (size - hlen > TAG_READER_SIZE_MAX)
+        return -1;
+
+      p = tag_reader_region (tr, off + hlen, size - hlen);
+      if (!p)
+        return -1;
+
+      return tag_reader_mp4_moov (tr, p, size - hlen);
+    }
+
+    off += size;
+  }
+
+  return -1;
+}
+
+/******************************************************************************/
+/*                                                                            */
+/*                                 Reader                                     */
+/*                                                                            */
+/******************************************************************************/
+
+int
+vh_tag_reader_get (const char *file, metadata_t **meta, arena_t *arena)
+{
+  int res = -1;
+  off_t start = 0;
+  struct stat st;
+  const uint8_t *p;
+  const char *suffix;
+  tag_reader_t tr;
+
+  if (!file || !meta)
+    return -1;
+
+  memset (&tr, 0, sizeof (tr));
+  tr.arena = arena;
+  tr.fd = open (file, O_RDONLY);
+  if (tr.fd < 0)
+    return -1;
+
+  if (fstat (tr.fd, &st) || st.st_size < 12)
+    goto out;
+
+  tr.size = st.st_size;
+
+  p = tag_reader_region (&tr, 0, 12);
+  if (!p)
+    goto out;
+
+  if (!memcmp (p + 4, "ftyp", 4))
+  {
+    res = tag_reader_mp4 (&tr);
+    goto out;
+  }
+
+  if (!memcmp (p, "OggS", 4))
+  {
+    res = tag_reader_ogg (&tr);
+    goto out;
+  }
+
+  if (!memcmp (p, "ID3", 3))
+  {
+    start = tag_reader_id3v2 (&tr);
+    if (start < 0)
+      goto out;
+  }
+
+  p = tag_reader_region (&tr, start, 4);
+  if (!p)
+    goto out;
+
+  if (!memcmp (p, "fLaC", 4))
+  {
+    /* lavf ignores the ID3v2 tag of the FLAC files */
+    if (!arena)
+      vh_metadata_free (tr.meta);
+    tr.meta = NULL;
+    res = tag_reader_flac (&tr, start + 4);
+    goto out;
+  }
+
+  /* without ID3v2, the sync is not enough to say that it is a MP3 file */
+  suffix = strrchr (file, '.');
+  if (!MPA_SYNC (p) || (!start && (!suffix || strcasecmp (suffix, ".mp3"))))
+    goto out;
+
+  if (!tr.meta)
+    tag_reader_id3v1 (&tr);
+  res = 0;
+
+ out:
+  close (tr.fd);
+  free (tr.win);
+
+  if (res)
+  {
+    vh_log (VALHALLA_MSG_VERBOSE, "[%s] %s is for lavf", __FUNCTION__, file);
+    if (!arena)
+      vh_metadata_free (tr.meta);
+    return -1;
+  }
+
+  if (!*meta)
+    *meta = tr.meta;
+  else if (tr.meta)
+  {
+    (*meta)->last->next = tr.meta;
+    (*meta)->last = tr.meta->last;
+  }
+  return 0;
+}
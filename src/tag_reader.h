@@ -0,0 +1,36 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef VALHALLA_TAG_READER_H
+#define VALHALLA_TAG_READER_H
+
+#include "metadata.h"
+
+/*
+ * Read the tags of the audio files (MP3 with ID3v2 or ID3v1, FLAC, Ogg
+ * Vorbis/Opus and MP4/M4A) without libavformat. The keys are the same as
+ * with libavformat. It returns -1 when the file must be parsed with
+ * libavformat, then *meta is not changed. The tags are appended with the
+ * arena of the list (see vh_metadata_add()).
+ */
+int vh_tag_reader_get (const char *file, metadata_t **meta, arena_t *arena);
+
+#endif /* VALHALLA_TAG_READER_H */
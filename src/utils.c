@@ -51,20 +51,6 @@ vh_strtolower (char *str)
     *str = (char) VH_TOLOWER (*str);
 }
 
-char *
-vh_strrcasestr (const char *buf, const char *str)
-{
-  char *ptr, *res = NULL;
-
-  while ((ptr = strcasestr (buf, str)))
-  {
-    res = ptr;
-    buf = ptr + strlen (str);
-  }
-
-  return res;
-}
-
 int
 vh_file_exists (const char *file)
 {
@@ -176,46 +162,49 @@ file_dl_free (file_dl_t *dl)
   }
 }
 
+/* grabber_list and the alignment of the first allocations */
+#define FILE_DATA_ARENA_EXTRA 128
+
 void
 vh_file_data_free (file_data_t *data)
 {
   if (!data)
     return;
 
-  if (data->file.path)
-    free ((void *) data->file.path);
-  if (data->meta_parser)
-    vh_metadata_free (data->meta_parser);
-  if (data->meta_grabber)
-    vh_metadata_free (data->meta_grabber);
+  if (data->props)
+    free (data->props);
   if (data->list_downloader)
     file_dl_free (data->list_downloader);
-  if (data->grabber_list)
-    vh_list_free (data->grabber_list);
 
   sem_destroy (&data->sem_grabber);
 
-  free (data);
+  /* the data are in the arena */
+  vh_arena_free (data->arena);
 }
 
 file_data_t *
 vh_file_data_new (const char *file, struct stat *st, int outofpath,
                   od_type_t od, fifo_queue_prio_t prio, processing_step_t step)
 {
+  arena_t *arena;
   file_data_t *fdata;
 
-  fdata = calloc (1, sizeof (file_data_t));
-  if (!fdata)
+  /* enough for the data and the path, the metadata use more chunks */
+  arena = vh_arena_new (sizeof (file_data_t) + strlen (file) + 1
+                        + FILE_DATA_ARENA_EXTRA);
+  if (!arena)
     return NULL;
 
-  fdata->file.path    = strdup (file);
+  fdata = vh_arena_alloc (arena, sizeof (file_data_t));
+  fdata->arena        = arena;
+  fdata->file.path    = vh_arena_strdup (arena, file);
   fdata->file.mtime   = (int64_t) st->st_mtime;
   fdata->file.size    = (int64_t) st->st_size;
   fdata->outofpath    = outofpath;
   fdata->od           = od;
   fdata->priority     = prio;
   fdata->step         = step;
-  fdata->grabber_list = vh_list_new (0, NULL);
+  fdata->grabber_list = vh_list_new (0, NULL, arena);
 
   sem_init (&fdata->sem_grabber, 0, 0);
 
@@ -298,3 +287,108 @@ vh_get_list_length (void *list)
     n++;
   return n;
 }
+
+int
+vh_dir_list_add (dir_list_t *list,
+                 const char *path, int64_t mtime, int nb_files)
+{
+  dir_data_t *dir;
+
+  if (!list || !path)
+    return -1;
+
+  if (list->nb == list->size)
+  {
+    unsigned int size = list->size ? 2 * list->size : 64;
+    dir_data_t *dirs;
+
+    dirs = realloc (list->dirs, size * sizeof (*list->dirs));
+    if (!dirs)
+      return -1;
+
+    list->dirs = dirs;
+    list->size = size;
+  }
+
+  dir = &list->dirs[list->nb];
+  dir->path = strdup (path);
+  if (!dir->path)
+    return -1;
+
+  dir->mtime    = mtime;
+  dir->nb_files = nb_files;
+  list->nb++;
+  return 0;
+}
+
+static int
+dir_list_cmp (const void *a, const void *b)
+{
+  const dir_data_t *da = a, *db = b;
+  return strcmp (da->path, db->path);
+}
+
+void
+vh_dir_list_sort (dir_list_t *list)
+{
+  if (list && list->nb > 1)
+    qsort (list->dirs, list->nb, sizeof (*list->dirs), dir_list_cmp);
+}
+
+/* Index of the first directory which is not lesser than path. */
+unsigned int
+vh_dir_list_lower (dir_list_t *list, const char *path)
+{
+  unsigned int lo = 0, hi;
+
+  if (!list || !path)
+    return 0;
+
+  hi = list->nb;
+  while (lo < hi)
+  {
+    unsigned int mid = lo + (hi - lo) / 2;
+    if (strcmp (list->dirs[mid].path, path) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+dir_data_t *
+vh_dir_list_get (dir_list_t *list, const char *path)
+{
+  unsigned int i;
+
+  i = vh_dir_list_lower (list, path);
+  if (!list || i >= list->nb || strcmp (list->dirs[i].path, path))
+    return NULL;
+
+  return &list->dirs[i];
+}
+
+void
+vh_dir_list_clear (dir_list_t *list)
+{
+  unsigned int i;
+
+  if (!list)
+    return;
+
+  for (i = 0; i < list->nb; i++)
+    free (list->dirs[i].path);
+  free (list->dirs);
+
+  list->dirs = NULL;
+  list->nb   = 0;
+  list->size = 0;
+}
+
+void
+vh_dir_list_free (dir_list_t *list)
+{
+  vh_dir_list_clear (list);
+  free (list);
+}
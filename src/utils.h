@@ -33,6 +33,7 @@
 #include "metadata.h"
 #include "fifo_queue.h"
 #include "list.h"
+#include "arena.h"
 
 typedef enum od_type {
   OD_TYPE_DEF = 0,  /* created by "scanner" (default value) */
@@ -55,6 +56,9 @@ typedef struct file_data_s {
   metadata_t          *meta_parser;
   processing_step_t    step;
 
+  /* streams read by the parser for the grabber ffmpeg (combined pass) */
+  struct lavf_utils_props_s *props;
+
   /* grabbing attributes */
   unsigned int skip : 1; /* when all grabber threads are busy */
   unsigned int wait : 1;
@@ -67,11 +71,26 @@ typedef struct file_data_s {
   file_dl_t  *list_downloader;
 
   int         clean_f;
+
+  /* data, path, grabber_list and metadata lists (vh_file_data_free) */
+  arena_t    *arena;
 } file_data_t;
 
+typedef struct dir_data_s {
+  char   *path;
+  int64_t mtime;    /* -1 if the directory must be read in all cases */
+  int     nb_files; /* regular files accepted by the suffixes */
+} dir_data_t;
+
+/* List of directories sorted by path (strcmp). */
+typedef struct dir_list_s {
+  dir_data_t  *dirs;
+  unsigned int nb;
+  unsigned int size;
+} dir_list_t;
+
 
 void vh_strtolower (char *str);
-char *vh_strrcasestr (const char *buf, const char *str);
 int vh_file_exists (const char *file);
 int vh_file_copy (const char *src, const char *dst);
 void vh_file_dl_add (file_dl_t **dl,
@@ -83,6 +102,13 @@ file_data_t *vh_file_data_new (const char *file, struct stat *st,
 void vh_file_data_step_increase (file_data_t *data, action_list_t *action);
 void vh_file_data_step_continue (file_data_t *data, action_list_t *action);
 int vh_get_list_length (void *list);
+int vh_dir_list_add (dir_list_t *list,
+                     const char *path, int64_t mtime, int nb_files);
+void vh_dir_list_sort (dir_list_t *list);
+unsigned int vh_dir_list_lower (dir_list_t *list, const char *path);
+dir_data_t *vh_dir_list_get (dir_list_t *list, const char *path);
+void vh_dir_list_clear (dir_list_t *list);
+void vh_dir_list_free (dir_list_t *list);
 
 #define ARRAY_NB_ELEMENTS(array) (sizeof (array) / sizeof (array[0]))
 
@@ -33,6 +33,7 @@
 #include "parser.h"
 #include "scanner.h"
 #include "dbmanager.h"
+#include "dbquery.h"
 #include "dispatcher.h"
 #include "ondemand.h"
 #include "event_handler.h"
@@ -102,6 +103,18 @@ queue_cleanup (fifo_queue_t *queue)
         vh_dbmanager_extmd_free (data);
       break;
 
+    case ACTION_DB_DIR_CHECKED:
+    case ACTION_DB_DELFILE:
+    case ACTION_DB_DELDIR:
+      if (data)
+        free (data);
+      break;
+
+    case ACTION_DB_DIRS:
+      if (data)
+        vh_dir_list_free (data);
+      break;
+
     case ACTION_OD_ENGAGE:
     case ACTION_EH_EVENTGL:
       if (data)
@@ -206,6 +219,10 @@ valhalla_mrproper (valhalla_t *handle)
       case ACTION_DB_EXT_INSERT:
       case ACTION_DB_EXT_UPDATE:
       case ACTION_DB_EXT_DELETE:
+      case ACTION_DB_DIR_CHECKED:
+      case ACTION_DB_DIRS:
+      case ACTION_DB_DELFILE:
+      case ACTION_DB_DELDIR:
       case ACTION_EH_EVENTOD:
       case ACTION_EH_EVENTMD:
       case ACTION_EH_EVENTGL:
@@ -274,6 +291,36 @@ valhalla_config_set_orig (valhalla_t *handle, valhalla_cfg_t conf, ...)
 
   switch (conf)
   {
+  case VALHALLA_CFG_DATABASE_CACHE:
+    res = vh_dbmanager_db_pragma_set (handle->dbmanager,
+                                      DATABASE_PRAGMA_CACHE, i);
+    break;
+
+  case VALHALLA_CFG_DATABASE_JOURNAL:
+    res = vh_dbmanager_db_pragma_set (handle->dbmanager,
+                                      DATABASE_PRAGMA_JOURNAL, i);
+    break;
+
+  case VALHALLA_CFG_DATABASE_MMAP:
+    res = vh_dbmanager_db_pragma_set (handle->dbmanager,
+                                      DATABASE_PRAGMA_MMAP, i);
+    break;
+
+  case VALHALLA_CFG_DATABASE_SEARCH:
+    if (p1)
+      vh_dbmanager_db_search_meta_add (handle->dbmanager, p1);
+    break;
+
+  case VALHALLA_CFG_DATABASE_SYNC:
+    res = vh_dbmanager_db_pragma_set (handle->dbmanager,
+                                      DATABASE_PRAGMA_SYNC, i);
+    break;
+
+  case VALHALLA_CFG_DATABASE_TEMPSTORE:
+    res = vh_dbmanager_db_pragma_set (handle->dbmanager,
+                                      DATABASE_PRAGMA_TEMPSTORE, i);
+    break;
+
 #ifdef USE_GRABBER
   case VALHALLA_CFG_DOWNLOADER_DEST:
     vh_downloader_destination_set (handle->downloader, (valhalla_dl_t) i, p1);
@@ -290,11 +337,31 @@ valhalla_config_set_orig (valhalla_t *handle, valhalla_cfg_t conf, ...)
     break;
 #endif /* USE_GRABBER */
 
+  case VALHALLA_CFG_PARSER_ANALYZEDURATION:
+    vh_parser_analyzeduration_set (handle->parser, i);
+    break;
+
   case VALHALLA_CFG_PARSER_KEYWORD:
     if (p1)
       vh_parser_bl_keyword_add (handle->parser, p1);
     break;
 
+  case VALHALLA_CFG_PARSER_PROBESIZE:
+    vh_parser_probesize_set (handle->parser, i);
+    break;
+
+  case VALHALLA_CFG_PARSER_STREAMINFO:
+    vh_parser_streaminfo_set (handle->parser, i);
+    break;
+
+  case VALHALLA_CFG_PARSER_TAGREADER:
+    vh_parser_tagreader_set (handle->parser, i);
+    break;
+
+  case VALHALLA_CFG_SCANNER_DIRCACHE:
+    vh_scanner_dircache_set (handle->scanner, i);
+    break;
+
   case VALHALLA_CFG_SCANNER_PATH:
     if (p1)
       vh_scanner_path_add (handle->scanner, p1, i);
@@ -305,6 +372,10 @@ valhalla_config_set_orig (valhalla_t *handle, valhalla_cfg_t conf, ...)
       vh_scanner_suffix_add (handle->scanner, p1);
     break;
 
+  case VALHALLA_CFG_SCANNER_WATCH:
+    vh_scanner_watch_set (handle->scanner, i);
+    break;
+
   default:
     vh_log (VALHALLA_MSG_WARNING,
             "%s: unsupported option %#x", __FUNCTION__, conf);
@@ -390,6 +461,9 @@ valhalla_uninit (valhalla_t *handle)
   preinit = --g_preinit;
   pthread_mutex_unlock (&g_preinit_mutex);
 
+  /* the selections are usable until here, even without valhalla_run() */
+  vh_dbquery_stop (handle->dbquery, STOP_FLAG_REQUEST | STOP_FLAG_WAIT);
+
   if (!handle->fstop)
     valhalla_force_stop (handle);
 
@@ -399,6 +473,7 @@ valhalla_uninit (valhalla_t *handle)
 
   vh_ondemand_uninit (handle->ondemand);
   vh_scanner_uninit (handle->scanner);
+  vh_dbquery_uninit (handle->dbquery);
   vh_dbmanager_uninit (handle->dbmanager);
   vh_dispatcher_uninit (handle->dispatcher);
   vh_parser_uninit (handle->parser);
@@ -664,11 +739,12 @@ valhalla_init (const char *db, valhalla_init_param_t *param)
     goto err;
 #endif /* USE_GRABBER */
 
-  handle->scanner = vh_scanner_init (handle);
+  handle->scanner = vh_scanner_init (handle, pp->scanner_nb);
   if (!handle->scanner)
     goto err;
 
-  handle->dbmanager = vh_dbmanager_init (handle, db, pp->commit_int);
+  handle->dbmanager =
+    vh_dbmanager_init (handle, db, pp->commit_int, pp->file_index);
   if (!handle->dbmanager)
     goto err;
 
@@ -676,6 +752,16 @@ valhalla_init (const char *db, valhalla_init_param_t *param)
   if (!handle->ondemand)
     goto err;
 
+  handle->dbquery =
+    vh_dbquery_init (vh_dbmanager_database_get (handle->dbmanager),
+                     pp->query_nb);
+  if (!handle->dbquery)
+    goto err;
+
+  /* the queries are for the front-end, the threads keep the normal priority */
+  if (vh_dbquery_run (handle->dbquery, 0))
+    goto err;
+
   if (!preinit)
   {
 #ifdef USE_LAVC
@@ -754,7 +840,7 @@ valhalla_db_metalist_get (valhalla_t *handle, valhalla_db_item_t *search,
     return NULL;
 
   return vh_dbmanager_db_metalist_get (handle->dbmanager,
-                                       search, filetype, restriction);
+                                       search, filetype, restriction, NULL);
 }
 
 const valhalla_db_metares_t *
@@ -777,8 +863,8 @@ valhalla_db_filelist_get (valhalla_t *handle, valhalla_file_type_t filetype,
   if (!handle)
     return NULL;
 
-  return
-    vh_dbmanager_db_filelist_get (handle->dbmanager, filetype, restriction);
+  return vh_dbmanager_db_filelist_get (handle->dbmanager,
+                                       filetype, restriction, NULL);
 }
 
 const valhalla_db_fileres_t *
@@ -815,6 +901,271 @@ valhalla_db_file_read (valhalla_t *handle, valhalla_db_stmt_t *vhstmt)
   return vh_dbmanager_db_file_read (handle->dbmanager, vhstmt);
 }
 
+valhalla_db_stmt_t *
+valhalla_db_files_get (valhalla_t *handle, const int64_t *ids, unsigned int nb,
+                       valhalla_file_type_t filetype,
+                       valhalla_db_restrict_t *restriction,
+                       const char *const *metas)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle)
+    return NULL;
+
+  return vh_dbmanager_db_files_get (handle->dbmanager,
+                                    ids, nb, filetype, restriction, metas);
+}
+
+const valhalla_db_filemetares_t *
+valhalla_db_files_read (valhalla_t *handle, valhalla_db_stmt_t *vhstmt)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !vhstmt)
+    return NULL;
+
+  return vh_dbmanager_db_files_read (handle->dbmanager, vhstmt);
+}
+
+valhalla_db_stmt_t *
+valhalla_db_metalist_page_get (valhalla_t *handle, valhalla_db_item_t *search,
+                               valhalla_file_type_t filetype,
+                               valhalla_db_restrict_t *restriction,
+                               const valhalla_db_page_t *page)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !search || !page)
+    return NULL;
+
+  return vh_dbmanager_db_metalist_get (handle->dbmanager,
+                                       search, filetype, restriction, page);
+}
+
+valhalla_db_stmt_t *
+valhalla_db_filelist_page_get (valhalla_t *handle,
+                               valhalla_file_type_t filetype,
+                               valhalla_db_restrict_t *restriction,
+                               const valhalla_db_page_t *page)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !page)
+    return NULL;
+
+  return vh_dbmanager_db_filelist_get (handle->dbmanager,
+                                       filetype, restriction, page);
+}
+
+char *
+valhalla_db_page_token (valhalla_t *handle, valhalla_db_stmt_t *vhstmt)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !vhstmt)
+    return NULL;
+
+  return vh_dbmanager_db_page_token (handle->dbmanager, vhstmt);
+}
+
+valhalla_db_stmt_t *
+valhalla_db_facet_get (valhalla_t *handle,
+                       valhalla_db_item_t *facet, valhalla_db_item_t *counted,
+                       valhalla_file_type_t filetype,
+                       valhalla_db_restrict_t *restriction)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !facet)
+    return NULL;
+
+  return vh_dbmanager_db_facet_get (handle->dbmanager,
+                                    facet, counted, filetype, restriction);
+}
+
+const valhalla_db_countres_t *
+valhalla_db_facet_read (valhalla_t *handle, valhalla_db_stmt_t *vhstmt)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !vhstmt)
+    return NULL;
+
+  return vh_dbmanager_db_facet_read (handle->dbmanager, vhstmt);
+}
+
+int64_t
+valhalla_db_count (valhalla_t *handle, valhalla_file_type_t filetype,
+                   valhalla_db_restrict_t *restriction)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle)
+    return -1;
+
+  return vh_dbmanager_db_count (handle->dbmanager, filetype, restriction);
+}
+
+valhalla_db_stmt_t *
+valhalla_db_search_get (valhalla_t *handle, const char *text,
+                        valhalla_file_type_t filetype, unsigned int max)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !text)
+    return NULL;
+
+  return vh_dbmanager_db_search_get (handle->dbmanager, text, filetype, max);
+}
+
+const valhalla_db_searchres_t *
+valhalla_db_search_read (valhalla_t *handle, valhalla_db_stmt_t *vhstmt)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !vhstmt)
+    return NULL;
+
+  return vh_dbmanager_db_search_read (handle->dbmanager, vhstmt);
+}
+
+/******************************************************************************/
+/*                                                                            */
+/*                     Public Asynchronous Selections                         */
+/*                                                                            */
+/******************************************************************************/
+
+unsigned int
+valhalla_db_metalist_async (valhalla_t *handle,
+                            valhalla_db_item_t *search,
+                            valhalla_file_type_t filetype,
+                            valhalla_db_restrict_t *restriction,
+                            const valhalla_db_page_t *page,
+                            valhalla_db_async_cb_t cb, void *data)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !search)
+    return 0;
+
+  return vh_dbquery_metalist (handle->dbquery,
+                              search, filetype, restriction, page, cb, data);
+}
+
+unsigned int
+valhalla_db_filelist_async (valhalla_t *handle,
+                            valhalla_file_type_t filetype,
+                            valhalla_db_restrict_t *restriction,
+                            const valhalla_db_page_t *page,
+                            valhalla_db_async_cb_t cb, void *data)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle)
+    return 0;
+
+  return vh_dbquery_filelist (handle->dbquery,
+                              filetype, restriction, page, cb, data);
+}
+
+unsigned int
+valhalla_db_file_async (valhalla_t *handle, int64_t id, const char *path,
+                        valhalla_db_restrict_t *restriction,
+                        valhalla_db_async_cb_t cb, void *data)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle)
+    return 0;
+
+  return vh_dbquery_file (handle->dbquery, id, path, restriction, cb, data);
+}
+
+unsigned int
+valhalla_db_files_async (valhalla_t *handle,
+                         const int64_t *ids, unsigned int nb,
+                         valhalla_file_type_t filetype,
+                         valhalla_db_restrict_t *restriction,
+                         const char *const *metas,
+                         valhalla_db_async_cb_t cb, void *data)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle)
+    return 0;
+
+  return vh_dbquery_files (handle->dbquery, ids, nb,
+                           filetype, restriction, metas, cb, data);
+}
+
+unsigned int
+valhalla_db_facet_async (valhalla_t *handle,
+                         valhalla_db_item_t *facet, valhalla_db_item_t *counted,
+                         valhalla_file_type_t filetype,
+                         valhalla_db_restrict_t *restriction,
+                         valhalla_db_async_cb_t cb, void *data)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !facet)
+    return 0;
+
+  return vh_dbquery_facet (handle->dbquery, facet, counted,
+                           filetype, restriction, cb, data);
+}
+
+unsigned int
+valhalla_db_search_async (valhalla_t *handle, const char *text,
+                          valhalla_file_type_t filetype, unsigned int max,
+                          valhalla_db_async_cb_t cb, void *data)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle || !text)
+    return 0;
+
+  return vh_dbquery_search (handle->dbquery, text, filetype, max, cb, data);
+}
+
+void
+valhalla_db_async_cancel (valhalla_t *handle, unsigned int id)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle)
+    return;
+
+  vh_dbquery_cancel (handle->dbquery, id);
+}
+
+int
+valhalla_db_async_fd (valhalla_t *handle)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle)
+    return -1;
+
+  return vh_dbquery_fd (handle->dbquery);
+}
+
+valhalla_db_batch_t *
+valhalla_db_async_pop (valhalla_t *handle)
+{
+  vh_log (VALHALLA_MSG_VERBOSE, __FUNCTION__);
+
+  if (!handle)
+    return NULL;
+
+  return vh_dbquery_pop (handle->dbquery);
+}
+
+void
+valhalla_db_batch_free (valhalla_db_batch_t *batch)
+{
+  vh_dbquery_batch_free (batch);
+}
+
 /******************************************************************************/
 /*                                                                            */
 /*                  For Public Insertions/Updates/Deletions                   */
@@ -318,6 +318,30 @@ typedef enum valhalla_stats_type {
   VALHALLA_STATS_COUNTER,     /**< Read value for a counter.                */
 } valhalla_stats_type_t;
 
+/** \brief Journal modes for the database. */
+typedef enum valhalla_db_journal {
+  VALHALLA_DB_JOURNAL_WAL = 0,    /**< Write-Ahead Logging (default).       */
+  VALHALLA_DB_JOURNAL_DELETE,     /**< Rollback journal (SQLite default).   */
+  VALHALLA_DB_JOURNAL_TRUNCATE,   /**< Rollback journal truncated.          */
+  VALHALLA_DB_JOURNAL_PERSIST,    /**< Rollback journal header zeroed.      */
+  VALHALLA_DB_JOURNAL_MEMORY,     /**< Rollback journal in memory.          */
+  VALHALLA_DB_JOURNAL_OFF,        /**< No rollback journal.                 */
+} valhalla_db_journal_t;
+
+/** \brief Synchronization levels for the database. */
+typedef enum valhalla_db_sync {
+  VALHALLA_DB_SYNC_OFF = 0,       /**< Data handed to the OS, no sync.      */
+  VALHALLA_DB_SYNC_NORMAL,        /**< Sync at the critical moments.        */
+  VALHALLA_DB_SYNC_FULL,          /**< Sync on each commit.                 */
+} valhalla_db_sync_t;
+
+/** \brief Storages for the temporary tables and indexes of the database. */
+typedef enum valhalla_db_tempstore {
+  VALHALLA_DB_TEMPSTORE_DEFAULT = 0, /**< Compile-time default of SQLite.   */
+  VALHALLA_DB_TEMPSTORE_FILE,        /**< Temporary files.                  */
+  VALHALLA_DB_TEMPSTORE_MEMORY,      /**< In memory.                        */
+} valhalla_db_tempstore_t;
+
 /**
  * \brief Priorities for the metadata.
  *
@@ -374,7 +398,8 @@ typedef struct valhalla_file_s {
  *
  * Next \p num for the current combinations :
  * <pre>
- * VH_VOIDP_T                           : 2
+ * VH_INT_T                             : 11
+ * VH_VOIDP_T                           : 3
  * VH_VOIDP_T | VH_INT_T                : 3
  * VH_VOIDP_T | VH_INT_T | VH_VOIDP_2_T : 1
  * </pre>
@@ -382,6 +407,62 @@ typedef struct valhalla_file_s {
  * \see VH_CFG_INIT().
  */
 typedef enum valhalla_cfg {
+  /**
+   * Size of the page cache for each connection on the database. The default
+   * size is the SQLite default (2000 KiB).
+   *
+   * \param[in] arg1 ::VH_INT_T     Size in KiB.
+   */
+  VH_CFG_INIT (DATABASE_CACHE, VH_INT_T, 2),
+
+  /**
+   * Journal mode of the database. With the Write-Ahead Logging (default),
+   * the selections (valhalla_db_metalist_get(), ...) are not blocked by the
+   * transactions of the scanning (they use their own connection and they
+   * see only the committed data). The mode is stored in the database file
+   * for ::VALHALLA_DB_JOURNAL_WAL.
+   *
+   * \param[in] arg1 ::VH_INT_T     Journal mode, ::valhalla_db_journal_t.
+   */
+  VH_CFG_INIT (DATABASE_JOURNAL, VH_INT_T, 3),
+
+  /**
+   * Size of the database which can be accessed with memory-mapped I/O. It
+   * is disabled (0) by default.
+   *
+   * \param[in] arg1 ::VH_INT_T     Size in MiB.
+   */
+  VH_CFG_INIT (DATABASE_MMAP, VH_INT_T, 4),
+
+  /**
+   * Add a metadata in the full-text index for valhalla_db_search_get().
+   * When no metadata is added, the index contains the values of
+   * ::VALHALLA_METADATA_ALBUM, ::VALHALLA_METADATA_ARTIST,
+   * ::VALHALLA_METADATA_SYNOPSIS and ::VALHALLA_METADATA_TITLE. The index
+   * is built again with valhalla_run() when the list is changed.
+   *
+   * \p arg1 must be a null-terminated string.
+   *
+   * \param[in] arg1 ::VH_VOIDP_T   Metadata name.
+   */
+  VH_CFG_INIT (DATABASE_SEARCH, VH_VOIDP_T, 2),
+
+  /**
+   * Synchronization level of the database. The default level is the SQLite
+   * default (::VALHALLA_DB_SYNC_FULL). ::VALHALLA_DB_SYNC_NORMAL is safe
+   * against the corruptions with ::VALHALLA_DB_JOURNAL_WAL and it is faster.
+   *
+   * \param[in] arg1 ::VH_INT_T     Level, ::valhalla_db_sync_t.
+   */
+  VH_CFG_INIT (DATABASE_SYNC, VH_INT_T, 5),
+
+  /**
+   * Storage for the temporary tables and indexes of the database.
+   *
+   * \param[in] arg1 ::VH_INT_T     Storage, ::valhalla_db_tempstore_t.
+   */
+  VH_CFG_INIT (DATABASE_TEMPSTORE, VH_INT_T, 6),
+
   /**
    * Set a destination for the downloader. The default destination is used when
    * a specific destination is NULL.
@@ -425,6 +506,14 @@ typedef enum valhalla_cfg {
    */
   VH_CFG_INIT (GRABBER_STATE, VH_VOIDP_T | VH_INT_T, 0),
 
+  /**
+   * Max duration of the streams analyzed by FFmpeg for a file opened by the
+   * parser. 0 (default) for the FFmpeg default.
+   *
+   * \param[in] arg1 ::VH_INT_T     Duration in milliseconds.
+   */
+  VH_CFG_INIT (PARSER_ANALYZEDURATION, VH_INT_T, 7),
+
   /**
    * This parameter is useful only if the decrapifier is enabled with
    * valhalla_init().
@@ -466,6 +555,58 @@ typedef enum valhalla_cfg {
    */
   VH_CFG_INIT (PARSER_KEYWORD, VH_VOIDP_T, 0),
 
+  /**
+   * Max number of bytes read by FFmpeg to detect the format and the streams
+   * of a file opened by the parser. The file is opened only one time and
+   * the bytes read for the detection are not read again. 0 (default) for
+   * the FFmpeg default (with at most 1 MiB for the detection of the format
+   * in function of the suffix).
+   *
+   * \param[in] arg1 ::VH_INT_T     Size in bytes.
+   */
+  VH_CFG_INIT (PARSER_PROBESIZE, VH_INT_T, 8),
+
+  /**
+   * Read the properties of the streams (codecs, bitrates, resolution and
+   * duration) with the parser, while the file is still open. Then the
+   * grabber "ffmpeg" uses these properties and it does not open the file
+   * a second time. The parsing is slower but the files are read only one
+   * time. It is disabled by default and it is useless when the grabber
+   * "ffmpeg" is not available.
+   *
+   * \param[in] arg1 ::VH_INT_T     1 to enable, 0 to disable.
+   */
+  VH_CFG_INIT (PARSER_STREAMINFO, VH_INT_T, 9),
+
+  /**
+   * Read the tags of the most common audio files (MP3 with ID3v2 or ID3v1,
+   * FLAC, Ogg Vorbis/Opus and MP4/M4A) without FFmpeg. Only the blocks of
+   * the tags are read, FFmpeg is used for all other files. The metadata
+   * are the same but the cover of a MP3 or FLAC file is not seen as a
+   * video stream, then these files are always audio files. It is enabled
+   * by default and it is not used when ::VALHALLA_CFG_PARSER_STREAMINFO is
+   * enabled.
+   *
+   * \param[in] arg1 ::VH_INT_T     1 to enable, 0 to disable.
+   */
+  VH_CFG_INIT (PARSER_TAGREADER, VH_INT_T, 10),
+
+  /**
+   * Enable the cache of the directories for the scanner. The mtime of each
+   * directory is saved in the database at the end of a complete loop. For
+   * the next loops (or the next run), a directory where the mtime has not
+   * changed is not read again; its files are considered as unchanged and
+   * only the subdirectories are visited.
+   *
+   * The cache is disabled by default. The mtime of a directory changes only
+   * when a file is added, removed or renamed. A file modified in place (for
+   * example, only its tags) is not detected as long as its directory is
+   * cached. The cache is dropped when the list of suffixes is changed.
+   *
+   * \param[in] arg1 ::VH_INT_T     1 to enable, 0 to disable.
+   */
+  VH_CFG_INIT (SCANNER_DIRCACHE, VH_INT_T, 0),
+
   /**
    * Add a path to the scanner. If the same path is added several times,
    * only one is saved in the scanner.
@@ -490,6 +631,27 @@ typedef enum valhalla_cfg {
    */
   VH_CFG_INIT (SCANNER_SUFFIX, VH_VOIDP_T, 1),
 
+  /**
+   * Enable the watch mode of the scanner (Linux inotify only). A first
+   * complete loop is done as usual, then the scanner no longer sleeps
+   * between loops but it listens for the changes on the directories of
+   * the paths. A new or modified file is handled as soon as it is closed,
+   * and a deleted (or renamed) file or directory is removed from the
+   * database.
+   *
+   * In watch mode, the number of loops passed to valhalla_run() is ignored,
+   * the scanner runs until valhalla_uninit(). When the system limit of
+   * watches is reached, the directories which can not be watched are
+   * scanned again each \p timeout seconds. valhalla_scanner_wakeup() forces
+   * a complete rescan of all paths.
+   *
+   * If inotify is not available, then a warning is printed and the scanner
+   * works with the loops.
+   *
+   * \param[in] arg1 ::VH_INT_T     1 to enable, 0 to disable.
+   */
+  VH_CFG_INIT (SCANNER_WATCH, VH_INT_T, 1),
+
 } valhalla_cfg_t;
 
 /** \brief Parameters for valhalla_init(). */
@@ -528,6 +690,14 @@ typedef struct valhalla_init_param_s {
    * ondemand callback by using the function valhalla_ondemand_cb_meta().
    */
   unsigned int od_meta     : 1;
+  /**
+   * If the attribute is set, the path, the mtime and the state of all files
+   * are loaded in memory at the initialization. Then the scanner can know
+   * if a file is unchanged without querying the database. The memory used
+   * by this index is reported in the "dbmanager" statistics group. It is
+   * disabled by default.
+   */
+  unsigned int file_index  : 1;
 
   /**
    * When \p od_cb is defined, an event is sent for each step with an on demand
@@ -569,6 +739,25 @@ typedef struct valhalla_init_param_s {
   /** User data for metadata event callback. */
   void *md_data;
 
+  /*
+   * The next fields are appended after the fields of 2.1.0, then the
+   * structure stays binary compatible.
+   */
+
+  /**
+   * Number of threads for walking the directories (max 16). The
+   * subdirectories of a path are shared between these threads, it is useful
+   * with slow storages (NFS, ...) and big trees. The default number of
+   * threads is 1.
+   */
+  unsigned int scanner_nb;
+  /**
+   * Number of threads for the asynchronous selections (max 8). The queries
+   * are concurrent, each thread uses its own read-only connection on the
+   * database. The default number of threads is 2.
+   */
+  unsigned int query_nb;
+
 } valhalla_init_param_t;
 
 /**
@@ -751,7 +940,8 @@ int valhalla_run (valhalla_t *handle,
  * \brief Wait until the scanning is finished.
  *
  * This function wait until the scanning is finished for all loops. If the
- * number of loops is infinite, then this function will wait forever. You
+ * number of loops is infinite (or if the watch mode is enabled, see
+ * VALHALLA_CFG_SCANNER_WATCH), then this function will wait forever. You
  * must not break this function with valhalla_uninit(), that is not safe!
  * If you prefer stop the scanner even if it is not finished. In this case
  * you must use _only_ valhalla_uninit().
@@ -770,7 +960,7 @@ void valhalla_wait (valhalla_t *handle);
  * If the scanner is sleeping, this function will wake up this one independently
  * of the time (\p timeout) set with valhalla_run(). If the number of loops is
  * already reached or if the scanner is already working, this function has no
- * effect.
+ * effect. In watch mode, a complete rescan of all paths is forced.
  *
  * \warning This function can be used only after valhalla_run()!
  * \param[in] handle      Handle on the scanner.
@@ -818,6 +1008,9 @@ const char *valhalla_ondemand_cb_meta (valhalla_t *handle, const char *meta);
 /** \brief Prepared statement. */
 typedef struct valhalla_db_stmt_s valhalla_db_stmt_t;
 
+/** \brief Max number of ids for valhalla_db_files_get(). */
+#define VALHALLA_DB_FILES_MAX 256
+
 /** \brief Type of field. */
 typedef enum valhalla_db_type {
   VALHALLA_DB_TYPE_ID,
@@ -858,6 +1051,28 @@ typedef struct valhalla_db_fileres_s {
   valhalla_file_type_t type;
 } valhalla_db_fileres_t;
 
+/** \brief Results for valhalla_db_files_get(). */
+typedef struct valhalla_db_filemetares_s {
+  int64_t     file_id;
+  const char *path;
+  valhalla_db_metares_t meta;
+} valhalla_db_filemetares_t;
+
+/** \brief Results for valhalla_db_facet_get(). */
+typedef struct valhalla_db_countres_s {
+  int64_t      meta_id,   data_id;
+  const char  *data_value;
+  unsigned int count;
+} valhalla_db_countres_t;
+
+/** \brief Results for valhalla_db_search_get(). */
+typedef struct valhalla_db_searchres_s {
+  int64_t     file_id;
+  int64_t     meta_id,    data_id;
+  const char *meta_name, *data_value;
+  valhalla_meta_grp_t group;
+} valhalla_db_searchres_t;
+
 /** \brief Restriction. */
 typedef struct valhalla_db_restrict_s {
   struct valhalla_db_restrict_s *next;
@@ -866,6 +1081,60 @@ typedef struct valhalla_db_restrict_s {
   valhalla_db_item_t data;
 } valhalla_db_restrict_t;
 
+/** \brief Sort key for the pages. */
+typedef enum valhalla_db_sort {
+  /** Data value then meta id (metadata), or path (files). */
+  VALHALLA_DB_SORT_VALUE = 0,
+  /** Data id then meta id (metadata), or file id (files). */
+  VALHALLA_DB_SORT_ID,
+} valhalla_db_sort_t;
+
+/** \brief Page of a selection. */
+typedef struct valhalla_db_page_s {
+  unsigned int       size;  /**< Max number of rows, 0 for no limit.      */
+  valhalla_db_sort_t sort;  /**< Sort key.                                */
+  int                desc;  /**< 1 for a descending order.                */
+  const char        *token; /**< Resume token, NULL for the first page.   */
+} valhalla_db_page_t;
+
+/** \brief State of a batch of rows (asynchronous selections). */
+typedef enum valhalla_db_async {
+  VALHALLA_DB_ASYNC_ROWS = 0, /**< Rows, the next batch follows.          */
+  VALHALLA_DB_ASYNC_END,      /**< Last batch, all rows are read.         */
+  VALHALLA_DB_ASYNC_CANCELED, /**< Last batch, the query is canceled.     */
+  VALHALLA_DB_ASYNC_ERROR,    /**< Last batch, the query has failed.      */
+} valhalla_db_async_t;
+
+/** \brief Batch of rows of an asynchronous selection. */
+typedef struct valhalla_db_batch_s {
+  unsigned int        id;     /**< Id of the query.                       */
+  valhalla_db_async_t state;  /**< State of the query.                    */
+  void               *data;   /**< User data passed with the query.       */
+  unsigned int        nb;     /**< Number of rows.                        */
+  /**
+   * Resume token of a full page (only with the last batch), NULL if the
+   * query is not paginated or if there is no more page.
+   */
+  const char         *token;
+  /** Rows, the member depends of the selection. */
+  union {
+    const valhalla_db_metares_t   *metares;   /**< Metalist and file.     */
+    const valhalla_db_fileres_t   *fileres;   /**< Filelist.              */
+    const valhalla_db_filemetares_t *filemetares; /**< Files.             */
+    const valhalla_db_countres_t  *countres;  /**< Facet.                 */
+    const valhalla_db_searchres_t *searchres; /**< Search.                */
+  } rows;
+} valhalla_db_batch_t;
+
+/**
+ * \brief Callback for the batches of an asynchronous selection.
+ *
+ * It is called by a thread of Valhalla. The batch must be freed with
+ * valhalla_db_batch_free().
+ */
+typedef void (*valhalla_db_async_cb_t) (valhalla_db_batch_t *batch,
+                                        void *data);
+
 
 /**
  * \name Macros for selection functions handling.
@@ -943,6 +1212,22 @@ typedef struct valhalla_db_restrict_s {
 #define VALHALLA_DB_RESTRICT_LINK(from, to) \
   do {(to).next = &(from);} while (0)
 
+/**
+ * \brief Set valhalla_db_page_t local variable.
+ *
+ * \param[in] n       Size of the page.
+ * \param[in] s       Sort key (VALUE or ID).
+ * \param[in] d       1 for a descending order.
+ * \param[in] t       Resume token or NULL.
+ */
+#define VALHALLA_DB_PAGE(n, s, d, t)              \
+  {                                               \
+    /* .size  = */ n,                             \
+    /* .sort  = */ VALHALLA_DB_SORT_##s,          \
+    /* .desc  = */ d,                             \
+    /* .token = */ t                              \
+  }
+
 /**
  * @}
  * \name Database selections.
@@ -1069,6 +1354,407 @@ valhalla_db_file_get (valhalla_t *handle, int64_t id, const char *path,
 const valhalla_db_metares_t *
 valhalla_db_file_read (valhalla_t *handle, valhalla_db_stmt_t *vhstmt);
 
+/**
+ * \brief Init a statement to retrieve the metadata of several files.
+ *
+ * All the metadata are returned by only one statement, instead of one
+ * valhalla_db_file_get() per file. The rows of a file are consecutive and
+ * the files are sorted by id.
+ *
+ * The files are selected by their ids (at most #VALHALLA_DB_FILES_MAX) if
+ * \p nb is not 0, then the type and the restrictions (like with
+ * valhalla_db_filelist_get()) are applied on these files. Without id, all
+ * the files of the type and of the restrictions are returned.
+ *
+ * Example (to retrieve only the title of a list of files):
+ *  \code
+ *  const char *const metas[] = { VALHALLA_METADATA_TITLE, NULL };
+ *  vhstmt = valhalla_db_files_get (handle, ids, nb,
+ *                                  VALHALLA_FILE_TYPE_NULL, NULL, metas);
+ *  \endcode
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] ids         Array of file IDs, or NULL.
+ * \param[in] nb          Number of IDs in \p ids.
+ * \param[in] filetype    File type.
+ * \param[in] restriction Restrictions on the files.
+ * \param[in] metas       NULL-terminated list of meta names, NULL for all.
+ * \return the statement, NULL on error.
+ */
+valhalla_db_stmt_t *
+valhalla_db_files_get (valhalla_t *handle, const int64_t *ids, unsigned int nb,
+                       valhalla_file_type_t filetype,
+                       valhalla_db_restrict_t *restriction,
+                       const char *const *metas);
+
+/**
+ * \brief Read the next row of a 'files' statement.
+ *
+ * The argument \p vhstmt must be initialized with valhalla_db_files_get().
+ * It is freed when the returned value is NULL. The pointer returned by the
+ * function is valid as long as no new call is done for the \p vhstmt.
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] vhstmt      Statement.
+ * \return the result, NULL if no more row or on error.
+ */
+const valhalla_db_filemetares_t *
+valhalla_db_files_read (valhalla_t *handle, valhalla_db_stmt_t *vhstmt);
+
+/**
+ * \brief Init a statement to retrieve a page of metadata.
+ *
+ * Like valhalla_db_metalist_get() but at most \p page->size rows are
+ * returned, in the order of the sort key. The next page starts after the
+ * row of the resume token (keyset pagination), then the cost of a page does
+ * not depend of its position in the list. The statement is read with
+ * valhalla_db_metalist_read().
+ *
+ * Example (to list the artists, 50 by 50):
+ *  \code
+ *  search = VALHALLA_DB_SEARCH_TEXT ("artist", ENTITIES, lang, pmin);
+ *  page   = VALHALLA_DB_PAGE (50, VALUE, 0, NULL);
+ *  \endcode
+ *  and for the next page, \p page.token is set with the token of the last
+ *  row (see valhalla_db_page_token()).
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] search      Condition for the search.
+ * \param[in] filetype    File type.
+ * \param[in] restriction Restrictions on the list.
+ * \param[in] page        Size, order and resume token.
+ * \return the statement, NULL on error (or with an invalid token).
+ */
+valhalla_db_stmt_t *
+valhalla_db_metalist_page_get (valhalla_t *handle,
+                               valhalla_db_item_t *search,
+                               valhalla_file_type_t filetype,
+                               valhalla_db_restrict_t *restriction,
+                               const valhalla_db_page_t *page);
+
+/**
+ * \brief Init a statement to retrieve a page of files.
+ *
+ * Like valhalla_db_filelist_get() but at most \p page->size rows are
+ * returned, in the order of the sort key. See
+ * valhalla_db_metalist_page_get() for the resume token. The statement is
+ * read with valhalla_db_filelist_read().
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] filetype    File type.
+ * \param[in] restriction Restrictions on the list.
+ * \param[in] page        Size, order and resume token.
+ * \return the statement, NULL on error (or with an invalid token).
+ */
+valhalla_db_stmt_t *
+valhalla_db_filelist_page_get (valhalla_t *handle,
+                               valhalla_file_type_t filetype,
+                               valhalla_db_restrict_t *restriction,
+                               const valhalla_db_page_t *page);
+
+/**
+ * \brief Get the resume token of the last row read.
+ *
+ * The function must be called after a successful read of a statement
+ * initialized with valhalla_db_metalist_page_get() or
+ * valhalla_db_filelist_page_get(). The page which starts after this row is
+ * retrieved with the token. The string must be freed with free().
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] vhstmt      Statement.
+ * \return the token, NULL if there is no current row or on error.
+ */
+char *valhalla_db_page_token (valhalla_t *handle, valhalla_db_stmt_t *vhstmt);
+
+/**
+ * \brief Init a statement to count the files by metadata (facets).
+ *
+ * The files are selected like with valhalla_db_filelist_get(). For every
+ * value of the metadata \p facet, the number of files is returned, or the
+ * number of values of the metadata \p counted in these files. Only one
+ * aggregate is computed by the database. The results are cached as long as
+ * the database is not changed, then the statement is read without query.
+ *
+ * Example (to count the albums by artist):
+ *  \code
+ *  facet   = VALHALLA_DB_SEARCH_TEXT ("artist", ENTITIES, lang, pmin);
+ *  counted = VALHALLA_DB_SEARCH_TEXT ("album", TITLES, lang, pmin);
+ *  \endcode
+ *  and with \p counted to NULL, the files are counted by artist.
+ *
+ * Only the meta (id or text), the group and the priority are used for
+ * \p counted.
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] facet       Metadata for the groups of results.
+ * \param[in] counted     Metadata to count, NULL to count the files.
+ * \param[in] filetype    File type.
+ * \param[in] restriction Restrictions on the files.
+ * \return the statement, NULL on error.
+ */
+valhalla_db_stmt_t *
+valhalla_db_facet_get (valhalla_t *handle,
+                       valhalla_db_item_t *facet,
+                       valhalla_db_item_t *counted,
+                       valhalla_file_type_t filetype,
+                       valhalla_db_restrict_t *restriction);
+
+/**
+ * \brief Read the next row of a 'facet' statement.
+ *
+ * The argument \p vhstmt must be initialized with valhalla_db_facet_get().
+ * It is freed when the returned value is NULL. The pointer returned by the
+ * function is valid as long as no new call is done for the \p vhstmt.
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] vhstmt      Statement.
+ * \return the result, NULL if no more row or on error.
+ */
+const valhalla_db_countres_t *
+valhalla_db_facet_read (valhalla_t *handle, valhalla_db_stmt_t *vhstmt);
+
+/**
+ * \brief Count the files.
+ *
+ * The files are selected like with valhalla_db_filelist_get(). The count
+ * is cached as long as the database is not changed.
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] filetype    File type.
+ * \param[in] restriction Restrictions on the files.
+ * \return the number of files, -1 on error.
+ */
+int64_t valhalla_db_count (valhalla_t *handle,
+                           valhalla_file_type_t filetype,
+                           valhalla_db_restrict_t *restriction);
+
+/**
+ * \brief Init a statement to search a text in the metadata.
+ *
+ * The values are searched in a full-text index (see
+ * ::VALHALLA_CFG_DATABASE_SEARCH for the metadata). The last word of \p text
+ * is a prefix (the word which is typed), the case and the diacritics are
+ * ignored. Then "star wa" finds "Star Wars" or "The Making of Star Wars".
+ * A row is returned for each file which uses a value. The shortest values
+ * are returned first; only the first 1000 values found are sorted when the
+ * text is too short.
+ *
+ * The search is not available (NULL is returned) when SQLite is compiled
+ * without FTS5.
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] text        Text typed by the user.
+ * \param[in] filetype    File type.
+ * \param[in] max         Max number of rows (0 for no limit).
+ * \return the statement, NULL on error.
+ */
+valhalla_db_stmt_t *
+valhalla_db_search_get (valhalla_t *handle, const char *text,
+                        valhalla_file_type_t filetype, unsigned int max);
+
+/**
+ * \brief Read the next row of a 'search' statement.
+ *
+ * The argument \p vhstmt must be initialized with valhalla_db_search_get().
+ * It is freed when the returned value is NULL. The pointer returned by the
+ * function is valid as long as no new call is done for the \p vhstmt.
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] vhstmt      Statement.
+ * \return the result, NULL if no more row or on error.
+ */
+const valhalla_db_searchres_t *
+valhalla_db_search_read (valhalla_t *handle, valhalla_db_stmt_t *vhstmt);
+
+/**
+ * @}
+ * \name Asynchronous database selections.
+ *
+ * These functions queue a selection to the threads of the queries (see
+ * ::valhalla_init_param_t) and return immediately. The rows are the same
+ * as with the synchronous selections, but they are copied in batches of at
+ * most 64 rows. The arguments are copied too; they can be released as soon
+ * as the function returns.
+ *
+ * If \p cb is not NULL, the batches are passed to the callback (called by
+ * an other thread). Else they are pushed in a completion queue which is
+ * read with valhalla_db_async_pop(). In both cases, a batch must be freed
+ * with valhalla_db_batch_free().
+ *
+ * Every query ends with exactly one batch where the state is not
+ * VALHALLA_DB_ASYNC_ROWS, even if the query is canceled or if it fails.
+ * Then the user data can be released.
+ *
+ * Example (with a poll loop):
+ *  \code
+ *  id = valhalla_db_filelist_async (handle, VALHALLA_FILE_TYPE_NULL,
+ *                                   &restr, NULL, NULL, view);
+ *  ...
+ *  fds.fd     = valhalla_db_async_fd (handle);
+ *  fds.events = POLLIN;
+ *  poll (&fds, 1, -1);
+ *  while ((batch = valhalla_db_async_pop (handle)))
+ *  {
+ *    view_append (batch->data, batch->rows.fileres, batch->nb);
+ *    valhalla_db_batch_free (batch);
+ *  }
+ *  \endcode
+ *
+ * @{
+ */
+
+/**
+ * \brief Queue a selection like valhalla_db_metalist_get().
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] search      Condition for the search.
+ * \param[in] filetype    File type.
+ * \param[in] restriction Restrictions on the list.
+ * \param[in] page        Page of the selection, NULL for all rows.
+ * \param[in] cb          Callback for the batches, NULL for the queue.
+ * \param[in] data        User data.
+ * \return the id of the query, 0 on error.
+ */
+unsigned int
+valhalla_db_metalist_async (valhalla_t *handle,
+                            valhalla_db_item_t *search,
+                            valhalla_file_type_t filetype,
+                            valhalla_db_restrict_t *restriction,
+                            const valhalla_db_page_t *page,
+                            valhalla_db_async_cb_t cb, void *data);
+
+/**
+ * \brief Queue a selection like valhalla_db_filelist_get().
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] filetype    File type.
+ * \param[in] restriction Restrictions on the list.
+ * \param[in] page        Page of the selection, NULL for all rows.
+ * \param[in] cb          Callback for the batches, NULL for the queue.
+ * \param[in] data        User data.
+ * \return the id of the query, 0 on error.
+ */
+unsigned int
+valhalla_db_filelist_async (valhalla_t *handle,
+                            valhalla_file_type_t filetype,
+                            valhalla_db_restrict_t *restriction,
+                            const valhalla_db_page_t *page,
+                            valhalla_db_async_cb_t cb, void *data);
+
+/**
+ * \brief Queue a selection like valhalla_db_file_get().
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] id          File ID or 0.
+ * \param[in] path        Path or NULL.
+ * \param[in] restriction Restrictions on the list.
+ * \param[in] cb          Callback for the batches, NULL for the queue.
+ * \param[in] data        User data.
+ * \return the id of the query, 0 on error.
+ */
+unsigned int
+valhalla_db_file_async (valhalla_t *handle, int64_t id, const char *path,
+                        valhalla_db_restrict_t *restriction,
+                        valhalla_db_async_cb_t cb, void *data);
+
+/**
+ * \brief Queue a selection like valhalla_db_files_get().
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] ids         Array of file IDs, or NULL.
+ * \param[in] nb          Number of IDs in \p ids.
+ * \param[in] filetype    File type.
+ * \param[in] restriction Restrictions on the files.
+ * \param[in] metas       NULL-terminated list of meta names, NULL for all.
+ * \param[in] cb          Callback for the batches, NULL for the queue.
+ * \param[in] data        User data.
+ * \return the id of the query, 0 on error.
+ */
+unsigned int
+valhalla_db_files_async (valhalla_t *handle,
+                         const int64_t *ids, unsigned int nb,
+                         valhalla_file_type_t filetype,
+                         valhalla_db_restrict_t *restriction,
+                         const char *const *metas,
+                         valhalla_db_async_cb_t cb, void *data);
+
+/**
+ * \brief Queue a selection like valhalla_db_facet_get().
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] facet       Metadata of the facet.
+ * \param[in] counted     Metadata counted, NULL to count the files.
+ * \param[in] filetype    File type.
+ * \param[in] restriction Restrictions on the files.
+ * \param[in] cb          Callback for the batches, NULL for the queue.
+ * \param[in] data        User data.
+ * \return the id of the query, 0 on error.
+ */
+unsigned int
+valhalla_db_facet_async (valhalla_t *handle,
+                         valhalla_db_item_t *facet, valhalla_db_item_t *counted,
+                         valhalla_file_type_t filetype,
+                         valhalla_db_restrict_t *restriction,
+                         valhalla_db_async_cb_t cb, void *data);
+
+/**
+ * \brief Queue a selection like valhalla_db_search_get().
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] text        Text typed by the user.
+ * \param[in] filetype    File type.
+ * \param[in] max         Max number of rows.
+ * \param[in] cb          Callback for the batches, NULL for the queue.
+ * \param[in] data        User data.
+ * \return the id of the query, 0 on error.
+ */
+unsigned int
+valhalla_db_search_async (valhalla_t *handle, const char *text,
+                          valhalla_file_type_t filetype, unsigned int max,
+                          valhalla_db_async_cb_t cb, void *data);
+
+/**
+ * \brief Cancel an asynchronous selection.
+ *
+ * A query not yet started is dropped, a running query is interrupted as
+ * soon as possible (even in the middle of a long step of SQLite). The last
+ * batch has the state VALHALLA_DB_ASYNC_CANCELED unless the query was
+ * already ended. Nothing is done if the query is unknown.
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \param[in] id          Id of the query.
+ */
+void valhalla_db_async_cancel (valhalla_t *handle, unsigned int id);
+
+/**
+ * \brief Get the file descriptor of the completion queue.
+ *
+ * The descriptor is readable as long as the queue is not empty. It must
+ * only be polled, the batches are read with valhalla_db_async_pop().
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \return the descriptor, -1 if not available.
+ */
+int valhalla_db_async_fd (valhalla_t *handle);
+
+/**
+ * \brief Pop the next batch of the completion queue.
+ *
+ * Only the queries without callback push their batches in the queue. The
+ * function never blocks.
+ *
+ * \param[in] handle      Handle on the scanner.
+ * \return the batch, NULL if the queue is empty.
+ */
+valhalla_db_batch_t *valhalla_db_async_pop (valhalla_t *handle);
+
+/**
+ * \brief Free a batch of an asynchronous selection.
+ *
+ * \param[in] batch       Batch to free.
+ */
+void valhalla_db_batch_free (valhalla_db_batch_t *batch);
+
 /**
  * @}
  * \name Database insertions/updates/deletions.
@@ -37,7 +37,13 @@ typedef enum action_list {
   ACTION_DB_EXT_UPDATE,     /* external metadata to update */
   ACTION_DB_EXT_DELETE,     /* external metadata to delete */
   ACTION_DB_EXT_PRIORITY,   /* new priority for one or more metadata */
-  ACTION_ACKNOWLEDGE,       /* dbmanager: ack scanner for each file handled */
+  ACTION_DB_DIR_CHECKED,    /* scanner: files of an unchanged directory */
+  ACTION_DB_DIRS,           /* scanner: directories of a complete loop */
+  ACTION_DB_DELFILE,        /* scanner: file removed (watch mode) */
+  ACTION_DB_DELDIR,         /* scanner: directory removed (watch mode) */
+  ACTION_DB_COMMIT,         /* scanner: commit the changes (watch mode) */
+  ACTION_DB_QUERY,          /* dbquery: asynchronous selection */
+  ACTION_ACKNOWLEDGE,       /* dbmanager: ack scanner for the files handled */
   ACTION_OD_ENGAGE,         /* engage ondemand procedure */
   ACTION_EH_EVENTOD,        /* ondemand event for the user */
   ACTION_EH_EVENTMD,        /* metadata event when a set is completed */
@@ -45,6 +51,10 @@ typedef enum action_list {
   ACTION_CLEANUP_END,       /* special case for garbage collector */
 } action_list_t;
 
+/* The data of ACTION_ACKNOWLEDGE is the number of files, NULL for one. */
+#define VH_ACK_DATA(nb)  ((void *) (intptr_t) (nb))
+#define VH_ACK_NB(data)  ((data) ? (int) (intptr_t) (data) : 1)
+
 typedef enum processing_step {
   STEP_PARSING = 0,
 #ifdef USE_GRABBER
@@ -65,6 +75,7 @@ struct valhalla_s {
 #endif /* USE_GRABBER */
   struct dbmanager_s     *dbmanager;
   struct event_handler_s *event_handler;
+  struct dbquery_s       *dbquery;
 
   struct vh_stats_s *stats;
 
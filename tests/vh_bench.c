@@ -0,0 +1,92 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "vh_bench.h"
+
+typedef struct vh_bench_case_s {
+  const char  *name;
+  void       (*run) (void);
+} vh_bench_case_t;
+
+static const vh_bench_case_t vbc[] = {
+  { "arena",        vh_bench_arena },
+  { "browse",       vh_bench_browse },
+  { "database",     vh_bench_database },
+  { "decrapifier",  vh_bench_decrapifier },
+  { "fifo_queue",   vh_bench_fifo_queue },
+  { "lavf_utils",   vh_bench_lavf_utils },
+  { "lookup",       vh_bench_lookup },
+};
+
+
+uint64_t
+vh_bench_now (void)
+{
+  struct timespec tp;
+
+  if (clock_gettime (CLOCK_MONOTONIC, &tp))
+    return 0;
+
+  return (uint64_t) tp.tv_sec * 1000000000 + tp.tv_nsec;
+}
+
+void
+vh_bench_report (const char *name, const char *unit, uint64_t nb, uint64_t ns)
+{
+  double sec = ns / 1000000000.0;
+
+  printf ("  %-40s %12llu %-6s %10.3f ms %14.0f %s/s\n",
+          name, (unsigned long long) nb, unit, ns / 1000000.0,
+          sec > 0.0 ? nb / sec : 0.0, unit);
+}
+
+/*
+ * Usage: vh_bench [name ...]
+ *
+ * Without argument, all benchmarks are run.
+ */
+int
+main (int argc, char **argv)
+{
+  unsigned int i;
+  int j;
+
+  for (i = 0; i < sizeof (vbc) / sizeof (*vbc); i++)
+  {
+    if (argc > 1)
+    {
+      for (j = 1; j < argc; j++)
+        if (!strcmp (argv[j], vbc[i].name))
+          break;
+      if (j == argc)
+        continue;
+    }
+
+    printf ("%s:\n", vbc[i].name);
+    vbc[i].run ();
+  }
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef VH_BENCH_H
+#define VH_BENCH_H
+
+#include <stdint.h>
+
+uint64_t vh_bench_now (void);
+void vh_bench_report (const char *name, const char *unit,
+                      uint64_t nb, uint64_t ns);
+
+void vh_bench_arena (void);
+void vh_bench_browse (void);
+void vh_bench_database (void);
+void vh_bench_decrapifier (void);
+void vh_bench_fifo_queue (void);
+void vh_bench_lavf_utils (void);
+void vh_bench_lookup (void);
+
+#endif /* VH_BENCH_H */
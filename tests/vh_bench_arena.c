@@ -0,0 +1,340 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "valhalla.h"
+#include "logs.h"
+#include "utils.h"
+#include "metadata.h"
+#include "list.h"
+#include "vh_bench.h"
+
+#define BENCH_ARENA_FILES    100000
+#define BENCH_ARENA_GRABBERS 3
+
+/* Tags of an audio file given by the parser. */
+static const char *const bench_arena_parser[][2] = {
+  { "title",        "The Song Number Seven"            },
+  { "artist",       "The Artist"                       },
+  { "album",        "The Album of the Year"            },
+  { "album_artist", "The Artist"                       },
+  { "track",        "7/12"                             },
+  { "date",         "2012"                             },
+  { "genre",        "Rock"                             },
+  { "composer",     "Somebody Else"                    },
+  { "comment",      "Ripped with a very good ripper"   },
+  { "encoder",      "LAME 3.99"                        },
+  { "disc",         "1/1"                              },
+  { "tsrc",         "USABC1200007"                     },
+  { "publisher",    "The Label"                        },
+  { "copyright",    "2012 The Label"                   },
+  { "language",     "eng"                              },
+  { "bpm",          "120"                              },
+};
+
+/* Tags given by each grabber. */
+static const char *const bench_arena_grabber[][2] = {
+  { "cover",        "the-artist-the-album-of-the-year.jpg" },
+  { "category",     "Rock"                                 },
+  { "category",     "Alternative"                          },
+  { "country",      "United Kingdom"                       },
+  { "synopsis",     "A text about the album, not so long"  },
+  { "rating",       "4"                                    },
+  { "lyrics",       "The lyrics of the song, a few lines"  },
+  { "fan_art",      "the-artist-fan-art.jpg"               },
+};
+
+static const char *const bench_arena_grabber_names[BENCH_ARENA_GRABBERS] = {
+  "lastfm", "local", "lyricwiki",
+};
+
+static const metadata_plist_t bench_arena_pl = {
+  .metadata = NULL,
+  .priority = VALHALLA_METADATA_PL_NORMAL
+};
+
+/*
+ * glibc supports the replacement of malloc(); the functions of the libc
+ * (like strdup()) use these ones. The allocations are counted only while
+ * bench_arena_count is set.
+ */
+#ifdef __GLIBC__
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static int bench_arena_count;
+static uint64_t bench_arena_nb;
+
+#define BENCH_ARENA_INC()                                         \
+  do                                                              \
+  {                                                               \
+    if (bench_arena_count)                                        \
+      __atomic_fetch_add (&bench_arena_nb, 1, __ATOMIC_RELAXED);  \
+  } while (0)
+
+void *
+malloc (size_t size)
+{
+  BENCH_ARENA_INC ();
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+  BENCH_ARENA_INC ();
+  return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  BENCH_ARENA_INC ();
+  return __libc_realloc (ptr, size);
+}
+#endif /* __GLIBC__ */
+
+/* Previous implementation of file_data_t, list_t and metadata_t. */
+typedef struct bench_arena_item_s {
+  void *data;
+  struct bench_arena_item_s *next;
+} bench_arena_item_t;
+
+typedef struct bench_arena_list_s {
+  bench_arena_item_t *item;
+  bench_arena_item_t *item_last;
+} bench_arena_list_t;
+
+typedef struct bench_arena_meta_s {
+  struct bench_arena_meta_s *next;
+  char *name;
+  char *value;
+} bench_arena_meta_t;
+
+typedef struct bench_arena_data_s {
+  char *path;
+  bench_arena_meta_t *meta_parser;
+  bench_arena_meta_t *meta_grabber;
+  bench_arena_list_t *grabber_list;
+} bench_arena_data_t;
+
+static void
+bench_arena_meta_add (bench_arena_meta_t **meta,
+                      const char *name, const char *value)
+{
+  bench_arena_meta_t *it;
+
+  if (!*meta)
+  {
+    *meta = calloc (1, sizeof (bench_arena_meta_t));
+    it = *meta;
+  }
+  else
+  {
+    for (it = *meta; it->next; it = it->next)
+      ;
+    it->next = calloc (1, sizeof (bench_arena_meta_t));
+    it = it->next;
+  }
+
+  if (!it)
+    return;
+
+  it->name  = strdup (name);
+  it->value = strdup (value);
+}
+
+static void
+bench_arena_meta_free (bench_arena_meta_t *meta)
+{
+  bench_arena_meta_t *tmp;
+
+  while (meta)
+  {
+    free (meta->name);
+    free (meta->value);
+    tmp = meta->next;
+    free (meta);
+    meta = tmp;
+  }
+}
+
+static void
+bench_arena_list_append (bench_arena_list_t *list,
+                         const void *data, size_t len)
+{
+  bench_arena_item_t *item = calloc (1, sizeof (bench_arena_item_t));
+  if (!item)
+    return;
+
+  if (!list->item)
+    list->item = item;
+  else
+    list->item_last->next = item;
+  list->item_last = item;
+
+  item->data = calloc (1, len);
+  if (item->data)
+    memcpy (item->data, data, len);
+}
+
+static void
+bench_arena_file_malloc (const char *file)
+{
+  unsigned int i, j;
+  bench_arena_data_t *data;
+  bench_arena_item_t *item, *item_n;
+
+  data = calloc (1, sizeof (bench_arena_data_t));
+  if (!data)
+    return;
+
+  data->path         = strdup (file);
+  data->grabber_list = calloc (1, sizeof (bench_arena_list_t));
+
+  for (i = 0; i < ARRAY_NB_ELEMENTS (bench_arena_parser); i++)
+    bench_arena_meta_add (&data->meta_parser, bench_arena_parser[i][0],
+                          bench_arena_parser[i][1]);
+
+  for (j = 0; j < BENCH_ARENA_GRABBERS; j++)
+  {
+    const char *name = bench_arena_grabber_names[j];
+
+    bench_arena_list_append (data->grabber_list, name, strlen (name) + 1);
+    for (i = 0; i < ARRAY_NB_ELEMENTS (bench_arena_grabber); i++)
+      bench_arena_meta_add (&data->meta_grabber, bench_arena_grabber[i][0],
+                            bench_arena_grabber[i][1]);
+
+    /* the dbmanager releases the metadata of each grabber */
+    bench_arena_meta_free (data->meta_grabber);
+    data->meta_grabber = NULL;
+  }
+
+  bench_arena_meta_free (data->meta_parser);
+  for (item = data->grabber_list->item; item; item = item_n)
+  {
+    item_n = item->next;
+    free (item->data);
+    free (item);
+  }
+  free (data->grabber_list);
+  free (data->path);
+  free (data);
+}
+
+static void
+bench_arena_file (const char *file)
+{
+  unsigned int i, j;
+  file_data_t *data;
+  struct stat st;
+
+  memset (&st, 0, sizeof (st));
+  data = vh_file_data_new (file, &st, 0, OD_TYPE_DEF,
+                           FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
+  if (!data)
+    return;
+
+  for (i = 0; i < ARRAY_NB_ELEMENTS (bench_arena_parser); i++)
+    vh_metadata_add_auto (&data->meta_parser, data->arena,
+                          bench_arena_parser[i][0], bench_arena_parser[i][1],
+                          VALHALLA_LANG_UNDEF, &bench_arena_pl);
+
+  for (j = 0; j < BENCH_ARENA_GRABBERS; j++)
+  {
+    const char *name = bench_arena_grabber_names[j];
+
+    vh_list_append (data->grabber_list, name, strlen (name) + 1);
+    for (i = 0; i < ARRAY_NB_ELEMENTS (bench_arena_grabber); i++)
+      vh_metadata_add_auto (&data->meta_grabber, data->arena,
+                            bench_arena_grabber[i][0],
+                            bench_arena_grabber[i][1],
+                            VALHALLA_LANG_UNDEF, &bench_arena_pl);
+    data->meta_grabber = NULL;
+  }
+
+  vh_file_data_free (data);
+}
+
+static void
+bench_arena_run (const char *name, char **files,
+                 void (*file_fct) (const char *file))
+{
+  unsigned int i;
+  uint64_t t;
+
+#ifdef __GLIBC__
+  bench_arena_nb    = 0;
+  bench_arena_count = 1;
+#endif /* __GLIBC__ */
+
+  t = vh_bench_now ();
+  for (i = 0; i < BENCH_ARENA_FILES; i++)
+    file_fct (files[i]);
+  t = vh_bench_now () - t;
+
+#ifdef __GLIBC__
+  bench_arena_count = 0;
+#endif /* __GLIBC__ */
+
+  vh_bench_report (name, "files", BENCH_ARENA_FILES, t);
+#ifdef __GLIBC__
+  printf ("  %-40s %12llu %-6s %12.1f %s\n", "",
+          (unsigned long long) bench_arena_nb, "allocs",
+          (double) bench_arena_nb / BENCH_ARENA_FILES, "per file");
+#endif /* __GLIBC__ */
+}
+
+void
+vh_bench_arena (void)
+{
+  unsigned int i;
+  char **files;
+
+  vh_log_verb (VALHALLA_MSG_CRITICAL);
+
+  files = calloc (BENCH_ARENA_FILES, sizeof (*files));
+  if (!files)
+    return;
+
+  for (i = 0; i < BENCH_ARENA_FILES; i++)
+  {
+    char name[256];
+
+    snprintf (name, sizeof (name),
+              "/mnt/share/music/Artist %u/Album %u/%02u - Song %u.mp3",
+              i % 97, i % 13, i % 12 + 1, i);
+    files[i] = strdup (name);
+  }
+
+  bench_arena_run ("file data (malloc)", files, bench_arena_file_malloc);
+  bench_arena_run ("file data (arena)", files, bench_arena_file);
+
+  for (i = 0; i < BENCH_ARENA_FILES; i++)
+    free (files[i]);
+  free (files);
+}
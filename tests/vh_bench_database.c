@@ -0,0 +1,554 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "valhalla.h"
+#include "valhalla_internals.h"
+#include "metadata.h"
+#include "database.h"
+#include "logs.h"
+#include "stats.h"
+#include "vh_bench.h"
+
+#define BENCH_DATABASE_FILES    20000
+#define BENCH_DATABASE_COMMIT   128
+#define BENCH_DATABASE_READERS  4
+#define BENCH_BROWSE_LOOPS      2000
+#define BENCH_EXPORT_LOOPS      10
+#define BENCH_FACET_LOOPS       100
+#define BENCH_FILES_LOOPS       100
+#define BENCH_FILES_NB          200
+#define BENCH_SEARCH_TEXT       "title 1234"
+#define BENCH_SEARCH_MAX        20
+
+typedef struct bench_database_s {
+  database_t     *database;
+  int             stop;
+  pthread_mutex_t mutex;
+
+  uint64_t        nb;
+  uint64_t        sum;
+  uint64_t        max;
+} bench_database_t;
+
+static int
+bench_database_stopped (bench_database_t *b)
+{
+  int stop;
+
+  pthread_mutex_lock (&b->mutex);
+  stop = b->stop;
+  pthread_mutex_unlock (&b->mutex);
+  return stop;
+}
+
+/* Browse the artists like a frontend, while the files are inserted. */
+static void *
+bench_database_reader (void *arg)
+{
+  bench_database_t *b = arg;
+  valhalla_db_item_t search =
+    VALHALLA_DB_SEARCH_TEXT ("artist", ENTITIES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  while (!bench_database_stopped (b))
+  {
+    uint64_t t, start = vh_bench_now ();
+    valhalla_db_stmt_t *vhstmt;
+
+    vhstmt = vh_database_metalist_get (b->database, &search,
+                                       VALHALLA_FILE_TYPE_NULL, NULL, NULL);
+    if (vhstmt)
+      while (vh_database_metalist_read (b->database, vhstmt))
+        ;
+
+    t = vh_bench_now () - start;
+    pthread_mutex_lock (&b->mutex);
+    b->nb++;
+    b->sum += t;
+    if (t > b->max)
+      b->max = t;
+    pthread_mutex_unlock (&b->mutex);
+
+    usleep (1000);
+  }
+
+  return NULL;
+}
+
+static uint64_t
+bench_database_insert (database_t *database)
+{
+  int i;
+  char path[64], value[64];
+  struct stat st;
+  uint64_t start;
+  const metadata_plist_t pl = {
+    .metadata = NULL,
+    .priority = VALHALLA_METADATA_PL_NORMAL
+  };
+
+  memset (&st, 0, sizeof (st));
+  start = vh_bench_now ();
+
+  vh_database_begin_transaction (database);
+  for (i = 0; i < BENCH_DATABASE_FILES; i++)
+  {
+    file_data_t *data;
+
+    snprintf (path, sizeof (path), "/media/dir%i/file%i.ogg", i % 64, i);
+    data = vh_file_data_new (path, &st, 0, OD_TYPE_DEF,
+                             FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
+    if (!data)
+      continue;
+
+    snprintf (value, sizeof (value), "title %i", i);
+    vh_metadata_add_auto (&data->meta_parser, data->arena,
+                          VALHALLA_METADATA_TITLE, value, VALHALLA_LANG_UNDEF,
+                          &pl);
+    snprintf (value, sizeof (value), "artist %i", i % 500);
+    vh_metadata_add_auto (&data->meta_parser, data->arena,
+                          VALHALLA_METADATA_ARTIST, value, VALHALLA_LANG_UNDEF,
+                          &pl);
+
+    vh_database_file_insert (database, data);
+    vh_database_file_data_update (database, data);
+    vh_database_step_transaction (database, BENCH_DATABASE_COMMIT, i);
+    vh_file_data_free (data);
+  }
+  vh_database_end_transaction (database);
+
+  return vh_bench_now () - start;
+}
+
+static void
+bench_database_journal (valhalla_db_journal_t journal, const char *name)
+{
+  char dir[] = "/tmp/vh_bench_XXXXXX";
+  char db[64], label[80];
+  uint64_t ns;
+  int i;
+  pthread_t thread[BENCH_DATABASE_READERS];
+  bench_database_t b;
+
+  if (!mkdtemp (dir))
+    return;
+
+  snprintf (db, sizeof (db), "%s/bench.db", dir);
+
+  memset (&b, 0, sizeof (b));
+  pthread_mutex_init (&b.mutex, NULL);
+
+  b.database = vh_database_init (db, 0);
+  if (!b.database)
+    goto out;
+
+  vh_database_pragma_set (b.database, DATABASE_PRAGMA_JOURNAL, journal);
+
+  /* the readers are concurrent, each one uses its own connection */
+  for (i = 0; i < BENCH_DATABASE_READERS; i++)
+    pthread_create (&thread[i], NULL, bench_database_reader, &b);
+  ns = bench_database_insert (b.database);
+
+  pthread_mutex_lock (&b.mutex);
+  b.stop = 1;
+  pthread_mutex_unlock (&b.mutex);
+  for (i = 0; i < BENCH_DATABASE_READERS; i++)
+    pthread_join (thread[i], NULL);
+
+  snprintf (label, sizeof (label), "insert (%s)", name);
+  vh_bench_report (label, "files", BENCH_DATABASE_FILES, ns);
+  printf ("  %-40s %12llu %-6s %10.3f ms (average) %10.3f ms (max)\n",
+          "metalist while inserting", (unsigned long long) b.nb, "reads",
+          b.nb ? b.sum / b.nb / 1000000.0 : 0.0, b.max / 1000000.0);
+
+  vh_database_uninit (b.database);
+ out:
+  pthread_mutex_destroy (&b.mutex);
+  snprintf (label, sizeof (label), "%s-wal", db);
+  unlink (label);
+  snprintf (label, sizeof (label), "%s-shm", db);
+  unlink (label);
+  unlink (db);
+  rmdir (dir);
+}
+
+void
+vh_bench_database (void)
+{
+  vh_log_verb (VALHALLA_MSG_WARNING);
+
+  bench_database_journal (VALHALLA_DB_JOURNAL_DELETE, "journal delete");
+  bench_database_journal (VALHALLA_DB_JOURNAL_WAL,    "journal wal");
+}
+
+static void
+bench_browse_loop (database_t *database, int i)
+{
+  char artist[64];
+  valhalla_db_stmt_t *vhstmt;
+  valhalla_db_item_t search =
+    VALHALLA_DB_SEARCH_TEXT ("title", TITLES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_restrict_t r =
+    VALHALLA_DB_RESTRICT_STR (EQUAL, "artist", artist,
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  snprintf (artist, sizeof (artist), "artist %i", i % 500);
+
+  /* titles of an artist */
+  vhstmt = vh_database_metalist_get (database, &search,
+                                     VALHALLA_FILE_TYPE_NULL, &r, NULL);
+  if (vhstmt)
+    while (vh_database_metalist_read (database, vhstmt))
+      ;
+
+  /* files of an artist */
+  r.op = VALHALLA_DB_OPERATOR_IN;
+  vhstmt = vh_database_filelist_get (database,
+                                     VALHALLA_FILE_TYPE_NULL, &r, NULL);
+  if (vhstmt)
+    while (vh_database_filelist_read (database, vhstmt))
+      ;
+
+  /* metadata of a file */
+  vhstmt = vh_database_file_get (database, i % BENCH_DATABASE_FILES + 1,
+                                 NULL, NULL);
+  if (vhstmt)
+    while (vh_database_file_read (database, vhstmt))
+      ;
+}
+
+/* All metadata and all files, like an export of the library. */
+static uint64_t
+bench_browse_export (database_t *database)
+{
+  int i;
+  uint64_t rows = 0;
+  valhalla_db_stmt_t *vhstmt;
+  valhalla_db_item_t search =
+    VALHALLA_DB_SEARCH_GRP (NIL, VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  for (i = 0; i < BENCH_EXPORT_LOOPS; i++)
+  {
+    vhstmt = vh_database_metalist_get (database, &search,
+                                       VALHALLA_FILE_TYPE_NULL, NULL, NULL);
+    if (vhstmt)
+      while (vh_database_metalist_read (database, vhstmt))
+        rows++;
+
+    vhstmt = vh_database_filelist_get (database,
+                                       VALHALLA_FILE_TYPE_NULL, NULL, NULL);
+    if (vhstmt)
+      while (vh_database_filelist_read (database, vhstmt))
+        rows++;
+  }
+
+  return rows;
+}
+
+/* Number of files by artist, row by row like without the counts. */
+static uint64_t
+bench_browse_facet_rows (database_t *database)
+{
+  int i;
+  uint64_t rows = 0;
+  char artist[64];
+  valhalla_db_restrict_t r =
+    VALHALLA_DB_RESTRICT_STR (IN, "artist", artist,
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  for (i = 0; i < 500; i++)
+  {
+    valhalla_db_stmt_t *vhstmt;
+
+    snprintf (artist, sizeof (artist), "artist %i", i);
+    vhstmt = vh_database_filelist_get (database,
+                                       VALHALLA_FILE_TYPE_NULL, &r, NULL);
+    if (vhstmt)
+      while (vh_database_filelist_read (database, vhstmt))
+        rows++;
+  }
+
+  return rows;
+}
+
+static uint64_t
+bench_browse_facet (database_t *database)
+{
+  uint64_t rows = 0;
+  valhalla_db_stmt_t *vhstmt;
+  const valhalla_db_countres_t *res;
+  valhalla_db_item_t artist =
+    VALHALLA_DB_SEARCH_TEXT ("artist", ENTITIES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  vhstmt = vh_database_facet_get (database, &artist, NULL,
+                                  VALHALLA_FILE_TYPE_NULL, NULL);
+  if (vhstmt)
+    while ((res = vh_database_facet_read (database, vhstmt)))
+      rows += res->count;
+
+  return rows;
+}
+
+/* Three restrictions on the files (IN, IN and NOT IN). */
+static uint64_t
+bench_browse_restrictions (database_t *database)
+{
+  int i;
+  uint64_t rows = 0;
+  char artist[64], title1[64], title2[64];
+  valhalla_db_restrict_t r1 =
+    VALHALLA_DB_RESTRICT_STR (IN, "artist", artist,
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_restrict_t r2 =
+    VALHALLA_DB_RESTRICT_STR (IN, "title", NULL,
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_restrict_t r3 =
+    VALHALLA_DB_RESTRICT_STR (NOTIN, "title", title1,
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_restrict_t r4 =
+    VALHALLA_DB_RESTRICT_STR (NOTIN, "title", title2,
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  VALHALLA_DB_RESTRICT_LINK (r2, r1);
+  VALHALLA_DB_RESTRICT_LINK (r3, r2);
+  VALHALLA_DB_RESTRICT_LINK (r4, r3);
+
+  for (i = 0; i < 500; i++)
+  {
+    valhalla_db_stmt_t *vhstmt;
+
+    snprintf (artist, sizeof (artist), "artist %i", i);
+    snprintf (title1, sizeof (title1), "title %i", i);
+    snprintf (title2, sizeof (title2), "title %i", i + 500);
+    vhstmt = vh_database_filelist_get (database,
+                                       VALHALLA_FILE_TYPE_NULL, &r1, NULL);
+    if (vhstmt)
+      while (vh_database_filelist_read (database, vhstmt))
+        rows++;
+  }
+
+  return rows;
+}
+
+/* Metadata of a view of files, one statement per file. */
+static uint64_t
+bench_browse_files_each (database_t *database, int loop)
+{
+  int i;
+  uint64_t rows = 0;
+
+  for (i = 0; i < BENCH_FILES_NB; i++)
+  {
+    valhalla_db_stmt_t *vhstmt;
+    int64_t id = (loop * BENCH_FILES_NB + i) % BENCH_DATABASE_FILES + 1;
+
+    vhstmt = vh_database_file_get (database, id, NULL, NULL);
+    if (vhstmt)
+      while (vh_database_file_read (database, vhstmt))
+        rows++;
+  }
+
+  return rows;
+}
+
+/* Metadata of a view of files, only one statement. */
+static uint64_t
+bench_browse_files_bulk (database_t *database, int loop)
+{
+  int i;
+  uint64_t rows = 0;
+  int64_t ids[BENCH_FILES_NB];
+  valhalla_db_stmt_t *vhstmt;
+
+  for (i = 0; i < BENCH_FILES_NB; i++)
+    ids[i] = (loop * BENCH_FILES_NB + i) % BENCH_DATABASE_FILES + 1;
+
+  vhstmt = vh_database_files_get (database, ids, BENCH_FILES_NB,
+                                  VALHALLA_FILE_TYPE_NULL, NULL, NULL);
+  if (vhstmt)
+    while (vh_database_files_read (database, vhstmt))
+      rows++;
+
+  return rows;
+}
+
+/* All titles are read and compared, like a frontend without the search. */
+static uint64_t
+bench_browse_search_scan (database_t *database, const char *text)
+{
+  uint64_t rows = 0;
+  valhalla_db_stmt_t *vhstmt;
+  const valhalla_db_metares_t *res;
+  valhalla_db_item_t search =
+    VALHALLA_DB_SEARCH_TEXT ("title", TITLES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  vhstmt = vh_database_metalist_get (database, &search,
+                                     VALHALLA_FILE_TYPE_NULL, NULL, NULL);
+  if (vhstmt)
+    while ((res = vh_database_metalist_read (database, vhstmt)))
+      if (strstr (res->data_value, text))
+        rows++;
+
+  return rows;
+}
+
+static uint64_t
+bench_browse_search (database_t *database, const char *text)
+{
+  uint64_t rows = 0;
+  valhalla_db_stmt_t *vhstmt;
+
+  vhstmt = vh_database_search_get (database, text,
+                                   VALHALLA_FILE_TYPE_NULL, BENCH_SEARCH_MAX);
+  if (vhstmt)
+    while (vh_database_search_read (database, vhstmt))
+      rows++;
+
+  return rows;
+}
+
+/* The same shapes of queries are used again and again like a frontend. */
+void
+vh_bench_browse (void)
+{
+  char dir[] = "/tmp/vh_bench_XXXXXX";
+  char db[64], label[80];
+  int i;
+  uint64_t start, ns, rows;
+  database_t *database;
+  vh_stats_t *stats;
+  vh_stats_cnt_t *hit, *miss;
+
+  vh_log_verb (VALHALLA_MSG_WARNING);
+
+  if (!mkdtemp (dir))
+    return;
+
+  snprintf (db, sizeof (db), "%s/bench.db", dir);
+
+  stats = vh_stats_new ();
+  if (!stats)
+    goto out;
+
+  vh_stats_grp_add (stats, "bench", NULL, NULL);
+  hit  = vh_stats_grp_counter_add (stats, "bench", "cache_hit",  NULL);
+  miss = vh_stats_grp_counter_add (stats, "bench", "cache_miss", NULL);
+
+  database = vh_database_init (db, 0);
+  if (!database)
+    goto out;
+
+  vh_database_cache_stats_set (database, hit, miss);
+  bench_database_insert (database);
+
+  start = vh_bench_now ();
+  for (i = 0; i < BENCH_BROWSE_LOOPS; i++)
+    bench_browse_loop (database, i);
+  ns = vh_bench_now () - start;
+
+  vh_bench_report ("metalist, filelist, file", "queries",
+                   3 * BENCH_BROWSE_LOOPS, ns);
+  printf ("  %-40s %12llu %-6s %12llu %s\n", "statement cache",
+          (unsigned long long) vh_stats_counter_read (hit), "hits",
+          (unsigned long long) vh_stats_counter_read (miss), "misses");
+
+  start = vh_bench_now ();
+  rows = bench_browse_export (database);
+  ns = vh_bench_now () - start;
+  vh_bench_report ("export (all metadata and files)", "rows", rows, ns);
+
+  start = vh_bench_now ();
+  rows = bench_browse_facet_rows (database);
+  ns = vh_bench_now () - start;
+  vh_bench_report ("files by artist (filelist)", "files", rows, ns);
+
+  start = vh_bench_now ();
+  rows = bench_browse_facet (database);
+  ns = vh_bench_now () - start;
+  vh_bench_report ("files by artist (facet)", "files", rows, ns);
+
+  start = vh_bench_now ();
+  rows = bench_browse_restrictions (database);
+  ns = vh_bench_now () - start;
+  vh_bench_report ("files by artist (4 restrictions)", "files", rows, ns);
+
+  start = vh_bench_now ();
+  for (i = 0; i < BENCH_FACET_LOOPS; i++)
+    bench_browse_facet (database);
+  ns = vh_bench_now () - start;
+  vh_bench_report ("files by artist (facet, cached)", "facets",
+                   BENCH_FACET_LOOPS, ns);
+
+  start = vh_bench_now ();
+  for (rows = 0, i = 0; i < BENCH_FILES_LOOPS; i++)
+    rows += bench_browse_files_each (database, i);
+  ns = vh_bench_now () - start;
+  vh_bench_report ("view of 200 files (file)", "rows", rows, ns);
+
+  start = vh_bench_now ();
+  for (rows = 0, i = 0; i < BENCH_FILES_LOOPS; i++)
+    rows += bench_browse_files_bulk (database, i);
+  ns = vh_bench_now () - start;
+  vh_bench_report ("view of 200 files (files)", "rows", rows, ns);
+
+  /* a search for each key typed by the user */
+  for (i = 1; i <= (int) strlen (BENCH_SEARCH_TEXT); i++)
+  {
+    char text[sizeof (BENCH_SEARCH_TEXT)];
+
+    snprintf (text, i + 1, "%s", BENCH_SEARCH_TEXT);
+    if (text[i - 1] == ' ')
+      continue;
+
+    start = vh_bench_now ();
+    rows = bench_browse_search_scan (database, text);
+    ns = vh_bench_now () - start;
+    snprintf (label, sizeof (label), "search scan \"%s\"", text);
+    vh_bench_report (label, "rows", rows, ns);
+
+    start = vh_bench_now ();
+    rows = bench_browse_search (database, text);
+    ns = vh_bench_now () - start;
+    snprintf (label, sizeof (label), "search fts \"%s\"", text);
+    vh_bench_report (label, "rows", rows, ns);
+  }
+
+  vh_database_uninit (database);
+ out:
+  vh_stats_free (stats);
+  snprintf (label, sizeof (label), "%s-wal", db);
+  unlink (label);
+  snprintf (label, sizeof (label), "%s-shm", db);
+  unlink (label);
+  unlink (db);
+  rmdir (dir);
+}
@@ -0,0 +1,247 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "utils.h"
+#include "metadata.h"
+#include "vh_bench.h"
+
+#include "parser.c"
+
+#define BENCH_DECRAP_FILES    100000
+#define BENCH_DECRAP_KEYWORDS 300
+
+static const char *const bench_decrap_keywords[] = {
+  "xvid", "divx", "x264", "h264", "x265", "hevc", "avc", "mpeg2", "ac3",
+  "aac", "dts", "mp3", "dd5", "5 1", "720p", "1080p", "1080i", "480p",
+  "hdtv", "pdtv", "dsr", "dvdrip", "dvdscr", "bdrip", "brrip", "bluray",
+  "webrip", "webdl", "web", "hdrip", "cam", "ts", "tc", "r5", "screener",
+  "proper", "repack", "limited", "internal", "unrated", "extended",
+  "dc", "remastered", "french", "vostfr", "multi", "subbed", "dubbed",
+  "sSEeEP", "SExEP", "NumEP", "fileNUM", "cdNUM", "partNUM", "NUMp",
+};
+
+static const char *const bench_decrap_files[] = {
+  "The Valkyries s01e02 720p HDTV x264 GRP%u",
+  "My Movie 2010 DVDRip XviD AC3 grp%u",
+  "Another Show 3x07 PDTV XviD grp%u",
+  "The Episode   Pilot DivX  01x01  FooBar %u",
+  "Name of the episode Num05 %u",
+  "Some Film  1080p BluRay x264 DTS grp%u",
+  "Holiday Video %u",
+  "Documentary Part2 WEBRip AAC grp%u",
+};
+
+/* Previous implementation of the decrapifier, with sscanf(). */
+static void
+bench_decrap_pattern_sscanf (char *str, const char *bl,
+                             unsigned int *se, unsigned int *ep)
+{
+  char pattern[64];
+  int res, len_s = 0, len_e = 0;
+  char *it, *it1, *it2;
+
+  snprintf (pattern, sizeof (pattern), "%%n%s%%n", bl);
+  while ((it = strstr (pattern, PATTERN_NUMBER)))
+    memcpy (it, "%*u", 3);
+
+  it1 = strstr (pattern, PATTERN_SEASON);
+  it2 = strstr (pattern, PATTERN_EPISODE);
+  if (it1)
+    memcpy (it1, "%u", 2);
+  if (it2)
+    memcpy (it2, "%u", 2);
+
+  it = str;
+  do
+  {
+    len_s = 0;
+    if (!it1 && it2)
+      res = sscanf (it, pattern, &len_s, ep, &len_e);
+    else if (!it2 && it1)
+      res = sscanf (it, pattern, &len_s, se, &len_e);
+    else if (it1 && it2)
+    {
+      if (it1 < it2)
+        res = sscanf (it, pattern, &len_s, se, ep, &len_e);
+      else
+        res = sscanf (it, pattern, &len_s, ep, se, &len_e);
+      if (!*ep)
+        *se = 0;
+      if (!*se)
+        *ep = 0;
+    }
+    else
+      res = sscanf (it, pattern, &len_s, &len_e);
+    it += len_s + 1;
+  }
+  while (!len_e && res != EOF);
+
+  if (len_e <= len_s)
+    return;
+
+  it--;
+
+  if ((it == str || *it == ' ' || *(it - 1) == ' ')
+      && (   *(it + len_e - len_s) == ' '
+          || *(it + len_e - len_s) == '\0'))
+    memset (it, ' ', len_e - len_s);
+  else
+  {
+    *se = 0;
+    *ep = 0;
+  }
+}
+
+static void
+bench_decrap_strcasestr (char **list, char *str, unsigned int *nb_meta)
+{
+  char **l;
+
+  for (l = list; l && *l; l++)
+  {
+    size_t size;
+    char *p;
+
+    if (   strstr (*l, PATTERN_NUMBER)
+        || strstr (*l, PATTERN_SEASON)
+        || strstr (*l, PATTERN_EPISODE))
+    {
+      unsigned int se = 0, ep = 0;
+
+      bench_decrap_pattern_sscanf (str, *l, &se, &ep);
+      *nb_meta += !!se + !!ep;
+      continue;
+    }
+
+    p = strcasestr (str, *l);
+    if (!p)
+      continue;
+
+    size = strlen (*l);
+    if (!VH_ISGRAPH (*(p + size)) && (p == str || !VH_ISGRAPH (*(p - 1))))
+      memset (p, ' ', size);
+  }
+}
+
+static void
+bench_decrap_run (char **list, char **files, char **res)
+{
+  unsigned int i, nb_meta = 0, diff = 0;
+  uint64_t t;
+  parser_bl_t *bl;
+
+  t = vh_bench_now ();
+  for (i = 0; i < BENCH_DECRAP_FILES; i++)
+  {
+    strcpy (res[i], files[i]);
+    bench_decrap_strcasestr (list, res[i], &nb_meta);
+  }
+  vh_bench_report ("blacklist (strcasestr and sscanf)", "files",
+                   BENCH_DECRAP_FILES, vh_bench_now () - t);
+
+  t = vh_bench_now ();
+  bl = parser_bl_compile (list);
+  if (!bl)
+    return;
+  vh_bench_report ("blacklist compilation", "words",
+                   BENCH_DECRAP_KEYWORDS, vh_bench_now () - t);
+
+  t = vh_bench_now ();
+  for (i = 0; i < BENCH_DECRAP_FILES; i++)
+  {
+    char str[256];
+    metadata_t *meta = NULL;
+
+    strcpy (str, files[i]);
+    parser_decrap_blacklist (bl, str, &meta, NULL);
+    if (strcmp (str, res[i]))
+      diff++;
+    vh_metadata_free (meta);
+  }
+  vh_bench_report ("blacklist (automaton)", "files",
+                   BENCH_DECRAP_FILES, vh_bench_now () - t);
+
+  printf ("  %u seasons and episodes found\n", nb_meta);
+  if (diff)
+    printf ("  the results are different for %u files\n", diff);
+
+  parser_bl_free (bl);
+}
+
+void
+vh_bench_decrapifier (void)
+{
+  unsigned int i;
+  const unsigned int nb = ARRAY_NB_ELEMENTS (bench_decrap_keywords);
+  char *list[BENCH_DECRAP_KEYWORDS + 1];
+  char **files, **res;
+
+  files = calloc (BENCH_DECRAP_FILES, sizeof (*files));
+  res   = calloc (BENCH_DECRAP_FILES, sizeof (*res));
+  if (!files || !res)
+    goto out;
+
+  /* the common keywords then the names of the release groups */
+  for (i = 0; i < BENCH_DECRAP_KEYWORDS; i++)
+  {
+    char word[32];
+
+    if (i < nb)
+      list[i] = strdup (bench_decrap_keywords[i]);
+    else
+    {
+      snprintf (word, sizeof (word), "grp%u", i - nb);
+      list[i] = strdup (word);
+    }
+  }
+  list[BENCH_DECRAP_KEYWORDS] = NULL;
+
+  for (i = 0; i < BENCH_DECRAP_FILES; i++)
+  {
+    char name[256];
+    const char *fmt =
+      bench_decrap_files[i % ARRAY_NB_ELEMENTS (bench_decrap_files)];
+
+    snprintf (name, sizeof (name), fmt, i % 997);
+    files[i] = strdup (name);
+    res[i]   = malloc (sizeof (name));
+  }
+
+  bench_decrap_run (list, files, res);
+
+  for (i = 0; i < BENCH_DECRAP_KEYWORDS; i++)
+    free (list[i]);
+ out:
+  for (i = 0; files && res && i < BENCH_DECRAP_FILES; i++)
+  {
+    free (files[i]);
+    free (res[i]);
+  }
+  free (files);
+  free (res);
+}
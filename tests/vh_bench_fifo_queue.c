@@ -0,0 +1,264 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fifo_queue.h"
+#include "vh_bench.h"
+
+#define BENCH_FIFO_QUEUE_ITEMS  (1 << 21)
+#define BENCH_FIFO_QUEUE_STOP   -1
+
+typedef struct bench_fifo_queue_ops_s {
+  const char *name;
+  void *(*new)  (void);
+  void  (*free) (void *queue);
+  int   (*push) (void *queue, int id, void *data);
+  int   (*pop)  (void *queue, int *id, void **data);
+} bench_fifo_queue_ops_t;
+
+typedef struct bench_fifo_queue_s {
+  const bench_fifo_queue_ops_t *ops;
+  void *queue;
+  int   nb;
+} bench_fifo_queue_t;
+
+/* Previous implementation of fifo_queue_t (linked list and semaphore). */
+typedef struct bench_fifo_queue_item_s {
+  int id;
+  void *data;
+  struct bench_fifo_queue_item_s *next;
+} bench_fifo_queue_item_t;
+
+typedef struct bench_fifo_queue_list_s {
+  bench_fifo_queue_item_t *item;
+  bench_fifo_queue_item_t *item_last;
+  pthread_mutex_t mutex;
+  sem_t sem;
+} bench_fifo_queue_list_t;
+
+static void *
+bench_fifo_queue_list_new (void)
+{
+  bench_fifo_queue_list_t *queue;
+
+  queue = calloc (1, sizeof (bench_fifo_queue_list_t));
+  if (!queue)
+    return NULL;
+
+  pthread_mutex_init (&queue->mutex, NULL);
+  sem_init (&queue->sem, 0, 0);
+
+  return queue;
+}
+
+static void
+bench_fifo_queue_list_free (void *data)
+{
+  bench_fifo_queue_list_t *queue = data;
+  bench_fifo_queue_item_t *item, *next;
+
+  for (item = queue->item; item; item = next)
+  {
+    next = item->next;
+    free (item);
+  }
+
+  pthread_mutex_destroy (&queue->mutex);
+  sem_destroy (&queue->sem);
+  free (queue);
+}
+
+static int
+bench_fifo_queue_list_push (void *data, int id, void *item_data)
+{
+  bench_fifo_queue_list_t *queue = data;
+  bench_fifo_queue_item_t *item;
+
+  item = calloc (1, sizeof (bench_fifo_queue_item_t));
+  if (!item)
+    return FIFO_QUEUE_ERROR_MALLOC;
+
+  item->id   = id;
+  item->data = item_data;
+
+  pthread_mutex_lock (&queue->mutex);
+  if (queue->item)
+    queue->item_last->next = item;
+  else
+    queue->item = item;
+  queue->item_last = item;
+
+  sem_post (&queue->sem);
+  pthread_mutex_unlock (&queue->mutex);
+
+  return FIFO_QUEUE_SUCCESS;
+}
+
+static int
+bench_fifo_queue_list_pop (void *data, int *id, void **item_data)
+{
+  bench_fifo_queue_list_t *queue = data;
+  bench_fifo_queue_item_t *item;
+
+  sem_wait (&queue->sem);
+
+  pthread_mutex_lock (&queue->mutex);
+  item = queue->item;
+  if (!item)
+  {
+    pthread_mutex_unlock (&queue->mutex);
+    return FIFO_QUEUE_ERROR_EMPTY;
+  }
+
+  *id        = item->id;
+  *item_data = item->data;
+  queue->item = item->next;
+  pthread_mutex_unlock (&queue->mutex);
+
+  free (item);
+  return FIFO_QUEUE_SUCCESS;
+}
+
+static void *
+bench_fifo_queue_ring_new (void)
+{
+  return vh_fifo_queue_new ();
+}
+
+static void
+bench_fifo_queue_ring_free (void *queue)
+{
+  vh_fifo_queue_free (queue);
+}
+
+static int
+bench_fifo_queue_ring_push (void *queue, int id, void *data)
+{
+  return vh_fifo_queue_push (queue, FIFO_QUEUE_PRIORITY_NORMAL, id, data);
+}
+
+static int
+bench_fifo_queue_ring_pop (void *queue, int *id, void **data)
+{
+  return vh_fifo_queue_pop (queue, id, data);
+}
+
+static const bench_fifo_queue_ops_t bench_fifo_queue_ops[] = {
+  { "list", bench_fifo_queue_list_new, bench_fifo_queue_list_free,
+            bench_fifo_queue_list_push, bench_fifo_queue_list_pop },
+  { "ring", bench_fifo_queue_ring_new, bench_fifo_queue_ring_free,
+            bench_fifo_queue_ring_push, bench_fifo_queue_ring_pop },
+};
+
+static void *
+bench_fifo_queue_producer (void *arg)
+{
+  int i;
+  bench_fifo_queue_t *b = arg;
+
+  for (i = 0; i < b->nb; i++)
+    b->ops->push (b->queue, i, (void *) (intptr_t) (i + 1));
+
+  return NULL;
+}
+
+static void *
+bench_fifo_queue_consumer (void *arg)
+{
+  int id;
+  void *data;
+  bench_fifo_queue_t *b = arg;
+
+  for (;;)
+  {
+    if (b->ops->pop (b->queue, &id, &data))
+      continue;
+    if (id == BENCH_FIFO_QUEUE_STOP)
+      break;
+  }
+
+  return NULL;
+}
+
+static void
+bench_fifo_queue_run (const bench_fifo_queue_ops_t *ops,
+                      int producers, int consumers)
+{
+  int i;
+  uint64_t t;
+  char name[64];
+  pthread_t prod[16], cons[16];
+  bench_fifo_queue_t b;
+
+  b.ops   = ops;
+  b.queue = ops->new ();
+  if (!b.queue)
+    return;
+
+  b.nb = BENCH_FIFO_QUEUE_ITEMS / producers;
+
+  t = vh_bench_now ();
+
+  for (i = 0; i < consumers; i++)
+    pthread_create (&cons[i], NULL, bench_fifo_queue_consumer, &b);
+  for (i = 0; i < producers; i++)
+    pthread_create (&prod[i], NULL, bench_fifo_queue_producer, &b);
+
+  for (i = 0; i < producers; i++)
+    pthread_join (prod[i], NULL);
+  for (i = 0; i < consumers; i++)
+    ops->push (b.queue, BENCH_FIFO_QUEUE_STOP, NULL);
+  for (i = 0; i < consumers; i++)
+    pthread_join (cons[i], NULL);
+
+  t = vh_bench_now () - t;
+
+  snprintf (name, sizeof (name), "%s, %2i producer(s) / %i consumer(s)",
+            ops->name, producers, consumers);
+  vh_bench_report (name, "items", (uint64_t) b.nb * producers, t);
+
+  ops->free (b.queue);
+}
+
+/*
+ * Throughput of the queue with several producers. One consumer is the usual
+ * case (dbmanager, dispatcher), four consumers is like the parsers pool.
+ * The previous queue (list) is the baseline for the ring.
+ */
+void
+vh_bench_fifo_queue (void)
+{
+  unsigned int i, j;
+  const int producers[] = { 1, 4, 16 };
+
+  for (i = 0; i < sizeof (producers) / sizeof (*producers); i++)
+    for (j = 0; j < sizeof (bench_fifo_queue_ops)
+                    / sizeof (*bench_fifo_queue_ops); j++)
+    {
+      bench_fifo_queue_run (&bench_fifo_queue_ops[j], producers[i], 1);
+      bench_fifo_queue_run (&bench_fifo_queue_ops[j], producers[i], 4);
+    }
+}
@@ -0,0 +1,279 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <libavformat/avformat.h>
+
+#include "valhalla.h"
+#include "logs.h"
+#include "lavf_utils.h"
+#include "metadata.h"
+#include "tag_reader.h"
+#include "vh_bench.h"
+
+#define BENCH_LAVF_CORPUS_ENV "VH_BENCH_CORPUS"
+#define BENCH_LAVF_FILES_MAX  4096
+
+static const metadata_plist_t bench_lavf_pl = {
+  .metadata = NULL,
+  .priority = VALHALLA_METADATA_PL_HIGHEST
+};
+
+typedef struct bench_lavf_corpus_s {
+  char        *files[BENCH_LAVF_FILES_MAX];
+  unsigned int nb;
+} bench_lavf_corpus_t;
+
+static void
+bench_lavf_corpus_load (bench_lavf_corpus_t *corpus, const char *dir)
+{
+  DIR *d;
+  struct dirent *ent;
+
+  d = opendir (dir);
+  if (!d)
+    return;
+
+  while ((ent = readdir (d)) && corpus->nb < BENCH_LAVF_FILES_MAX)
+  {
+    char path[4096];
+    struct stat st;
+
+    if (*ent->d_name == '.')
+      continue;
+
+    snprintf (path, sizeof (path), "%s/%s", dir, ent->d_name);
+    if (stat (path, &st))
+      continue;
+
+    if (S_ISDIR (st.st_mode))
+      bench_lavf_corpus_load (corpus, path);
+    else if (S_ISREG (st.st_mode))
+      corpus->files[corpus->nb++] = strdup (path);
+  }
+
+  closedir (d);
+}
+
+/* Bytes read by the process with read() and pread() (Linux only). */
+static uint64_t
+bench_lavf_rchar (void)
+{
+  FILE *f;
+  char line[128];
+  unsigned long long rchar = 0;
+
+  f = fopen ("/proc/self/io", "r");
+  if (!f)
+    return 0;
+
+  while (fgets (line, sizeof (line), f))
+    if (sscanf (line, "rchar: %llu", &rchar) == 1)
+      break;
+
+  fclose (f);
+  return rchar;
+}
+
+/* Open like before, the file protocol of FFmpeg reads the probe again. */
+static int
+bench_lavf_open_file (const char *file)
+{
+  AVFormatContext *ctx = NULL;
+
+  if (avformat_open_input (&ctx, file, NULL, NULL))
+    return -1;
+
+  avformat_close_input (&ctx);
+  return 0;
+}
+
+static int
+bench_lavf_open_utils (const char *file)
+{
+  AVFormatContext *ctx;
+
+  ctx = vh_lavf_utils_open_input_file (file, NULL);
+  if (!ctx)
+    return -1;
+
+  vh_lavf_utils_close_input_file (&ctx);
+  return 0;
+}
+
+/* The parser then the grabber ffmpeg, each one opens the file. */
+static int
+bench_lavf_open_twice (const char *file)
+{
+  AVFormatContext *ctx;
+  lavf_utils_props_t *props;
+
+  if (bench_lavf_open_utils (file))
+    return -1;
+
+  ctx = vh_lavf_utils_open_input_file (file, NULL);
+  if (!ctx)
+    return -1;
+
+  props = vh_lavf_utils_props_get (ctx);
+  vh_lavf_utils_close_input_file (&ctx);
+  free (props);
+  return 0;
+}
+
+/* The parser reads the streams for the grabber (PARSER_STREAMINFO). */
+static int
+bench_lavf_open_combined (const char *file)
+{
+  AVFormatContext *ctx;
+  lavf_utils_props_t *props;
+
+  ctx = vh_lavf_utils_open_input_file (file, NULL);
+  if (!ctx)
+    return -1;
+
+  props = vh_lavf_utils_props_get (ctx);
+  vh_lavf_utils_close_input_file (&ctx);
+  free (props);
+  return 0;
+}
+
+/* The tags like the parser, always with lavf. */
+static int
+bench_lavf_tags_lavf (const char *file)
+{
+  unsigned int i;
+  AVFormatContext *ctx;
+  AVDictionaryEntry *tag = NULL;
+  metadata_t *meta = NULL;
+
+  ctx = vh_lavf_utils_open_input_file (file, NULL);
+  if (!ctx)
+    return -1;
+
+  while ((tag = av_dict_get (ctx->metadata, "", tag, AV_DICT_IGNORE_SUFFIX)))
+    vh_metadata_add_auto (&meta, NULL, tag->key, tag->value,
+                          VALHALLA_LANG_UNDEF, &bench_lavf_pl);
+
+  for (i = 0; i < ctx->nb_streams; i++)
+    while ((tag = av_dict_get (ctx->streams[i]->metadata,
+                               "", tag, AV_DICT_IGNORE_SUFFIX)))
+      vh_metadata_add_auto (&meta, NULL, tag->key, tag->value,
+                            VALHALLA_LANG_UNDEF, &bench_lavf_pl);
+
+  vh_lavf_utils_close_input_file (&ctx);
+  vh_metadata_free (meta);
+  return 0;
+}
+
+/* The tags with the tag reader (PARSER_TAGREADER), else with lavf. */
+static int
+bench_lavf_tags_reader (const char *file)
+{
+  metadata_t *meta = NULL;
+
+  if (vh_tag_reader_get (file, &meta, NULL))
+    return bench_lavf_tags_lavf (file);
+
+  vh_metadata_free (meta);
+  return 0;
+}
+
+static void
+bench_lavf_run (bench_lavf_corpus_t *corpus,
+                const char *name, int (*open) (const char *file))
+{
+  unsigned int i, nb = 0;
+  uint64_t start, ns, bytes;
+
+  bytes = bench_lavf_rchar ();
+  start = vh_bench_now ();
+  for (i = 0; i < corpus->nb; i++)
+    if (!open (corpus->files[i]))
+      nb++;
+  ns = vh_bench_now () - start;
+  bytes = bench_lavf_rchar () - bytes;
+
+  vh_bench_report (name, "files", nb, ns);
+  printf ("  %-40s %12llu %-6s %12llu %s\n", "",
+          (unsigned long long) (nb ? bytes / nb : 0), "bytes",
+          (unsigned long long) (nb ? ns / nb / 1000 : 0), "us/file");
+}
+
+/*
+ * Usage: VH_BENCH_CORPUS=<dir> vh_bench lavf_utils
+ *
+ * The files are opened one time before the measures, then the page cache
+ * is the same for all the runs. The bytes are counted even from the cache.
+ */
+void
+vh_bench_lavf_utils (void)
+{
+  unsigned int i, nb = 0;
+  const char *dir;
+  bench_lavf_corpus_t corpus;
+
+  vh_log_verb (VALHALLA_MSG_CRITICAL);
+  av_log_set_level (AV_LOG_FATAL);
+  av_register_all ();
+
+  dir = getenv (BENCH_LAVF_CORPUS_ENV);
+  if (!dir)
+  {
+    printf ("  %s is not set, no corpus of media files\n",
+            BENCH_LAVF_CORPUS_ENV);
+    return;
+  }
+
+  memset (&corpus, 0, sizeof (corpus));
+  bench_lavf_corpus_load (&corpus, dir);
+
+  for (i = 0; i < corpus.nb; i++)
+  {
+    metadata_t *meta = NULL;
+
+    bench_lavf_open_file (corpus.files[i]);
+    if (!vh_tag_reader_get (corpus.files[i], &meta, NULL))
+      nb++;
+    vh_metadata_free (meta);
+  }
+
+  bench_lavf_run (&corpus, "open (file protocol)", bench_lavf_open_file);
+  bench_lavf_run (&corpus, "open (probe and pread)", bench_lavf_open_utils);
+  bench_lavf_run (&corpus, "parser and grabber (two opens)",
+                  bench_lavf_open_twice);
+  bench_lavf_run (&corpus, "parser and grabber (combined)",
+                  bench_lavf_open_combined);
+
+  printf ("  %u of %u files are read by the tag reader\n", nb, corpus.nb);
+  bench_lavf_run (&corpus, "parser tags (lavf)", bench_lavf_tags_lavf);
+  bench_lavf_run (&corpus, "parser tags (tag reader, else lavf)",
+                  bench_lavf_tags_reader);
+
+  for (i = 0; i < corpus.nb; i++)
+    free (corpus.files[i]);
+}
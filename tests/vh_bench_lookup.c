@@ -0,0 +1,188 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libavformat/avformat.h>
+
+#include "valhalla.h"
+#include "utils.h"
+#include "lavf_utils.h"
+#include "metadata.h"
+#include "vh_bench.h"
+
+#include "scanner.c"
+
+#define BENCH_LOOKUP_FILES 100000
+
+/* The default suffixes of libvalhalla-test. */
+static const char *const bench_lookup_suffixes[] = {
+  "flac", "m4a", "mp3",  "ogg", "wav", "wma",
+  "avi",  "mkv", "mov",  "mpg", "wmv",
+  "bmp",  "gif", "jpeg", "jpg", "png", "tga", "tif", "tiff",
+  NULL
+};
+
+/* Suffixes of the files in the shares (not all are accepted). */
+static const char *const bench_lookup_files[] = {
+  "mp3", "mp3", "MP3", "flac", "flac", "m4a", "ogg", "jpg", "png", "mkv",
+  "avi", "nfo", "txt", "cue", "log", "srt", "tar.gz", "part",
+};
+
+/* Keys of the tags given to vh_metadata_add_auto() by the parser. */
+static const char *const bench_lookup_keys[] = {
+  "title", "artist", "album", "track", "date", "genre", "album_artist",
+  "composer", "comment", "encoder", "disc", "TITLE", "ARTIST", "tsrc",
+  "major_brand", "compatible_brands", "creation_time", "language",
+};
+
+/* The suffixes given to vh_lavf_utils_fmtname_get() by the parser. */
+static const char *const bench_lookup_fmt[] = {
+  "mp3", "flac", "m4a", "mp4", "mkv", "avi", "jpg", "png", "ogg", "mpg",
+  "MP3", "JPG", "wav", "wma", "tif", "3gp", "m2a", "y4m",
+};
+
+/* Previous implementation of the scanner, with strrcasestr(). */
+static int
+bench_lookup_linear (const char *const *suffix, const char *file)
+{
+  for (; *suffix; suffix++)
+  {
+    const char *it = NULL, *ptr, *buf = file;
+
+    while ((ptr = strcasestr (buf, *suffix)))
+    {
+      it  = ptr;
+      buf = ptr + strlen (*suffix);
+    }
+
+    if (it && (it > file)
+        && *(it + strlen (*suffix)) == '\0' && *(it - 1) == '.')
+      return 0;
+  }
+
+  return -1;
+}
+
+static void
+bench_lookup_suffix (char **files)
+{
+  unsigned int i, nb = 0, nb_set = 0;
+  const char *const *it;
+  uint64_t t;
+  scanner_suffixes_t suffixes = { NULL, 0 };
+
+  for (it = bench_lookup_suffixes; *it; it++)
+    scanner_suffixes_add (&suffixes, *it);
+
+  t = vh_bench_now ();
+  for (i = 0; i < BENCH_LOOKUP_FILES; i++)
+    if (!bench_lookup_linear (bench_lookup_suffixes, files[i]))
+      nb++;
+  vh_bench_report ("suffixes (linear)", "files",
+                   BENCH_LOOKUP_FILES, vh_bench_now () - t);
+
+  t = vh_bench_now ();
+  for (i = 0; i < BENCH_LOOKUP_FILES; i++)
+    if (!scanner_suffixes_get (&suffixes, files[i]))
+      nb_set++;
+  vh_bench_report ("suffixes (bsearch)", "files",
+                   BENCH_LOOKUP_FILES, vh_bench_now () - t);
+
+  if (nb != nb_set)
+    printf ("  the results are different (%u != %u)\n", nb, nb_set);
+
+  scanner_suffixes_free (&suffixes);
+}
+
+static void
+bench_lookup_group (void)
+{
+  unsigned int i, j, misc = 0;
+  const unsigned int nb = ARRAY_NB_ELEMENTS (bench_lookup_keys);
+  uint64_t t;
+
+  t = vh_bench_now ();
+  for (i = 0; i < BENCH_LOOKUP_FILES; i++)
+    for (j = 0; j < nb; j++)
+      if (vh_metadata_group_get (bench_lookup_keys[j])
+          == VALHALLA_META_GRP_MISCELLANEOUS)
+        misc++;
+  vh_bench_report ("metadata groups", "keys",
+                   (uint64_t) BENCH_LOOKUP_FILES * nb, vh_bench_now () - t);
+
+  if (!misc)
+    printf ("  no key without group\n");
+}
+
+static void
+bench_lookup_fmtname (void)
+{
+  unsigned int i, j, found = 0;
+  const unsigned int nb = ARRAY_NB_ELEMENTS (bench_lookup_fmt);
+  uint64_t t;
+
+  t = vh_bench_now ();
+  for (i = 0; i < BENCH_LOOKUP_FILES; i++)
+    for (j = 0; j < nb; j++)
+      if (vh_lavf_utils_fmtname_get (bench_lookup_fmt[j])
+          != bench_lookup_fmt[j])
+        found++;
+  vh_bench_report ("format names", "suffix",
+                   (uint64_t) BENCH_LOOKUP_FILES * nb, vh_bench_now () - t);
+
+  if (!found)
+    printf ("  no format name found\n");
+}
+
+void
+vh_bench_lookup (void)
+{
+  unsigned int i;
+  char **files;
+
+  files = calloc (BENCH_LOOKUP_FILES, sizeof (*files));
+  if (!files)
+    return;
+
+  for (i = 0; i < BENCH_LOOKUP_FILES; i++)
+  {
+    char name[256];
+    const char *suffix =
+      bench_lookup_files[i % ARRAY_NB_ELEMENTS (bench_lookup_files)];
+
+    snprintf (name, sizeof (name),
+              "Artist %u - The Song Number %u.%s", i % 97, i, suffix);
+    files[i] = strdup (name);
+  }
+
+  bench_lookup_suffix (files);
+  bench_lookup_group ();
+  bench_lookup_fmtname ();
+
+  for (i = 0; i < BENCH_LOOKUP_FILES; i++)
+    free (files[i]);
+  free (files);
+}
@@ -30,7 +30,13 @@ typedef struct vh_test_case_s {
 
 static const vh_test_case_t vtc[] = {
   { "osdep",        vh_test_osdep },
+  { "fifo_queue",   vh_test_fifo_queue },
+  { "database",     vh_test_database },
+  { "file_index",   vh_test_file_index },
+  { "metadata",     vh_test_metadata },
   { "parser",       vh_test_parser },
+  { "scanner",      vh_test_scanner },
+  { "tag_reader",   vh_test_tag_reader },
   { "json_utils",   vh_test_json_utils },
 };
 
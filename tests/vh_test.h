@@ -22,8 +22,14 @@
 #ifndef VH_TEST_H
 #define VH_TEST_H
 
+void vh_test_database (TCase *tc);
+void vh_test_fifo_queue (TCase *tc);
+void vh_test_file_index (TCase *tc);
+void vh_test_metadata (TCase *tc);
 void vh_test_osdep (TCase *tc);
 void vh_test_parser (TCase *tc);
+void vh_test_scanner (TCase *tc);
+void vh_test_tag_reader (TCase *tc);
 void vh_test_json_utils (TCase *tc);
 
 #endif /* VH_TEST_H */
@@ -0,0 +1,1260 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/stat.h>
+
+#include <check.h>
+#include <sqlite3.h>
+
+#include "valhalla.h"
+#include "valhalla_internals.h"
+#include "metadata.h"
+#include "database.h"
+#include "dbquery.h"
+#include "logs.h"
+#include "stats.h"
+#include "vh_test.h"
+
+#define TEST_DATABASE_FILES   100
+#define TEST_DATABASE_ARTISTS 37
+#define TEST_DATABASE_ALBUMS  13
+#define TEST_DATABASE_PAGE    8
+
+/* More than the values read in the full-text index for a search. */
+#define TEST_DATABASE_SEARCH_VALUES 1200
+
+typedef struct test_database_s {
+  char        dir[32];
+  char        path[64];
+  database_t *database;
+} test_database_t;
+
+static void
+test_database_open (test_database_t *t)
+{
+  int i;
+  struct stat st;
+  const metadata_plist_t pl = {
+    .metadata = NULL,
+    .priority = VALHALLA_METADATA_PL_NORMAL
+  };
+
+  vh_log_verb (VALHALLA_MSG_ERROR);
+
+  strcpy (t->dir, "/tmp/vh_test_XXXXXX");
+  fail_if (!mkdtemp (t->dir), "temporary directory not created");
+  snprintf (t->path, sizeof (t->path), "%s/test.db", t->dir);
+
+  t->database = vh_database_init (t->path, 0);
+  fail_if (!t->database, "database not created");
+
+  memset (&st, 0, sizeof (st));
+
+  vh_database_begin_transaction (t->database);
+  for (i = 0; i < TEST_DATABASE_FILES; i++)
+  {
+    char path[64], value[64];
+    file_data_t *data;
+
+    snprintf (path, sizeof (path), "/media/file%03i.ogg", i);
+    data = vh_file_data_new (path, &st, 0, OD_TYPE_DEF,
+                             FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
+    fail_if (!data, "file data not created");
+
+    snprintf (value, sizeof (value), "artist %02i",
+              i % TEST_DATABASE_ARTISTS);
+    vh_metadata_add_auto (&data->meta_parser, data->arena,
+                          VALHALLA_METADATA_ARTIST, value, VALHALLA_LANG_UNDEF,
+                          &pl);
+    snprintf (value, sizeof (value), "title %03i", i);
+    vh_metadata_add_auto (&data->meta_parser, data->arena,
+                          VALHALLA_METADATA_TITLE, value, VALHALLA_LANG_UNDEF,
+                          &pl);
+    snprintf (value, sizeof (value), "album %02i", i % TEST_DATABASE_ALBUMS);
+    vh_metadata_add_auto (&data->meta_parser, data->arena,
+                          VALHALLA_METADATA_ALBUM, value, VALHALLA_LANG_UNDEF,
+                          &pl);
+
+    vh_database_file_insert (t->database, data);
+    vh_database_file_data_update (t->database, data);
+    vh_file_data_free (data);
+  }
+  vh_database_end_transaction (t->database);
+}
+
+static void
+test_database_close (test_database_t *t)
+{
+  char file[80];
+
+  vh_database_uninit (t->database);
+
+  snprintf (file, sizeof (file), "%s-wal", t->path);
+  unlink (file);
+  snprintf (file, sizeof (file), "%s-shm", t->path);
+  unlink (file);
+  unlink (t->path);
+  rmdir (t->dir);
+}
+
+/* Concatenate the pages of artists, the resume token is the last row. */
+static int
+test_database_artist_pages (database_t *database,
+                            valhalla_db_sort_t sort, int desc,
+                            int64_t *ids, int nb)
+{
+  int n = 0;
+  char *token = NULL;
+  valhalla_db_item_t search =
+    VALHALLA_DB_SEARCH_TEXT ("artist", ENTITIES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  for (;;)
+  {
+    int rows = 0;
+    valhalla_db_stmt_t *vhstmt;
+    const valhalla_db_metares_t *res;
+    valhalla_db_page_t page = VALHALLA_DB_PAGE (TEST_DATABASE_PAGE,
+                                                VALUE, desc, token);
+
+    page.sort = sort;
+    vhstmt = vh_database_metalist_get (database, &search,
+                                       VALHALLA_FILE_TYPE_NULL, NULL, &page);
+    fail_if (!vhstmt, "page not prepared");
+
+    free (token);
+    token = NULL;
+
+    while ((res = vh_database_metalist_read (database, vhstmt)))
+    {
+      if (n < nb)
+        ids[n] = res->data_id;
+      n++;
+      rows++;
+
+      free (token);
+      token = vh_database_page_token (database, vhstmt);
+      fail_if (!token, "no resume token");
+    }
+
+    fail_if (rows > TEST_DATABASE_PAGE, "page too big");
+    if (rows < TEST_DATABASE_PAGE)
+      break;
+  }
+
+  free (token);
+  return n;
+}
+
+START_TEST (test_database_page_metalist)
+{
+  int i, nb, n;
+  test_database_t t;
+  int64_t all[TEST_DATABASE_ARTISTS + 1], page[TEST_DATABASE_ARTISTS + 1];
+  valhalla_db_stmt_t *vhstmt;
+  const valhalla_db_metares_t *res;
+  valhalla_db_item_t search =
+    VALHALLA_DB_SEARCH_TEXT ("artist", ENTITIES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  test_database_open (&t);
+
+  /* reference, all artists sorted by value */
+  nb = 0;
+  vhstmt = vh_database_metalist_get (t.database, &search,
+                                     VALHALLA_FILE_TYPE_NULL, NULL, NULL);
+  fail_if (!vhstmt, "list not prepared");
+  while ((res = vh_database_metalist_read (t.database, vhstmt)))
+    if (nb < TEST_DATABASE_ARTISTS + 1)
+      all[nb++] = res->data_id;
+  fail_unless (nb == TEST_DATABASE_ARTISTS, "bad number of artists %i", nb);
+
+  n = test_database_artist_pages (t.database, VALHALLA_DB_SORT_VALUE, 0,
+                                  page, TEST_DATABASE_ARTISTS + 1);
+  fail_unless (n == nb, "bad number of artists with the pages %i", n);
+  for (i = 0; i < nb; i++)
+    fail_unless (page[i] == all[i], "bad artist %i", i);
+
+  n = test_database_artist_pages (t.database, VALHALLA_DB_SORT_VALUE, 1,
+                                  page, TEST_DATABASE_ARTISTS + 1);
+  fail_unless (n == nb, "bad number of artists (desc) %i", n);
+  for (i = 0; i < nb; i++)
+    fail_unless (page[i] == all[nb - i - 1], "bad artist (desc) %i", i);
+
+  n = test_database_artist_pages (t.database, VALHALLA_DB_SORT_ID, 0,
+                                  page, TEST_DATABASE_ARTISTS + 1);
+  fail_unless (n == nb, "bad number of artists (id) %i", n);
+  for (i = 1; i < nb; i++)
+    fail_unless (page[i] > page[i - 1], "bad order (id) %i", i);
+
+  test_database_close (&t);
+}
+END_TEST
+
+START_TEST (test_database_page_filelist)
+{
+  int n = 0, rows;
+  char *token = NULL;
+  char last[64] = "";
+  test_database_t t;
+
+  test_database_open (&t);
+
+  do
+  {
+    valhalla_db_stmt_t *vhstmt;
+    const valhalla_db_fileres_t *res;
+    valhalla_db_page_t page = VALHALLA_DB_PAGE (TEST_DATABASE_PAGE,
+                                                VALUE, 0, token);
+
+    vhstmt = vh_database_filelist_get (t.database,
+                                       VALHALLA_FILE_TYPE_NULL, NULL, &page);
+    fail_if (!vhstmt, "page not prepared");
+
+    free (token);
+    token = NULL;
+
+    for (rows = 0; (res = vh_database_filelist_read (t.database, vhstmt));
+         rows++, n++)
+    {
+      fail_unless (strcmp (res->path, last) > 0, "bad order %s", res->path);
+      snprintf (last, sizeof (last), "%s", res->path);
+
+      free (token);
+      token = vh_database_page_token (t.database, vhstmt);
+    }
+  }
+  while (rows == TEST_DATABASE_PAGE);
+
+  free (token);
+  fail_unless (n == TEST_DATABASE_FILES, "bad number of files %i", n);
+
+  /* a token of an other list is refused */
+  {
+    valhalla_db_page_t page = VALHALLA_DB_PAGE (1, VALUE, 0, "mv1:1:x");
+
+    fail_if (vh_database_filelist_get (t.database, VALHALLA_FILE_TYPE_NULL,
+                                       NULL, &page),
+             "invalid token accepted");
+  }
+
+  test_database_close (&t);
+}
+END_TEST
+
+START_TEST (test_database_facet)
+{
+  int i, nb = 0;
+  test_database_t t;
+  valhalla_db_stmt_t *vhstmt;
+  const valhalla_db_countres_t *res;
+  valhalla_db_item_t artist =
+    VALHALLA_DB_SEARCH_TEXT ("artist", ENTITIES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_item_t album =
+    VALHALLA_DB_SEARCH_TEXT ("album", TITLES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  test_database_open (&t);
+
+  /* files by artist */
+  vhstmt = vh_database_facet_get (t.database, &artist, NULL,
+                                  VALHALLA_FILE_TYPE_NULL, NULL);
+  fail_if (!vhstmt, "facet not prepared");
+  while ((res = vh_database_facet_read (t.database, vhstmt)))
+  {
+    int a = atoi (res->data_value + strlen ("artist "));
+
+    fail_unless (res->count == (a < TEST_DATABASE_FILES % TEST_DATABASE_ARTISTS
+                                ? 3 : 2),
+                 "bad number of files for %s: %u", res->data_value, res->count);
+    nb++;
+  }
+  fail_unless (nb == TEST_DATABASE_ARTISTS, "bad number of artists %i", nb);
+
+  /* albums by artist */
+  nb = 0;
+  vhstmt = vh_database_facet_get (t.database, &artist, &album,
+                                  VALHALLA_FILE_TYPE_NULL, NULL);
+  fail_if (!vhstmt, "facet not prepared");
+  while ((res = vh_database_facet_read (t.database, vhstmt)))
+  {
+    int a = atoi (res->data_value + strlen ("artist "));
+    unsigned int albums = 0;
+    int seen[TEST_DATABASE_ALBUMS] = { 0 };
+
+    for (i = a; i < TEST_DATABASE_FILES; i += TEST_DATABASE_ARTISTS)
+      if (!seen[i % TEST_DATABASE_ALBUMS]++)
+        albums++;
+
+    fail_unless (res->count == albums,
+                 "bad number of albums for %s: %u", res->data_value, res->count);
+    nb++;
+  }
+  fail_unless (nb == TEST_DATABASE_ARTISTS, "bad number of artists %i", nb);
+
+  /* restricted like the lists */
+  {
+    valhalla_db_restrict_t r =
+      VALHALLA_DB_RESTRICT_STR (IN, "album", "album 00",
+                                VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+    fail_unless (vh_database_count (t.database, VALHALLA_FILE_TYPE_NULL, &r)
+                 == (TEST_DATABASE_FILES + TEST_DATABASE_ALBUMS - 1)
+                    / TEST_DATABASE_ALBUMS,
+                 "bad number of files for the album");
+  }
+
+  test_database_close (&t);
+}
+END_TEST
+
+/* The counts are cached until the next commit. */
+START_TEST (test_database_count_generation)
+{
+  test_database_t t;
+  vh_stats_t *stats;
+  vh_stats_cnt_t *hit, *miss;
+  struct stat st;
+  file_data_t *data;
+
+  test_database_open (&t);
+
+  stats = vh_stats_new ();
+  fail_if (!stats, "stats not created");
+  vh_stats_grp_add (stats, "test", NULL, NULL);
+  hit  = vh_stats_grp_counter_add (stats, "test", "hit",  NULL);
+  miss = vh_stats_grp_counter_add (stats, "test", "miss", NULL);
+  vh_database_cache_stats_set (t.database, hit, miss);
+
+  fail_unless (vh_database_count (t.database, VALHALLA_FILE_TYPE_NULL, NULL)
+               == TEST_DATABASE_FILES, "bad number of files");
+  fail_unless (vh_stats_counter_read (hit) + vh_stats_counter_read (miss)
+               == 1, "the count is not computed");
+
+  fail_unless (vh_database_count (t.database, VALHALLA_FILE_TYPE_NULL, NULL)
+               == TEST_DATABASE_FILES, "bad number of files (cache)");
+  fail_unless (vh_stats_counter_read (hit) + vh_stats_counter_read (miss)
+               == 1, "the count is not cached");
+
+  memset (&st, 0, sizeof (st));
+  data = vh_file_data_new ("/media/new.ogg", &st, 0, OD_TYPE_DEF,
+                           FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
+  fail_if (!data, "file data not created");
+
+  vh_database_begin_transaction (t.database);
+  vh_database_file_insert (t.database, data);
+  vh_database_end_transaction (t.database);
+  vh_file_data_free (data);
+
+  fail_unless (vh_database_count (t.database, VALHALLA_FILE_TYPE_NULL, NULL)
+               == TEST_DATABASE_FILES + 1, "the count is outdated");
+  fail_unless (vh_stats_counter_read (hit) + vh_stats_counter_read (miss)
+               == 2, "the count is not computed again");
+
+  vh_database_cache_stats_set (t.database, NULL, NULL);
+  vh_stats_free (stats);
+  test_database_close (&t);
+}
+END_TEST
+
+/*
+ * Number of rows found for a text, all rows must be for the metadata and
+ * the shortest values first.
+ */
+static int
+test_database_search_nb (database_t *database,
+                         const char *text, const char *meta)
+{
+  int nb = 0;
+  size_t len = 0;
+  valhalla_db_stmt_t *vhstmt;
+  const valhalla_db_searchres_t *res;
+
+  vhstmt = vh_database_search_get (database, text, VALHALLA_FILE_TYPE_NULL, 0);
+  fail_if (!vhstmt, "search statement not created");
+
+  while ((res = vh_database_search_read (database, vhstmt)))
+  {
+    fail_if (strcmp (res->meta_name, meta), "bad metadata %s", res->meta_name);
+    fail_if (res->file_id <= 0, "bad file id");
+    fail_if (strlen (res->data_value) < len, "bad order");
+    len = strlen (res->data_value);
+    nb++;
+  }
+
+  return nb;
+}
+
+/* The last word is a prefix, the case and the diacritics are ignored. */
+START_TEST (test_database_search)
+{
+  test_database_t t;
+
+  test_database_open (&t);
+
+  fail_unless (test_database_search_nb (t.database, "title 042",
+                                        VALHALLA_METADATA_TITLE) == 1,
+               "exact value not found");
+  fail_unless (test_database_search_nb (t.database, "TITLE 04",
+                                        VALHALLA_METADATA_TITLE) == 10,
+               "prefix not found");
+  fail_unless (test_database_search_nb (t.database, "tit 042",
+                                        VALHALLA_METADATA_TITLE) == 0,
+               "a typed word is a prefix");
+  fail_unless (test_database_search_nb (t.database, "title 04 ",
+                                        VALHALLA_METADATA_TITLE) == 0,
+               "the last typed word is a prefix");
+  fail_unless (test_database_search_nb (t.database, "  Tïtlé   042 ",
+                                        VALHALLA_METADATA_TITLE) == 1,
+               "diacritics not ignored");
+  fail_unless (test_database_search_nb (t.database, "artist 05",
+                                        VALHALLA_METADATA_ARTIST)
+               == (TEST_DATABASE_FILES + TEST_DATABASE_ARTISTS - 1 - 5)
+                  / TEST_DATABASE_ARTISTS,
+               "bad number of files for an artist");
+  fail_unless (test_database_search_nb (t.database, "\"title OR",
+                                        VALHALLA_METADATA_TITLE) == 0,
+               "the FTS5 syntax is not ignored");
+  fail_if (vh_database_search_get (t.database, "   ",
+                                   VALHALLA_FILE_TYPE_NULL, 0),
+           "empty search accepted");
+
+  test_database_close (&t);
+}
+END_TEST
+
+static void
+test_database_search_file (database_t *database, const char *path,
+                           const char *title, valhalla_file_type_t type)
+{
+  struct stat st;
+  file_data_t *data;
+
+  memset (&st, 0, sizeof (st));
+  data = vh_file_data_new (path, &st, 0, OD_TYPE_DEF,
+                           FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
+  fail_if (!data, "file data not created");
+
+  data->file.type = type;
+  vh_metadata_add_auto (&data->meta_parser, data->arena,
+                        VALHALLA_METADATA_TITLE, title, VALHALLA_LANG_UNDEF,
+                        NULL);
+  vh_database_file_insert (database, data);
+  vh_database_file_data_update (database, data);
+  vh_file_data_free (data);
+}
+
+static int
+test_database_search_type (database_t *database, const char *text,
+                           valhalla_file_type_t type, unsigned int max)
+{
+  int nb = 0;
+  valhalla_db_stmt_t *vhstmt;
+
+  vhstmt = vh_database_search_get (database, text, type, max);
+  fail_if (!vhstmt, "search statement not created");
+
+  while (vh_database_search_read (database, vhstmt))
+    nb++;
+
+  return nb;
+}
+
+/*
+ * More values than the limit of the full-text index (DATABASE_SEARCH_VALUES),
+ * the shortest values and the videos are inserted after the others.
+ */
+START_TEST (test_database_search_values)
+{
+  int i;
+  test_database_t t;
+  valhalla_db_stmt_t *vhstmt;
+  const valhalla_db_searchres_t *res;
+
+  test_database_open (&t);
+
+  vh_database_begin_transaction (t.database);
+  for (i = 0; i < TEST_DATABASE_SEARCH_VALUES; i++)
+  {
+    char path[64], title[64];
+
+    snprintf (path, sizeof (path), "/media/common%04i.ogg", i);
+    snprintf (title, sizeof (title), "common song number %04i", i);
+    test_database_search_file (t.database, path, title,
+                               VALHALLA_FILE_TYPE_AUDIO);
+  }
+  test_database_search_file (t.database, "/media/common1.mkv",
+                             "common 1", VALHALLA_FILE_TYPE_VIDEO);
+  test_database_search_file (t.database, "/media/common2.mkv",
+                             "common 2", VALHALLA_FILE_TYPE_VIDEO);
+  vh_database_end_transaction (t.database);
+
+  fail_unless (test_database_search_type (t.database, "common",
+                                          VALHALLA_FILE_TYPE_VIDEO, 0) == 2,
+               "the videos are not found");
+
+  vhstmt = vh_database_search_get (t.database, "common",
+                                   VALHALLA_FILE_TYPE_NULL, 2);
+  fail_if (!vhstmt, "search statement not created");
+  for (i = 0; (res = vh_database_search_read (t.database, vhstmt)); i++)
+    fail_if (strncmp (res->data_value, "common ", 7)
+             || strlen (res->data_value) != 8,
+             "the shortest values are not first (%s)", res->data_value);
+  fail_unless (i == 2, "bad number of results");
+
+  fail_if (test_database_search_type (t.database, "common",
+                                      VALHALLA_FILE_TYPE_AUDIO, 0) <= 0,
+           "the audio files are not found");
+
+  test_database_close (&t);
+}
+END_TEST
+
+/* The index follows the deletions and the list of the metadata. */
+START_TEST (test_database_search_sync)
+{
+  test_database_t t;
+  sqlite3 *db;
+  sqlite3_stmt *stmt;
+  int nb = -1;
+
+  test_database_open (&t);
+
+  vh_database_begin_transaction (t.database);
+  vh_database_file_delete (t.database, "/media/file042.ogg");
+  vh_database_end_transaction (t.database);
+  vh_database_cleanup (t.database);
+
+  fail_unless (test_database_search_nb (t.database, "title 042",
+                                        VALHALLA_METADATA_TITLE) == 0,
+               "deleted value found");
+
+  fail_if (sqlite3_open_v2 (t.path, &db, SQLITE_OPEN_READONLY, NULL)
+           != SQLITE_OK, "database not opened");
+  fail_if (sqlite3_prepare_v2 (db, "SELECT COUNT(*) FROM data_fts "
+                                   "WHERE rowid NOT IN "
+                                   "(SELECT data_id FROM data);",
+                               -1, &stmt, NULL) != SQLITE_OK,
+           "query not prepared");
+  if (sqlite3_step (stmt) == SQLITE_ROW)
+    nb = sqlite3_column_int (stmt, 0);
+  sqlite3_finalize (stmt);
+  sqlite3_close (db);
+  fail_unless (nb == 0, "%i values are not removed from the index", nb);
+
+  vh_database_search_meta_add (t.database, VALHALLA_METADATA_ALBUM);
+  vh_database_search_sync (t.database);
+
+  fail_unless (test_database_search_nb (t.database, "title",
+                                        VALHALLA_METADATA_TITLE) == 0,
+               "the title is still in the index");
+  fail_unless (test_database_search_nb (t.database, "album 04",
+                                        VALHALLA_METADATA_ALBUM)
+               == (TEST_DATABASE_FILES + TEST_DATABASE_ALBUMS - 1 - 4)
+                  / TEST_DATABASE_ALBUMS,
+               "bad number of files for an album");
+
+  test_database_close (&t);
+}
+END_TEST
+
+static void
+test_database_meta_file (database_t *database, const char *path)
+{
+  struct stat st;
+  file_data_t *data;
+
+  memset (&st, 0, sizeof (st));
+  data = vh_file_data_new (path, &st, 0, OD_TYPE_DEF,
+                           FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
+  fail_if (!data, "file data not created");
+
+  vh_metadata_add_auto (&data->meta_parser, data->arena,
+                        "test_database_meta", "value", VALHALLA_LANG_UNDEF,
+                        NULL);
+
+  vh_database_begin_transaction (database);
+  vh_database_file_insert (database, data);
+  vh_database_file_data_update (database, data);
+  vh_database_end_transaction (database);
+  vh_file_data_free (data);
+}
+
+/* The ids of the metadata are cached, the cleanup removes the unused. */
+START_TEST (test_database_meta_cache)
+{
+  test_database_t t;
+  sqlite3 *db;
+  sqlite3_stmt *stmt;
+  int nb = -1;
+
+  test_database_open (&t);
+
+  test_database_meta_file (t.database, "/media/meta1.ogg");
+  vh_database_begin_transaction (t.database);
+  vh_database_file_delete (t.database, "/media/meta1.ogg");
+  vh_database_end_transaction (t.database);
+  vh_database_cleanup (t.database);
+
+  test_database_meta_file (t.database, "/media/meta2.ogg");
+
+  fail_if (sqlite3_open_v2 (t.path, &db, SQLITE_OPEN_READONLY, NULL)
+           != SQLITE_OK, "database not opened");
+  fail_if (sqlite3_prepare_v2 (db, "SELECT COUNT(*) "
+                                   "FROM assoc_file_metadata AS a "
+                                   "INNER JOIN meta AS m "
+                                   "ON a.meta_id = m.meta_id "
+                                   "WHERE m.meta_name = "
+                                   "'test_database_meta';",
+                               -1, &stmt, NULL) != SQLITE_OK,
+           "query not prepared");
+  if (sqlite3_step (stmt) == SQLITE_ROW)
+    nb = sqlite3_column_int (stmt, 0);
+  sqlite3_finalize (stmt);
+  sqlite3_close (db);
+  fail_unless (nb == 1, "the metadata is linked to %i rows of 'meta'", nb);
+
+  test_database_close (&t);
+}
+END_TEST
+
+static int
+test_database_rows_nb (const char *path, const char *sql)
+{
+  int nb = -1;
+  sqlite3 *db;
+  sqlite3_stmt *stmt;
+
+  fail_if (sqlite3_open_v2 (path, &db, SQLITE_OPEN_READONLY, NULL)
+           != SQLITE_OK, "database not opened");
+  fail_if (sqlite3_prepare_v2 (db, sql, -1, &stmt, NULL) != SQLITE_OK,
+           "query not prepared: %s", sql);
+  if (sqlite3_step (stmt) == SQLITE_ROW)
+    nb = sqlite3_column_int (stmt, 0);
+  sqlite3_finalize (stmt);
+  sqlite3_close (db);
+
+  return nb;
+}
+
+static void
+test_database_cleanup_file (database_t *database, const char *path,
+                            const char *value, const char *const *grabbers)
+{
+  struct stat st;
+  file_data_t *data;
+
+  memset (&st, 0, sizeof (st));
+  data = vh_file_data_new (path, &st, 0, OD_TYPE_DEF,
+                           FIFO_QUEUE_PRIORITY_NORMAL, STEP_PARSING);
+  fail_if (!data, "file data not created");
+
+  vh_metadata_add_auto (&data->meta_parser, data->arena,
+                        VALHALLA_METADATA_ARTIST, "artist 00",
+                        VALHALLA_LANG_UNDEF, NULL);
+  vh_metadata_add_auto (&data->meta_parser, data->arena,
+                        "test_database_cleanup", value,
+                        VALHALLA_LANG_UNDEF, NULL);
+
+  vh_database_begin_transaction (database);
+  vh_database_file_insert (database, data);
+  vh_database_file_data_update (database, data);
+  for (; *grabbers; grabbers++)
+  {
+    data->grabber_name = *grabbers;
+    vh_database_file_grab_insert (database, data);
+  }
+  vh_database_end_transaction (database);
+  vh_file_data_free (data);
+}
+
+/* Only the meta, data and grabbers of the deleted files are removed. */
+START_TEST (test_database_cleanup)
+{
+  test_database_t t;
+  const char *const grabbers1[] = { "test_orphan", "test_shared", NULL };
+  const char *const grabbers2[] = { "test_shared", NULL };
+
+  test_database_open (&t);
+
+  test_database_cleanup_file (t.database, "/media/cleanup1.ogg",
+                              "orphan", grabbers1);
+  test_database_cleanup_file (t.database, "/media/cleanup2.ogg",
+                              "shared", grabbers2);
+  test_database_cleanup_file (t.database, "/media/cleanup3.ogg",
+                              "shared", grabbers2);
+
+  vh_database_begin_transaction (t.database);
+  vh_database_file_delete (t.database, "/media/cleanup1.ogg");
+  vh_database_file_delete (t.database, "/media/cleanup2.ogg");
+  vh_database_end_transaction (t.database);
+  vh_database_cleanup (t.database);
+
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM data WHERE data_value = 'orphan';")
+               == 0, "the orphaned data is not removed");
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM grabber "
+                 "WHERE grabber_name = 'test_orphan';")
+               == 0, "the orphaned grabber is not removed");
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM assoc_file_metadata AS a "
+                 "WHERE NOT EXISTS (SELECT 1 FROM file AS f "
+                                   "WHERE f.file_id = a.file_id);")
+               == 0, "the associations of the deleted files are kept");
+
+  /* still used by cleanup3.ogg and the other files */
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM data WHERE data_value = 'shared';")
+               == 1, "the shared data is removed");
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM data "
+                 "WHERE data_value = 'artist 00';")
+               == 1, "the shared artist is removed");
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM meta "
+                 "WHERE meta_name = 'test_database_cleanup';")
+               == 1, "the shared meta is removed");
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM grabber "
+                 "WHERE grabber_name = 'test_shared';")
+               == 1, "the shared grabber is removed");
+
+  /* the last file, then the meta is orphaned */
+  vh_database_begin_transaction (t.database);
+  vh_database_file_delete (t.database, "/media/cleanup3.ogg");
+  vh_database_end_transaction (t.database);
+  vh_database_cleanup (t.database);
+
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM meta "
+                 "WHERE meta_name = 'test_database_cleanup';")
+               == 0, "the orphaned meta is not removed");
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM grabber "
+                 "WHERE grabber_name = 'test_shared';")
+               == 0, "the last grabber is not removed");
+
+  /* the grabbers are checked with the index */
+  fail_unless (test_database_rows_nb (t.path,
+                 "SELECT COUNT(*) FROM pragma_index_list "
+                 "('assoc_file_grabber') "
+                 "WHERE name = 'assoc_grabber_idx';")
+               == 1, "no index for the cleanup of the grabbers");
+
+  test_database_close (&t);
+}
+END_TEST
+
+static int
+test_database_files_nb (database_t *database,
+                        valhalla_db_restrict_t *restriction)
+{
+  int nb = 0;
+  valhalla_db_stmt_t *vhstmt;
+
+  vhstmt = vh_database_filelist_get (database,
+                                     VALHALLA_FILE_TYPE_NULL, restriction, NULL);
+  fail_if (!vhstmt, "filelist statement not created");
+
+  while (vh_database_filelist_read (database, vhstmt))
+    nb++;
+
+  return nb;
+}
+
+/* The restrictions are intersected (IN) and subtracted (NOT IN). */
+START_TEST (test_database_restriction_sets)
+{
+  test_database_t t;
+  int i, nb;
+  valhalla_db_restrict_t album =
+    VALHALLA_DB_RESTRICT_STR (IN, VALHALLA_METADATA_ALBUM, "album 04",
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_restrict_t artist =
+    VALHALLA_DB_RESTRICT_STR (NOTIN, VALHALLA_METADATA_ARTIST, "artist 06",
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_restrict_t title =
+    VALHALLA_DB_RESTRICT_STR (NOTIN, VALHALLA_METADATA_TITLE, "title 095",
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  test_database_open (&t);
+
+  /* NOT IN first, the sets must be composed in the right order */
+  VALHALLA_DB_RESTRICT_LINK (album, artist);
+  VALHALLA_DB_RESTRICT_LINK (title, album);
+
+  for (nb = 0, i = 0; i < TEST_DATABASE_FILES; i++)
+    if (i % TEST_DATABASE_ALBUMS == 4 && i % TEST_DATABASE_ARTISTS != 6
+        && i != 95)
+      nb++;
+  fail_unless (test_database_files_nb (t.database, &artist) == nb,
+               "bad number of files with IN and NOT IN");
+
+  /* only NOT IN */
+  album.op = VALHALLA_DB_OPERATOR_NOTIN;
+  title.meta.text = VALHALLA_METADATA_ALBUM;
+  title.data.text = "album 00";
+  for (nb = 0, i = 0; i < TEST_DATABASE_FILES; i++)
+    if (i % TEST_DATABASE_ALBUMS && i % TEST_DATABASE_ALBUMS != 4
+        && i % TEST_DATABASE_ARTISTS != 6)
+      nb++;
+  fail_unless (test_database_files_nb (t.database, &artist) == nb,
+               "bad number of files with NOT IN");
+
+  /* unknown values */
+  album.next = NULL;
+  album.data.text = "unknown";
+  fail_unless (test_database_files_nb (t.database, &album)
+               == TEST_DATABASE_FILES, "a file is not in an unknown album");
+  album.op = VALHALLA_DB_OPERATOR_IN;
+  fail_unless (test_database_files_nb (t.database, &album) == 0,
+               "a file is in an unknown album");
+
+  test_database_close (&t);
+}
+END_TEST
+
+static void
+test_database_plan_check (database_t *database, valhalla_db_stmt_t *vhstmt)
+{
+  char *plan;
+
+  fail_if (!vhstmt, "statement not created");
+
+  plan = vh_database_query_plan (database, vhstmt);
+  fail_if (!plan, "no query plan");
+
+  /* the sets are read only in the covering index */
+  fail_if (!strstr (plan, "SEARCH sa USING COVERING INDEX assoc_file_idx"),
+           "the covering index is not used:\n%s", plan);
+  fail_if (strstr (plan, "SCAN sa"), "full scan of a set:\n%s", plan);
+  fail_if (strstr (plan, "SCAN meta"), "full scan of meta:\n%s", plan);
+  fail_if (strstr (plan, "SCAN data"), "full scan of data:\n%s", plan);
+  free (plan);
+}
+
+/* Regressions of the indexes for the restrictions. */
+START_TEST (test_database_restriction_plan)
+{
+  test_database_t t;
+  valhalla_db_stmt_t *vhstmt;
+  valhalla_db_item_t search =
+    VALHALLA_DB_SEARCH_TEXT (VALHALLA_METADATA_TITLE, TITLES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_restrict_t album =
+    VALHALLA_DB_RESTRICT_STR (IN, VALHALLA_METADATA_ALBUM, "album 04",
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_restrict_t artist =
+    VALHALLA_DB_RESTRICT_STR (IN, VALHALLA_METADATA_ARTIST, "artist 04",
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_restrict_t title =
+    VALHALLA_DB_RESTRICT_STR (NOTIN, VALHALLA_METADATA_TITLE, "title 004",
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  test_database_open (&t);
+
+  VALHALLA_DB_RESTRICT_LINK (artist, album);
+  VALHALLA_DB_RESTRICT_LINK (title, artist);
+
+  vhstmt = vh_database_filelist_get (t.database,
+                                     VALHALLA_FILE_TYPE_NULL, &album, NULL);
+  test_database_plan_check (t.database, vhstmt);
+  while (vh_database_filelist_read (t.database, vhstmt))
+    ;
+
+  vhstmt = vh_database_metalist_get (t.database, &search,
+                                     VALHALLA_FILE_TYPE_NULL, &album, NULL);
+  test_database_plan_check (t.database, vhstmt);
+  while (vh_database_metalist_read (t.database, vhstmt))
+    ;
+
+  test_database_close (&t);
+}
+END_TEST
+
+/* Read a 'files' statement, the rows of a file must be consecutive. */
+static int
+test_database_files_read (database_t *database, valhalla_db_stmt_t *vhstmt,
+                          int *files, int *titles)
+{
+  int rows = 0;
+  int64_t last = 0;
+  const valhalla_db_filemetares_t *res;
+
+  *files = *titles = 0;
+  while ((res = vh_database_files_read (database, vhstmt)))
+  {
+    char path[64];
+
+    fail_if (res->file_id < last, "files not sorted");
+    if (res->file_id != last)
+      (*files)++;
+    last = res->file_id;
+
+    snprintf (path, sizeof (path), "/media/file%03i.ogg",
+              (int) res->file_id - 1);
+    fail_if (strcmp (res->path, path), "bad path %s", res->path);
+    if (!strcmp (res->meta.meta_name, VALHALLA_METADATA_TITLE))
+      (*titles)++;
+    rows++;
+  }
+
+  return rows;
+}
+
+START_TEST (test_database_files)
+{
+  test_database_t t;
+  int i, rows, files, titles, metas_nb;
+  int64_t ids[VALHALLA_DB_FILES_MAX + 1];
+  valhalla_db_stmt_t *vhstmt;
+  const char *const metas[] = { VALHALLA_METADATA_TITLE, NULL };
+  valhalla_db_restrict_t album =
+    VALHALLA_DB_RESTRICT_STR (IN, VALHALLA_METADATA_ALBUM, "album 04",
+                              VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  test_database_open (&t);
+
+  /* metadata of a file, like with vh_database_file_get() */
+  vhstmt = vh_database_file_get (t.database, 7, NULL, NULL);
+  fail_if (!vhstmt, "file statement not created");
+  for (metas_nb = 0; vh_database_file_read (t.database, vhstmt); metas_nb++)
+    ;
+
+  /* unsorted, duplicated and unknown ids */
+  ids[0] = 42;
+  ids[1] = 7;
+  ids[2] = 1000;
+  ids[3] = 7;
+  ids[4] = 13;
+  vhstmt = vh_database_files_get (t.database, ids, 5,
+                                  VALHALLA_FILE_TYPE_NULL, NULL, NULL);
+  fail_if (!vhstmt, "files statement not created");
+  rows = test_database_files_read (t.database, vhstmt, &files, &titles);
+  fail_unless (files == 3 && rows == 3 * metas_nb && titles == 3,
+               "bad rows for the ids (%i files, %i rows)", files, rows);
+
+  /* all the files (padded list) but only the titles */
+  for (i = 0; i < TEST_DATABASE_FILES; i++)
+    ids[i] = i + 1;
+  vhstmt = vh_database_files_get (t.database, ids, TEST_DATABASE_FILES,
+                                  VALHALLA_FILE_TYPE_NULL, NULL, metas);
+  fail_if (!vhstmt, "files statement not created");
+  rows = test_database_files_read (t.database, vhstmt, &files, &titles);
+  fail_unless (files == TEST_DATABASE_FILES
+               && rows == TEST_DATABASE_FILES && titles == rows,
+               "bad rows for the titles (%i files, %i rows)", files, rows);
+
+  /* no id, the files of the restrictions */
+  vhstmt = vh_database_files_get (t.database, NULL, 0,
+                                  VALHALLA_FILE_TYPE_NULL, &album, metas);
+  fail_if (!vhstmt, "files statement not created");
+  rows = test_database_files_read (t.database, vhstmt, &files, &titles);
+  for (i = 0; i < TEST_DATABASE_FILES; i++)
+    if (i % TEST_DATABASE_ALBUMS == 4)
+      titles--;
+  fail_unless (files == rows && !titles,
+               "bad rows for the restriction (%i files)", files);
+
+  /* the ids and the restrictions */
+  vhstmt = vh_database_files_get (t.database, ids, 10,
+                                  VALHALLA_FILE_TYPE_NULL, &album, NULL);
+  fail_if (!vhstmt, "files statement not created");
+  rows = test_database_files_read (t.database, vhstmt, &files, &titles);
+  fail_unless (files == 1 && rows == metas_nb,
+               "bad rows for ids and restriction");
+
+  for (i = 0; i < VALHALLA_DB_FILES_MAX + 1; i++)
+    ids[i] = i + 1;
+  fail_if (vh_database_files_get (t.database, ids, VALHALLA_DB_FILES_MAX + 1,
+                                  VALHALLA_FILE_TYPE_NULL, NULL, NULL),
+           "too many ids accepted");
+
+  test_database_close (&t);
+}
+END_TEST
+
+static int
+test_database_progress_cb (void *data)
+{
+  int *calls = data;
+  return ++*calls;
+}
+
+/* The steps are aborted by the progress handler of the thread. */
+START_TEST (test_database_progress)
+{
+  int calls = 0;
+  test_database_t t;
+  valhalla_db_stmt_t *vhstmt;
+  database_progress_t progress = { test_database_progress_cb, &calls };
+  valhalla_db_item_t search =
+    VALHALLA_DB_SEARCH_TEXT (VALHALLA_METADATA_TITLE, TITLES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+
+  test_database_open (&t);
+
+  vh_database_progress_set (t.database, &progress);
+  vhstmt = vh_database_metalist_get (t.database, &search,
+                                     VALHALLA_FILE_TYPE_NULL, NULL, NULL);
+  fail_if (!vhstmt, "statement not created");
+  fail_if (vh_database_metalist_read (t.database, vhstmt),
+           "the statement is not interrupted");
+  fail_unless (calls == 1, "progress handler called %i times", calls);
+
+  /* the handler is removed with the statement */
+  vh_database_progress_set (t.database, NULL);
+  vhstmt = vh_database_metalist_get (t.database, &search,
+                                     VALHALLA_FILE_TYPE_NULL, NULL, NULL);
+  fail_if (!vhstmt, "statement not created");
+  fail_if (!vh_database_metalist_read (t.database, vhstmt),
+           "the statement is interrupted");
+  vh_database_vhstmt_free (t.database, vhstmt);
+  fail_unless (calls == 1, "progress handler called %i times", calls);
+
+  test_database_close (&t);
+}
+END_TEST
+
+typedef struct test_database_async_s {
+  sem_t        end;
+  sem_t        blocked;
+  sem_t        block;    /* posted to release a blocked callback */
+  int          blocking; /* the callback waits on 'block' */
+  unsigned int rows;
+  unsigned int batches;
+  valhalla_db_async_t state;
+} test_database_async_t;
+
+static void
+test_database_async_cb (valhalla_db_batch_t *batch, void *data)
+{
+  test_database_async_t *a = data;
+
+  fail_unless (batch->data == data, "bad user data");
+  fail_if (batch->state == VALHALLA_DB_ASYNC_ROWS
+           && batch->nb != DBQUERY_BATCH_SIZE, "batch not full");
+
+  a->rows += batch->nb;
+  a->batches++;
+  a->state = batch->state;
+  vh_dbquery_batch_free (batch);
+
+  if (a->blocking)
+  {
+    a->blocking = 0;
+    sem_post (&a->blocked);
+    sem_wait (&a->block);
+  }
+
+  if (a->state != VALHALLA_DB_ASYNC_ROWS)
+    sem_post (&a->end);
+}
+
+static void
+test_database_async_init (test_database_async_t *a, int blocking)
+{
+  memset (a, 0, sizeof (*a));
+  a->blocking = blocking;
+  sem_init (&a->end, 0, 0);
+  sem_init (&a->blocked, 0, 0);
+  sem_init (&a->block, 0, 0);
+}
+
+START_TEST (test_database_async_callback)
+{
+  unsigned int id;
+  test_database_t t;
+  test_database_async_t a;
+  dbquery_t *dbquery;
+
+  test_database_open (&t);
+  test_database_async_init (&a, 0);
+
+  dbquery = vh_dbquery_init (t.database, 0);
+  fail_if (!dbquery, "dbquery not created");
+  fail_if (vh_dbquery_run (dbquery, 0), "threads not created");
+
+  id = vh_dbquery_filelist (dbquery, VALHALLA_FILE_TYPE_NULL,
+                            NULL, NULL, test_database_async_cb, &a);
+  fail_if (!id, "query not queued");
+  sem_wait (&a.end);
+
+  fail_unless (a.state == VALHALLA_DB_ASYNC_END, "bad state %i", a.state);
+  fail_unless (a.rows == TEST_DATABASE_FILES, "%u files", a.rows);
+  fail_unless (a.batches == (TEST_DATABASE_FILES + DBQUERY_BATCH_SIZE - 1)
+                            / DBQUERY_BATCH_SIZE, "%u batches", a.batches);
+
+  vh_dbquery_stop (dbquery, STOP_FLAG_REQUEST | STOP_FLAG_WAIT);
+  fail_if (vh_dbquery_filelist (dbquery, VALHALLA_FILE_TYPE_NULL,
+                                NULL, NULL, test_database_async_cb, &a),
+           "query queued after the stop");
+  vh_dbquery_uninit (dbquery);
+  test_database_close (&t);
+}
+END_TEST
+
+/* The completion queue is read like with a poll loop. */
+START_TEST (test_database_async_queue)
+{
+  int fd, artists = 0, pages = 0;
+  unsigned int id1, id2;
+  struct pollfd pfd;
+  test_database_t t;
+  dbquery_t *dbquery;
+  valhalla_db_item_t search =
+    VALHALLA_DB_SEARCH_TEXT ("artist", ENTITIES,
+                             VALHALLA_LANG_ALL, VALHALLA_METADATA_PL_LOWEST);
+  valhalla_db_page_t page = VALHALLA_DB_PAGE (TEST_DATABASE_PAGE,
+                                              VALUE, 0, NULL);
+
+  test_database_open (&t);
+
+  dbquery = vh_dbquery_init (t.database, 2);
+  fail_if (!dbquery, "dbquery not created");
+  fail_if (vh_dbquery_run (dbquery, 0), "threads not created");
+
+  fd = vh_dbquery_fd (dbquery);
+  fail_if (fd < 0, "no descriptor");
+
+  id1 = vh_dbquery_metalist (dbquery, &search, VALHALLA_FILE_TYPE_NULL,
+                             NULL, NULL, NULL, &artists);
+  id2 = vh_dbquery_filelist (dbquery, VALHALLA_FILE_TYPE_NULL,
+                             NULL, &page, NULL, &pages);
+  fail_if (!id1 || !id2 || id1 == id2, "queries not queued");
+
+  while (artists >= 0 || pages >= 0)
+  {
+    valhalla_db_batch_t *batch;
+
+    pfd.fd     = fd;
+    pfd.events = POLLIN;
+    fail_unless (poll (&pfd, 1, 5000) == 1, "no batch");
+
+    while ((batch = vh_dbquery_pop (dbquery)))
+    {
+      int *nb = batch->data;
+
+      fail_unless (batch->id == (nb == &artists ? id1 : id2), "bad id");
+      *nb += batch->nb;
+
+      if (batch->state != VALHALLA_DB_ASYNC_ROWS)
+      {
+        fail_unless (batch->state == VALHALLA_DB_ASYNC_END, "bad state");
+        fail_unless (nb == &artists ? !batch->token : !!batch->token,
+                     "bad resume token");
+        *nb = -*nb - 1;
+      }
+      vh_dbquery_batch_free (batch);
+    }
+  }
+
+  fail_unless (-artists - 1 == TEST_DATABASE_ARTISTS, "%i artists",
+               -artists - 1);
+  fail_unless (-pages - 1 == TEST_DATABASE_PAGE, "%i files", -pages - 1);
+
+  /* the descriptor is not readable with an empty queue */
+  pfd.fd     = fd;
+  pfd.events = POLLIN;
+  fail_unless (poll (&pfd, 1, 0) == 0, "descriptor still readable");
+
+  vh_dbquery_stop (dbquery, STOP_FLAG_REQUEST | STOP_FLAG_WAIT);
+  vh_dbquery_uninit (dbquery);
+  test_database_close (&t);
+}
+END_TEST
+
+START_TEST (test_database_async_cancel)
+{
+  unsigned int id1, id2;
+  test_database_t t;
+  test_database_async_t a1, a2;
+  dbquery_t *dbquery;
+
+  test_database_open (&t);
+  test_database_async_init (&a1, 1);
+  test_database_async_init (&a2, 0);
+
+  /* one thread, the second query waits behind the first one */
+  dbquery = vh_dbquery_init (t.database, 1);
+  fail_if (!dbquery, "dbquery not created");
+  fail_if (vh_dbquery_run (dbquery, 0), "threads not created");
+
+  id1 = vh_dbquery_filelist (dbquery, VALHALLA_FILE_TYPE_NULL,
+                             NULL, NULL, test_database_async_cb, &a1);
+  id2 = vh_dbquery_filelist (dbquery, VALHALLA_FILE_TYPE_NULL,
+                             NULL, NULL, test_database_async_cb, &a2);
+  fail_if (!id1 || !id2, "queries not queued");
+
+  /* the first query is blocked in the callback of its first batch */
+  sem_wait (&a1.blocked);
+  vh_dbquery_cancel (dbquery, id2);
+  vh_dbquery_cancel (dbquery, id1);
+  vh_dbquery_cancel (dbquery, id2 + 1);
+  sem_post (&a1.block);
+
+  sem_wait (&a1.end);
+  sem_wait (&a2.end);
+
+  fail_unless (a1.state == VALHALLA_DB_ASYNC_CANCELED, "query 1 not canceled");
+  fail_unless (a1.rows == DBQUERY_BATCH_SIZE, "%u files", a1.rows);
+  fail_unless (a1.batches == 2, "%u batches", a1.batches);
+  fail_unless (a2.state == VALHALLA_DB_ASYNC_CANCELED, "query 2 not canceled");
+  fail_unless (a2.rows == 0 && a2.batches == 1, "query 2 is run");
+
+  /* unknown (ended) query */
+  vh_dbquery_cancel (dbquery, id1);
+
+  vh_dbquery_stop (dbquery, STOP_FLAG_REQUEST | STOP_FLAG_WAIT);
+  vh_dbquery_uninit (dbquery);
+  test_database_close (&t);
+}
+END_TEST
+
+void
+vh_test_database (TCase *tc)
+{
+  tcase_add_test (tc, test_database_page_metalist);
+  tcase_add_test (tc, test_database_page_filelist);
+  tcase_add_test (tc, test_database_facet);
+  tcase_add_test (tc, test_database_count_generation);
+  tcase_add_test (tc, test_database_search);
+  tcase_add_test (tc, test_database_search_values);
+  tcase_add_test (tc, test_database_search_sync);
+  tcase_add_test (tc, test_database_meta_cache);
+  tcase_add_test (tc, test_database_cleanup);
+  tcase_add_test (tc, test_database_restriction_sets);
+  tcase_add_test (tc, test_database_restriction_plan);
+  tcase_add_test (tc, test_database_files);
+  tcase_add_test (tc, test_database_progress);
+  tcase_add_test (tc, test_database_async_callback);
+  tcase_add_test (tc, test_database_async_queue);
+  tcase_add_test (tc, test_database_async_cancel);
+}
@@ -0,0 +1,160 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <check.h>
+
+#include "fifo_queue.h"
+#include "vh_test.h"
+
+/* Must be greater than the ring size in order to test the overflow. */
+#define TEST_FIFO_QUEUE_NB 3000
+
+static int
+test_fifo_queue_cmp (const void *tocmp, int id, const void *data)
+{
+  (void) id;
+  return tocmp != data;
+}
+
+START_TEST (test_fifo_queue_order)
+{
+  int i, id, res;
+  void *data;
+  fifo_queue_t *queue;
+
+  queue = vh_fifo_queue_new ();
+  fail_if (!queue, "queue not created");
+
+  for (i = 0; i < TEST_FIFO_QUEUE_NB; i++)
+  {
+    res = vh_fifo_queue_push (queue, FIFO_QUEUE_PRIORITY_NORMAL,
+                              i, (void *) (intptr_t) (i + 1));
+    fail_unless (res == FIFO_QUEUE_SUCCESS, "push %i has failed", i);
+  }
+
+  vh_fifo_queue_push (queue, FIFO_QUEUE_PRIORITY_HIGH, -1, NULL);
+
+  vh_fifo_queue_pop (queue, &id, &data);
+  fail_unless (id == -1, "high priority entry expected, found %i", id);
+
+  for (i = 0; i < TEST_FIFO_QUEUE_NB; i++)
+  {
+    vh_fifo_queue_pop (queue, &id, &data);
+    fail_unless (id == i, "entry %i expected, found %i", i, id);
+    fail_unless ((intptr_t) data == i + 1,
+                 "bad data for the entry %i", i);
+  }
+
+  vh_fifo_queue_free (queue);
+}
+END_TEST
+
+START_TEST (test_fifo_queue_moveup)
+{
+  unsigned int i;
+  int id;
+  void *data;
+  fifo_queue_t *queue;
+  /* the first one is in the ring, the second one in the overflow list */
+  const int moved[] = { 10, TEST_FIFO_QUEUE_NB - 10 };
+
+  queue = vh_fifo_queue_new ();
+  fail_if (!queue, "queue not created");
+
+  for (i = 0; i < TEST_FIFO_QUEUE_NB; i++)
+    vh_fifo_queue_push (queue, FIFO_QUEUE_PRIORITY_NORMAL,
+                        i, (void *) (intptr_t) (i + 1));
+
+  for (i = 0; i < sizeof (moved) / sizeof (*moved); i++)
+  {
+    void *tomove = (void *) (intptr_t) (moved[i] + 1);
+
+    data = vh_fifo_queue_search (queue, &id, tomove, test_fifo_queue_cmp);
+    fail_unless (data == tomove && id == moved[i],
+                 "entry %i not found", moved[i]);
+
+    vh_fifo_queue_moveup (queue, tomove, test_fifo_queue_cmp);
+  }
+
+  for (i = 0; i < sizeof (moved) / sizeof (*moved); i++)
+  {
+    vh_fifo_queue_pop (queue, &id, &data);
+    fail_unless (id == moved[i],
+                 "entry %i expected first, found %i", moved[i], id);
+  }
+
+  /* the other entries are still in order */
+  for (i = 0; i < TEST_FIFO_QUEUE_NB - 2; i++)
+  {
+    int e = i;
+
+    if (e >= moved[0])
+      e++;
+    if (e >= moved[1])
+      e++;
+
+    vh_fifo_queue_pop (queue, &id, &data);
+    fail_unless (id == e, "entry %i expected, found %i", e, id);
+  }
+
+  vh_fifo_queue_free (queue);
+}
+END_TEST
+
+START_TEST (test_fifo_queue_trypop)
+{
+  int id, res;
+  void *data;
+  fifo_queue_t *queue;
+
+  queue = vh_fifo_queue_new ();
+  fail_if (!queue, "queue not created");
+
+  res = vh_fifo_queue_trypop (queue, &id, &data);
+  fail_unless (res == FIFO_QUEUE_ERROR_EMPTY, "the queue must be empty");
+
+  vh_fifo_queue_push (queue, FIFO_QUEUE_PRIORITY_NORMAL, 1, NULL);
+  vh_fifo_queue_push (queue, FIFO_QUEUE_PRIORITY_HIGH,   2, NULL);
+
+  res = vh_fifo_queue_trypop (queue, &id, &data);
+  fail_unless (res == FIFO_QUEUE_SUCCESS && id == 2,
+               "high priority entry expected, found %i", id);
+  res = vh_fifo_queue_trypop (queue, &id, &data);
+  fail_unless (res == FIFO_QUEUE_SUCCESS && id == 1,
+               "normal priority entry expected, found %i", id);
+
+  res = vh_fifo_queue_trypop (queue, &id, &data);
+  fail_unless (res == FIFO_QUEUE_ERROR_EMPTY, "the queue must be empty");
+
+  vh_fifo_queue_free (queue);
+}
+END_TEST
+
+void
+vh_test_fifo_queue (TCase *tc)
+{
+  tcase_add_test (tc, test_fifo_queue_order);
+  tcase_add_test (tc, test_fifo_queue_moveup);
+  tcase_add_test (tc, test_fifo_queue_trypop);
+}
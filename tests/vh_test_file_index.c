@@ -0,0 +1,165 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <check.h>
+
+#include "file_index.h"
+#include "vh_test.h"
+
+/* Enough entries for several resizes of the table. */
+#define TEST_FILE_INDEX_NB 5000
+
+static void
+test_file_index_path (char *buf, size_t size, int i)
+{
+  snprintf (buf, size, "/media/dir%i/file%i.ogg", i % 7, i);
+}
+
+static int
+test_file_index_odd (void *data, const char *path, file_index_data_t *fdata)
+{
+  int *nb = data;
+
+  (void) path;
+  (*nb)++;
+  return fdata->id & 1;
+}
+
+START_TEST (test_file_index_set_get)
+{
+  int i, res;
+  char path[64];
+  file_index_t *index;
+  file_index_data_t *fdata;
+
+  index = vh_file_index_new ();
+  fail_if (!index, "index not created");
+
+  for (i = 0; i < TEST_FILE_INDEX_NB; i++)
+  {
+    file_index_data_t d = { .id = i + 1, .mtime = i * 10, .interrupted = -1 };
+
+    test_file_index_path (path, sizeof (path), i);
+    res = vh_file_index_set (index, path, &d);
+    fail_unless (!res, "set %i has failed", i);
+  }
+
+  fail_unless (vh_file_index_count (index) == TEST_FILE_INDEX_NB,
+               "bad number of entries");
+  fail_unless (vh_file_index_memory (index) > 0, "bad memory use");
+
+  for (i = 0; i < TEST_FILE_INDEX_NB; i++)
+  {
+    test_file_index_path (path, sizeof (path), i);
+    fdata = vh_file_index_get (index, path);
+    fail_if (!fdata, "entry %i not found", i);
+    fail_unless (fdata->id == i + 1 && fdata->mtime == i * 10,
+                 "bad data for the entry %i", i);
+  }
+
+  fail_unless (!vh_file_index_get (index, "/media/unknown.ogg"),
+               "unknown entry found");
+
+  /* an existing entry is updated */
+  {
+    file_index_data_t d = { .id = 1, .mtime = 42, .interrupted = 0 };
+
+    test_file_index_path (path, sizeof (path), 0);
+    vh_file_index_set (index, path, &d);
+    fdata = vh_file_index_get (index, path);
+    fail_unless (fdata && fdata->mtime == 42 && !fdata->interrupted,
+                 "entry not updated");
+    fail_unless (vh_file_index_count (index) == TEST_FILE_INDEX_NB,
+                 "the update must not add an entry");
+  }
+
+  vh_file_index_free (index);
+}
+END_TEST
+
+START_TEST (test_file_index_del)
+{
+  int i, nb = 0;
+  char path[64];
+  size_t mem;
+  file_index_t *index;
+
+  index = vh_file_index_new ();
+  fail_if (!index, "index not created");
+
+  for (i = 0; i < TEST_FILE_INDEX_NB; i++)
+  {
+    file_index_data_t d = { .id = i };
+
+    test_file_index_path (path, sizeof (path), i);
+    vh_file_index_set (index, path, &d);
+  }
+
+  mem = vh_file_index_memory (index);
+
+  /* remove the odd ids */
+  vh_file_index_foreach (index, test_file_index_odd, &nb);
+  fail_unless (nb == TEST_FILE_INDEX_NB, "foreach has skipped entries");
+  fail_unless (vh_file_index_count (index) == TEST_FILE_INDEX_NB / 2,
+               "bad number of entries after foreach");
+  fail_unless (vh_file_index_memory (index) < mem, "memory not released");
+
+  for (i = 0; i < TEST_FILE_INDEX_NB; i++)
+  {
+    file_index_data_t *fdata;
+
+    test_file_index_path (path, sizeof (path), i);
+    fdata = vh_file_index_get (index, path);
+    fail_unless ((fdata == NULL) == (i & 1), "bad state for the entry %i", i);
+
+    /* the tombstones must not hide the remaining entries */
+    if (!(i & 1))
+      vh_file_index_del (index, path);
+  }
+
+  fail_unless (!vh_file_index_count (index), "the index must be empty");
+
+  /* the slots are reused */
+  for (i = 0; i < TEST_FILE_INDEX_NB; i++)
+  {
+    file_index_data_t d = { .id = i };
+
+    test_file_index_path (path, sizeof (path), i);
+    vh_file_index_set (index, path, &d);
+    fail_if (!vh_file_index_get (index, path), "entry %i not found", i);
+  }
+
+  fail_unless (vh_file_index_count (index) == TEST_FILE_INDEX_NB,
+               "bad number of entries");
+
+  vh_file_index_free (index);
+}
+END_TEST
+
+void
+vh_test_file_index (TCase *tc)
+{
+  tcase_add_test (tc, test_file_index_set_get);
+  tcase_add_test (tc, test_file_index_del);
+}
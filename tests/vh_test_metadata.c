@@ -0,0 +1,147 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <check.h>
+
+#include "valhalla.h"
+#include "metadata.h"
+#include "vh_test.h"
+
+#define TEST_METADATA_THREADS 4
+#define TEST_METADATA_NAMES   1000
+
+START_TEST (test_metadata_atom)
+{
+  const metadata_atom_t *atom, *atom2;
+
+  atom = vh_metadata_atom_get (VALHALLA_METADATA_TITLE);
+  fail_if (!atom, "atom not created");
+  fail_unless (!strcmp (atom->name, VALHALLA_METADATA_TITLE)
+               && atom->id, "bad atom");
+  fail_unless (atom->group == VALHALLA_META_GRP_TITLES, "bad group");
+
+  /* the same atom for all the cases */
+  atom2 = vh_metadata_atom_get ("TiTlE");
+  fail_unless (atom == atom2, "the atom must be the same");
+
+  atom2 = vh_metadata_atom_get ("test_metadata_unknown");
+  fail_if (!atom2 || atom2 == atom || atom2->id == atom->id,
+           "the atom must be new");
+  fail_unless (atom2->group == VALHALLA_META_GRP_MISCELLANEOUS,
+               "bad group for an unknown metadata");
+}
+END_TEST
+
+START_TEST (test_metadata_list)
+{
+  metadata_t *meta = NULL, *dup = NULL;
+  const metadata_t *tag = NULL;
+  const metadata_plist_t pl = {
+    .metadata = NULL,
+    .priority = VALHALLA_METADATA_PL_NORMAL
+  };
+
+  vh_metadata_add_auto (&meta, NULL, "ARTIST", "foo", VALHALLA_LANG_UNDEF, &pl);
+  vh_metadata_add_auto (&meta, NULL, "title", "bar", VALHALLA_LANG_UNDEF, &pl);
+  vh_metadata_add_auto (&meta, NULL, "Artist", "baz", VALHALLA_LANG_UNDEF, &pl);
+  fail_if (!meta, "no metadata");
+
+  fail_unless (!vh_metadata_get (meta, VALHALLA_METADATA_ARTIST, 0, &tag)
+               && !strcmp (tag->value, "foo")
+               && tag->name == tag->atom->name
+               && tag->group == VALHALLA_META_GRP_ENTITIES, "bad artist");
+  fail_unless (!vh_metadata_get (meta, VALHALLA_METADATA_ARTIST, 0, &tag)
+               && !strcmp (tag->value, "baz"), "bad second artist");
+  fail_unless (vh_metadata_get (meta, VALHALLA_METADATA_ARTIST, 0, &tag),
+               "only two artists");
+
+  tag = NULL;
+  fail_unless (vh_metadata_get (meta, "test_metadata_none", 0, &tag)
+               && !tag, "the metadata must not be found");
+
+  /* the names are compared with the lowercase names of the atoms */
+  fail_unless (vh_metadata_get (meta, "Artist", 0, &tag) && !tag
+               && vh_metadata_get (meta, "ART", METADATA_IGNORE_SUFFIX, &tag)
+               && !tag, "the name must be in lowercase");
+  fail_unless (!vh_metadata_get (meta, "art", METADATA_IGNORE_SUFFIX, &tag)
+               && !strcmp (tag->value, "foo"), "bad artist prefix");
+
+  vh_metadata_dup (&dup, meta);
+  tag = NULL;
+  fail_unless (!vh_metadata_get (dup, VALHALLA_METADATA_TITLE, 0, &tag)
+               && tag->atom == meta->next->atom
+               && !strcmp (tag->value, "bar"), "bad duplicated title");
+
+  vh_metadata_free (dup);
+  vh_metadata_free (meta);
+}
+END_TEST
+
+static void *
+test_metadata_thread (void *arg)
+{
+  int i;
+  const metadata_atom_t **atoms = arg;
+
+  for (i = 0; i < TEST_METADATA_NAMES; i++)
+  {
+    char name[64];
+
+    snprintf (name, sizeof (name), "test_metadata_thread_%i", i);
+    atoms[i] = vh_metadata_atom_get (name);
+  }
+
+  return NULL;
+}
+
+START_TEST (test_metadata_atom_threads)
+{
+  int i, j;
+  pthread_t th[TEST_METADATA_THREADS];
+  static const metadata_atom_t *atoms[TEST_METADATA_THREADS]
+                                     [TEST_METADATA_NAMES];
+
+  for (i = 0; i < TEST_METADATA_THREADS; i++)
+    pthread_create (&th[i], NULL, test_metadata_thread, atoms[i]);
+  for (i = 0; i < TEST_METADATA_THREADS; i++)
+    pthread_join (th[i], NULL);
+
+  for (j = 0; j < TEST_METADATA_NAMES; j++)
+  {
+    fail_if (!atoms[0][j], "atom not created");
+    for (i = 1; i < TEST_METADATA_THREADS; i++)
+      fail_unless (atoms[i][j] == atoms[0][j],
+                   "the atom must be the same for all the threads");
+  }
+}
+END_TEST
+
+void
+vh_test_metadata (TCase *tc)
+{
+  tcase_add_test (tc, test_metadata_atom);
+  tcase_add_test (tc, test_metadata_list);
+  tcase_add_test (tc, test_metadata_atom_threads);
+}
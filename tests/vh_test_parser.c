@@ -19,13 +19,19 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _GNU_SOURCE
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include <check.h>
 
 #include "vh_test.h"
+#include "utils.h"
+#include "osdep.h"
+#include "metadata.h"
 
 #include "parser.c"
 
@@ -58,9 +64,11 @@ START_TEST (test_parser_decrap_pattern)
   {
     unsigned int se = 0, ep = 0;
     char str[256];
+    parser_pattern_t pattern;
 
     snprintf (str, sizeof (str), "%s", list[i].str);
-    parser_decrap_pattern (str, list[i].bl, &se, &ep);
+    parser_decrap_pattern_compile (&pattern, list[i].bl);
+    parser_decrap_pattern (str, &pattern, &se, &ep);
     fail_unless (!strcmp (str, list[i].res),
                  "badly decrapified with %s (expected : %s, found : %s)",
                  list[i].bl, list[i].res, str);
@@ -74,8 +82,76 @@ START_TEST (test_parser_decrap_pattern)
 }
 END_TEST
 
+/*
+ * The keywords are applied in the order of the list, see the examples of
+ * VALHALLA_CFG_PARSER_KEYWORD. The strings are already decrapified.
+ */
+START_TEST (test_parser_decrap_blacklist)
+{
+  unsigned int i;
+  char *bl_list[] = {
+    "xvid", "foobar", "fileNUM", "sSEeEP", "divx", "SExEP", "NumEP",
+    "dvd", "dvdrip", "rip", "the end", NULL
+  };
+  const struct {
+    const char *str;  /* input string */
+    const char *res;  /* result string */
+    const char *se;
+    const char *ep;
+  } list[] = {
+    { " XvID Foobar  file01 My Movie s02e10",
+      "                     My Movie       ",            "2", "10"  },
+    { "My Movie 2 s02e10  5x3  ",
+      "My Movie 2              ",                        "2", "10"  },
+    { "The Episode   Pilot DivX  01x01  FooBar",
+      "The Episode   Pilot                    ",         "1", "1"   },
+    { " Name of the episode Num05",
+      " Name of the episode      ",                      NULL, "5"  },
+    { "Movie xvidxvid XVID xvid",
+      "Movie xvidxvid XVID xvid",                        NULL, NULL },
+    { "Movie dvdrip DVD",
+      "Movie        DVD",                                NULL, NULL },
+    { "Movie dvdrip rip",
+      "Movie           ",                                NULL, NULL },
+    { "The End of the end",
+      "        of the end",                              NULL, NULL },
+  };
+  parser_bl_t *bl;
+
+  bl = parser_bl_compile (bl_list);
+  fail_if (!bl, "blacklist not compiled");
+
+  for (i = 0; i < sizeof (list) / sizeof (*list); i++)
+  {
+    char str[256];
+    const metadata_t *tag;
+    metadata_t *meta = NULL;
+
+    snprintf (str, sizeof (str), "%s", list[i].str);
+    parser_decrap_blacklist (bl, str, &meta, NULL);
+    fail_unless (!strcmp (str, list[i].res),
+                 "badly decrapified (expected : %s, found : %s)",
+                 list[i].res, str);
+
+    tag = NULL;
+    fail_if (!list[i].se != !!vh_metadata_get (meta, "season", 0, &tag)
+             || (tag && strcmp (tag->value, list[i].se)),
+             "the season is not correct for %s", list[i].str);
+    tag = NULL;
+    fail_if (!list[i].ep != !!vh_metadata_get (meta, "episode", 0, &tag)
+             || (tag && strcmp (tag->value, list[i].ep)),
+             "the episode is not correct for %s", list[i].str);
+
+    vh_metadata_free (meta);
+  }
+
+  parser_bl_free (bl);
+}
+END_TEST
+
 void
 vh_test_parser (TCase *tc)
 {
   tcase_add_test (tc, test_parser_decrap_pattern);
+  tcase_add_test (tc, test_parser_decrap_blacklist);
 }
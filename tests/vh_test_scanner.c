@@ -0,0 +1,83 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <check.h>
+
+#include "vh_test.h"
+#include "utils.h"
+
+#include "scanner.c"
+
+START_TEST (test_scanner_suffixes)
+{
+  unsigned int i;
+  scanner_suffixes_t suffixes = { NULL, 0 };
+  const struct {
+    const char *file;
+    int         found;
+  } list[] = {
+    { "song.mp3",         1 },
+    { "Song.MP3",         1 },
+    { ".mp3",             1 },
+    { "archive.tar.gz",   1 },
+    { "archive.gz",       0 },
+    { "song.mp3.part",    0 },
+    { "songmp3",          0 },
+    { "/media/dir.mp3/x", 0 },
+    { "/media/dir.ogg/x", 0 },
+    { "/media/dir/x.ogg", 1 },
+  };
+
+  fail_if (!scanner_suffixes_get (&suffixes, "song.mp3"),
+           "the empty set must not accept a suffix");
+
+  fail_unless (!scanner_suffixes_add (&suffixes, "ogg")
+               && !scanner_suffixes_add (&suffixes, "MP3")
+               && !scanner_suffixes_add (&suffixes, "tar.gz"),
+               "suffix not added");
+  fail_unless (scanner_suffixes_add (&suffixes, "Mp3") == 1,
+               "the suffix must be already in the set");
+
+  /* the suffixes are saved in lowercase and sorted */
+  fail_unless (suffixes.nb == 3
+               && !strcmp (suffixes.list[0], "mp3")
+               && !strcmp (suffixes.list[1], "ogg")
+               && !strcmp (suffixes.list[2], "tar.gz"), "bad set");
+
+  for (i = 0; i < sizeof (list) / sizeof (*list); i++)
+    fail_unless (!scanner_suffixes_get (&suffixes, list[i].file)
+                 == !!list[i].found, "bad suffix for %s", list[i].file);
+
+  scanner_suffixes_free (&suffixes);
+  fail_unless (!suffixes.list && !suffixes.nb, "the set must be empty");
+}
+END_TEST
+
+void
+vh_test_scanner (TCase *tc)
+{
+  tcase_add_test (tc, test_scanner_suffixes);
+}
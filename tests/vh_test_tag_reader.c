@@ -0,0 +1,398 @@
+/*
+ * GeeXboX Valhalla: tiny media scanner API.
+ * Copyright (C) 2026 Mathieu Schroeter <mathieu@schroetersa.ch>
+ *
+ * This file is part of libvalhalla.
+ *
+ * libvalhalla is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libvalhalla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libvalhalla; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <check.h>
+
+#include "valhalla.h"
+#include "metadata.h"
+#include "tag_reader.h"
+#include "vh_test.h"
+
+/* The files are built in memory, then written in the current directory. */
+#define TEST_TAG_READER_FILE "vh_test_tag_reader"
+
+typedef struct test_tag_buf_s {
+  unsigned char data[8192];
+  size_t        len;
+} test_tag_buf_t;
+
+static void
+test_tag_put (test_tag_buf_t *buf, const void *data, size_t len)
+{
+  fail_unless (buf->len + len <= sizeof (buf->data), "buffer too small");
+  memcpy (buf->data + buf->len, data, len);
+  buf->len += len;
+}
+
+#define test_tag_str(buf, str) test_tag_put (buf, str, sizeof (str) - 1)
+
+static void
+test_tag_be32 (test_tag_buf_t *buf, unsigned int v)
+{
+  unsigned char b[4] = { v >> 24, v >> 16, v >> 8, v };
+  test_tag_put (buf, b, 4);
+}
+
+static void
+test_tag_le32 (test_tag_buf_t *buf, unsigned int v)
+{
+  unsigned char b[4] = { v, v >> 8, v >> 16, v >> 24 };
+  test_tag_put (buf, b, 4);
+}
+
+/* Two frames MPEG-1 Layer III, 128 kb/s, 44100 Hz. */
+static void
+test_tag_mpa (test_tag_buf_t *buf)
+{
+  int i;
+  unsigned char frame[417] = { 0xFF, 0xFB, 0x90, 0x00 };
+
+  for (i = 0; i < 2; i++)
+    test_tag_put (buf, frame, sizeof (frame));
+}
+
+static void
+test_tag_id3v2_frame (test_tag_buf_t *buf,
+                      const char *id, const void *data, size_t len)
+{
+  test_tag_put (buf, id, 4);
+  test_tag_be32 (buf, len);
+  test_tag_put (buf, "\0\0", 2);
+  test_tag_put (buf, data, len);
+}
+
+static void
+test_tag_vorbis_comment (test_tag_buf_t *buf, const char *const *comments)
+{
+  unsigned int nb;
+
+  test_tag_le32 (buf, 4);
+  test_tag_str (buf, "test");
+
+  for (nb = 0; comments[nb]; nb++)
+    ;
+  test_tag_le32 (buf, nb);
+
+  for (; *comments; comments++)
+  {
+    test_tag_le32 (buf, strlen (*comments));
+    test_tag_put (buf, *comments, strlen (*comments));
+  }
+}
+
+static void
+test_tag_mp4_atom (test_tag_buf_t *buf, const char *type,
+                   const test_tag_buf_t *payload)
+{
+  test_tag_be32 (buf, payload->len + 8);
+  test_tag_put (buf, type, 4);
+  test_tag_put (buf, payload->data, payload->len);
+}
+
+static metadata_t *
+test_tag_read (const test_tag_buf_t *buf, const char *suffix, int *res)
+{
+  FILE *f;
+  char file[64];
+  metadata_t *meta = NULL;
+
+  snprintf (file, sizeof (file), "%s%s", TEST_TAG_READER_FILE, suffix);
+  f = fopen (file, "wb");
+  fail_if (!f, "file not created");
+  fwrite (buf->data, 1, buf->len, f);
+  fclose (f);
+
+  *res = vh_tag_reader_get (file, &meta, NULL);
+  unlink (file);
+  return meta;
+}
+
+static void
+test_tag_check (const metadata_t *meta, const char *name, const char *value)
+{
+  const metadata_t *tag = NULL;
+
+  fail_if (vh_metadata_get (meta, name, 0, &tag), "%s not found", name);
+  fail_unless (!strcmp (tag->value, value),
+               "bad %s: '%s' instead of '%s'", name, tag->value, value);
+}
+
+START_TEST (test_tag_reader_id3v2)
+{
+  int res;
+  metadata_t *meta;
+  test_tag_buf_t buf, tag;
+  const metadata_t *t = NULL;
+  static const unsigned char artist[] = /* UTF-16 with BOM */
+    "\x01\xFF\xFE" "A\0r\0t\0i\0s\0t\0";
+
+  memset (&tag, 0, sizeof (tag));
+  test_tag_id3v2_frame (&tag, "TIT2", "\0Caf\xE9", 5);
+  test_tag_id3v2_frame (&tag, "TPE1", artist, sizeof (artist) - 1);
+  test_tag_id3v2_frame (&tag, "TRCK", "\x03" "3/12", 5);
+  test_tag_id3v2_frame (&tag, "TCON", "\0(17)", 5);
+  test_tag_id3v2_frame (&tag, "TYER", "\0" "2004", 5);
+  test_tag_id3v2_frame (&tag, "TXXX", "\0mood\0calm", 10);
+  test_tag_id3v2_frame (&tag, "APIC", "\0image/png", 10);
+  test_tag_put (&tag, "\0\0\0\0\0\0\0\0\0\0", 10); /* padding */
+
+  memset (&buf, 0, sizeof (buf));
+  test_tag_put (&buf, "ID3\x03\0\0", 6);
+  test_tag_put (&buf, (unsigned char []) {
+    tag.len >> 21 & 0x7F, tag.len >> 14 & 0x7F, tag.len >> 7 & 0x7F,
+    tag.len & 0x7F }, 4);
+  test_tag_put (&buf, tag.data, tag.len);
+  test_tag_mpa (&buf);
+
+  /* the suffix is useless with a ID3v2 tag */
+  meta = test_tag_read (&buf, ".bin", &res);
+  fail_unless (!res, "MP3 file not read");
+  test_tag_check (meta, VALHALLA_METADATA_TITLE,  "Caf\xC3\xA9");
+  test_tag_check (meta, VALHALLA_METADATA_ARTIST, "Artist");
+  test_tag_check (meta, VALHALLA_METADATA_TRACK,  "3/12");
+  test_tag_check (meta, VALHALLA_METADATA_GENRE,  "Rock");
+  test_tag_check (meta, VALHALLA_METADATA_DATE,   "2004");
+  test_tag_check (meta, "mood", "calm");
+  fail_unless (!vh_metadata_get (meta, VALHALLA_METADATA_TITLE, 0, &t)
+               && t->group == VALHALLA_META_GRP_TITLES, "bad group");
+  vh_metadata_free (meta);
+
+  /* truncated tag */
+  buf.len = 64;
+  meta = test_tag_read (&buf, ".mp3", &res);
+  fail_unless (res == -1 && !meta, "truncated tag must be for lavf");
+}
+END_TEST
+
+START_TEST (test_tag_reader_id3v1)
+{
+  int res;
+  metadata_t *meta;
+  test_tag_buf_t buf;
+  unsigned char tag[128];
+
+  memset (tag, 0, sizeof (tag));
+  memcpy (tag, "TAG", 3);
+  memcpy (tag + 3,  "Title   ", 8);
+  memcpy (tag + 33, "Artist", 6);
+  memcpy (tag + 93, "1999", 4);
+  tag[126] = 7;
+  tag[127] = 8;
+
+  memset (&buf, 0, sizeof (buf));
+  test_tag_mpa (&buf);
+  test_tag_put (&buf, tag, sizeof (tag));
+
+  /* only the suffix says that it is a MP3 file */
+  meta = test_tag_read (&buf, ".wav", &res);
+  fail_unless (res == -1 && !meta, "not a MP3 file");
+
+  meta = test_tag_read (&buf, ".mp3", &res);
+  fail_unless (!res, "MP3 file not read");
+  test_tag_check (meta, VALHALLA_METADATA_TITLE,  "Title");
+  test_tag_check (meta, VALHALLA_METADATA_ARTIST, "Artist");
+  test_tag_check (meta, VALHALLA_METADATA_DATE,   "1999");
+  test_tag_check (meta, VALHALLA_METADATA_TRACK,  "7");
+  test_tag_check (meta, VALHALLA_METADATA_GENRE,  "Jazz");
+  vh_metadata_free (meta);
+}
+END_TEST
+
+START_TEST (test_tag_reader_flac)
+{
+  int res;
+  metadata_t *meta;
+  test_tag_buf_t buf, comment;
+  unsigned char streaminfo[34] = { 0 };
+  const char *const comments[] = {
+    "TITLE=Song", "ALBUMARTIST=Band", "tracknumber=5",
+    "METADATA_BLOCK_PICTURE=AAAA", NULL
+  };
+
+  memset (&comment, 0, sizeof (comment));
+  test_tag_vorbis_comment (&comment, comments);
+
+  memset (&buf, 0, sizeof (buf));
+  test_tag_str (&buf, "fLaC");
+  test_tag_be32 (&buf, sizeof (streaminfo)); /* STREAMINFO */
+  test_tag_put (&buf, streaminfo, sizeof (streaminfo));
+  test_tag_be32 (&buf, 0x84000000 | comment.len); /* last, VORBIS_COMMENT */
+  test_tag_put (&buf, comment.data, comment.len);
+
+  meta = test_tag_read (&buf, ".flac", &res);
+  fail_unless (!res, "FLAC file not read");
+  test_tag_check (meta, VALHALLA_METADATA_TITLE, "Song");
+  test_tag_check (meta, "album_artist", "Band");
+  test_tag_check (meta, VALHALLA_METADATA_TRACK, "5");
+  fail_unless (vh_metadata_get (meta, "metadata_block_picture", 0,
+                                &(const metadata_t *) { NULL }),
+               "the pictures are not metadata");
+  vh_metadata_free (meta);
+}
+END_TEST
+
+START_TEST (test_tag_reader_ogg)
+{
+  int res;
+  unsigned int i;
+  metadata_t *meta;
+  test_tag_buf_t buf, tags;
+  const char *const comments[] = { "TITLE=Opus", "ARTIST=Voice", NULL };
+
+  memset (&tags, 0, sizeof (tags));
+  test_tag_str (&tags, "OpusTags");
+  test_tag_vorbis_comment (&tags, comments);
+
+  memset (&buf, 0, sizeof (buf));
+  for (i = 0; i < 2; i++)
+  {
+    unsigned char hdr[27] = { 'O', 'g', 'g', 'S', 0, i ? 0x00 : 0x02 };
+
+    hdr[14] = 0x42; /* serial */
+    hdr[18] = i;    /* sequence */
+    hdr[26] = 1;
+    test_tag_put (&buf, hdr, sizeof (hdr));
+    if (!i)
+    {
+      test_tag_put (&buf, (unsigned char []) { 19 }, 1);
+      test_tag_str (&buf, "OpusHead\x01\x02\0\0\x80\xBB\0\0\0\0\0");
+    }
+    else
+    {
+      test_tag_put (&buf, (unsigned char []) { tags.len }, 1);
+      test_tag_put (&buf, tags.data, tags.len);
+    }
+  }
+
+  meta = test_tag_read (&buf, ".opus", &res);
+  fail_unless (!res, "Ogg file not read");
+  test_tag_check (meta, VALHALLA_METADATA_TITLE,  "Opus");
+  test_tag_check (meta, VALHALLA_METADATA_ARTIST, "Voice");
+  vh_metadata_free (meta);
+}
+END_TEST
+
+static void
+test_tag_mp4 (test_tag_buf_t *buf, const char *handler)
+{
+  test_tag_buf_t a, b, c;
+
+  memset (buf, 0, sizeof (*buf));
+  memset (&a, 0, sizeof (a));
+  test_tag_str (&a, "M4A \0\0\0\0M4A mp42isom");
+  test_tag_mp4_atom (buf, "ftyp", &a);
+
+  memset (&a, 0, sizeof (a));
+  test_tag_str (&a, "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0");
+  test_tag_mp4_atom (buf, "mdat", &a);
+
+  /* moov/trak/mdia/hdlr */
+  memset (&a, 0, sizeof (a));
+  test_tag_str (&a, "\0\0\0\0\0\0\0\0");
+  test_tag_put (&a, handler, 4);
+  test_tag_str (&a, "\0\0\0\0\0\0\0\0\0\0\0\0\0");
+  memset (&b, 0, sizeof (b));
+  test_tag_mp4_atom (&b, "hdlr", &a);
+  memset (&a, 0, sizeof (a));
+  test_tag_mp4_atom (&a, "mdia", &b);
+  memset (&c, 0, sizeof (c));
+  test_tag_mp4_atom (&c, "trak", &a);
+
+  /* moov/udta/meta/ilst */
+  memset (&a, 0, sizeof (a));
+  test_tag_str (&a, "\0\0\0\x01\0\0\0\0Album");
+  memset (&b, 0, sizeof (b));
+  test_tag_mp4_atom (&b, "data", &a);
+  memset (&a, 0, sizeof (a));
+  test_tag_mp4_atom (&a, "\xA9" "alb", &b);
+  memset (&b, 0, sizeof (b));
+  test_tag_str (&b, "\0\0\0\0\0\0\0\0\0\0\0\x02\0\x09\0\0");
+  {
+    test_tag_buf_t d;
+
+    memset (&d, 0, sizeof (d));
+    test_tag_mp4_atom (&d, "data", &b);
+    test_tag_mp4_atom (&a, "trkn", &d);
+  }
+  memset (&b, 0, sizeof (b));
+  test_tag_mp4_atom (&b, "ilst", &a);
+  memset (&a, 0, sizeof (a));
+  test_tag_str (&a, "\0\0\0\0");
+  test_tag_put (&a, b.data, b.len);
+  memset (&b, 0, sizeof (b));
+  test_tag_mp4_atom (&b, "meta", &a);
+  test_tag_mp4_atom (&c, "udta", &b);
+
+  /* the moov atom is after mdat */
+  test_tag_mp4_atom (buf, "moov", &c);
+}
+
+START_TEST (test_tag_reader_mp4)
+{
+  int res;
+  metadata_t *meta;
+  test_tag_buf_t buf;
+
+  test_tag_mp4 (&buf, "soun");
+  meta = test_tag_read (&buf, ".m4a", &res);
+  fail_unless (!res, "MP4 file not read");
+  test_tag_check (meta, VALHALLA_METADATA_ALBUM, "Album");
+  test_tag_check (meta, VALHALLA_METADATA_TRACK, "2/9");
+  vh_metadata_free (meta);
+
+  test_tag_mp4 (&buf, "vide");
+  meta = test_tag_read (&buf, ".mp4", &res);
+  fail_unless (res == -1 && !meta, "the videos must be for lavf");
+}
+END_TEST
+
+START_TEST (test_tag_reader_unknown)
+{
+  int res;
+  metadata_t *meta;
+  test_tag_buf_t buf;
+
+  memset (&buf, 0, sizeof (buf));
+  test_tag_str (&buf, "RIFF\0\0\0\0WAVEfmt \0\0\0\0");
+  meta = test_tag_read (&buf, ".wav", &res);
+  fail_unless (res == -1 && !meta, "unknown file must be for lavf");
+
+  meta = NULL;
+  fail_unless (vh_tag_reader_get ("/nonexistent.mp3", &meta, NULL) == -1
+               && !meta, "missing file must be for lavf");
+}
+END_TEST
+
+void
+vh_test_tag_reader (TCase *tc)
+{
+  tcase_add_test (tc, test_tag_reader_id3v2);
+  tcase_add_test (tc, test_tag_reader_id3v1);
+  tcase_add_test (tc, test_tag_reader_flac);
+  tcase_add_test (tc, test_tag_reader_ogg);
+  tcase_add_test (tc, test_tag_reader_mp4);
+  tcase_add_test (tc, test_tag_reader_unknown);
+}